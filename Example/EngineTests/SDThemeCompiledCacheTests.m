@@ -0,0 +1,236 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+// offsets in SDThemeCacheHeader: magic, formatVersion, libraryVersion[16], sourceHash[32], payloadLength, checksum
+#define HEADER_FORMAT_VERSION_OFFSET    4
+#define HEADER_CHECKSUM_OFFSET          64
+#define HEADER_LENGTH                   72
+
+@interface SDThemeCompiledCacheTests : XCTestCase
+
+@property (nonatomic, copy) NSString* directory;
+@property (nonatomic, strong) SDThemeCompiledCache* cache;
+@property (nonatomic, strong) NSDictionary* theme;
+@property (nonatomic, strong) NSData* sourceData;
+
+@end
+
+@implementation SDThemeCompiledCacheTests
+
+- (void) setUp
+{
+    [super setUp];
+    self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    self.cache = [[SDThemeCompiledCache alloc] initWithDirectory:self.directory maximumSize:1024 * 1024];
+    self.theme = @{ @"formatVersion": @2,
+                    @"Constants": @{ @"COLOR_TEXT": @"c:333333", @"DIMENSION_LARGE": @4294967296, @"DIMENSION_RATIO": @12.75, @"NEGATIVE": @-1 },
+                    @"Styles": @{ @"CommonLabel": @{ @"textColor": @"COLOR_TEXT", @"hidden": @NO, @"enabled": @YES, @"numberOfLines": @0 },
+                                  @"IconButton": @{ @"images": @[@"icon_normal", @"", @[@"nested"]], @"layer": @{ @"cornerRadius": @4 } },
+                                  @"UnicodeLabel": @{ @"text": @"Perché è così — ✓" },
+                                  @"Empty": @{} },
+                    @"Metadata": @{ @"date": [NSDate dateWithTimeIntervalSinceReferenceDate:510000000.5], @"data": [NSData dataWithBytes:"\x00\x01\xFF" length:3] } };
+    self.sourceData = [@"<plist>theme</plist>" dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    [super tearDown];
+}
+
+/**
+ * Entries are written and removed on a background queue: waits until the condition holds, for a few seconds at most.
+ */
+- (BOOL) waitForCondition:(BOOL (^)(void))condition
+{
+    NSDate* timeout = [NSDate dateWithTimeIntervalSinceNow:5];
+    while (!condition())
+    {
+        if (timeout.timeIntervalSinceNow < 0)
+        {
+            return NO;
+        }
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    return YES;
+}
+
+- (NSArray<NSString*>*) entryPaths
+{
+    NSMutableArray<NSString*>* paths = [NSMutableArray new];
+    for (NSString* name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directory error:nil])
+    {
+        if ([name.pathExtension isEqualToString:@"gtc"])
+        {
+            [paths addObject:[self.directory stringByAppendingPathComponent:name]];
+        }
+    }
+    return paths;
+}
+
+/**
+ * Stores the theme for the given source and waits for its entry to be written.
+ *
+ * @return the path of the entry
+ */
+- (NSString*) storeTheme:(NSDictionary*)theme forSourceData:(NSData*)sourceData
+{
+    NSSet<NSString*>* previousPaths = [NSSet setWithArray:[self entryPaths]];
+    [self.cache storeTheme:theme forSourceData:sourceData];
+    __block NSString* path = nil;
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        for (NSString* entryPath in [self entryPaths])
+        {
+            if (![previousPaths containsObject:entryPath])
+            {
+                path = entryPath;
+            }
+        }
+        return path != nil;
+    }]);
+    return path;
+}
+
+/**
+ * Rewrites the entry with the given byte modified and checks that it is discarded.
+ */
+- (void) assertEntryIsDiscardedFlippingByteAtOffset:(NSUInteger)offset
+{
+    NSString* path = [self storeTheme:self.theme forSourceData:self.sourceData];
+    NSMutableData* data = [NSMutableData dataWithContentsOfFile:path];
+    ((uint8_t*)data.mutableBytes)[offset] ^= 0x01;
+    [data writeToFile:path atomically:YES];
+    
+    XCTAssertNil([self.cache themeForSourceData:self.sourceData]);
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return ![[NSFileManager defaultManager] fileExistsAtPath:path];
+    }]);
+}
+
+#pragma mark Round trip
+
+- (void) testStoredThemeIsReadBack
+{
+    [self storeTheme:self.theme forSourceData:self.sourceData];
+    XCTAssertEqualObjects([self.cache themeForSourceData:self.sourceData], self.theme);
+    
+    // a new cache on the same directory, as at the next launch
+    SDThemeCompiledCache* cache = [[SDThemeCompiledCache alloc] initWithDirectory:self.directory maximumSize:1024 * 1024];
+    XCTAssertEqualObjects([cache themeForSourceData:self.sourceData], self.theme);
+}
+
+- (void) testChangedSourceMisses
+{
+    [self storeTheme:self.theme forSourceData:self.sourceData];
+    XCTAssertNil([self.cache themeForSourceData:[@"<plist>theme </plist>" dataUsingEncoding:NSUTF8StringEncoding]]);
+    XCTAssertNil([self.cache themeForSourceData:nil]);
+}
+
+- (void) testConventionValuesAreReadBackWithTheSameSignature
+{
+    NSDictionary* conventionValues = @{ @"c:333333": @[@0.2, @0.2, @0.2, @1], @"f:FONT_REGULAR,14": @{ @"name": @"HelveticaNeue", @"size": @14 } };
+    [self.cache storeTheme:self.theme conventionValues:conventionValues conventionSignature:@"bg:,c:,f:" forSourceData:self.sourceData];
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return [self entryPaths].count == 1;
+    }]);
+    
+    NSDictionary* values = nil;
+    XCTAssertEqualObjects([self.cache themeForSourceData:self.sourceData conventionSignature:@"bg:,c:,f:" conventionValues:&values], self.theme);
+    XCTAssertEqualObjects(values, conventionValues);
+    
+    // conventions registered since: the theme is still valid, the values are not
+    XCTAssertEqualObjects([self.cache themeForSourceData:self.sourceData conventionSignature:@"bg:,c:,f:,shadow:" conventionValues:&values], self.theme);
+    XCTAssertNil(values);
+}
+
+#pragma mark Invalid entries
+
+- (void) testEntryOfAnotherFormatVersionIsDiscarded
+{
+    [self assertEntryIsDiscardedFlippingByteAtOffset:HEADER_FORMAT_VERSION_OFFSET];
+}
+
+- (void) testEntryWithWrongChecksumIsDiscarded
+{
+    [self assertEntryIsDiscardedFlippingByteAtOffset:HEADER_CHECKSUM_OFFSET];
+}
+
+- (void) testEntryWithCorruptPayloadIsDiscarded
+{
+    [self assertEntryIsDiscardedFlippingByteAtOffset:HEADER_LENGTH + 10];
+}
+
+- (void) testTruncatedEntryIsDiscarded
+{
+    NSString* path = [self storeTheme:self.theme forSourceData:self.sourceData];
+    NSData* data = [NSData dataWithContentsOfFile:path];
+    [[data subdataWithRange:NSMakeRange(0, data.length - 1)] writeToFile:path atomically:YES];
+    
+    XCTAssertNil([self.cache themeForSourceData:self.sourceData]);
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return ![[NSFileManager defaultManager] fileExistsAtPath:path];
+    }]);
+}
+
+#pragma mark LRU cleanup
+
+- (void) testLeastRecentlyUsedEntriesAreRemoved
+{
+    NSData* sourceA = [@"A" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData* sourceB = [@"B" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData* sourceC = [@"C" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString* pathA = [self storeTheme:@{ @"name": @"A" } forSourceData:sourceA];
+    NSString* pathB = [self storeTheme:@{ @"name": @"B" } forSourceData:sourceB];
+    
+    // room for two entries of the same size
+    NSNumber* entrySize = nil;
+    [[NSURL fileURLWithPath:pathA] getResourceValue:&entrySize forKey:NSURLTotalFileAllocatedSizeKey error:nil];
+    self.cache.maximumSize = entrySize.unsignedIntegerValue * 5 / 2;
+    
+    // A is older than B, then it is used
+    NSFileManager* fileManager = [NSFileManager defaultManager];
+    [fileManager setAttributes:@{ NSFileModificationDate: [NSDate dateWithTimeIntervalSinceNow:-200] } ofItemAtPath:pathA error:nil];
+    [fileManager setAttributes:@{ NSFileModificationDate: [NSDate dateWithTimeIntervalSinceNow:-100] } ofItemAtPath:pathB error:nil];
+    XCTAssertEqualObjects([self.cache themeForSourceData:sourceA], @{ @"name": @"A" });
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return [[fileManager attributesOfItemAtPath:pathA error:nil].fileModificationDate timeIntervalSinceNow] > -50;
+    }]);
+    
+    NSString* pathC = [self storeTheme:@{ @"name": @"C" } forSourceData:sourceC];
+    XCTAssertTrue([self waitForCondition:^BOOL{
+        return ![fileManager fileExistsAtPath:pathB];
+    }]);
+    XCTAssertTrue([fileManager fileExistsAtPath:pathA]);
+    XCTAssertTrue([fileManager fileExistsAtPath:pathC]);
+    XCTAssertEqualObjects([self.cache themeForSourceData:sourceA], @{ @"name": @"A" });
+    XCTAssertNil([self.cache themeForSourceData:sourceB]);
+}
+
+- (void) testNothingIsStoredWithoutSize
+{
+    self.cache.maximumSize = 0;
+    [self.cache storeTheme:self.theme forSourceData:self.sourceData];
+    // the writes are serial: once the second entry is written the first one would be too
+    self.cache.maximumSize = 1024 * 1024;
+    [self storeTheme:@{ @"name": @"B" } forSourceData:[@"B" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqual([self entryPaths].count, (NSUInteger)1);
+    XCTAssertNil([self.cache themeForSourceData:self.sourceData]);
+}
+
+@end
@@ -0,0 +1,100 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+@interface SDThemeEnumRegistryTests : XCTestCase
+
+@property (nonatomic, strong) SDThemeEnumRegistry* registry;
+
+@end
+
+@implementation SDThemeEnumRegistryTests
+
+- (void) setUp
+{
+    [super setUp];
+    // a registry of its own, without the UIKit enums
+    self.registry = [SDThemeEnumRegistry new];
+    [self.registry registerEnumWithName:@"CardLayout" values:@{ @"compact": @0, @"regular": @1, @"expanded": @2 } optionSet:NO];
+    [self.registry registerEnumWithName:@"CardEdges" values:@{ @"top": @(1 << 0), @"left": @(1 << 1), @"bottom": @(1 << 2), @"right": @(1 << 3), @"far": @(1ULL << 40) } optionSet:YES];
+}
+
+#pragma mark Enums
+
+- (void) testCasesOfAnEnum
+{
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardLayout.regular"], @1);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardLayout.EXPANDED"], @2);
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayoutCompact"]);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardLayout.CardLayoutCompact"], @0);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@" CardLayout . regular "], @1);
+    XCTAssertEqualObjects([self.registry valueForCase:@"compact" ofEnum:@"CardLayout"], @0);
+    
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayout.missing"]);
+    XCTAssertNil([self.registry valueForSpecs:@"MissingEnum.compact"]);
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayout."]);
+    // "|" combines only the cases of option sets
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayout.compact|regular"]);
+}
+
+#pragma mark Option sets
+
+- (void) testOptionSetsCombineTheirCases
+{
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.top"], @1);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.top|bottom"], @5);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.top | Left | BOTTOM | right"], @15);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.CardEdgesTop|CardEdgesRight"], @9);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.left|left"], @2);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardEdges.far|top"], @((1ULL << 40) | 1));
+    XCTAssertEqualObjects([self.registry valueForCase:@"bottom|right" ofEnum:@"CardEdges"], @12);
+}
+
+- (void) testOptionSetsWithAnUnknownCaseAreNotResolved
+{
+    XCTAssertNil([self.registry valueForSpecs:@"CardEdges.top|middle"]);
+    XCTAssertNil([self.registry valueForSpecs:@"CardEdges.top|"]);
+    XCTAssertNil([self.registry valueForSpecs:@"CardEdges.|top"]);
+    XCTAssertNil([self.registry valueForSpecs:@"CardEdges.top||bottom"]);
+}
+
+#pragma mark Registration
+
+- (void) testInvalidTablesAreNotRegistered
+{
+    XCTAssertFalse([self.registry registerEnumWithName:@"" values:@{ @"a": @0 } optionSet:NO]);
+    XCTAssertFalse([self.registry registerEnumWithName:@"Card.Layout" values:@{ @"a": @0 } optionSet:NO]);
+    XCTAssertFalse([self.registry registerEnumWithName:@"Card|Layout" values:@{ @"a": @0 } optionSet:NO]);
+    XCTAssertFalse([self.registry registerEnumWithName:@"Empty" values:@{} optionSet:NO]);
+    XCTAssertFalse([self.registry registerEnumWithName:@"Strings" values:(NSDictionary*)@{ @"a": @"0" } optionSet:NO]);
+    XCTAssertEqualObjects(self.registry.names, (@[@"CardEdges", @"CardLayout"]));
+}
+
+- (void) testTablesAreReplacedAndUnregistered
+{
+    XCTAssertTrue([self.registry registerEnumWithName:@"CardLayout" values:@{ @"grid": @3 } optionSet:NO]);
+    XCTAssertEqualObjects([self.registry valueForSpecs:@"CardLayout.grid"], @3);
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayout.compact"]);
+    
+    [self.registry unregisterEnumWithName:@"CardLayout"];
+    [self.registry unregisterEnumWithName:@"CardEdges"];
+    XCTAssertNil([self.registry valueForSpecs:@"CardLayout.grid"]);
+    XCTAssertTrue(self.registry.empty);
+}
+
+@end
@@ -0,0 +1,158 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+@interface SDThemeExpressionTests : XCTestCase <SDThemeExpressionContext>
+
+@property (nonatomic, strong) NSDictionary<NSString*, id>* constants;
+
+@end
+
+@implementation SDThemeExpressionTests
+
+- (void) setUp
+{
+    [super setUp];
+    self.constants = @{ @"DIMENSION_BASE": @8,
+                        @"DIMENSION_TEXT": @"12",
+                        @"COLOR_BRAND": [SDThemeColorValue colorWithHexString:@"FF0000"],
+                        @"TEXT": @"plain text" };
+}
+
+- (id) valueForExpressionReference:(NSString*)reference
+{
+    return self.constants[reference];
+}
+
+- (SDThemeColorValue*) colorForExpressionLiteral:(NSString*)literal
+{
+    return [SDThemeColorValue colorWithHexString:literal];
+}
+
+/**
+ * Parses and evaluates the given expression string.
+ */
+- (id) valueOfExpression:(NSString*)string error:(NSError**)error
+{
+    SDThemeExpression* expression = [SDThemeExpression expressionWithString:string error:error];
+    return [expression evaluateWithContext:self error:error];
+}
+
+- (void) assertExpression:(NSString*)string failsWithCode:(SDThemeExpressionError)code
+{
+    NSError* error = nil;
+    XCTAssertNil([self valueOfExpression:string error:&error], @"%@", string);
+    XCTAssertEqualObjects(error.domain, SDThemeExpressionErrorDomain, @"%@", string);
+    XCTAssertEqual(error.code, code, @"%@", string);
+}
+
+#pragma mark Numbers
+
+- (void) testOperatorPrecedence
+{
+    XCTAssertEqualObjects([self valueOfExpression:@"= 2 + 3 * 4" error:nil], @14);
+    XCTAssertEqualObjects([self valueOfExpression:@"= (2 + 3) * 4" error:nil], @20);
+    XCTAssertEqualObjects([self valueOfExpression:@"= 10 - 4 - 3" error:nil], @3);
+    XCTAssertEqualObjects([self valueOfExpression:@"= 16 / 4 / 2" error:nil], @2);
+    XCTAssertEqualObjects([self valueOfExpression:@"= -2 * 3 + 1" error:nil], @-5);
+    XCTAssertEqualObjects([self valueOfExpression:@"= 1 - -1" error:nil], @2);
+    XCTAssertEqualObjects([self valueOfExpression:@"=DIMENSION_BASE*1.5+2" error:nil], @14);
+}
+
+- (void) testReferencesAndNumberFunctions
+{
+    XCTAssertEqualObjects([self valueOfExpression:@"= DIMENSION_TEXT + 1" error:nil], @13);
+    XCTAssertEqualObjects([self valueOfExpression:@"= max(DIMENSION_BASE, 10) - min(1, 2)" error:nil], @9);
+    XCTAssertEqualObjects([self valueOfExpression:@"= round(DIMENSION_BASE / 3)" error:nil], @3);
+    
+    SDThemeExpression* expression = [SDThemeExpression expressionWithString:@"= DIMENSION_BASE + max(DIMENSION_TEXT, DIMENSION_BASE)" error:nil];
+    XCTAssertEqualObjects(expression.references, ([NSSet setWithObjects:@"DIMENSION_BASE", @"DIMENSION_TEXT", nil]));
+}
+
+- (void) testDivisionByZero
+{
+    [self assertExpression:@"= 1 / 0" failsWithCode:SDThemeExpressionErrorType];
+    [self assertExpression:@"= DIMENSION_BASE / (2 - 2)" failsWithCode:SDThemeExpressionErrorType];
+    XCTAssertEqualObjects([self valueOfExpression:@"= 0 / 2" error:nil], @0);
+}
+
+#pragma mark Colors
+
+- (void) testColorFunctions
+{
+    XCTAssertEqualObjects([self valueOfExpression:@"= alpha(COLOR_BRAND, 0.5)" error:nil], [SDThemeColorValue colorWithRed:1 green:0 blue:0 alpha:0.5]);
+    XCTAssertEqualObjects([self valueOfExpression:@"= mix(#000000, #FFFFFF, 0.5)" error:nil], [SDThemeColorValue colorWithRed:0.5 green:0.5 blue:0.5 alpha:1]);
+    XCTAssertEqualObjects([self valueOfExpression:@"= lighten(COLOR_BRAND, 1.5)" error:nil], [SDThemeColorValue colorWithRed:1 green:1 blue:1 alpha:1]);
+    XCTAssertEqualObjects([self valueOfExpression:@"= darken(#FF000080, 1)" error:nil], [SDThemeColorValue colorWithRed:0 green:0 blue:0 alpha:128 / 255.0]);
+    [self assertExpression:@"= alpha(DIMENSION_BASE, 0.5)" failsWithCode:SDThemeExpressionErrorType];
+    [self assertExpression:@"= COLOR_BRAND + 1" failsWithCode:SDThemeExpressionErrorType];
+    [self assertExpression:@"= #GG0000" failsWithCode:SDThemeExpressionErrorSyntax];
+}
+
+#pragma mark Errors
+
+- (void) testSyntaxErrors
+{
+    for (NSString* string in @[@"= 2 +", @"= (2 + 3", @"= 2 3", @"= max(1, 2", @"= #", @"=", @"= 2 $ 3"])
+    {
+        [self assertExpression:string failsWithCode:SDThemeExpressionErrorSyntax];
+    }
+    NSError* error = nil;
+    XCTAssertNil([SDThemeExpression expressionWithString:@"2 + 3" error:&error]);
+    XCTAssertEqual(error.code, SDThemeExpressionErrorSyntax);
+}
+
+- (void) testUnknownFunctionsAndReferences
+{
+    [self assertExpression:@"= pow(2, 3)" failsWithCode:SDThemeExpressionErrorUnknownFunction];
+    [self assertExpression:@"= MISSING * 2" failsWithCode:SDThemeExpressionErrorUnknownReference];
+    [self assertExpression:@"= TEXT * 2" failsWithCode:SDThemeExpressionErrorType];
+}
+
+- (void) testFunctionArity
+{
+    [self assertExpression:@"= min(1)" failsWithCode:SDThemeExpressionErrorSyntax];
+    [self assertExpression:@"= round(1, 2)" failsWithCode:SDThemeExpressionErrorSyntax];
+    [self assertExpression:@"= mix(#000000, 0.5)" failsWithCode:SDThemeExpressionErrorSyntax];
+    [self assertExpression:@"= max()" failsWithCode:SDThemeExpressionErrorSyntax];
+}
+
+- (void) testCyclesBetweenConstantsAreReported
+{
+    NSDictionary* theme = @{ @"formatVersion": @2,
+                             @"Constants": @{ @"A": @"= B + 1",
+                                              @"B": @"= C * 2",
+                                              @"C": @"= A",
+                                              @"SELF": @"= SELF + 1",
+                                              @"AFTER_CYCLE": @"= A + 1",
+                                              @"VALID": @"= 1 + 2" } };
+    SDThemeResolver* resolver = [SDThemeResolver new];
+    resolver.themes = @[theme];
+    resolver.defaultTheme = theme;
+    [resolver resolveConstantExpressions];
+    
+    NSArray<NSError*>* cycleErrors = [resolver.constantExpressionErrors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"code == %ld", (long)SDThemeExpressionErrorCycle]];
+    XCTAssertEqual(cycleErrors.count, (NSUInteger)2);
+    for (NSString* name in @[@"A", @"B", @"C", @"SELF", @"AFTER_CYCLE"])
+    {
+        XCTAssertNil([resolver valueForConstantWithName:name], @"%@", name);
+    }
+    XCTAssertEqualObjects([resolver valueForConstantWithName:@"VALID"], @3);
+}
+
+@end
@@ -0,0 +1,256 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+#define BENCHMARK_GROUP_COUNT       12
+#define BENCHMARK_STYLES_PER_GROUP  500
+#define SAMPLE_COUNT                5
+
+@interface SDThemePlistReaderTests : XCTestCase
+
+@property (nonatomic, strong) SDThemePlistReader* reader;
+@property (nonatomic, strong) NSMutableArray<NSArray<NSString*>*>* duplicates;
+@property (nonatomic, strong) NSMutableArray<NSString*>* invalidKeys;
+
+@end
+
+@implementation SDThemePlistReaderTests
+
+- (void) setUp
+{
+    [super setUp];
+    self.reader = [[SDThemePlistReader alloc] initWithCopiedKeys:[NSSet setWithObjects:@"formatVersion", @"Constants", @"Rules", nil] mergedKey:@"Styles"];
+    self.duplicates = [NSMutableArray new];
+    self.invalidKeys = [NSMutableArray new];
+    __weak typeof(self) weakSelf = self;
+    self.reader.duplicateHandler = ^(NSString* key, NSString* group) {
+        [weakSelf.duplicates addObject:@[key, group]];
+    };
+    self.reader.invalidValueHandler = ^(NSString* key) {
+        [weakSelf.invalidKeys addObject:key];
+    };
+}
+
+- (NSData*) dataOfFixtureWithName:(NSString*)name
+{
+    NSString* path = [[NSBundle bundleForClass:[self class]] pathForResource:name ofType:@"plist"];
+    XCTAssertNotNil(path, @"missing fixture %@", name);
+    return [NSData dataWithContentsOfFile:path];
+}
+
+/**
+ * The theme expected from the reader, built from the whole property list: the copied keys as they are and the entries of the other dictionaries merged.
+ */
+- (NSDictionary*) expectedThemeWithData:(NSData*)data
+{
+    NSDictionary* plist = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:nil];
+    NSMutableDictionary* theme = [NSMutableDictionary new];
+    NSMutableDictionary* merged = [NSMutableDictionary new];
+    [plist enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
+        if ([key isEqualToString:@"formatVersion"] || [key isEqualToString:@"Constants"] || [key isEqualToString:@"Rules"])
+        {
+            theme[key] = value;
+        }
+        else if ([value isKindOfClass:[NSDictionary class]])
+        {
+            [merged addEntriesFromDictionary:value];
+        }
+    }];
+    theme[@"Styles"] = merged;
+    return theme;
+}
+
+#pragma mark Formats
+
+- (void) testXMLThemeEqualsThePropertyList
+{
+    NSData* data = [self dataOfFixtureWithName:@"theme_reader"];
+    NSDictionary* theme = [self.reader themeWithData:data];
+    XCTAssertNotNil(theme);
+    XCTAssertEqualObjects(theme, [self expectedThemeWithData:data]);
+    XCTAssertEqualObjects(theme[@"Styles"][@"UnicodeLabel"][@"text"], @"Perché è così — ✓");
+    XCTAssertEqualObjects(theme[@"Styles"][@"EscapedLabel"][@"text"], @"Tom & Jerry <3 \"quoted\"");
+    XCTAssertEqualObjects(self.invalidKeys, @[@"Author"]);
+    XCTAssertEqual(self.duplicates.count, (NSUInteger)0);
+}
+
+- (void) testBinaryThemeEqualsThePropertyList
+{
+    NSData* data = [self dataOfFixtureWithName:@"theme_reader_binary"];
+    NSDictionary* theme = [self.reader themeWithData:data];
+    XCTAssertNotNil(theme);
+    XCTAssertEqualObjects(theme, [self expectedThemeWithData:data]);
+    XCTAssertEqualObjects(theme, [self.reader themeWithData:[self dataOfFixtureWithName:@"theme_reader"]]);
+    XCTAssertEqualObjects(self.invalidKeys, (@[@"Author", @"Author"]));
+}
+
+- (void) testBinaryThemeWrittenByFoundationEqualsThePropertyList
+{
+    NSDictionary* plist = [NSPropertyListSerialization propertyListWithData:[self dataOfFixtureWithName:@"theme_reader"] options:NSPropertyListImmutable format:NULL error:nil];
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    XCTAssertEqualObjects([self.reader themeWithData:data], [self expectedThemeWithData:data]);
+}
+
+#pragma mark Invalid data
+
+- (void) testTruncatedAndCorruptBinaryPlistsAreRejected
+{
+    NSData* data = [self dataOfFixtureWithName:@"theme_reader_binary"];
+    XCTAssertNil([self.reader themeWithData:[data subdataWithRange:NSMakeRange(0, data.length / 2)]]);
+    XCTAssertNil([self.reader themeWithData:[data subdataWithRange:NSMakeRange(0, data.length - 1)]]);
+    XCTAssertNil([self.reader themeWithData:[data subdataWithRange:NSMakeRange(0, 8)]]);
+    XCTAssertNil([self.reader themeWithData:[NSData data]]);
+    
+    // the offset of the offset table, the last 8 bytes of the trailer, past the end of the data
+    NSMutableData* corrupt = [data mutableCopy];
+    memset((uint8_t*)corrupt.mutableBytes + corrupt.length - 8, 0x7F, 8);
+    XCTAssertNil([self.reader themeWithData:corrupt]);
+    
+    // the top object, the 8 bytes before it, out of the objects
+    corrupt = [data mutableCopy];
+    memset((uint8_t*)corrupt.mutableBytes + corrupt.length - 16, 0x7F, 8);
+    XCTAssertNil([self.reader themeWithData:corrupt]);
+}
+
+- (void) testEveryCorruptedByteIsHandled
+{
+    // a flipped byte can still give a valid plist (eg. in a string), but it must never crash the reader
+    NSData* data = [self dataOfFixtureWithName:@"theme_reader_binary"];
+    for (NSUInteger i = 0; i < data.length; i++)
+    {
+        NSMutableData* corrupt = [data mutableCopy];
+        ((uint8_t*)corrupt.mutableBytes)[i] ^= 0xFF;
+        [self.reader themeWithData:corrupt];
+    }
+}
+
+- (void) testTruncatedXMLPlistIsRejected
+{
+    NSData* data = [self dataOfFixtureWithName:@"theme_reader"];
+    XCTAssertNil([self.reader themeWithData:[data subdataWithRange:NSMakeRange(0, data.length / 2)]]);
+    XCTAssertNil([self.reader themeWithData:[@"<plist version=\"1.0\"><array/></plist>" dataUsingEncoding:NSUTF8StringEncoding]]);
+}
+
+#pragma mark Benchmark
+
+/**
+ * A theme of BENCHMARK_GROUP_COUNT groups of BENCHMARK_STYLES_PER_GROUP styles (6000 entries), with the repeated keys and values of a real theme.
+ */
+- (NSDictionary*) benchmarkTheme
+{
+    NSMutableDictionary* theme = [NSMutableDictionary new];
+    theme[@"formatVersion"] = @2;
+    theme[@"Constants"] = @{ @"COLOR_TEXT": @"c:333333", @"FONT_REGULAR": @"HelveticaNeue", @"DIMENSION_BASE": @8 };
+    for (NSUInteger group = 0; group < BENCHMARK_GROUP_COUNT; group++)
+    {
+        NSMutableDictionary* styles = [NSMutableDictionary new];
+        for (NSUInteger i = 0; i < BENCHMARK_STYLES_PER_GROUP; i++)
+        {
+            styles[[NSString stringWithFormat:@"Style_%lu_%lu", (unsigned long)group, (unsigned long)i]] = @{ @"_superstyle": @"BaseStyle",
+                                                                                                            @"textColor": @"COLOR_TEXT",
+                                                                                                            @"font": [NSString stringWithFormat:@"f:FONT_REGULAR,%lu", (unsigned long)(10 + i % 8)],
+                                                                                                            @"layer.cornerRadius": @(i % 5),
+                                                                                                            @"contentInset": @"edge:4,8,4,8" };
+        }
+        theme[[NSString stringWithFormat:@"Group%lu", (unsigned long)group]] = styles;
+    }
+    return theme;
+}
+
+/**
+ * @return the best time of a few reads of the data
+ */
+- (NSTimeInterval) bestTimeReadingData:(NSData*)data withBlock:(NSDictionary* (^)(NSData* data))read
+{
+    NSTimeInterval best = DBL_MAX;
+    for (NSUInteger i = 0; i < SAMPLE_COUNT; i++)
+    {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSDictionary* theme = read(data);
+        best = MIN(best, CFAbsoluteTimeGetCurrent() - start);
+        XCTAssertEqual([theme[@"Styles"] count], (NSUInteger)(BENCHMARK_GROUP_COUNT * BENCHMARK_STYLES_PER_GROUP));
+    }
+    return best;
+}
+
+- (void) compareReaderWithPropertyListSerializationInFormat:(NSPropertyListFormat)format name:(NSString*)name
+{
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:[self benchmarkTheme] format:format options:0 error:nil];
+    NSTimeInterval readerTime = [self bestTimeReadingData:data withBlock:^NSDictionary*(NSData* data) {
+        return [self.reader themeWithData:data];
+    }];
+    // what the manager did before the reader: the whole property list, then the groups merged
+    NSTimeInterval serializationTime = [self bestTimeReadingData:data withBlock:^NSDictionary*(NSData* data) {
+        return [self expectedThemeWithData:data];
+    }];
+    NSLog(@"%@ theme of %lu bytes: reader %.2f ms, property list and merge %.2f ms", name, (unsigned long)data.length, readerTime * 1e3, serializationTime * 1e3);
+    
+    // generous bound, the timings of a shared simulator are noisy
+    XCTAssertLessThan(readerTime, serializationTime * 2);
+}
+
+- (void) testBinaryReaderIsNotSlowerThanPropertyListSerialization
+{
+    [self compareReaderWithPropertyListSerializationInFormat:NSPropertyListBinaryFormat_v1_0 name:@"Binary"];
+}
+
+- (void) testXMLReaderIsNotSlowerThanPropertyListSerialization
+{
+    [self compareReaderWithPropertyListSerializationInFormat:NSPropertyListXMLFormat_v1_0 name:@"XML"];
+}
+
+- (void) testBinaryReaderPerformance
+{
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:[self benchmarkTheme] format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    [self measureBlock:^{
+        [self.reader themeWithData:data];
+    }];
+}
+
+#pragma mark Duplicates
+
+- (void) testFirstDuplicateKeyAcrossGroupsWins
+{
+    NSString* xml = @"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    @"<plist version=\"1.0\"><dict>"
+                    @"<key>formatVersion</key><integer>2</integer>"
+                    @"<key>Labels</key><dict><key>Shared</key><dict><key>alpha</key><real>1</real></dict></dict>"
+                    @"<key>Buttons</key><dict><key>Shared</key><dict><key>alpha</key><real>0.5</real></dict><key>Other</key><string>s:Shared</string></dict>"
+                    @"</dict></plist>";
+    NSDictionary* theme = [self.reader themeWithData:[xml dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqualObjects(theme[@"Styles"], (@{ @"Shared": @{ @"alpha": @1 }, @"Other": @"s:Shared" }));
+    XCTAssertEqualObjects(self.duplicates, (@[@[@"Shared", @"Buttons"]]));
+}
+
+- (void) testDuplicateKeyAcrossGroupsOfBinaryPlist
+{
+    NSDictionary* plist = @{ @"formatVersion": @2,
+                             @"Labels": @{ @"Shared": @{ @"alpha": @1 } },
+                             @"Buttons": @{ @"Shared": @{ @"alpha": @0.5 }, @"Other": @"s:Shared" } };
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    NSDictionary* theme = [self.reader themeWithData:data];
+    
+    // the order of the groups in the file is chosen by Foundation: the duplicate is reported in the group read last
+    XCTAssertEqual(self.duplicates.count, (NSUInteger)1);
+    XCTAssertEqualObjects(self.duplicates.firstObject.firstObject, @"Shared");
+    NSString* firstGroup = [self.duplicates.firstObject.lastObject isEqualToString:@"Labels"] ? @"Buttons" : @"Labels";
+    XCTAssertEqualObjects(theme[@"Styles"][@"Shared"], plist[firstGroup][@"Shared"]);
+    XCTAssertEqualObjects(theme[@"Styles"][@"Other"], @"s:Shared");
+}
+
+@end
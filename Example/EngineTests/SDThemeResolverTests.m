@@ -0,0 +1,222 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Linked only against Foundation and the Giotto/Engine subspec: nothing here may use UIKit.
+
+@import XCTest;
+@import Giotto;
+
+#define BENCHMARK_STYLE_COUNT   500
+
+@interface SDThemeResolverTests : XCTestCase
+
+@property (nonatomic, strong) SDThemeResolver* resolver;
+
+@end
+
+@implementation SDThemeResolverTests
+
+- (void) setUp
+{
+    [super setUp];
+    NSDictionary* defaultTheme = @{ @"formatVersion": @2,
+                                    @"Constants": @{ @"DIMENSION_BASE": @10,
+                                                     @"COLOR_BRAND": @"c:FF0000",
+                                                     @"COLOR_TEXT": @"c:333333",
+                                                     @"FONT_REGULAR": @"HelveticaNeue",
+                                                     @"DIMENSION_DOUBLE": @"= DIMENSION_BASE * 2",
+                                                     @"COLOR_BRAND_FADED": @"= alpha(COLOR_BRAND, 0.5)" },
+                                    @"Styles": @{ @"Base": @{ @"alpha": @1, @"textColor": @"COLOR_TEXT" },
+                                                  @"Title": @{ @"_superstyle": @"Base",
+                                                               @"font": @"f:FONT_REGULAR,DIMENSION_BASE",
+                                                               @"titleLabel.textColor": @"COLOR_BRAND" },
+                                                  @"Alias": @"s:Title" } };
+    NSDictionary* alternativeTheme = @{ @"formatVersion": @2,
+                                        @"Constants": @{ @"COLOR_TEXT": @"c:000000" },
+                                        @"Styles": @{ @"Base": @{ @"_inherit": @"Base", @"hidden": @NO } } };
+    self.resolver = [SDThemeResolver new];
+    self.resolver.themes = @[alternativeTheme, defaultTheme];
+    self.resolver.defaultTheme = defaultTheme;
+    [self.resolver resolveConstantExpressions];
+}
+
+- (SDThemeWrite*) writeWithKeyPath:(NSString*)keyPath target:(NSArray<NSString*>*)target inWrites:(NSArray<SDThemeWrite*>*)writes
+{
+    // the last write of a keyPath wins, as when it is committed
+    SDThemeWrite* found = nil;
+    for (SDThemeWrite* write in writes)
+    {
+        if ([write.keyPath isEqualToString:keyPath] && [write.target isEqualToArray:target])
+        {
+            found = write;
+        }
+    }
+    return found;
+}
+
+#pragma mark Layering
+
+- (void) testConstantsAreReadFromTheFirstLayerDefiningThem
+{
+    XCTAssertEqualObjects([self.resolver valueForConstantWithName:@"COLOR_TEXT"], [SDThemeColorValue colorWithHexString:@"000000"]);
+    XCTAssertEqualObjects([self.resolver valueForConstantWithName:@"DIMENSION_BASE"], @10);
+    XCTAssertNil([self.resolver valueForConstantWithName:@"MISSING"]);
+    XCTAssertEqualObjects([self.resolver constantValueForString:@"MISSING"], @"MISSING");
+}
+
+- (void) testDefaultThemeIsReadOnlyWhenAsked
+{
+    XCTAssertEqualObjects([self.resolver valueForKeyPath:@"Constants.COLOR_TEXT" fromDefaultTheme:YES], @"c:333333");
+    XCTAssertEqualObjects([self.resolver valueForKeyPath:@"Constants.COLOR_TEXT" fromDefaultTheme:NO], @"c:000000");
+}
+
+#pragma mark Conventions
+
+- (void) testConventionsProduceEngineValues
+{
+    XCTAssertEqualObjects([self.resolver valueForConventionalString:@"c:00FF0080"], [SDThemeColorValue colorWithRed:0 green:1 blue:0 alpha:128 / 255.0]);
+    XCTAssertEqualObjects([self.resolver valueForConventionalString:@"f:systemBold,DIMENSION_BASE"], [SDThemeFontValue fontWithName:@"systemBold" size:10]);
+    XCTAssertEqualObjects([self.resolver valueForConventionalString:@"size:10,20"], [SDThemeGeometryValue geometryWithType:SDThemeGeometryTypeSize string:@"10,20"]);
+    XCTAssertNil([self.resolver valueForConventionalString:@"null"]);
+    XCTAssertEqualObjects([self.resolver valueForConventionalString:@"plain text"], @"plain text");
+    
+    SDThemeBackgroundValue* background = [self.resolver valueForConventionalString:@"bg:COLOR_BRAND,DIMENSION_BASE,1,c:000000"];
+    XCTAssertTrue([background isKindOfClass:[SDThemeBackgroundValue class]]);
+    XCTAssertEqualObjects(background.fillColor, [SDThemeColorValue colorWithHexString:@"FF0000"]);
+    XCTAssertEqual(background.cornerRadius, 10.0);
+    XCTAssertEqual(background.borderWidth, 1.0);
+    XCTAssertEqualObjects(background.borderColor, [SDThemeColorValue colorWithHexString:@"000000"]);
+    XCTAssertNil(background.tintColor);
+}
+
+// fonts are shared by resolved name and size, whatever constants they are written with
+- (void) testEqualFontsAreInterned
+{
+    SDThemeFontValue* font = [self.resolver valueForConventionalString:@"f:FONT_REGULAR,DIMENSION_BASE"];
+    XCTAssertEqual([self.resolver valueForConventionalString:@"f:HelveticaNeue,10"], font);
+    XCTAssertNotEqual([self.resolver valueForConventionalString:@"f:HelveticaNeue,11"], font);
+}
+
+- (void) testNamedColorsAreLookedUpBeforeTheHexadecimalFormats
+{
+    // "BAD" is also a valid RGB string
+    self.resolver.namedColorProvider = ^SDThemeColorValue*(NSString* name) {
+        return [name isEqualToString:@"BAD"] ? [SDThemeColorValue colorWithName:name red:0.25 green:0.5 blue:0.75 alpha:1] : nil;
+    };
+    SDThemeColorValue* named = [self.resolver colorValueForString:@"BAD"];
+    XCTAssertEqualObjects(named.name, @"BAD");
+    XCTAssertEqual(named.green, 0.5);
+    XCTAssertNil([self.resolver colorValueForString:@"ACE"].name);
+    
+    self.resolver.namedColorProvider = nil;
+    XCTAssertNil([self.resolver colorValueForString:@"BAD"].name);
+}
+
+#pragma mark Expressions
+
+- (void) testExpressionsAreEvaluatedWithTheValuesOfTheLayers
+{
+    XCTAssertEqualObjects([self.resolver valueForConstantWithName:@"DIMENSION_DOUBLE"], @20);
+    XCTAssertEqualObjects([self.resolver valueForConstantWithName:@"COLOR_BRAND_FADED"], [SDThemeColorValue colorWithRed:1 green:0 blue:0 alpha:0.5]);
+    XCTAssertEqual(self.resolver.constantExpressionErrors.count, (NSUInteger)0);
+}
+
+#pragma mark Styles
+
+- (void) testStylesResolveIntoWritesWithTheirSuperstylesAndGraftedStyles
+{
+    NSArray<SDThemeWrite*>* writes = [self.resolver writesForStyleWithName:@"Title" variantStyleNames:@[]];
+    
+    // the superstyle comes from the alternative theme, that inherits from the default one; the constants are still read from the first layer
+    XCTAssertEqualObjects([self writeWithKeyPath:@"alpha" target:@[] inWrites:writes].value, @1);
+    XCTAssertEqualObjects([self writeWithKeyPath:@"hidden" target:@[] inWrites:writes].value, @NO);
+    XCTAssertEqualObjects([self writeWithKeyPath:@"textColor" target:@[] inWrites:writes].value, [SDThemeColorValue colorWithHexString:@"000000"]);
+    XCTAssertEqualObjects([self writeWithKeyPath:@"font" target:@[] inWrites:writes].value, [SDThemeFontValue fontWithName:@"HelveticaNeue" size:10]);
+    
+    SDThemeWrite* graftedWrite = [self writeWithKeyPath:@"textColor" target:@[@"titleLabel"] inWrites:writes];
+    XCTAssertEqualObjects(graftedWrite.value, [SDThemeColorValue colorWithHexString:@"FF0000"]);
+}
+
+- (void) testStyleConventionResolvesTheReferencedStyle
+{
+    NSDictionary* style = [self.resolver themeStyleForKey:@"Alias" fromDefaultTheme:NO];
+    XCTAssertEqualObjects(style[@"font"], @"f:FONT_REGULAR,DIMENSION_BASE");
+}
+
+- (void) testValueConverterIsAppliedToTheResolvedValues
+{
+    self.resolver.valueConverter = ^id(id value) {
+        return [value isKindOfClass:[SDThemeColorValue class]] ? @"converted" : value;
+    };
+    NSArray<SDThemeWrite*>* writes = [self.resolver writesForStyleWithName:@"Base" variantStyleNames:@[]];
+    XCTAssertEqualObjects([self writeWithKeyPath:@"textColor" target:@[] inWrites:writes].value, @"converted");
+    XCTAssertEqualObjects([self writeWithKeyPath:@"alpha" target:@[] inWrites:writes].value, @1);
+}
+
+#pragma mark Concurrency
+
+// the changes run as barriers on the queue of the reads, which see either the previous or the new layers
+- (void) testChangesRunAsBarriersOnTheResolutionQueue
+{
+    dispatch_queue_t queue = dispatch_queue_create("it.sysdata.giotto.tests.resolution", DISPATCH_QUEUE_CONCURRENT);
+    self.resolver.resolutionQueue = queue;
+    NSDictionary* theme = @{ @"formatVersion": @2, @"Constants": @{ @"DIMENSION_BASE": @20, @"DIMENSION_DOUBLE": @"= DIMENSION_BASE * 2" } };
+    dispatch_barrier_sync(queue, ^{
+        self.resolver.themes = @[theme];
+        self.resolver.defaultTheme = theme;
+        [self.resolver resolveConstantExpressions];
+    });
+    
+    __block id value = nil;
+    dispatch_sync(queue, ^{
+        value = [self.resolver valueForConstantWithName:@"DIMENSION_DOUBLE"];
+    });
+    XCTAssertEqualObjects(value, @40);
+}
+
+#pragma mark Benchmark
+
+- (void) testResolutionPerformance
+{
+    NSMutableDictionary* styles = [NSMutableDictionary new];
+    NSMutableArray<NSString*>* styleNames = [NSMutableArray new];
+    for (NSUInteger i = 0; i < BENCHMARK_STYLE_COUNT; i++)
+    {
+        NSString* name = [NSString stringWithFormat:@"Style%lu", (unsigned long)i];
+        styles[name] = @{ @"_superstyle": @"Base",
+                          @"font": [NSString stringWithFormat:@"f:FONT_REGULAR,%lu", (unsigned long)(10 + i % 8)],
+                          @"layer.cornerRadius": @"DIMENSION_DOUBLE",
+                          @"layer.borderColor": @"COLOR_BRAND_FADED",
+                          @"contentInset": @"edge:4,8,4,8" };
+        [styleNames addObject:name];
+    }
+    NSMutableDictionary* theme = [self.resolver.defaultTheme mutableCopy];
+    NSMutableDictionary* allStyles = [theme[@"Styles"] mutableCopy];
+    [allStyles addEntriesFromDictionary:styles];
+    theme[@"Styles"] = allStyles;
+    self.resolver.themes = @[theme];
+    [self.resolver resolveConstantExpressions];
+    
+    [self measureBlock:^{
+        NSUInteger writeCount = 0;
+        for (NSString* name in styleNames)
+        {
+            writeCount += [self.resolver writesForStyleWithName:name variantStyleNames:@[]].count;
+        }
+        XCTAssertGreaterThan(writeCount, (NSUInteger)0);
+    }];
+}
+
+@end
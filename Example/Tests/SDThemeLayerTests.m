@@ -0,0 +1,208 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+@import XCTest;
+@import Giotto;
+
+#define STYLE_COUNT     500
+#define LOOKUP_ROUNDS   20
+
+@interface SDThemeLayerTests : XCTestCase
+
+@property (nonatomic, strong) NSDictionary* sourceTheme;
+
+@end
+
+@implementation SDThemeLayerTests
+
+- (void) setUp
+{
+    [super setUp];
+    // a theme shaped like the real ones: styles with a few keys, constants referenced by name and nested dictionaries
+    NSMutableDictionary* styles = [NSMutableDictionary new];
+    for (NSUInteger i = 0; i < STYLE_COUNT; i++)
+    {
+        styles[[NSString stringWithFormat:@"Style%lu", (unsigned long)i]] = @{ @"textColor": @"COLOR_TEXT_COMMON",
+                                                                               @"font": [NSString stringWithFormat:@"font:FONT_REGULAR,%lu", (unsigned long)(10 + i % 8)],
+                                                                               @"numberOfLines": @(i % 3),
+                                                                               @"alpha": @0.5,
+                                                                               @"hidden": @NO,
+                                                                               @"layer": @{ @"cornerRadius": @4, @"borderWidth": @1 } };
+    }
+    self.sourceTheme = @{ @"formatVersion": @2, @"Constants": @{ @"COLOR_TEXT_COMMON": @"color:333333", @"FONT_REGULAR": @"HelveticaNeue" }, @"Styles": styles };
+}
+
+/**
+ * Reads every key of every style as the manager does when it resolves them.
+ */
+- (NSUInteger) lookUpAllStylesOfTheme:(NSDictionary*)theme
+{
+    NSUInteger found = 0;
+    for (NSUInteger round = 0; round < LOOKUP_ROUNDS; round++)
+    {
+        for (NSUInteger i = 0; i < STYLE_COUNT; i++)
+        {
+            NSDictionary* style = theme[@"Styles"][[NSString stringWithFormat:@"Style%lu", (unsigned long)i]];
+            for (NSString* key in @[@"textColor", @"font", @"numberOfLines", @"alpha", @"hidden"])
+            {
+                found += style[key] != nil;
+            }
+            found += style[@"layer"][@"cornerRadius"] != nil;
+        }
+    }
+    return found;
+}
+
+#pragma mark Materialization
+
+- (void) testRepeatedLookupsReturnTheSameObjects
+{
+    SDThemeLayer* layer = [SDThemeLayer layerWithTheme:self.sourceTheme name:@"test" sharingWithLayers:nil];
+    NSDictionary* theme = layer.dictionary;
+    
+    XCTAssertTrue(theme[@"Styles"] == theme[@"Styles"]);
+    NSDictionary* style = theme[@"Styles"][@"Style1"];
+    XCTAssertTrue(style == theme[@"Styles"][@"Style1"]);
+    XCTAssertTrue(style[@"layer"] == style[@"layer"]);
+    XCTAssertTrue(style[@"alpha"] == style[@"alpha"]);
+    XCTAssertTrue(style[@"textColor"] == theme[@"Styles"][@"Style2"][@"textColor"]);
+    XCTAssertEqualObjects(style[@"numberOfLines"], @1);
+}
+
+#pragma mark String table
+
+- (void) testStringsOfReleasedLayersAreRemoved
+{
+    SDThemeStringTable* table = [SDThemeStringTable sharedTable];
+    NSUInteger count = table.count;
+    NSString* uniqueString = [NSUUID UUID].UUIDString;
+    @autoreleasepool
+    {
+        SDThemeLayer* layer = [SDThemeLayer layerWithTheme:@{ @"Styles": @{ uniqueString: @{ @"text": [uniqueString stringByAppendingString:@"-value"] } } } name:@"test" sharingWithLayers:nil];
+        XCTAssertNotEqual([table existingIdentifierForString:uniqueString], SDThemeStringNotFound);
+        XCTAssertEqualObjects(layer.dictionary[@"Styles"][uniqueString][@"text"], [uniqueString stringByAppendingString:@"-value"]);
+        XCTAssertGreaterThanOrEqual(table.count, count + 2);
+    }
+    XCTAssertEqual([table existingIdentifierForString:uniqueString], SDThemeStringNotFound);
+    XCTAssertEqual(table.count, count);
+}
+
+- (void) testStringsSharedWithALiveLayerAreKept
+{
+    SDThemeStringTable* table = [SDThemeStringTable sharedTable];
+    NSString* uniqueString = [NSUUID UUID].UUIDString;
+    SDThemeLayer* liveLayer = [SDThemeLayer layerWithTheme:@{ @"Constants": @{ uniqueString: @1 } } name:@"live" sharingWithLayers:nil];
+    @autoreleasepool
+    {
+        [SDThemeLayer layerWithTheme:@{ @"Constants": @{ uniqueString: @2 } } name:@"released" sharingWithLayers:nil];
+    }
+    XCTAssertNotEqual([table existingIdentifierForString:uniqueString], SDThemeStringNotFound);
+    XCTAssertEqualObjects(liveLayer.dictionary[@"Constants"][uniqueString], @1);
+}
+
+#pragma mark Contents
+
+- (void) testCompactContentsEqualTheSourceTree
+{
+    NSDictionary* theme = @{ @"formatVersion": @2,
+                             @"Constants": @{ @"COLOR_TEXT": @"c:333333", @"DIMENSION_LARGE": @4294967296, @"DIMENSION_RATIO": @12.75, @"NEGATIVE": @-1 },
+                             @"Styles": @{ @"CommonLabel": @{ @"textColor": @"COLOR_TEXT", @"hidden": @NO, @"enabled": @YES, @"numberOfLines": @0 },
+                                           @"IconButton": @{ @"images": @[@"icon_normal", @"", @[@"nested", @{ @"key": @"value" }]], @"layer": @{ @"cornerRadius": @4 } },
+                                           @"UnicodeLabel": @{ @"text": @"Perché è così — ✓" },
+                                           @"Empty": @{ @"items": @[], @"values": @{} } },
+                             @"Metadata": @{ @"date": [NSDate dateWithTimeIntervalSinceReferenceDate:510000000], @"data": [NSData dataWithBytes:"\x00\x01\xFF" length:3] } };
+    NSDictionary* compactTheme = [SDThemeLayer layerWithTheme:theme name:@"test" sharingWithLayers:nil].dictionary;
+    
+    XCTAssertEqualObjects(compactTheme, theme);
+    XCTAssertEqualObjects(self.sourceTheme, [SDThemeLayer layerWithTheme:self.sourceTheme name:@"test" sharingWithLayers:nil].dictionary);
+    XCTAssertEqualObjects([NSSet setWithArray:compactTheme.allKeys], [NSSet setWithArray:theme.allKeys]);
+    XCTAssertEqual(compactTheme.count, theme.count);
+    XCTAssertNil(compactTheme[@"Missing"]);
+    
+    // the kinds of the numbers are kept, eg. for the setters of BOOL properties
+    NSNumber* hidden = compactTheme[@"Styles"][@"CommonLabel"][@"hidden"];
+    XCTAssertEqual(CFGetTypeID((__bridge CFTypeRef)hidden), CFBooleanGetTypeID());
+    XCTAssertTrue(CFNumberIsFloatType((__bridge CFNumberRef)compactTheme[@"Constants"][@"DIMENSION_RATIO"]));
+    XCTAssertEqual([compactTheme[@"Constants"][@"DIMENSION_LARGE"] longLongValue], 4294967296LL);
+}
+
+#pragma mark Sharing
+
+- (void) testIdenticalRecordsAreStoredOnce
+{
+    SDThemeLayerFootprint* footprint = [[SDThemeLayer layerWithTheme:self.sourceTheme name:@"test" sharingWithLayers:nil] footprint];
+    // the styles differ only by font size and number of lines: most of them are the same record
+    XCTAssertLessThan(footprint.recordCount, (NSUInteger)STYLE_COUNT);
+    XCTAssertEqual(footprint.sharedRecordCount, (NSUInteger)0);
+}
+
+- (void) testRecordsAreSharedAcrossLayers
+{
+    SDThemeLayer* defaultLayer = [SDThemeLayer layerWithTheme:self.sourceTheme name:@"default" sharingWithLayers:nil];
+    
+    // an identical layer references all the records of the other one
+    SDThemeLayer* identicalLayer = [SDThemeLayer layerWithTheme:self.sourceTheme name:@"identical" sharingWithLayers:@[defaultLayer]];
+    XCTAssertEqual(identicalLayer.footprint.recordCount, (NSUInteger)0);
+    XCTAssertGreaterThan(identicalLayer.footprint.sharedRecordCount, (NSUInteger)0);
+    XCTAssertEqualObjects(identicalLayer.dictionary, self.sourceTheme);
+    
+    // a layer overriding a style stores only the new records
+    NSMutableDictionary* styles = [self.sourceTheme[@"Styles"] mutableCopy];
+    styles[@"Style1"] = @{ @"textColor": @"COLOR_TEXT_COMMON", @"alpha": @0.75 };
+    NSMutableDictionary* theme = [self.sourceTheme mutableCopy];
+    theme[@"Styles"] = styles;
+    SDThemeLayer* alternativeLayer = [SDThemeLayer layerWithTheme:theme name:@"alternative" sharingWithLayers:@[defaultLayer]];
+    SDThemeLayerFootprint* footprint = alternativeLayer.footprint;
+    XCTAssertLessThan(footprint.recordCount, (NSUInteger)10);
+    XCTAssertGreaterThan(footprint.sharedRecordCount, (NSUInteger)0);
+    XCTAssertEqualObjects(alternativeLayer.dictionary, theme);
+}
+
+#pragma mark Performance
+
+// baseline: the lookups on the plist dictionaries, as before the compilation of the layers
+- (void) testPlainDictionaryLookupPerformance
+{
+    NSDictionary* theme = self.sourceTheme;
+    [self measureBlock:^{
+        XCTAssertEqual([self lookUpAllStylesOfTheme:theme], (NSUInteger)(LOOKUP_ROUNDS * STYLE_COUNT * 6));
+    }];
+}
+
+- (void) testCompactLayerLookupPerformance
+{
+    NSDictionary* theme = [SDThemeLayer layerWithTheme:self.sourceTheme name:@"test" sharingWithLayers:nil].dictionary;
+    [self measureBlock:^{
+        XCTAssertEqual([self lookUpAllStylesOfTheme:theme], (NSUInteger)(LOOKUP_ROUNDS * STYLE_COUNT * 6));
+    }];
+}
+
+- (void) testApplyStylePerformance
+{
+    SDThemeManager* manager = [SDThemeManager sharedManager];
+    NSMutableArray<UILabel*>* labels = [NSMutableArray new];
+    for (NSUInteger i = 0; i < 1000; i++)
+    {
+        [labels addObject:[UILabel new]];
+    }
+    [self measureBlock:^{
+        for (UILabel* label in labels)
+        {
+            [manager applyStyleWithName:@"CommonLabel" toObject:label];
+        }
+    }];
+}
+
+@end
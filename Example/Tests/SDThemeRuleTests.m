@@ -0,0 +1,148 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+#define ROW_COUNT       250
+#define SAMPLE_COUNT    5
+
+@interface SDThemeRuleTests : XCTestCase
+
+@property (nonatomic, copy) NSString* themePath;
+@property (nonatomic, strong) SDThemeManager* manager;
+
+@end
+
+@implementation SDThemeRuleTests
+
+- (void) setUp
+{
+    [super setUp];
+    NSDictionary* theme = @{ @"formatVersion": @2,
+                             @"Constants": @{ @"COLOR_RULE_TEXT": @"c:333333" },
+                             @"Styles": @{ @"RuleRow": @{ @"backgroundColor": @"c:FFFFFF" },
+                                           @"RuleLabel": @{ @"textColor": @"COLOR_RULE_TEXT" },
+                                           @"RuleTitle": @{ @"numberOfLines": @2 },
+                                           @"RuleButton": @{ @"alpha": @0.5 } },
+                             @"Rules": @{ @"UILabel": @"RuleLabel",
+                                          @".row": @"RuleRow",
+                                          @".row UILabel.title": @"RuleTitle",
+                                          @"#ruleButton": @"RuleButton" } };
+    self.themePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"theme_rules_test.plist"];
+    [theme writeToFile:self.themePath atomically:YES];
+    self.manager = [[SDThemeManager alloc] initWithIdentifier:@"rules-test"];
+    [self.manager setAlternativeThemesWithPaths:@[self.themePath]];
+}
+
+- (void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:self.themePath error:nil];
+    [super tearDown];
+}
+
+/**
+ * A list of rows, each one with a title, a subtitle and a button, like the content of a table.
+ */
+- (UIView*) hierarchyWithRowCount:(NSUInteger)rowCount
+{
+    UIView* root = [UIView new];
+    for (NSUInteger i = 0; i < rowCount; i++)
+    {
+        UIView* row = [UIView new];
+        row.themeStyleClass = @"row";
+        UILabel* title = [UILabel new];
+        title.themeStyleClass = @"title";
+        [row addSubview:title];
+        [row addSubview:[UILabel new]];
+        UIButton* button = [UIButton buttonWithType:UIButtonTypeSystem];
+        button.accessibilityIdentifier = @"ruleButton";
+        [row addSubview:button];
+        [root addSubview:row];
+    }
+    return root;
+}
+
+- (NSUInteger) viewCountOfHierarchy:(UIView*)view
+{
+    NSUInteger count = 1;
+    for (UIView* subview in view.subviews)
+    {
+        count += [self viewCountOfHierarchy:subview];
+    }
+    return count;
+}
+
+/**
+ * @return the best time of a few applications of the rules, divided by the number of views of the hierarchy.
+ */
+- (NSTimeInterval) timePerViewApplyingRulesToRowCount:(NSUInteger)rowCount
+{
+    UIView* root = [self hierarchyWithRowCount:rowCount];
+    // the first application warms up the index of the rules and the resolved styles
+    [self.manager applyStyleRulesToView:root];
+    NSTimeInterval best = DBL_MAX;
+    for (NSUInteger i = 0; i < SAMPLE_COUNT; i++)
+    {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [self.manager applyStyleRulesToView:root];
+        best = MIN(best, CFAbsoluteTimeGetCurrent() - start);
+    }
+    return best / [self viewCountOfHierarchy:root];
+}
+
+#pragma mark Matching
+
+- (void) testRulesAreAppliedToTheHierarchy
+{
+    UIView* root = [self hierarchyWithRowCount:1];
+    [self.manager applyStyleRulesToView:root];
+    
+    UIView* row = root.subviews[0];
+    UILabel* title = row.subviews[0];
+    UILabel* subtitle = row.subviews[1];
+    XCTAssertEqualObjects(row.backgroundColor, [UIColor colorWithRed:1 green:1 blue:1 alpha:1]);
+    XCTAssertEqual(title.numberOfLines, 2);
+    XCTAssertEqual(subtitle.numberOfLines, 1);
+    XCTAssertEqualObjects(subtitle.textColor, title.textColor);
+    XCTAssertEqualWithAccuracy(row.subviews[2].alpha, 0.5, 0.001);
+    XCTAssertEqualObjects([self.manager styleNamesMatchingView:title], (@[@"RuleLabel", @"RuleTitle"]));
+}
+
+#pragma mark Performance
+
+// the traversal checks only the candidate rules of each view: the time per view must not grow with the size of the hierarchy
+- (void) testRuleApplicationScalesLinearly
+{
+    NSTimeInterval timePerView = [self timePerViewApplyingRulesToRowCount:ROW_COUNT];
+    NSTimeInterval timePerViewDouble = [self timePerViewApplyingRulesToRowCount:ROW_COUNT * 2];
+    NSTimeInterval timePerViewQuadruple = [self timePerViewApplyingRulesToRowCount:ROW_COUNT * 4];
+    NSLog(@"Rules: %.2f, %.2f, %.2f µs per view", timePerView * 1e6, timePerViewDouble * 1e6, timePerViewQuadruple * 1e6);
+    
+    // generous bounds, the timings of a shared simulator are noisy
+    XCTAssertLessThan(timePerViewDouble, timePerView * 2);
+    XCTAssertLessThan(timePerViewQuadruple, timePerView * 2);
+}
+
+- (void) testApplyStyleRulesPerformance
+{
+    UIView* root = [self hierarchyWithRowCount:ROW_COUNT];
+    [self measureBlock:^{
+        [self.manager applyStyleRulesToView:root];
+    }];
+}
+
+@end
@@ -0,0 +1,139 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+@import XCTest;
+@import Giotto;
+
+#define SESSION_DIMENSION   @"session"
+#define LOGGED_VARIANT      @"LOGGED"
+#define GUEST_VARIANT       @"GUEST"
+
+@interface SDThemeVariantTests : XCTestCase
+
+@property (nonatomic, copy) NSString* themePath;
+@property (nonatomic, strong) SDThemeManager* manager;
+
+@end
+
+@implementation SDThemeVariantTests
+
+- (void) setUp
+{
+    [super setUp];
+    NSDictionary* theme = @{ @"formatVersion": @2,
+                             @"Styles": @{ @"VariantLabel": @{ @"textColor": @"c:000000", @"numberOfLines": @1 },
+                                           @"VariantLabel_LOGGED": @{ @"_variantOf": @"VariantLabel", @"textColor": @"c:FF0000" },
+                                           @"Banner": @{ @"numberOfLines": @1 },
+                                           @"Banner_GUEST": @{ @"numberOfLines": @3 } } };
+    self.themePath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"theme_variants_test.plist"];
+    [theme writeToFile:self.themePath atomically:YES];
+    self.manager = [[SDThemeManager alloc] initWithIdentifier:@"variants-test"];
+    [self.manager setAlternativeThemesWithPaths:@[self.themePath]];
+    [self.manager registerVariantDimension:SESSION_DIMENSION withValues:@[LOGGED_VARIANT, GUEST_VARIANT]];
+}
+
+- (void) tearDown
+{
+    [self.manager resetModifies];
+    [[NSFileManager defaultManager] removeItemAtPath:self.themePath error:nil];
+    [super tearDown];
+}
+
+- (UILabel*) labelWithStyleName:(NSString*)styleName
+{
+    UILabel* label = [UILabel new];
+    [self.manager applyStyleWithName:styleName toObject:label];
+    return label;
+}
+
+#pragma mark Selection
+
+- (void) testVariantMatchingTheCurrentValueIsApplied
+{
+    XCTAssertEqualObjects([self labelWithStyleName:@"VariantLabel"].textColor, [UIColor colorWithRed:0 green:0 blue:0 alpha:1]);
+    
+    [self.manager setVariant:LOGGED_VARIANT forDimension:SESSION_DIMENSION];
+    UILabel* label = [self labelWithStyleName:@"VariantLabel"];
+    XCTAssertEqualObjects(label.textColor, [UIColor colorWithRed:1 green:0 blue:0 alpha:1]);
+    XCTAssertEqual(label.numberOfLines, 1);
+    XCTAssertEqualObjects([self.manager resolvedStyleWithName:@"VariantLabel"].variantStyleNames, @[@"VariantLabel_LOGGED"]);
+}
+
+// a style is a variant only if it declares its base style in "_variantOf"
+- (void) testStyleWithoutMarkerIsNotAVariant
+{
+    NSSet<NSString*>* affectedStyles = [self.manager setVariant:GUEST_VARIANT forDimension:SESSION_DIMENSION];
+    XCTAssertFalse([affectedStyles containsObject:@"Banner"]);
+    XCTAssertEqual([self labelWithStyleName:@"Banner"].numberOfLines, 1);
+    XCTAssertEqual([self labelWithStyleName:@"Banner_GUEST"].numberOfLines, 3);
+}
+
+#pragma mark Invalidation
+
+- (void) testResolvedStyleIsReused
+{
+    SDThemeResolvedStyle* resolvedStyle = [self.manager resolvedStyleWithName:@"VariantLabel"];
+    XCTAssertEqual([self.manager resolvedStyleWithName:@"VariantLabel"], resolvedStyle);
+    [self labelWithStyleName:@"VariantLabel"];
+    XCTAssertEqual([self.manager resolvedStyleWithName:@"VariantLabel"], resolvedStyle);
+}
+
+- (void) testVariantChangeInvalidatesResolvedStyle
+{
+    [self.manager setVariant:LOGGED_VARIANT forDimension:SESSION_DIMENSION];
+    SDThemeResolvedStyle* resolvedStyle = [self.manager resolvedStyleWithName:@"VariantLabel"];
+    
+    NSSet<NSString*>* affectedStyles = [self.manager setVariant:GUEST_VARIANT forDimension:SESSION_DIMENSION];
+    XCTAssertTrue([affectedStyles containsObject:@"VariantLabel"]);
+    XCTAssertNotEqual([self.manager resolvedStyleWithName:@"VariantLabel"], resolvedStyle);
+    XCTAssertEqualObjects([self labelWithStyleName:@"VariantLabel"].textColor, [UIColor colorWithRed:0 green:0 blue:0 alpha:1]);
+    
+    [self.manager setVariant:LOGGED_VARIANT forDimension:SESSION_DIMENSION];
+    XCTAssertEqualObjects([self labelWithStyleName:@"VariantLabel"].textColor, [UIColor colorWithRed:1 green:0 blue:0 alpha:1]);
+}
+
+- (void) testThemeChangeInvalidatesResolvedStyle
+{
+    [self.manager setVariant:LOGGED_VARIANT forDimension:SESSION_DIMENSION];
+    [self labelWithStyleName:@"VariantLabel"];
+    
+    [self.manager modifyStlye:@"VariantLabel_LOGGED" forKeyPath:@"textColor" withValue:@"c:0000FF"];
+    XCTAssertEqualObjects([self labelWithStyleName:@"VariantLabel"].textColor, [UIColor colorWithRed:0 green:0 blue:1 alpha:1]);
+}
+
+// a variant change is a change of the themes for everything resolved with a generation
+- (void) testVariantChangeStartsANewGeneration
+{
+    SDThemeResolvedStyle* resolvedStyle = [self.manager resolvedStyleWithName:@"Banner"];
+    XCTAssertEqualObjects([self.manager textAttributesForStyleWithName:@"VariantLabel"][NSForegroundColorAttributeName], [UIColor colorWithRed:0 green:0 blue:0 alpha:1]);
+    
+    [self.manager setVariant:LOGGED_VARIANT forDimension:SESSION_DIMENSION];
+    XCTAssertGreaterThan([self.manager resolvedStyleWithName:@"Banner"].generation, resolvedStyle.generation);
+    XCTAssertEqualObjects([self.manager textAttributesForStyleWithName:@"VariantLabel"][NSForegroundColorAttributeName], [UIColor colorWithRed:1 green:0 blue:0 alpha:1]);
+}
+
+// a variant declared at runtime is indexed as soon as its marker is set
+- (void) testVariantDeclaredAtRuntimeIsApplied
+{
+    [self.manager setVariant:GUEST_VARIANT forDimension:SESSION_DIMENSION];
+    [self labelWithStyleName:@"VariantLabel"];
+    
+    [self.manager modifyStlye:@"VariantLabel_GUEST" forKeyPath:@"numberOfLines" withValue:@4];
+    [self.manager modifyStlye:@"VariantLabel_GUEST" forKeyPath:@"_variantOf" withValue:@"VariantLabel"];
+    XCTAssertEqual([self labelWithStyleName:@"VariantLabel"].numberOfLines, 4);
+}
+
+@end
@@ -14,6 +14,22 @@
 
 #import <QuartzCore/QuartzCore.h>
 
+/**
+ * Layer keys that let a theme express shadows, corners and rasterization without an offscreen rendering pass:
+ *
+ * - automaticShadowPath: if YES the shadowPath is a rounded rect built from the bounds and the cornerRadius of the layer, and it is rebuilt when the layer is laid out after a change of its bounds and when the theme writes its cornerRadius. Without a shadowPath Core Animation renders the layer offscreen to find the shape of the shadow.
+ * - rasterize: shouldRasterize, with the rasterizationScale of the main screen instead of the default 1.
+ * - continuousCorners: uses the continuous corner curve (iOS 13 and later, ignored on previous versions).
+ */
 @interface CALayer (ThemeManager)
 
+@property (nonatomic, assign) BOOL automaticShadowPath;
+@property (nonatomic, assign) BOOL rasterize;
+@property (nonatomic, assign) BOOL continuousCorners;
+
+/**
+ * Rebuilds the shadowPath if automaticShadowPath is YES and the bounds or the cornerRadius changed since the last time. It is called on layout; call it after changing the cornerRadius outside the theme manager.
+ */
+- (void) updateAutomaticShadowPath;
+
 @end
@@ -14,9 +14,130 @@
 
 #import "CALayer+ThemeManager.h"
 #import "NSObject+ThemeManager.h"
+#import <UIKit/UIKit.h>
+#import <objc/runtime.h>
+
+static char SDThemeAutomaticShadowPathKey;
+
+/**
+ * Geometry the automatic shadowPath of a layer was built from.
+ */
+@interface SDThemeShadowPathGeometry : NSObject
+
+@property (nonatomic, assign) CGRect bounds;
+@property (nonatomic, assign) CGFloat cornerRadius;
+@property (nonatomic, assign) BOOL valid;
+
+@end
+
+@implementation SDThemeShadowPathGeometry
+@end
+
 
 @implementation CALayer (ThemeManager)
 
+#pragma mark - Layout
+
+/**
+ * Hooks layoutSublayers, the first time a layer asks for an automatic shadowPath, to follow the changes of its bounds.
+ */
++ (void) installAutomaticShadowPathHook
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        Method original = class_getInstanceMethod(self, @selector(layoutSublayers));
+        Method replacement = class_getInstanceMethod(self, @selector(sd_theme_layoutSublayers));
+        method_exchangeImplementations(original, replacement);
+    });
+}
+
+- (void) sd_theme_layoutSublayers
+{
+    // after the exchange it calls the original implementation
+    [self sd_theme_layoutSublayers];
+    [self updateAutomaticShadowPath];
+}
+
+- (void) updateAutomaticShadowPath
+{
+    SDThemeShadowPathGeometry* geometry = objc_getAssociatedObject(self, &SDThemeAutomaticShadowPathKey);
+    if (!geometry)
+    {
+        return;
+    }
+    
+    CGRect bounds = self.bounds;
+    CGFloat cornerRadius = self.cornerRadius;
+    if (geometry.valid && CGRectEqualToRect(geometry.bounds, bounds) && geometry.cornerRadius == cornerRadius)
+    {
+        return;
+    }
+    geometry.bounds = bounds;
+    geometry.cornerRadius = cornerRadius;
+    geometry.valid = YES;
+    
+    UIBezierPath* path = cornerRadius > 0.0 ? [UIBezierPath bezierPathWithRoundedRect:bounds cornerRadius:cornerRadius] : [UIBezierPath bezierPathWithRect:bounds];
+    self.shadowPath = path.CGPath;
+}
+
+#pragma mark - Keys
+
+- (BOOL) automaticShadowPath
+{
+    return objc_getAssociatedObject(self, &SDThemeAutomaticShadowPathKey) != nil;
+}
+
+- (void) setAutomaticShadowPath:(BOOL)automaticShadowPath
+{
+    if (automaticShadowPath == self.automaticShadowPath)
+    {
+        return;
+    }
+    
+    if (automaticShadowPath)
+    {
+        [CALayer installAutomaticShadowPathHook];
+        objc_setAssociatedObject(self, &SDThemeAutomaticShadowPathKey, [SDThemeShadowPathGeometry new], OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        [self updateAutomaticShadowPath];
+    }
+    else
+    {
+        objc_setAssociatedObject(self, &SDThemeAutomaticShadowPathKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        self.shadowPath = NULL;
+    }
+}
+
+- (BOOL) rasterize
+{
+    return self.shouldRasterize;
+}
+
+- (void) setRasterize:(BOOL)rasterize
+{
+    self.shouldRasterize = rasterize;
+    // the default scale of 1 would produce a blurred bitmap on retina screens
+    self.rasterizationScale = rasterize ? [UIScreen mainScreen].scale : 1.0;
+}
+
+- (BOOL) continuousCorners
+{
+    if (@available(iOS 13.0, *))
+    {
+        return [self.cornerCurve isEqualToString:kCACornerCurveContinuous];
+    }
+    return NO;
+}
+
+- (void) setContinuousCorners:(BOOL)continuousCorners
+{
+    if (@available(iOS 13.0, *))
+    {
+        self.cornerCurve = continuousCorners ? kCACornerCurveContinuous : kCACornerCurveCircular;
+    }
+}
+
+#pragma mark - ThemeManager
+
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
 {
     if ([keyPath isEqualToString:@"borderColor"])
@@ -29,11 +150,21 @@
     {
         if ([value isKindOfClass:[UIColor class]])
         {
-            self.borderColor = [value CGColor];
+            self.shadowColor = [value CGColor];
+        }
+    } else if ([keyPath isEqualToString:@"automaticShadowPath"] || [keyPath isEqualToString:@"rasterize"] || [keyPath isEqualToString:@"continuousCorners"])
+    {
+        if ([value respondsToSelector:@selector(boolValue)])
+        {
+            [self setValue:@([value boolValue]) forKey:keyPath];
         }
     } else
     {
         [super applyThemeValue:value forKeyPath:keyPath];
+        if ([keyPath isEqualToString:@"cornerRadius"])
+        {
+            [self updateAutomaticShadowPath];
+        }
     }
 }
 
@@ -0,0 +1,73 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * On-disk cache of the parsed themes, so that the themes loaded at every launch are not parsed from their plist again.
+ *
+ * Every entry is a file named after the SHA-256 of the source plist, storing the parsed theme, and the values of the conventions parsed with it, in a flat binary form read through a memory mapping. The header records the format, the library version, the hash of the source and a checksum of the content: an entry that does not match is discarded and written again in the background.
+ * When the total size of the entries exceeds the limit the least recently used ones are removed.
+ */
+@interface SDThemeCompiledCache : NSObject
+
+/**
+ * @param directory the directory of the entries, created if needed
+ * @param maximumSize the maximum total size of the entries, in bytes
+ */
+- (instancetype) initWithDirectory:(NSString*)directory maximumSize:(NSUInteger)maximumSize;
+
+@property (nonatomic, copy, readonly) NSString* directory;
+@property (nonatomic, assign) NSUInteger maximumSize;
+
+/**
+ * Returns the theme stored for the given plist data, or nil if there is no valid entry for it. An invalid entry is removed.
+ *
+ * @param sourceData the content of the plist
+ */
+- (NSDictionary*) themeForSourceData:(NSData*)sourceData;
+
+/**
+ * Returns the theme stored for the given plist data and the values of the conventions parsed when it was compiled.
+ *
+ * @param sourceData the content of the plist
+ * @param signature the signature of the conventions registered now: the stored values are returned only if they were parsed with the same conventions
+ * @param conventionValues set to the stored values by conventional string, or to nil if the signature does not match
+ */
+- (NSDictionary*) themeForSourceData:(NSData*)sourceData conventionSignature:(NSString*)signature conventionValues:(NSDictionary<NSString*, id>**)conventionValues;
+
+/**
+ * Stores the theme parsed from the given plist data. The entry is written in the background, then the cache is trimmed to its maximum size.
+ *
+ * @param theme the parsed theme: a tree of dictionaries, arrays, strings, numbers, dates and data
+ * @param sourceData the content of the plist
+ */
+- (void) storeTheme:(NSDictionary*)theme forSourceData:(NSData*)sourceData;
+
+/**
+ * Stores the theme parsed from the given plist data with the values of the conventions it uses, so a later load does not parse them again.
+ *
+ * @param theme the parsed theme
+ * @param conventionValues the values by conventional string: a tree of the same types as the theme
+ * @param signature the signature of the conventions the values were parsed with
+ * @param sourceData the content of the plist
+ */
+- (void) storeTheme:(NSDictionary*)theme conventionValues:(NSDictionary<NSString*, id>*)conventionValues conventionSignature:(NSString*)signature forSourceData:(NSData*)sourceData;
+
+/**
+ * Removes all the entries.
+ */
+- (void) removeAllThemes;
+
+@end
@@ -0,0 +1,580 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeCompiledCache.h"
+#import "SDThemeLogger.h"
+#import "SDThemeDigest.h"
+
+// entries written by another version of the library are discarded: keep in sync with the podspec
+#define LIBRARY_VERSION         "0.3.7"
+#define CACHE_MAGIC             0x31435447  // "GTC1"
+#define CACHE_FORMAT_VERSION    2
+#define CACHE_FILE_EXTENSION    @"gtc"
+// nesting deeper than this is treated as a corrupt entry
+#define MAX_VALUE_DEPTH         128
+
+typedef NS_ENUM(uint8_t, SDThemeCacheTag) {
+    SDThemeCacheTagString,
+    SDThemeCacheTagInteger,
+    SDThemeCacheTagReal,
+    SDThemeCacheTagBoolean,
+    SDThemeCacheTagDictionary,
+    SDThemeCacheTagArray,
+    SDThemeCacheTagDate,
+    SDThemeCacheTagData,
+};
+
+/**
+ * Header of an entry. It is followed by the payload: the table of the strings (count, then length and UTF-8 bytes of each) and the root value, where strings are referenced by their index in the table.
+ * The root value is the array [theme, signature of the conventions, values of the conventions by string].
+ */
+typedef struct SDThemeCacheHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    char libraryVersion[16];
+    uint8_t sourceHash[SDThemeSHA256DigestLength];
+    uint64_t payloadLength;
+    uint64_t checksum;
+} SDThemeCacheHeader;
+
+static uint64_t SDThemeCacheChecksum(const uint8_t* bytes, size_t length)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#pragma mark - Reader
+
+typedef struct SDThemeCacheReader {
+    const uint8_t* bytes;
+    size_t length;
+    size_t offset;
+    BOOL failed;
+} SDThemeCacheReader;
+
+static BOOL SDThemeCacheRead(SDThemeCacheReader* reader, void* destination, size_t size)
+{
+    if (reader->failed || reader->length - reader->offset < size)
+    {
+        reader->failed = YES;
+        return NO;
+    }
+    memcpy(destination, reader->bytes + reader->offset, size);
+    reader->offset += size;
+    return YES;
+}
+
+static id SDThemeCacheReadValue(SDThemeCacheReader* reader, NSArray<NSString*>* strings, NSUInteger depth)
+{
+    uint8_t tag = 0;
+    if (depth > MAX_VALUE_DEPTH || !SDThemeCacheRead(reader, &tag, sizeof(tag)))
+    {
+        reader->failed = YES;
+        return nil;
+    }
+    switch (tag)
+    {
+        case SDThemeCacheTagString:
+        {
+            uint32_t index = 0;
+            if (!SDThemeCacheRead(reader, &index, sizeof(index)) || index >= strings.count)
+            {
+                reader->failed = YES;
+                return nil;
+            }
+            return strings[index];
+        }
+        case SDThemeCacheTagInteger:
+        {
+            int64_t integer = 0;
+            return SDThemeCacheRead(reader, &integer, sizeof(integer)) ? @(integer) : nil;
+        }
+        case SDThemeCacheTagReal:
+        {
+            double real = 0;
+            return SDThemeCacheRead(reader, &real, sizeof(real)) ? @(real) : nil;
+        }
+        case SDThemeCacheTagBoolean:
+        {
+            uint8_t boolean = 0;
+            return SDThemeCacheRead(reader, &boolean, sizeof(boolean)) ? (boolean ? @YES : @NO) : nil;
+        }
+        case SDThemeCacheTagDate:
+        {
+            double interval = 0;
+            return SDThemeCacheRead(reader, &interval, sizeof(interval)) ? [NSDate dateWithTimeIntervalSinceReferenceDate:interval] : nil;
+        }
+        case SDThemeCacheTagData:
+        {
+            uint32_t length = 0;
+            if (!SDThemeCacheRead(reader, &length, sizeof(length)) || reader->length - reader->offset < length)
+            {
+                reader->failed = YES;
+                return nil;
+            }
+            NSData* data = [NSData dataWithBytes:reader->bytes + reader->offset length:length];
+            reader->offset += length;
+            return data;
+        }
+        case SDThemeCacheTagDictionary:
+        {
+            uint32_t count = 0;
+            if (!SDThemeCacheRead(reader, &count, sizeof(count)))
+            {
+                return nil;
+            }
+            NSMutableDictionary* dictionary = [NSMutableDictionary dictionaryWithCapacity:MIN(count, 1024)];
+            for (uint32_t i = 0; i < count && !reader->failed; i++)
+            {
+                uint32_t keyIndex = 0;
+                if (!SDThemeCacheRead(reader, &keyIndex, sizeof(keyIndex)) || keyIndex >= strings.count)
+                {
+                    reader->failed = YES;
+                    return nil;
+                }
+                id value = SDThemeCacheReadValue(reader, strings, depth + 1);
+                if (value)
+                {
+                    dictionary[strings[keyIndex]] = value;
+                }
+            }
+            return reader->failed ? nil : dictionary;
+        }
+        case SDThemeCacheTagArray:
+        {
+            uint32_t count = 0;
+            if (!SDThemeCacheRead(reader, &count, sizeof(count)))
+            {
+                return nil;
+            }
+            NSMutableArray* array = [NSMutableArray arrayWithCapacity:MIN(count, 1024)];
+            for (uint32_t i = 0; i < count && !reader->failed; i++)
+            {
+                id value = SDThemeCacheReadValue(reader, strings, depth + 1);
+                if (value)
+                {
+                    [array addObject:value];
+                }
+            }
+            return reader->failed ? nil : array;
+        }
+    }
+    reader->failed = YES;
+    return nil;
+}
+
+#pragma mark - Writer
+
+@interface SDThemeCacheWriter : NSObject
+
+@property (nonatomic, strong) NSMutableData* values;
+@property (nonatomic, strong) NSMutableArray<NSString*>* strings;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSNumber*>* stringIndexes;
+
+@end
+
+@implementation SDThemeCacheWriter
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.values = [NSMutableData new];
+        self.strings = [NSMutableArray new];
+        self.stringIndexes = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (uint32_t) indexOfString:(NSString*)string
+{
+    NSNumber* index = self.stringIndexes[string];
+    if (!index)
+    {
+        index = @(self.strings.count);
+        self.stringIndexes[string] = index;
+        [self.strings addObject:string];
+    }
+    return index.unsignedIntValue;
+}
+
+- (void) appendTag:(SDThemeCacheTag)tag
+{
+    [self.values appendBytes:&tag length:sizeof(tag)];
+}
+
+- (BOOL) appendValue:(id)value
+{
+    if ([value isKindOfClass:[NSString class]])
+    {
+        uint32_t index = [self indexOfString:value];
+        [self appendTag:SDThemeCacheTagString];
+        [self.values appendBytes:&index length:sizeof(index)];
+        return YES;
+    }
+    if ([value isKindOfClass:[NSNumber class]])
+    {
+        if (CFGetTypeID((__bridge CFTypeRef)value) == CFBooleanGetTypeID())
+        {
+            uint8_t boolean = [value boolValue];
+            [self appendTag:SDThemeCacheTagBoolean];
+            [self.values appendBytes:&boolean length:sizeof(boolean)];
+        }
+        else if (CFNumberIsFloatType((__bridge CFNumberRef)value))
+        {
+            double real = [value doubleValue];
+            [self appendTag:SDThemeCacheTagReal];
+            [self.values appendBytes:&real length:sizeof(real)];
+        }
+        else
+        {
+            int64_t integer = [value longLongValue];
+            [self appendTag:SDThemeCacheTagInteger];
+            [self.values appendBytes:&integer length:sizeof(integer)];
+        }
+        return YES;
+    }
+    if ([value isKindOfClass:[NSDate class]])
+    {
+        double interval = [value timeIntervalSinceReferenceDate];
+        [self appendTag:SDThemeCacheTagDate];
+        [self.values appendBytes:&interval length:sizeof(interval)];
+        return YES;
+    }
+    if ([value isKindOfClass:[NSData class]])
+    {
+        uint32_t length = (uint32_t)[value length];
+        [self appendTag:SDThemeCacheTagData];
+        [self.values appendBytes:&length length:sizeof(length)];
+        [self.values appendData:value];
+        return YES;
+    }
+    if ([value isKindOfClass:[NSDictionary class]])
+    {
+        NSDictionary* dictionary = value;
+        uint32_t count = (uint32_t)dictionary.count;
+        [self appendTag:SDThemeCacheTagDictionary];
+        [self.values appendBytes:&count length:sizeof(count)];
+        for (id key in dictionary)
+        {
+            if (![key isKindOfClass:[NSString class]])
+            {
+                return NO;
+            }
+            uint32_t keyIndex = [self indexOfString:key];
+            [self.values appendBytes:&keyIndex length:sizeof(keyIndex)];
+            if (![self appendValue:dictionary[key]])
+            {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    if ([value isKindOfClass:[NSArray class]])
+    {
+        NSArray* array = value;
+        uint32_t count = (uint32_t)array.count;
+        [self appendTag:SDThemeCacheTagArray];
+        [self.values appendBytes:&count length:sizeof(count)];
+        for (id item in array)
+        {
+            if (![self appendValue:item])
+            {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    return NO;
+}
+
+- (NSData*) payload
+{
+    NSMutableData* payload = [NSMutableData new];
+    uint32_t count = (uint32_t)self.strings.count;
+    [payload appendBytes:&count length:sizeof(count)];
+    for (NSString* string in self.strings)
+    {
+        NSData* bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+        uint32_t length = (uint32_t)bytes.length;
+        [payload appendBytes:&length length:sizeof(length)];
+        [payload appendData:bytes];
+    }
+    [payload appendData:self.values];
+    return payload;
+}
+
+@end
+
+#pragma mark - Cache
+
+@interface SDThemeCompiledCache ()
+
+@property (nonatomic, copy) NSString* directory;
+// serial queue of the writes, of the removals and of the updates of the access dates
+@property (nonatomic, strong) dispatch_queue_t ioQueue;
+
+@end
+
+@implementation SDThemeCompiledCache
+
+- (instancetype) initWithDirectory:(NSString*)directory maximumSize:(NSUInteger)maximumSize
+{
+    self = [super init];
+    if (self)
+    {
+        self.directory = directory;
+        self.maximumSize = maximumSize;
+        self.ioQueue = dispatch_queue_create("it.sysdata.giotto.compiledcache", DISPATCH_QUEUE_SERIAL);
+        // the utility QoS on Apple platforms, also available where there are no QoS classes
+        dispatch_set_target_queue(self.ioQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+    }
+    return self;
+}
+
+- (NSDictionary*) themeForSourceData:(NSData*)sourceData
+{
+    return [self themeForSourceData:sourceData conventionSignature:nil conventionValues:NULL];
+}
+
+- (NSDictionary*) themeForSourceData:(NSData*)sourceData conventionSignature:(NSString*)signature conventionValues:(NSDictionary<NSString*, id>**)conventionValues
+{
+    if (conventionValues)
+    {
+        *conventionValues = nil;
+    }
+    if (!sourceData)
+    {
+        return nil;
+    }
+    uint8_t sourceHash[SDThemeSHA256DigestLength];
+    SDThemeSHA256(sourceData.bytes, sourceData.length, sourceHash);
+    NSString* path = [self pathForSourceHash:sourceHash];
+    
+    NSData* data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+    if (!data)
+    {
+        return nil;
+    }
+    
+    NSArray* contents = [self contentsOfEntryData:data sourceHash:sourceHash];
+    if (!contents)
+    {
+        SDLogModuleWarning(kThemeManagerLogModuleName, @"Compiled theme %@ is not valid and will be rebuilt", path.lastPathComponent);
+        dispatch_async(self.ioQueue, ^{
+            [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        });
+        return nil;
+    }
+    
+    // the modification date is the access date used by the LRU cleanup
+    dispatch_async(self.ioQueue, ^{
+        [[NSFileManager defaultManager] setAttributes:@{ NSFileModificationDate: [NSDate date] } ofItemAtPath:path error:nil];
+    });
+    if (conventionValues && signature && [contents[1] isEqualToString:signature])
+    {
+        *conventionValues = contents[2];
+    }
+    return contents[0];
+}
+
+- (void) storeTheme:(NSDictionary*)theme forSourceData:(NSData*)sourceData
+{
+    [self storeTheme:theme conventionValues:nil conventionSignature:nil forSourceData:sourceData];
+}
+
+- (void) storeTheme:(NSDictionary*)theme conventionValues:(NSDictionary<NSString*, id>*)conventionValues conventionSignature:(NSString*)signature forSourceData:(NSData*)sourceData
+{
+    if (!theme || !sourceData || self.maximumSize == 0)
+    {
+        return;
+    }
+    // an entry without values is never matched by a signature
+    NSArray* contents = @[[theme copy], signature ?: @"", [conventionValues copy] ?: @{}];
+    NSData* sourceDataCopy = [sourceData copy];
+    dispatch_async(self.ioQueue, ^{
+        uint8_t sourceHash[SDThemeSHA256DigestLength];
+        SDThemeSHA256(sourceDataCopy.bytes, sourceDataCopy.length, sourceHash);
+        
+        NSData* entry = [self entryDataForContents:contents sourceHash:sourceHash];
+        if (!entry)
+        {
+            SDLogModuleWarning(kThemeManagerLogModuleName, @"Theme contains values that cannot be cached");
+            return;
+        }
+        [[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+        NSError* error = nil;
+        if (![entry writeToFile:[self pathForSourceHash:sourceHash] options:NSDataWritingAtomic error:&error])
+        {
+            SDLogModuleWarning(kThemeManagerLogModuleName, @"Cannot write compiled theme: %@", error.localizedDescription);
+            return;
+        }
+        [self trimToMaximumSize];
+    });
+}
+
+- (void) removeAllThemes
+{
+    dispatch_async(self.ioQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    });
+}
+
+#pragma mark Entries
+
+- (NSString*) pathForSourceHash:(const uint8_t*)sourceHash
+{
+    NSMutableString* name = [NSMutableString stringWithCapacity:SDThemeSHA256DigestLength * 2];
+    for (int i = 0; i < SDThemeSHA256DigestLength; i++)
+    {
+        [name appendFormat:@"%02x", sourceHash[i]];
+    }
+    return [[self.directory stringByAppendingPathComponent:name] stringByAppendingPathExtension:CACHE_FILE_EXTENSION];
+}
+
+- (NSData*) entryDataForContents:(NSArray*)contents sourceHash:(const uint8_t*)sourceHash
+{
+    SDThemeCacheWriter* writer = [SDThemeCacheWriter new];
+    if (![writer appendValue:contents])
+    {
+        return nil;
+    }
+    NSData* payload = [writer payload];
+    
+    SDThemeCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.formatVersion = CACHE_FORMAT_VERSION;
+    strncpy(header.libraryVersion, LIBRARY_VERSION, sizeof(header.libraryVersion) - 1);
+    memcpy(header.sourceHash, sourceHash, SDThemeSHA256DigestLength);
+    header.payloadLength = payload.length;
+    header.checksum = SDThemeCacheChecksum(payload.bytes, payload.length);
+    
+    NSMutableData* entry = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+    [entry appendData:payload];
+    return entry;
+}
+
+/**
+ * @return the root array stored in the entry, or nil if the entry does not match the source, the version of the library or its checksum.
+ */
+- (NSArray*) contentsOfEntryData:(NSData*)data sourceHash:(const uint8_t*)sourceHash
+{
+    if (data.length < sizeof(SDThemeCacheHeader))
+    {
+        return nil;
+    }
+    SDThemeCacheHeader header;
+    memcpy(&header, data.bytes, sizeof(header));
+    if (header.magic != CACHE_MAGIC ||
+        header.formatVersion != CACHE_FORMAT_VERSION ||
+        strncmp(header.libraryVersion, LIBRARY_VERSION, sizeof(header.libraryVersion)) != 0 ||
+        memcmp(header.sourceHash, sourceHash, SDThemeSHA256DigestLength) != 0 ||
+        header.payloadLength != data.length - sizeof(header))
+    {
+        return nil;
+    }
+    const uint8_t* payload = (const uint8_t*)data.bytes + sizeof(header);
+    if (SDThemeCacheChecksum(payload, (size_t)header.payloadLength) != header.checksum)
+    {
+        return nil;
+    }
+    
+    SDThemeCacheReader reader = { payload, (size_t)header.payloadLength, 0, NO };
+    uint32_t stringCount = 0;
+    if (!SDThemeCacheRead(&reader, &stringCount, sizeof(stringCount)))
+    {
+        return nil;
+    }
+    NSMutableArray<NSString*>* strings = [NSMutableArray arrayWithCapacity:MIN(stringCount, 4096)];
+    for (uint32_t i = 0; i < stringCount; i++)
+    {
+        uint32_t length = 0;
+        if (!SDThemeCacheRead(&reader, &length, sizeof(length)) || reader.length - reader.offset < length)
+        {
+            return nil;
+        }
+        NSString* string = [[NSString alloc] initWithBytes:reader.bytes + reader.offset length:length encoding:NSUTF8StringEncoding];
+        if (!string)
+        {
+            return nil;
+        }
+        [strings addObject:string];
+        reader.offset += length;
+    }
+    
+    id contents = SDThemeCacheReadValue(&reader, strings, 0);
+    if (reader.failed || reader.offset != reader.length || ![contents isKindOfClass:[NSArray class]] || [contents count] != 3 ||
+        ![contents[0] isKindOfClass:[NSDictionary class]] || ![contents[1] isKindOfClass:[NSString class]] || ![contents[2] isKindOfClass:[NSDictionary class]])
+    {
+        return nil;
+    }
+    return contents;
+}
+
+#pragma mark LRU cleanup
+
+/**
+ * Removes the least recently used entries until the total size is under the maximum size. Runs on the io queue.
+ */
+- (void) trimToMaximumSize
+{
+    NSArray<NSURLResourceKey>* keys = @[NSURLContentModificationDateKey, NSURLTotalFileAllocatedSizeKey];
+    NSArray<NSURL*>* urls = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:[NSURL fileURLWithPath:self.directory]
+                                                          includingPropertiesForKeys:keys
+                                                                             options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                               error:nil];
+    NSMutableArray<NSDictionary<NSURLResourceKey, id>*>* entries = [NSMutableArray new];
+    NSUInteger totalSize = 0;
+    for (NSURL* url in urls)
+    {
+        if (![url.pathExtension isEqualToString:CACHE_FILE_EXTENSION])
+        {
+            continue;
+        }
+        NSDictionary<NSURLResourceKey, id>* values = [url resourceValuesForKeys:keys error:nil];
+        if (values[NSURLContentModificationDateKey] && values[NSURLTotalFileAllocatedSizeKey])
+        {
+            [entries addObject:@{ @"url": url, NSURLContentModificationDateKey: values[NSURLContentModificationDateKey], NSURLTotalFileAllocatedSizeKey: values[NSURLTotalFileAllocatedSizeKey] }];
+            totalSize += [values[NSURLTotalFileAllocatedSizeKey] unsignedIntegerValue];
+        }
+    }
+    if (totalSize <= self.maximumSize)
+    {
+        return;
+    }
+    
+    [entries sortUsingComparator:^NSComparisonResult(NSDictionary* entry1, NSDictionary* entry2) {
+        return [entry1[NSURLContentModificationDateKey] compare:entry2[NSURLContentModificationDateKey]];
+    }];
+    for (NSDictionary* entry in entries)
+    {
+        if (totalSize <= self.maximumSize)
+        {
+            break;
+        }
+        if ([[NSFileManager defaultManager] removeItemAtURL:entry[@"url"] error:nil])
+        {
+            totalSize -= [entry[NSURLTotalFileAllocatedSizeKey] unsignedIntegerValue];
+        }
+    }
+}
+
+@end
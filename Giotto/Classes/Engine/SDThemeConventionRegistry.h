@@ -0,0 +1,61 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Parses the part of a conventional string that follows its prefix (eg. "0,2,4,000000" of "shadow:0,2,4,000000") into an immutable value.
+ *
+ * @return the value, or nil if the string is not valid
+ */
+typedef id (^SDThemeConventionParser)(NSString* specs);
+
+/**
+ * Conventions registered by the application, by prefix. The prefix of a string is the part up to its first ":", so finding the convention of a string costs a single lookup however many conventions are registered.
+ *
+ * The registry is thread safe.
+ */
+@interface SDThemeConventionRegistry : NSObject
+
++ (instancetype) sharedRegistry;
+
+/**
+ * Registers a parser for a prefix, replacing the one registered before.
+ *
+ * @param prefix the prefix, ending with ":" and without other ":"
+ * @param parser the parser
+ *
+ * @return NO if the prefix is not valid
+ */
+- (BOOL) registerPrefix:(NSString*)prefix parser:(SDThemeConventionParser)parser;
+
+- (void) unregisterPrefix:(NSString*)prefix;
+
+/**
+ * Returns the parser of the convention of a string.
+ *
+ * @param string the string
+ * @param prefix set to the prefix of the convention, if found
+ *
+ * @return the parser or nil if the string does not start with a registered prefix
+ */
+- (SDThemeConventionParser) parserForString:(NSString*)string prefix:(NSString**)prefix;
+
+// YES if no convention is registered
+@property (nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+// the registered prefixes, sorted
+@property (nonatomic, readonly) NSArray<NSString*>* prefixes;
+
+@end
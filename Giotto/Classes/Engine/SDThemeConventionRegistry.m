@@ -0,0 +1,121 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeConventionRegistry.h"
+#import <pthread.h>
+
+@interface SDThemeConventionRegistry ()
+{
+    pthread_mutex_t _lock;
+}
+
+@property (nonatomic, strong) NSMutableDictionary<NSString*, SDThemeConventionParser>* parsers;
+
+@end
+
+@implementation SDThemeConventionRegistry
+
++ (instancetype) sharedRegistry
+{
+    static dispatch_once_t pred;
+    static id sharedRegistryInstance_ = nil;
+
+    dispatch_once(&pred, ^{
+        sharedRegistryInstance_ = [[self alloc] init];
+    });
+
+    return sharedRegistryInstance_;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        pthread_mutex_init(&_lock, NULL);
+        self.parsers = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (BOOL) registerPrefix:(NSString*)prefix parser:(SDThemeConventionParser)parser
+{
+    NSRange colon = [prefix rangeOfString:@":"];
+    if (!parser || prefix.length < 2 || colon.location != prefix.length - 1)
+    {
+        return NO;
+    }
+
+    pthread_mutex_lock(&_lock);
+    self.parsers[prefix] = [parser copy];
+    pthread_mutex_unlock(&_lock);
+    return YES;
+}
+
+- (void) unregisterPrefix:(NSString*)prefix
+{
+    if (!prefix)
+    {
+        return;
+    }
+    pthread_mutex_lock(&_lock);
+    [self.parsers removeObjectForKey:prefix];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (SDThemeConventionParser) parserForString:(NSString*)string prefix:(NSString**)prefix
+{
+    if (self.empty)
+    {
+        return nil;
+    }
+    NSRange colon = [string rangeOfString:@":"];
+    if (colon.location == NSNotFound)
+    {
+        return nil;
+    }
+
+    NSString* stringPrefix = [string substringToIndex:NSMaxRange(colon)];
+    pthread_mutex_lock(&_lock);
+    SDThemeConventionParser parser = self.parsers[stringPrefix];
+    pthread_mutex_unlock(&_lock);
+    if (parser && prefix)
+    {
+        *prefix = stringPrefix;
+    }
+    return parser;
+}
+
+- (BOOL) isEmpty
+{
+    pthread_mutex_lock(&_lock);
+    BOOL empty = self.parsers.count == 0;
+    pthread_mutex_unlock(&_lock);
+    return empty;
+}
+
+- (NSArray<NSString*>*) prefixes
+{
+    pthread_mutex_lock(&_lock);
+    NSArray<NSString*>* prefixes = [self.parsers.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    pthread_mutex_unlock(&_lock);
+    return prefixes;
+}
+
+@end
@@ -0,0 +1,56 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Records, for every layer of the themes, which constants and styles reference each name, so that the effects of a change can be found without scanning all the themes.
+ *
+ * A constant or a style references a name if the name appears as a word (letters, digits and underscores) in one of its string values, including the superstyles and the constants used by expressions and conventions. The lookup is conservative: a name can be reported as affected even if the word is used for another purpose.
+ */
+@interface SDThemeDependencyIndex : NSObject
+
+/**
+ * @param constantsKey the key of the constants in a theme dictionary
+ * @param stylesKey the key of the styles in a theme dictionary
+ */
+- (instancetype) initWithConstantsKey:(NSString*)constantsKey stylesKey:(NSString*)stylesKey;
+
+/**
+ * Indexes the references of a theme, replacing the ones previously indexed for the same layer.
+ *
+ * @param theme the theme dictionary, or nil to remove the layer
+ * @param layerIdentifier the identifier of the layer (eg. the path of its file)
+ */
+- (void) indexTheme:(NSDictionary*)theme forLayer:(NSString*)layerIdentifier;
+
+/**
+ * Removes all the layers.
+ */
+- (void) removeAllLayers;
+
+/**
+ * Adds to the given sets all the constants and styles that directly or indirectly reference one of the names they contain.
+ *
+ * @param constants the names of the changed constants, expanded with the affected ones
+ * @param styles the names of the changed styles, expanded with the affected ones
+ */
+- (void) expandChangedConstants:(NSMutableSet<NSString*>*)constants styles:(NSMutableSet<NSString*>*)styles;
+
+/**
+ * @return the keys whose value differs between the two dictionaries, including the added and the removed ones.
+ */
++ (NSSet<NSString*>*) changedKeysFromDictionary:(NSDictionary*)oldDictionary toDictionary:(NSDictionary*)newDictionary;
+
+@end
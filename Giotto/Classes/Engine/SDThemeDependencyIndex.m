@@ -0,0 +1,185 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeDependencyIndex.h"
+
+@interface SDThemeLayerReferences : NSObject
+
+// referenced name -> names of the constants / styles referencing it
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableSet<NSString*>*>* constantDependents;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableSet<NSString*>*>* styleDependents;
+
+@end
+
+@implementation SDThemeLayerReferences
+@end
+
+
+@interface SDThemeDependencyIndex ()
+
+@property (nonatomic, copy) NSString* constantsKey;
+@property (nonatomic, copy) NSString* stylesKey;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, SDThemeLayerReferences*>* layers;
+@property (nonatomic, strong) NSCharacterSet* separators;
+
+@end
+
+@implementation SDThemeDependencyIndex
+
+- (instancetype) initWithConstantsKey:(NSString*)constantsKey stylesKey:(NSString*)stylesKey
+{
+    self = [super init];
+    if (self)
+    {
+        self.constantsKey = constantsKey;
+        self.stylesKey = stylesKey;
+        self.layers = [NSMutableDictionary new];
+        
+        NSMutableCharacterSet* wordCharacters = [NSMutableCharacterSet alphanumericCharacterSet];
+        [wordCharacters addCharactersInString:@"_"];
+        self.separators = [wordCharacters invertedSet];
+    }
+    return self;
+}
+
+- (void) indexTheme:(NSDictionary*)theme forLayer:(NSString*)layerIdentifier
+{
+    if (!layerIdentifier)
+    {
+        return;
+    }
+    if (!theme)
+    {
+        [self.layers removeObjectForKey:layerIdentifier];
+        return;
+    }
+    
+    SDThemeLayerReferences* references = [SDThemeLayerReferences new];
+    references.constantDependents = [self dependentsOfSection:theme[self.constantsKey]];
+    references.styleDependents = [self dependentsOfSection:theme[self.stylesKey]];
+    self.layers[layerIdentifier] = references;
+}
+
+- (void) removeAllLayers
+{
+    [self.layers removeAllObjects];
+}
+
+- (void) expandChangedConstants:(NSMutableSet<NSString*>*)constants styles:(NSMutableSet<NSString*>*)styles
+{
+    NSMutableArray<NSString*>* queue = [NSMutableArray arrayWithArray:constants.allObjects];
+    [queue addObjectsFromArray:styles.allObjects];
+    
+    while (queue.count > 0)
+    {
+        NSString* name = queue.lastObject;
+        [queue removeLastObject];
+        
+        for (SDThemeLayerReferences* references in self.layers.allValues)
+        {
+            for (NSString* constant in references.constantDependents[name])
+            {
+                if (![constants containsObject:constant])
+                {
+                    [constants addObject:constant];
+                    [queue addObject:constant];
+                }
+            }
+            for (NSString* style in references.styleDependents[name])
+            {
+                if (![styles containsObject:style])
+                {
+                    [styles addObject:style];
+                    [queue addObject:style];
+                }
+            }
+        }
+    }
+}
+
++ (NSSet<NSString*>*) changedKeysFromDictionary:(NSDictionary*)oldDictionary toDictionary:(NSDictionary*)newDictionary
+{
+    NSMutableSet<NSString*>* changedKeys = [NSMutableSet new];
+    [oldDictionary enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
+        if (![value isEqual:newDictionary[key]])
+        {
+            [changedKeys addObject:key];
+        }
+    }];
+    [newDictionary enumerateKeysAndObjectsUsingBlock:^(NSString* key, id value, BOOL* stop) {
+        if (oldDictionary[key] == nil)
+        {
+            [changedKeys addObject:key];
+        }
+    }];
+    return changedKeys;
+}
+
+#pragma mark Utils
+
+- (NSMutableDictionary<NSString*, NSMutableSet<NSString*>*>*) dependentsOfSection:(NSDictionary*)section
+{
+    NSMutableDictionary<NSString*, NSMutableSet<NSString*>*>* dependents = [NSMutableDictionary new];
+    if (![section isKindOfClass:[NSDictionary class]])
+    {
+        return dependents;
+    }
+    
+    [section enumerateKeysAndObjectsUsingBlock:^(NSString* name, id value, BOOL* stop) {
+        NSMutableSet<NSString*>* words = [NSMutableSet new];
+        [self collectWordsOfValue:value intoSet:words];
+        [words removeObject:name];
+        for (NSString* word in words)
+        {
+            NSMutableSet<NSString*>* names = dependents[word];
+            if (!names)
+            {
+                names = [NSMutableSet new];
+                dependents[word] = names;
+            }
+            [names addObject:name];
+        }
+    }];
+    return dependents;
+}
+
+- (void) collectWordsOfValue:(id)value intoSet:(NSMutableSet<NSString*>*)words
+{
+    if ([value isKindOfClass:[NSString class]])
+    {
+        for (NSString* word in [(NSString*)value componentsSeparatedByCharactersInSet:self.separators])
+        {
+            if (word.length > 0)
+            {
+                [words addObject:word];
+            }
+        }
+    }
+    else if ([value isKindOfClass:[NSDictionary class]])
+    {
+        for (id subvalue in [(NSDictionary*)value allValues])
+        {
+            [self collectWordsOfValue:subvalue intoSet:words];
+        }
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        for (id subvalue in (NSArray*)value)
+        {
+            [self collectWordsOfValue:subvalue intoSet:words];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,27 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+
+#define SDThemeSHA256DigestLength 32
+
+/**
+ * Computes the SHA-256 of the given bytes, with CommonCrypto where it is available and with a portable implementation elsewhere.
+ *
+ * @param bytes the bytes
+ * @param length the number of bytes
+ * @param digest filled with the digest
+ */
+FOUNDATION_EXPORT void SDThemeSHA256(const void* bytes, size_t length, uint8_t digest[SDThemeSHA256DigestLength]);
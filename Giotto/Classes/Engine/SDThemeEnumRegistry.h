@@ -0,0 +1,65 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Tables of the names of the cases of enums and option sets, used by the "enum:" convention (eg. "enum:UIViewContentMode.scaleAspectFill" or "enum:UIViewAutoresizing.flexibleWidth|flexibleHeight").
+ * The names of the cases are compared ignoring the case, and can also be written with the name of the enum as prefix (eg. "UIViewContentModeScaleAspectFill").
+ *
+ * The registry is thread safe.
+ */
+@interface SDThemeEnumRegistry : NSObject
+
++ (instancetype) sharedRegistry;
+
+/**
+ * Registers the table of an enum, replacing the one registered before with the same name.
+ *
+ * @param name the name of the enum, without "." and "|"
+ * @param values the values of the cases, by name
+ * @param optionSet YES if more cases can be combined with "|"
+ *
+ * @return NO if the name or the values are not valid
+ */
+- (BOOL) registerEnumWithName:(NSString*)name values:(NSDictionary<NSString*, NSNumber*>*)values optionSet:(BOOL)optionSet;
+
+- (void) unregisterEnumWithName:(NSString*)name;
+
+/**
+ * Returns the value of a case of an enum.
+ *
+ * @param caseName the name of the case, or "<CASE>|<CASE>..." for an option set
+ * @param name the name of the enum
+ *
+ * @return the value, or nil if the enum or one of the cases is unknown
+ */
+- (NSNumber*) valueForCase:(NSString*)caseName ofEnum:(NSString*)name;
+
+/**
+ * Returns the value of the specs of the "enum:" convention.
+ *
+ * @param specs "<ENUM>.<CASE>" or, for an option set, "<ENUM>.<CASE>|<CASE>..."
+ *
+ * @return the value, or nil if the enum or one of the cases is unknown
+ */
+- (NSNumber*) valueForSpecs:(NSString*)specs;
+
+// YES if no enum is registered
+@property (nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+// the names of the registered enums, sorted
+@property (nonatomic, readonly) NSArray<NSString*>* names;
+
+@end
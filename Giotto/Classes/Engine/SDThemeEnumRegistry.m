@@ -0,0 +1,185 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeEnumRegistry.h"
+#import <pthread.h>
+
+#define CASE_SEPARATOR      @"."
+#define OPTION_SEPARATOR    @"|"
+
+@interface SDThemeEnumTable : NSObject
+
+// prefix of the cases written with the name of the enum, lowercase
+@property (nonatomic, copy) NSString* prefix;
+// values by lowercase name
+@property (nonatomic, copy) NSDictionary<NSString*, NSNumber*>* values;
+@property (nonatomic, assign) BOOL optionSet;
+
+@end
+
+@implementation SDThemeEnumTable
+@end
+
+
+@interface SDThemeEnumRegistry ()
+{
+    pthread_mutex_t _lock;
+}
+
+@property (nonatomic, strong) NSMutableDictionary<NSString*, SDThemeEnumTable*>* tables;
+
+@end
+
+@implementation SDThemeEnumRegistry
+
++ (instancetype) sharedRegistry
+{
+    static dispatch_once_t pred;
+    static id sharedRegistryInstance_ = nil;
+
+    dispatch_once(&pred, ^{
+        sharedRegistryInstance_ = [[self alloc] init];
+    });
+
+    return sharedRegistryInstance_;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        pthread_mutex_init(&_lock, NULL);
+        self.tables = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (BOOL) registerEnumWithName:(NSString*)name values:(NSDictionary<NSString*, NSNumber*>*)values optionSet:(BOOL)optionSet
+{
+    if (name.length == 0 || values.count == 0 || [name containsString:CASE_SEPARATOR] || [name containsString:OPTION_SEPARATOR])
+    {
+        return NO;
+    }
+
+    // the names are lowercased once, so the lookups are a single hash
+    NSMutableDictionary<NSString*, NSNumber*>* lowercaseValues = [NSMutableDictionary dictionaryWithCapacity:values.count];
+    for (NSString* caseName in values)
+    {
+        if (![caseName isKindOfClass:[NSString class]] || ![values[caseName] isKindOfClass:[NSNumber class]])
+        {
+            return NO;
+        }
+        lowercaseValues[caseName.lowercaseString] = values[caseName];
+    }
+
+    SDThemeEnumTable* table = [SDThemeEnumTable new];
+    table.prefix = name.lowercaseString;
+    table.values = lowercaseValues;
+    table.optionSet = optionSet;
+
+    pthread_mutex_lock(&_lock);
+    self.tables[name] = table;
+    pthread_mutex_unlock(&_lock);
+    return YES;
+}
+
+- (void) unregisterEnumWithName:(NSString*)name
+{
+    if (!name)
+    {
+        return;
+    }
+    pthread_mutex_lock(&_lock);
+    [self.tables removeObjectForKey:name];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSNumber*) valueForCase:(NSString*)caseName ofEnum:(NSString*)name
+{
+    if (!caseName || !name)
+    {
+        return nil;
+    }
+    pthread_mutex_lock(&_lock);
+    SDThemeEnumTable* table = self.tables[name];
+    pthread_mutex_unlock(&_lock);
+    if (!table)
+    {
+        return nil;
+    }
+
+    NSArray<NSString*>* caseNames = table.optionSet ? [caseName componentsSeparatedByString:OPTION_SEPARATOR] : @[caseName];
+    unsigned long long value = 0;
+    for (NSString* component in caseNames)
+    {
+        NSNumber* caseValue = [self valueForCase:[component stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] inTable:table];
+        if (!caseValue)
+        {
+            return nil;
+        }
+        if (!table.optionSet)
+        {
+            return caseValue;
+        }
+        value |= caseValue.unsignedLongLongValue;
+    }
+    return @(value);
+}
+
+- (NSNumber*) valueForCase:(NSString*)caseName inTable:(SDThemeEnumTable*)table
+{
+    NSString* lowercaseName = caseName.lowercaseString;
+    NSNumber* value = table.values[lowercaseName];
+    if (!value && lowercaseName.length > table.prefix.length && [lowercaseName hasPrefix:table.prefix])
+    {
+        // eg. "UIViewContentModeScaleAspectFill"
+        value = table.values[[lowercaseName substringFromIndex:table.prefix.length]];
+    }
+    return value;
+}
+
+- (NSNumber*) valueForSpecs:(NSString*)specs
+{
+    NSRange separator = [specs rangeOfString:CASE_SEPARATOR];
+    if (separator.location == NSNotFound)
+    {
+        return nil;
+    }
+    NSString* name = [[specs substringToIndex:separator.location] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    return [self valueForCase:[specs substringFromIndex:NSMaxRange(separator)] ofEnum:name];
+}
+
+- (BOOL) isEmpty
+{
+    pthread_mutex_lock(&_lock);
+    BOOL empty = self.tables.count == 0;
+    pthread_mutex_unlock(&_lock);
+    return empty;
+}
+
+- (NSArray<NSString*>*) names
+{
+    pthread_mutex_lock(&_lock);
+    NSArray<NSString*>* names = [self.tables.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    pthread_mutex_unlock(&_lock);
+    return names;
+}
+
+@end
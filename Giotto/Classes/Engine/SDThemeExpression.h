@@ -0,0 +1,93 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "SDThemeValue.h"
+
+#define EXPRESSION_IDENTIFIER @"="
+
+extern NSString* const SDThemeExpressionErrorDomain;
+
+typedef NS_ENUM(NSInteger, SDThemeExpressionError) {
+    SDThemeExpressionErrorSyntax = 1,
+    SDThemeExpressionErrorUnknownReference,
+    SDThemeExpressionErrorUnknownFunction,
+    SDThemeExpressionErrorType,
+    SDThemeExpressionErrorCycle,
+};
+
+/**
+ * Provides the values of the names and of the color literals used by an expression.
+ */
+@protocol SDThemeExpressionContext <NSObject>
+
+/**
+ * @return the value of the constant with the given name, or nil if it does not exist.
+ */
+- (id) valueForExpressionReference:(NSString*)reference;
+
+/**
+ * @return the color described by the given RRGGBBAA, RRGGBB, RGBA or RGB hexadecimal string, or nil.
+ */
+- (SDThemeColorValue*) colorForExpressionLiteral:(NSString*)literal;
+
+@end
+
+/**
+ * A derived constant value, written in the plist as a string starting with "=".
+ *
+ * Supported syntax:
+ *  - numbers and the arithmetic operators + - * / with parentheses: "= DIMENSION_BASE * 1.5 + 2"
+ *  - references to other constants by name: "= COLOR_BRAND"
+ *  - color literals: "= #FF000080"
+ *  - color functions: alpha(color, alpha), mix(color1, color2, fraction), lighten(color, fraction), darken(color, fraction)
+ *  - number functions: min(a, b), max(a, b), round(a)
+ *
+ * Expressions are parsed and evaluated once, when the themes are loaded.
+ */
+@interface SDThemeExpression : NSObject
+
+/**
+ * @return YES if the given value is a string using the expression syntax.
+ */
++ (BOOL) isExpressionValue:(id)value;
+
+/**
+ * Parses an expression.
+ *
+ * @param string the expression string, including the leading "="
+ * @param error set if the string is not a valid expression
+ *
+ * @return the parsed expression or nil
+ */
++ (instancetype) expressionWithString:(NSString*)string error:(NSError**)error;
+
+@property (nonatomic, copy, readonly) NSString* string;
+
+/**
+ * The names of the constants referenced by the expression.
+ */
+@property (nonatomic, strong, readonly) NSSet<NSString*>* references;
+
+/**
+ * Evaluates the expression.
+ *
+ * @param context the provider of the referenced values
+ * @param error set if the expression can't be evaluated
+ *
+ * @return a NSNumber or a SDThemeColorValue, or nil in case of error
+ */
+- (id) evaluateWithContext:(id<SDThemeExpressionContext>)context error:(NSError**)error;
+
+@end
@@ -0,0 +1,571 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeExpression.h"
+
+NSString* const SDThemeExpressionErrorDomain = @"SDThemeExpressionErrorDomain";
+
+#define FUNCTION_ALPHA   @"alpha"
+#define FUNCTION_MIX     @"mix"
+#define FUNCTION_LIGHTEN @"lighten"
+#define FUNCTION_DARKEN  @"darken"
+#define FUNCTION_MIN     @"min"
+#define FUNCTION_MAX     @"max"
+#define FUNCTION_ROUND   @"round"
+
+static NSError* SDThemeExpressionMakeError(SDThemeExpressionError code, NSString* format, ...) NS_FORMAT_FUNCTION(2,3);
+
+static NSError* SDThemeExpressionMakeError(SDThemeExpressionError code, NSString* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    NSString* message = [[NSString alloc] initWithFormat:format arguments:arguments];
+    va_end(arguments);
+    return [NSError errorWithDomain:SDThemeExpressionErrorDomain code:code userInfo:@{ NSLocalizedDescriptionKey: message }];
+}
+
+#pragma mark - Nodes
+
+typedef NS_ENUM(NSInteger, SDThemeExpressionNodeType) {
+    SDThemeExpressionNodeTypeNumber,
+    SDThemeExpressionNodeTypeColor,
+    SDThemeExpressionNodeTypeReference,
+    SDThemeExpressionNodeTypeNegate,
+    SDThemeExpressionNodeTypeBinary,
+    SDThemeExpressionNodeTypeCall,
+};
+
+@interface SDThemeExpressionNode : NSObject
+
+@property (nonatomic, assign) SDThemeExpressionNodeType type;
+@property (nonatomic, assign) double number;
+// reference name, color literal or function name
+@property (nonatomic, copy) NSString* name;
+@property (nonatomic, assign) unichar operation;
+@property (nonatomic, copy) NSArray<SDThemeExpressionNode*>* children;
+
+@end
+
+@implementation SDThemeExpressionNode
+@end
+
+#pragma mark - Parser
+
+/**
+ * Recursive descent parser:
+ *
+ *  expression := term (('+' | '-') term)*
+ *  term       := unary (('*' | '/') unary)*
+ *  unary      := '-' unary | primary
+ *  primary    := number | '#' hex | name | name '(' expression (',' expression)* ')' | '(' expression ')'
+ */
+@interface SDThemeExpressionParser : NSObject
+{
+    NSString* _string;
+    NSUInteger _index;
+}
+
+@property (nonatomic, strong) NSMutableSet<NSString*>* references;
+@property (nonatomic, copy) NSString* errorMessage;
+
+- (instancetype) initWithString:(NSString*)string;
+- (SDThemeExpressionNode*) parse;
+
+@end
+
+@implementation SDThemeExpressionParser
+
+- (instancetype) initWithString:(NSString*)string
+{
+    self = [super init];
+    if (self)
+    {
+        _string = [string copy];
+        _index = 0;
+        self.references = [NSMutableSet new];
+    }
+    return self;
+}
+
+- (SDThemeExpressionNode*) parse
+{
+    SDThemeExpressionNode* node = [self parseExpression];
+    [self skipWhitespaces];
+    if (node && _index < _string.length)
+    {
+        [self failWithMessage:@"unexpected character"];
+        return nil;
+    }
+    return node;
+}
+
+- (void) failWithMessage:(NSString*)message
+{
+    if (!self.errorMessage)
+    {
+        self.errorMessage = [NSString stringWithFormat:@"%@ at position %lu", message, (unsigned long)_index];
+    }
+}
+
+- (void) skipWhitespaces
+{
+    NSCharacterSet* whitespaces = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    while (_index < _string.length && [whitespaces characterIsMember:[_string characterAtIndex:_index]])
+    {
+        _index++;
+    }
+}
+
+- (unichar) peek
+{
+    [self skipWhitespaces];
+    return _index < _string.length ? [_string characterAtIndex:_index] : 0;
+}
+
+- (SDThemeExpressionNode*) binaryNodeWithOperation:(unichar)operation left:(SDThemeExpressionNode*)left right:(SDThemeExpressionNode*)right
+{
+    SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+    node.type = SDThemeExpressionNodeTypeBinary;
+    node.operation = operation;
+    node.children = @[left, right];
+    return node;
+}
+
+- (SDThemeExpressionNode*) parseExpression
+{
+    SDThemeExpressionNode* left = [self parseTerm];
+    while (left)
+    {
+        unichar character = [self peek];
+        if (character != '+' && character != '-')
+        {
+            break;
+        }
+        _index++;
+        SDThemeExpressionNode* right = [self parseTerm];
+        if (!right)
+        {
+            return nil;
+        }
+        left = [self binaryNodeWithOperation:character left:left right:right];
+    }
+    return left;
+}
+
+- (SDThemeExpressionNode*) parseTerm
+{
+    SDThemeExpressionNode* left = [self parseUnary];
+    while (left)
+    {
+        unichar character = [self peek];
+        if (character != '*' && character != '/')
+        {
+            break;
+        }
+        _index++;
+        SDThemeExpressionNode* right = [self parseUnary];
+        if (!right)
+        {
+            return nil;
+        }
+        left = [self binaryNodeWithOperation:character left:left right:right];
+    }
+    return left;
+}
+
+- (SDThemeExpressionNode*) parseUnary
+{
+    if ([self peek] == '-')
+    {
+        _index++;
+        SDThemeExpressionNode* operand = [self parseUnary];
+        if (!operand)
+        {
+            return nil;
+        }
+        SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+        node.type = SDThemeExpressionNodeTypeNegate;
+        node.children = @[operand];
+        return node;
+    }
+    return [self parsePrimary];
+}
+
+- (NSString*) scanCharactersInSet:(NSCharacterSet*)characterSet
+{
+    NSUInteger start = _index;
+    while (_index < _string.length && [characterSet characterIsMember:[_string characterAtIndex:_index]])
+    {
+        _index++;
+    }
+    return [_string substringWithRange:NSMakeRange(start, _index - start)];
+}
+
+- (SDThemeExpressionNode*) parsePrimary
+{
+    unichar character = [self peek];
+
+    if (character == '(')
+    {
+        _index++;
+        SDThemeExpressionNode* node = [self parseExpression];
+        if (node && [self peek] != ')')
+        {
+            [self failWithMessage:@"missing ')'"];
+            return nil;
+        }
+        _index++;
+        return node;
+    }
+
+    if (character == '#')
+    {
+        _index++;
+        NSString* literal = [self scanCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"]];
+        if (literal.length == 0)
+        {
+            [self failWithMessage:@"missing color value after '#'"];
+            return nil;
+        }
+        SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+        node.type = SDThemeExpressionNodeTypeColor;
+        node.name = literal;
+        return node;
+    }
+
+    if ((character >= '0' && character <= '9') || character == '.')
+    {
+        NSString* number = [self scanCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"0123456789."]];
+        SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+        node.type = SDThemeExpressionNodeTypeNumber;
+        node.number = number.doubleValue;
+        return node;
+    }
+
+    NSMutableCharacterSet* nameCharacters = [NSMutableCharacterSet alphanumericCharacterSet];
+    [nameCharacters addCharactersInString:@"_"];
+    if (character == '_' || [[NSCharacterSet letterCharacterSet] characterIsMember:character])
+    {
+        NSString* name = [self scanCharactersInSet:nameCharacters];
+        if ([self peek] != '(')
+        {
+            [self.references addObject:name];
+            SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+            node.type = SDThemeExpressionNodeTypeReference;
+            node.name = name;
+            return node;
+        }
+
+        _index++;
+        NSMutableArray<SDThemeExpressionNode*>* arguments = [NSMutableArray new];
+        if ([self peek] != ')')
+        {
+            while (YES)
+            {
+                SDThemeExpressionNode* argument = [self parseExpression];
+                if (!argument)
+                {
+                    return nil;
+                }
+                [arguments addObject:argument];
+                if ([self peek] != ',')
+                {
+                    break;
+                }
+                _index++;
+            }
+        }
+        if ([self peek] != ')')
+        {
+            [self failWithMessage:@"missing ')'"];
+            return nil;
+        }
+        _index++;
+
+        SDThemeExpressionNode* node = [SDThemeExpressionNode new];
+        node.type = SDThemeExpressionNodeTypeCall;
+        node.name = name.lowercaseString;
+        node.children = arguments;
+        return node;
+    }
+
+    [self failWithMessage:character == 0 ? @"unexpected end of expression" : @"unexpected character"];
+    return nil;
+}
+
+@end
+
+#pragma mark - Expression
+
+@interface SDThemeExpression ()
+
+@property (nonatomic, copy) NSString* string;
+@property (nonatomic, strong) NSSet<NSString*>* references;
+@property (nonatomic, strong) SDThemeExpressionNode* root;
+
+@end
+
+@implementation SDThemeExpression
+
++ (BOOL) isExpressionValue:(id)value
+{
+    return [value isKindOfClass:[NSString class]] && [value hasPrefix:EXPRESSION_IDENTIFIER];
+}
+
++ (instancetype) expressionWithString:(NSString*)string error:(NSError**)error
+{
+    if (![self isExpressionValue:string])
+    {
+        if (error)
+        {
+            *error = SDThemeExpressionMakeError(SDThemeExpressionErrorSyntax, @"'%@' is not an expression", string);
+        }
+        return nil;
+    }
+
+    SDThemeExpressionParser* parser = [[SDThemeExpressionParser alloc] initWithString:[string substringFromIndex:EXPRESSION_IDENTIFIER.length]];
+    SDThemeExpressionNode* root = [parser parse];
+    if (!root)
+    {
+        if (error)
+        {
+            *error = SDThemeExpressionMakeError(SDThemeExpressionErrorSyntax, @"Invalid expression '%@': %@", string, parser.errorMessage);
+        }
+        return nil;
+    }
+
+    SDThemeExpression* expression = [self new];
+    expression.string = string;
+    expression.references = [parser.references copy];
+    expression.root = root;
+    return expression;
+}
+
+- (id) evaluateWithContext:(id<SDThemeExpressionContext>)context error:(NSError**)error
+{
+    NSError* evaluationError = nil;
+    id value = [self evaluateNode:self.root context:context error:&evaluationError];
+    if (evaluationError)
+    {
+        if (error)
+        {
+            *error = SDThemeExpressionMakeError(evaluationError.code, @"Can't evaluate expression '%@': %@", self.string, evaluationError.localizedDescription);
+        }
+        return nil;
+    }
+    return value;
+}
+
+#pragma mark Evaluation
+
+- (NSNumber*) numberFromValue:(id)value
+{
+    if ([value isKindOfClass:[NSNumber class]])
+    {
+        return value;
+    }
+    if ([value isKindOfClass:[NSString class]])
+    {
+        // numeric constants are sometimes written as strings
+        NSScanner* scanner = [NSScanner scannerWithString:value];
+        double number;
+        if ([scanner scanDouble:&number] && scanner.isAtEnd)
+        {
+            return @(number);
+        }
+    }
+    return nil;
+}
+
+- (id) evaluateNode:(SDThemeExpressionNode*)node context:(id<SDThemeExpressionContext>)context error:(NSError**)error
+{
+    switch (node.type)
+    {
+        case SDThemeExpressionNodeTypeNumber:
+            return @(node.number);
+
+        case SDThemeExpressionNodeTypeColor:
+        {
+            SDThemeColorValue* color = [context colorForExpressionLiteral:node.name];
+            if (!color)
+            {
+                *error = SDThemeExpressionMakeError(SDThemeExpressionErrorSyntax, @"invalid color #%@", node.name);
+            }
+            return color;
+        }
+
+        case SDThemeExpressionNodeTypeReference:
+        {
+            id value = [context valueForExpressionReference:node.name];
+            if (!value)
+            {
+                *error = SDThemeExpressionMakeError(SDThemeExpressionErrorUnknownReference, @"unknown or unresolved constant %@", node.name);
+            }
+            return value;
+        }
+
+        case SDThemeExpressionNodeTypeNegate:
+        {
+            NSArray* operands = [self numbersForNodes:node.children context:context error:error];
+            return operands ? @(-[operands[0] doubleValue]) : nil;
+        }
+
+        case SDThemeExpressionNodeTypeBinary:
+        {
+            NSArray* operands = [self numbersForNodes:node.children context:context error:error];
+            if (!operands)
+            {
+                return nil;
+            }
+            double left = [operands[0] doubleValue];
+            double right = [operands[1] doubleValue];
+            switch (node.operation)
+            {
+                case '+': return @(left + right);
+                case '-': return @(left - right);
+                case '*': return @(left * right);
+                default:
+                    if (right == 0)
+                    {
+                        *error = SDThemeExpressionMakeError(SDThemeExpressionErrorType, @"division by zero");
+                        return nil;
+                    }
+                    return @(left / right);
+            }
+        }
+
+        case SDThemeExpressionNodeTypeCall:
+            return [self evaluateCall:node context:context error:error];
+    }
+    return nil;
+}
+
+- (NSArray<NSNumber*>*) numbersForNodes:(NSArray<SDThemeExpressionNode*>*)nodes context:(id<SDThemeExpressionContext>)context error:(NSError**)error
+{
+    NSMutableArray<NSNumber*>* numbers = [NSMutableArray new];
+    for (SDThemeExpressionNode* node in nodes)
+    {
+        id value = [self evaluateNode:node context:context error:error];
+        if (!value)
+        {
+            return nil;
+        }
+        NSNumber* number = [self numberFromValue:value];
+        if (!number)
+        {
+            *error = SDThemeExpressionMakeError(SDThemeExpressionErrorType, @"%@ is not a number", value);
+            return nil;
+        }
+        [numbers addObject:number];
+    }
+    return numbers;
+}
+
+- (BOOL) getComponents:(double*)components ofValue:(id)value error:(NSError**)error
+{
+    if (![value isKindOfClass:[SDThemeColorValue class]])
+    {
+        *error = SDThemeExpressionMakeError(SDThemeExpressionErrorType, @"%@ is not a RGB color", value);
+        return NO;
+    }
+    SDThemeColorValue* color = value;
+    components[0] = color.red;
+    components[1] = color.green;
+    components[2] = color.blue;
+    components[3] = color.alpha;
+    return YES;
+}
+
+- (SDThemeColorValue*) mixComponents:(const double*)components1 withComponents:(const double*)components2 fraction:(double)fraction keepAlpha:(BOOL)keepAlpha
+{
+    fraction = MIN(MAX(fraction, 0), 1);
+    double mixed[4];
+    for (int i = 0; i < 4; i++)
+    {
+        mixed[i] = components1[i] * (1 - fraction) + components2[i] * fraction;
+    }
+    return [SDThemeColorValue colorWithRed:mixed[0] green:mixed[1] blue:mixed[2] alpha:keepAlpha ? components1[3] : mixed[3]];
+}
+
+- (id) evaluateCall:(SDThemeExpressionNode*)node context:(id<SDThemeExpressionContext>)context error:(NSError**)error
+{
+    NSDictionary<NSString*, NSNumber*>* arities = @{ FUNCTION_ALPHA: @2, FUNCTION_MIX: @3, FUNCTION_LIGHTEN: @2, FUNCTION_DARKEN: @2, FUNCTION_MIN: @2, FUNCTION_MAX: @2, FUNCTION_ROUND: @1 };
+    NSNumber* arity = arities[node.name];
+    if (!arity)
+    {
+        *error = SDThemeExpressionMakeError(SDThemeExpressionErrorUnknownFunction, @"unknown function %@", node.name);
+        return nil;
+    }
+    if (node.children.count != arity.unsignedIntegerValue)
+    {
+        *error = SDThemeExpressionMakeError(SDThemeExpressionErrorSyntax, @"function %@ expects %@ arguments", node.name, arity);
+        return nil;
+    }
+
+    if ([node.name isEqualToString:FUNCTION_MIN] || [node.name isEqualToString:FUNCTION_MAX] || [node.name isEqualToString:FUNCTION_ROUND])
+    {
+        NSArray<NSNumber*>* numbers = [self numbersForNodes:node.children context:context error:error];
+        if (!numbers)
+        {
+            return nil;
+        }
+        if ([node.name isEqualToString:FUNCTION_ROUND])
+        {
+            return @(round(numbers[0].doubleValue));
+        }
+        double first = numbers[0].doubleValue;
+        double second = numbers[1].doubleValue;
+        return @([node.name isEqualToString:FUNCTION_MIN] ? MIN(first, second) : MAX(first, second));
+    }
+
+    // color functions: the first argument is a color, the last one a number
+    double components[4];
+    id color = [self evaluateNode:node.children.firstObject context:context error:error];
+    if (!color || ![self getComponents:components ofValue:color error:error])
+    {
+        return nil;
+    }
+    NSArray<NSNumber*>* numbers = [self numbersForNodes:@[node.children.lastObject] context:context error:error];
+    if (!numbers)
+    {
+        return nil;
+    }
+    double fraction = numbers[0].doubleValue;
+
+    if ([node.name isEqualToString:FUNCTION_ALPHA])
+    {
+        return [SDThemeColorValue colorWithRed:components[0] green:components[1] blue:components[2] alpha:MIN(MAX(fraction, 0), 1)];
+    }
+    if ([node.name isEqualToString:FUNCTION_LIGHTEN])
+    {
+        const double white[4] = { 1, 1, 1, 1 };
+        return [self mixComponents:components withComponents:white fraction:fraction keepAlpha:YES];
+    }
+    if ([node.name isEqualToString:FUNCTION_DARKEN])
+    {
+        const double black[4] = { 0, 0, 0, 1 };
+        return [self mixComponents:components withComponents:black fraction:fraction keepAlpha:YES];
+    }
+
+    // mix
+    double otherComponents[4];
+    id otherColor = [self evaluateNode:node.children[1] context:context error:error];
+    if (!otherColor || ![self getComponents:otherComponents ofValue:otherColor error:error])
+    {
+        return nil;
+    }
+    return [self mixComponents:components withComponents:otherComponents fraction:fraction keepAlpha:NO];
+}
+
+@end
@@ -0,0 +1,35 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Watches a file for changes with a dispatch source. Editors that save by replacing the file (atomic writes) are handled by watching the new file; if the file does not exist, its directory is watched until it is created.
+ * Where the file system events are not available to dispatch sources (outside of Apple platforms) the modification date and the size of the file are polled every second.
+ */
+@interface SDThemeFileWatcher : NSObject
+
+/**
+ * @param path the path of the file to watch
+ * @param queue the queue the handler is called on
+ * @param handler called every time the file is written, replaced or created
+ */
+- (instancetype) initWithPath:(NSString*)path queue:(dispatch_queue_t)queue handler:(void (^)(NSString* path))handler;
+
+@property (nonatomic, copy, readonly) NSString* path;
+
+- (void) start;
+- (void) stop;
+
+@end
@@ -0,0 +1,172 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeFileWatcher.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// interval of the polling of the file where there are no vnode dispatch sources, in seconds
+#define POLLING_INTERVAL    1
+
+@interface SDThemeFileWatcher ()
+
+@property (nonatomic, copy) NSString* path;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, copy) void (^handler)(NSString* path);
+@property (nonatomic, strong) dispatch_source_t source;
+// YES if the source is watching the directory because the file does not exist
+@property (nonatomic, assign) BOOL watchingDirectory;
+// modification date and size of the file at the last poll, nil if it did not exist
+@property (nonatomic, strong) NSDate* polledModificationDate;
+@property (nonatomic, strong) NSNumber* polledSize;
+
+@end
+
+@implementation SDThemeFileWatcher
+
+- (instancetype) initWithPath:(NSString*)path queue:(dispatch_queue_t)queue handler:(void (^)(NSString* path))handler
+{
+    self = [super init];
+    if (self)
+    {
+        self.path = path;
+        self.queue = queue ?: dispatch_get_main_queue();
+        self.handler = handler;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [self stop];
+}
+
+#if defined(__APPLE__)
+
+- (void) start
+{
+    if (self.source)
+    {
+        return;
+    }
+    
+    int fileDescriptor = open(self.path.fileSystemRepresentation, O_EVTONLY);
+    self.watchingDirectory = fileDescriptor < 0;
+    if (self.watchingDirectory)
+    {
+        fileDescriptor = open(self.path.stringByDeletingLastPathComponent.fileSystemRepresentation, O_EVTONLY);
+        if (fileDescriptor < 0)
+        {
+            return;
+        }
+    }
+    
+    unsigned long mask = self.watchingDirectory ? DISPATCH_VNODE_WRITE : DISPATCH_VNODE_WRITE | DISPATCH_VNODE_EXTEND | DISPATCH_VNODE_ATTRIB | DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME;
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fileDescriptor, mask, self.queue);
+    
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(source, ^{
+        [weakSelf handleEvent:dispatch_source_get_data(source)];
+    });
+    dispatch_source_set_cancel_handler(source, ^{
+        close(fileDescriptor);
+    });
+    self.source = source;
+    dispatch_resume(source);
+}
+
+#else
+
+- (void) start
+{
+    if (self.source)
+    {
+        return;
+    }
+    [self pollFile];
+    
+    dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(source, dispatch_time(DISPATCH_TIME_NOW, POLLING_INTERVAL * NSEC_PER_SEC), POLLING_INTERVAL * NSEC_PER_SEC, NSEC_PER_SEC / 10);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(source, ^{
+        typeof(self) strongSelf = weakSelf;
+        if ([strongSelf pollFile] && strongSelf.handler)
+        {
+            strongSelf.handler(strongSelf.path);
+        }
+    });
+    self.source = source;
+    dispatch_resume(source);
+}
+
+/**
+ * @return YES if the file has been written, replaced or created since the last poll
+ */
+- (BOOL) pollFile
+{
+    NSDictionary<NSFileAttributeKey, id>* attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:self.path error:nil];
+    NSDate* modificationDate = attributes.fileModificationDate;
+    NSNumber* size = attributes[NSFileSize];
+    BOOL changed = modificationDate && (![modificationDate isEqual:self.polledModificationDate] || ![size isEqual:self.polledSize]);
+    self.polledModificationDate = modificationDate;
+    self.polledSize = size;
+    return changed;
+}
+
+#endif
+
+- (void) stop
+{
+    if (self.source)
+    {
+        dispatch_source_cancel(self.source);
+        self.source = nil;
+    }
+}
+
+#if defined(__APPLE__)
+
+- (void) handleEvent:(unsigned long)flags
+{
+    if (self.watchingDirectory)
+    {
+        // something changed in the directory: switches to the file as soon as it exists
+        if (![[NSFileManager defaultManager] fileExistsAtPath:self.path])
+        {
+            return;
+        }
+        [self stop];
+        [self start];
+    }
+    else if (flags & (DISPATCH_VNODE_DELETE | DISPATCH_VNODE_RENAME))
+    {
+        // the file has been replaced: the descriptor refers to the old one
+        [self stop];
+        [self start];
+        if (self.watchingDirectory)
+        {
+            // the new file is not there yet, the handler will be called when it is created
+            return;
+        }
+    }
+    
+    if (self.handler)
+    {
+        self.handler(self.path);
+    }
+}
+
+#endif
+
+@end
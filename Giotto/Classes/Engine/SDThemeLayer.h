@@ -0,0 +1,74 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Memory used by a compiled theme layer.
+ */
+@interface SDThemeLayerFootprint : NSObject
+
+// name of the layer (the plist file name)
+@property (nonatomic, copy, readonly) NSString* layerName;
+// heap used by the records stored in the layer, including its lookup table
+@property (nonatomic, assign, readonly) NSUInteger ownBytes;
+// size of the identical records reused from other layers instead of being stored again
+@property (nonatomic, assign, readonly) NSUInteger sharedBytes;
+// number of records stored in the layer
+@property (nonatomic, assign, readonly) NSUInteger recordCount;
+// number of records reused from other layers
+@property (nonatomic, assign, readonly) NSUInteger sharedRecordCount;
+
+@end
+
+
+/**
+ * Compact, immutable representation of a theme layer.
+ *
+ * Keys and string values are stored as identifiers of the shared SDThemeStringTable; values are fixed size records allocated in an arena owned by the layer.
+ * Records are unique: identical values and subtrees are stored once inside the layer and, when they already exist in one of the layers given at compile time, they are referenced instead of being copied.
+ *
+ * The layer is exposed as an immutable NSDictionary, so it can be used everywhere a theme dictionary is expected. Leaf values are materialized when the layer is compiled, collections the first time they are accessed and then kept by their parent, so repeated lookups do not allocate.
+ */
+@interface SDThemeLayer : NSObject
+
+/**
+ * Compiles a theme dictionary.
+ *
+ * @param theme the theme dictionary, as loaded from the plist
+ * @param name the name of the layer, used for diagnostics
+ * @param layers already compiled layers whose records can be shared with the new one. They are retained by the new layer.
+ *
+ * @return the compiled layer
+ */
++ (instancetype) layerWithTheme:(NSDictionary*)theme name:(NSString*)name sharingWithLayers:(NSArray<SDThemeLayer*>*)layers;
+
+/**
+ * @return the layer that backs the given dictionary, or nil if it is not a compiled theme dictionary.
+ */
++ (SDThemeLayer*) layerOfDictionary:(NSDictionary*)dictionary;
+
+@property (nonatomic, copy, readonly) NSString* name;
+
+/**
+ * The root of the layer as an immutable dictionary.
+ */
+@property (nonatomic, strong, readonly) NSDictionary* dictionary;
+
+/**
+ * @return the memory used by the layer.
+ */
+- (SDThemeLayerFootprint*) footprint;
+
+@end
@@ -0,0 +1,807 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeLayer.h"
+#import "SDThemeStringTable.h"
+#import "SDThemeLogger.h"
+#include <stdatomic.h>
+
+#define ARENA_BLOCK_SIZE                (16 * 1024)
+#define ARENA_ALIGNMENT                 8
+#define RECORD_TABLE_INITIAL_CAPACITY   256
+
+#pragma mark - Records
+
+typedef NS_ENUM(uint8_t, SDThemeRecordKind) {
+    SDThemeRecordKindString,
+    SDThemeRecordKindInteger,
+    SDThemeRecordKindReal,
+    SDThemeRecordKindBoolean,
+    SDThemeRecordKindDictionary,
+    SDThemeRecordKindArray,
+    SDThemeRecordKindObject,
+};
+
+typedef struct SDThemeRecord SDThemeRecord;
+
+typedef struct SDThemeEntry {
+    uint32_t keyID;
+    const SDThemeRecord* value;
+} SDThemeEntry;
+
+struct SDThemeRecord {
+    SDThemeRecordKind kind;
+    uint32_t count;     // number of entries of a dictionary or of items of an array
+    uint32_t hash;
+    uint32_t bytes;     // bytes used by the record and by its entries/items, children excluded
+    union {
+        uint32_t stringID;
+        int64_t integer;
+        double real;
+        const SDThemeEntry* entries;        // sorted by keyID
+        const SDThemeRecord* const* items;
+    } payload;
+    // materialized value of a leaf, created when the record is stored: the NSString of the string table, or the NSNumber or object retained by the layer
+    const void* object;
+};
+
+// slot of a materialized child collection, holding a +1 reference
+typedef _Atomic(void*) SDThemeChildSlot;
+
+typedef struct SDThemeArenaBlock {
+    struct SDThemeArenaBlock* next;
+    size_t capacity;
+    size_t used;
+    char data[];
+} SDThemeArenaBlock;
+
+static inline uint32_t SDThemeHashMix(uint32_t hash, uint64_t value)
+{
+    uint64_t mixed = ((uint64_t)hash ^ value) * 0x100000001b3ULL;
+    return (uint32_t)(mixed ^ (mixed >> 32));
+}
+
+static int SDThemeEntryCompare(const void* entry1, const void* entry2)
+{
+    uint32_t key1 = ((const SDThemeEntry*)entry1)->keyID;
+    uint32_t key2 = ((const SDThemeEntry*)entry2)->keyID;
+    return key1 < key2 ? -1 : (key1 > key2 ? 1 : 0);
+}
+
+static BOOL SDThemeRecordsEqual(const SDThemeRecord* record1, const SDThemeRecord* record2)
+{
+    if (record1->kind != record2->kind || record1->count != record2->count || record1->hash != record2->hash)
+    {
+        return NO;
+    }
+    switch (record1->kind)
+    {
+        case SDThemeRecordKindString:
+            return record1->payload.stringID == record2->payload.stringID;
+        case SDThemeRecordKindInteger:
+        case SDThemeRecordKindBoolean:
+            return record1->payload.integer == record2->payload.integer;
+        case SDThemeRecordKindReal:
+            return memcmp(&record1->payload.real, &record2->payload.real, sizeof(double)) == 0;
+        case SDThemeRecordKindDictionary:
+            // children are unique, so comparing their addresses compares the whole subtrees
+            for (uint32_t i = 0; i < record1->count; i++)
+            {
+                if (record1->payload.entries[i].keyID != record2->payload.entries[i].keyID ||
+                    record1->payload.entries[i].value != record2->payload.entries[i].value)
+                {
+                    return NO;
+                }
+            }
+            return YES;
+        case SDThemeRecordKindArray:
+            for (uint32_t i = 0; i < record1->count; i++)
+            {
+                if (record1->payload.items[i] != record2->payload.items[i])
+                {
+                    return NO;
+                }
+            }
+            return YES;
+        case SDThemeRecordKindObject:
+            return record1 == record2;
+    }
+    return NO;
+}
+
+/**
+ * @return the index of the entry with the given key, or UINT32_MAX if the dictionary does not contain the key
+ */
+static uint32_t SDThemeRecordIndexOfKeyID(const SDThemeRecord* record, uint32_t keyID)
+{
+    if (record == NULL || record->kind != SDThemeRecordKindDictionary)
+    {
+        return UINT32_MAX;
+    }
+    // binary search on the sorted entries
+    uint32_t low = 0;
+    uint32_t high = record->count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t middleKey = record->payload.entries[middle].keyID;
+        if (middleKey == keyID)
+        {
+            return middle;
+        }
+        if (middleKey < keyID)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return UINT32_MAX;
+}
+
+
+@interface SDThemeLayer ()
+{
+    SDThemeArenaBlock* _blocks;
+    const SDThemeRecord** _slots;
+    uint32_t _slotCapacity;
+    uint32_t _slotCount;
+    NSUInteger _arenaBytes;
+    NSUInteger _recordCount;
+    CFMutableSetRef _sharedRecords;
+    // identifiers of the strings retained in the string table, and the same by string while compiling
+    uint32_t* _stringIDs;
+    NSUInteger _stringIDCount;
+    CFMutableDictionaryRef _stringIDsByString;
+    NSUInteger _sharedBytes;
+    NSUInteger _sharedRecordCount;
+    const SDThemeRecord* _root;
+}
+
+@property (nonatomic, copy) NSString* name;
+@property (nonatomic, strong) NSArray<SDThemeLayer*>* sharedLayers;
+@property (nonatomic, strong) NSMutableArray* objects;
+@property (nonatomic, strong) SDThemeStringTable* stringTable;
+
+- (id) objectForRecord:(const SDThemeRecord*)record;
+
+@end
+
+
+/**
+ * Returns the materialized child of a collection. Leaves are materialized when the layer is compiled; collections the first time they are accessed, then kept by their parent, so repeated lookups do not allocate.
+ *
+ * @param layer the layer of the parent
+ * @param child the record of the child
+ * @param children the slots of the children of the parent, allocated at the first access
+ * @param count the number of children of the parent
+ * @param index the index of the child
+ */
+static id SDThemeChildObject(SDThemeLayer* layer, const SDThemeRecord* child, SDThemeChildSlot* _Atomic* children, uint32_t count, uint32_t index)
+{
+    if (child->kind != SDThemeRecordKindDictionary && child->kind != SDThemeRecordKindArray)
+    {
+        return (__bridge id)child->object;
+    }
+
+    // the parent may be read by several threads: the slots are published with a compare and swap and the loser discards its copy
+    SDThemeChildSlot* slots = atomic_load_explicit(children, memory_order_acquire);
+    if (slots == NULL)
+    {
+        SDThemeChildSlot* newSlots = calloc(count, sizeof(SDThemeChildSlot));
+        if (atomic_compare_exchange_strong(children, &slots, newSlots))
+        {
+            slots = newSlots;
+        }
+        else
+        {
+            free(newSlots);
+        }
+    }
+    void* cached = atomic_load_explicit(&slots[index], memory_order_acquire);
+    if (cached)
+    {
+        return (__bridge id)cached;
+    }
+    void* object = (void*)CFBridgingRetain([layer objectForRecord:child]);
+    if (!atomic_compare_exchange_strong(&slots[index], &cached, object))
+    {
+        CFRelease(object);
+        return (__bridge id)cached;
+    }
+    return (__bridge id)object;
+}
+
+static void SDThemeReleaseChildren(SDThemeChildSlot* slots, uint32_t count)
+{
+    if (slots == NULL)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        void* child = atomic_load_explicit(&slots[i], memory_order_relaxed);
+        if (child)
+        {
+            CFRelease(child);
+        }
+    }
+    free(slots);
+}
+
+
+@interface SDThemeLayerFootprint ()
+
+@property (nonatomic, copy) NSString* layerName;
+@property (nonatomic, assign) NSUInteger ownBytes;
+@property (nonatomic, assign) NSUInteger sharedBytes;
+@property (nonatomic, assign) NSUInteger recordCount;
+@property (nonatomic, assign) NSUInteger sharedRecordCount;
+
+@end
+
+@implementation SDThemeLayerFootprint
+
+- (NSString*) description
+{
+    return [NSString stringWithFormat:@"<%@: %@ own %lu bytes (%lu records), shared %lu bytes (%lu records)>", NSStringFromClass(self.class), self.layerName, (unsigned long)self.ownBytes, (unsigned long)self.recordCount, (unsigned long)self.sharedBytes, (unsigned long)self.sharedRecordCount];
+}
+
+@end
+
+
+#pragma mark - Collections
+
+/**
+ * Immutable dictionary backed by a dictionary record. Keys are looked up by identifier with a binary search; the child collections are materialized once and kept by the dictionary.
+ */
+@interface SDThemeCompactDictionary : NSDictionary
+{
+    const SDThemeRecord* _record;
+    SDThemeLayer* _layer;
+    SDThemeChildSlot* _Atomic _children;
+}
+
+- (instancetype) initWithRecord:(const SDThemeRecord*)record layer:(SDThemeLayer*)layer;
+
+@property (nonatomic, strong, readonly) SDThemeLayer* layer;
+
+@end
+
+/**
+ * Immutable array backed by an array record. The child collections are materialized once and kept by the array.
+ */
+@interface SDThemeCompactArray : NSArray
+{
+    const SDThemeRecord* _record;
+    SDThemeLayer* _layer;
+    SDThemeChildSlot* _Atomic _children;
+}
+
+- (instancetype) initWithRecord:(const SDThemeRecord*)record layer:(SDThemeLayer*)layer;
+
+@end
+
+
+@implementation SDThemeCompactDictionary
+
+- (instancetype) initWithRecord:(const SDThemeRecord*)record layer:(SDThemeLayer*)layer
+{
+    self = [super init];
+    if (self)
+    {
+        _record = record;
+        _layer = layer;
+    }
+    return self;
+}
+
+- (instancetype) initWithObjects:(const id [])objects forKeys:(const id<NSCopying> [])keys count:(NSUInteger)count
+{
+    // compact dictionaries are only created from records
+    return self;
+}
+
+- (void) dealloc
+{
+    SDThemeReleaseChildren(atomic_load_explicit(&_children, memory_order_acquire), _record ? _record->count : 0);
+}
+
+- (SDThemeLayer*) layer
+{
+    return _layer;
+}
+
+- (NSUInteger) count
+{
+    return _record ? _record->count : 0;
+}
+
+- (id) objectForKey:(id)key
+{
+    if (_record == NULL || ![key isKindOfClass:[NSString class]])
+    {
+        return nil;
+    }
+    uint32_t keyID = [_layer.stringTable existingIdentifierForString:key];
+    if (keyID == SDThemeStringNotFound)
+    {
+        return nil;
+    }
+    uint32_t index = SDThemeRecordIndexOfKeyID(_record, keyID);
+    if (index == UINT32_MAX)
+    {
+        return nil;
+    }
+    return SDThemeChildObject(_layer, _record->payload.entries[index].value, &_children, _record->count, index);
+}
+
+- (NSArray*) allKeys
+{
+    NSUInteger count = self.count;
+    NSMutableArray* keys = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        [keys addObject:[_layer.stringTable stringForIdentifier:_record->payload.entries[i].keyID]];
+    }
+    return keys;
+}
+
+- (NSEnumerator*) keyEnumerator
+{
+    return [[self allKeys] objectEnumerator];
+}
+
+- (void) enumerateKeysAndObjectsWithOptions:(NSEnumerationOptions)options usingBlock:(void (^)(id key, id obj, BOOL* stop))block
+{
+    BOOL stop = NO;
+    NSUInteger count = self.count;
+    for (NSUInteger i = 0; i < count && !stop; i++)
+    {
+        const SDThemeEntry* entry = &_record->payload.entries[i];
+        block([_layer.stringTable stringForIdentifier:entry->keyID], SDThemeChildObject(_layer, entry->value, &_children, _record->count, (uint32_t)i), &stop);
+    }
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+@end
+
+
+@implementation SDThemeCompactArray
+
+- (instancetype) initWithRecord:(const SDThemeRecord*)record layer:(SDThemeLayer*)layer
+{
+    self = [super init];
+    if (self)
+    {
+        _record = record;
+        _layer = layer;
+    }
+    return self;
+}
+
+- (instancetype) initWithObjects:(const id [])objects count:(NSUInteger)count
+{
+    // compact arrays are only created from records
+    return self;
+}
+
+- (void) dealloc
+{
+    SDThemeReleaseChildren(atomic_load_explicit(&_children, memory_order_acquire), _record ? _record->count : 0);
+}
+
+- (NSUInteger) count
+{
+    return _record ? _record->count : 0;
+}
+
+- (id) objectAtIndex:(NSUInteger)index
+{
+    if (index >= self.count)
+    {
+        [NSException raise:NSRangeException format:@"Index %lu beyond bounds [0 .. %lu]", (unsigned long)index, (unsigned long)self.count];
+    }
+    return SDThemeChildObject(_layer, _record->payload.items[index], &_children, _record->count, (uint32_t)index);
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+@end
+
+
+#pragma mark - Layer
+
+@implementation SDThemeLayer
+
++ (instancetype) layerWithTheme:(NSDictionary*)theme name:(NSString*)name sharingWithLayers:(NSArray<SDThemeLayer*>*)layers
+{
+    SDThemeLayer* layer = [[self alloc] init];
+    layer.name = name;
+    layer.sharedLayers = layers ?: @[];
+    [layer compileTheme:theme];
+    return layer;
+}
+
++ (SDThemeLayer*) layerOfDictionary:(NSDictionary*)dictionary
+{
+    if ([dictionary isKindOfClass:[SDThemeCompactDictionary class]])
+    {
+        return ((SDThemeCompactDictionary*)dictionary).layer;
+    }
+    return nil;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.stringTable = [SDThemeStringTable sharedTable];
+        self.objects = [NSMutableArray new];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    SDThemeArenaBlock* block = _blocks;
+    while (block)
+    {
+        SDThemeArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(_slots);
+    // the strings used only by this layer are removed from the table
+    [self.stringTable releaseIdentifiers:_stringIDs count:_stringIDCount];
+    free(_stringIDs);
+}
+
+- (NSDictionary*) dictionary
+{
+    // not stored, the dictionary retains the layer
+    return [[SDThemeCompactDictionary alloc] initWithRecord:_root layer:self];
+}
+
+- (SDThemeLayerFootprint*) footprint
+{
+    SDThemeLayerFootprint* footprint = [SDThemeLayerFootprint new];
+    footprint.layerName = self.name;
+    footprint.ownBytes = _arenaBytes + _slotCapacity * sizeof(SDThemeRecord*);
+    footprint.sharedBytes = _sharedBytes;
+    footprint.recordCount = _recordCount;
+    footprint.sharedRecordCount = _sharedRecordCount;
+    return footprint;
+}
+
+#pragma mark Compilation
+
+- (void) compileTheme:(NSDictionary*)theme
+{
+    _sharedRecords = CFSetCreateMutable(kCFAllocatorDefault, 0, NULL);
+    _stringIDsByString = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+    _root = [self recordForObject:theme ?: @{}];
+    CFRelease(_stringIDsByString);
+    _stringIDsByString = NULL;
+
+    // the shared records are counted once, however many times they are referenced
+    CFIndex sharedCount = CFSetGetCount(_sharedRecords);
+    const void** sharedRecords = malloc(sizeof(void*) * MAX(sharedCount, 1));
+    CFSetGetValues(_sharedRecords, sharedRecords);
+    for (CFIndex i = 0; i < sharedCount; i++)
+    {
+        _sharedBytes += ((const SDThemeRecord*)sharedRecords[i])->bytes;
+    }
+    _sharedRecordCount = (NSUInteger)sharedCount;
+    free(sharedRecords);
+    CFRelease(_sharedRecords);
+    _sharedRecords = NULL;
+}
+
+/**
+ * Returns the identifier of a string of the theme being compiled, retaining it in the string table once for the layer.
+ */
+- (uint32_t) identifierForString:(NSString*)string
+{
+    const void* value = NULL;
+    if (CFDictionaryGetValueIfPresent(_stringIDsByString, (__bridge CFStringRef)string, &value))
+    {
+        return (uint32_t)(uintptr_t)value;
+    }
+    uint32_t identifier = [self.stringTable retainIdentifierForString:string];
+    CFDictionarySetValue(_stringIDsByString, (__bridge CFStringRef)string, (const void*)(uintptr_t)identifier);
+    if ((_stringIDCount & (_stringIDCount - 1)) == 0)
+    {
+        // grows at every power of two
+        _stringIDs = realloc(_stringIDs, MAX(_stringIDCount * 2, 64) * sizeof(uint32_t));
+    }
+    _stringIDs[_stringIDCount++] = identifier;
+    return identifier;
+}
+
+- (void*) allocateBytes:(size_t)size
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+    if (_blocks == NULL || _blocks->capacity - _blocks->used < size)
+    {
+        size_t capacity = MAX((size_t)ARENA_BLOCK_SIZE, size);
+        SDThemeArenaBlock* block = malloc(sizeof(SDThemeArenaBlock) + capacity);
+        block->next = _blocks;
+        block->capacity = capacity;
+        block->used = 0;
+        _blocks = block;
+        _arenaBytes += sizeof(SDThemeArenaBlock) + capacity;
+    }
+    void* pointer = _blocks->data + _blocks->used;
+    _blocks->used += size;
+    return pointer;
+}
+
+- (const SDThemeRecord*) findRecord:(const SDThemeRecord*)candidate
+{
+    if (_slotCapacity == 0)
+    {
+        return NULL;
+    }
+    uint32_t mask = _slotCapacity - 1;
+    for (uint32_t index = candidate->hash & mask; ; index = (index + 1) & mask)
+    {
+        const SDThemeRecord* record = _slots[index];
+        if (record == NULL)
+        {
+            return NULL;
+        }
+        if (SDThemeRecordsEqual(record, candidate))
+        {
+            return record;
+        }
+    }
+}
+
+- (void) insertRecord:(const SDThemeRecord*)record
+{
+    if ((_slotCount + 1) * 10 > _slotCapacity * 7)
+    {
+        // grows the open addressing table keeping the load factor under 0.7
+        uint32_t oldCapacity = _slotCapacity;
+        const SDThemeRecord** oldSlots = _slots;
+        _slotCapacity = oldCapacity > 0 ? oldCapacity * 2 : RECORD_TABLE_INITIAL_CAPACITY;
+        _slots = calloc(_slotCapacity, sizeof(SDThemeRecord*));
+        _slotCount = 0;
+        for (uint32_t i = 0; i < oldCapacity; i++)
+        {
+            if (oldSlots[i])
+            {
+                [self insertRecord:oldSlots[i]];
+            }
+        }
+        free(oldSlots);
+    }
+    uint32_t mask = _slotCapacity - 1;
+    uint32_t index = record->hash & mask;
+    while (_slots[index] != NULL)
+    {
+        index = (index + 1) & mask;
+    }
+    _slots[index] = record;
+    _slotCount++;
+}
+
+/**
+ * Returns the unique record equal to the candidate: an existing one of this layer or of the shared layers, otherwise a copy of the candidate allocated in the arena.
+ */
+- (const SDThemeRecord*) uniqueRecord:(SDThemeRecord*)candidate payloadBytes:(size_t)payloadBytes
+{
+    const SDThemeRecord* existing = [self findRecord:candidate];
+    if (existing)
+    {
+        return existing;
+    }
+    for (SDThemeLayer* layer in self.sharedLayers)
+    {
+        existing = [layer findRecord:candidate];
+        if (existing)
+        {
+            CFSetAddValue(_sharedRecords, existing);
+            return existing;
+        }
+    }
+
+    SDThemeRecord* record = [self allocateBytes:sizeof(SDThemeRecord)];
+    *record = *candidate;
+    if (payloadBytes > 0)
+    {
+        void* payload = [self allocateBytes:payloadBytes];
+        if (candidate->kind == SDThemeRecordKindDictionary)
+        {
+            memcpy(payload, candidate->payload.entries, payloadBytes);
+            record->payload.entries = payload;
+        }
+        else
+        {
+            memcpy(payload, candidate->payload.items, payloadBytes);
+            record->payload.items = payload;
+        }
+    }
+    record->bytes = (uint32_t)(sizeof(SDThemeRecord) + payloadBytes);
+    record->object = [self materializedLeafOfRecord:record];
+    [self insertRecord:record];
+    _recordCount++;
+    return record;
+}
+
+- (const SDThemeRecord*) recordForObject:(id)object
+{
+    SDThemeRecord candidate;
+    memset(&candidate, 0, sizeof(candidate));
+
+    if ([object isKindOfClass:[NSString class]])
+    {
+        candidate.kind = SDThemeRecordKindString;
+        candidate.payload.stringID = [self identifierForString:object];
+        candidate.hash = SDThemeHashMix(candidate.kind, candidate.payload.stringID);
+        return [self uniqueRecord:&candidate payloadBytes:0];
+    }
+
+    if ([object isKindOfClass:[NSNumber class]])
+    {
+        if (CFGetTypeID((__bridge CFTypeRef)object) == CFBooleanGetTypeID())
+        {
+            candidate.kind = SDThemeRecordKindBoolean;
+            candidate.payload.integer = [object boolValue];
+        }
+        else if (CFNumberIsFloatType((__bridge CFNumberRef)object))
+        {
+            candidate.kind = SDThemeRecordKindReal;
+            candidate.payload.real = [object doubleValue];
+        }
+        else
+        {
+            candidate.kind = SDThemeRecordKindInteger;
+            candidate.payload.integer = [object longLongValue];
+        }
+        uint64_t bits;
+        memcpy(&bits, &candidate.payload, sizeof(bits));
+        candidate.hash = SDThemeHashMix(candidate.kind, bits);
+        return [self uniqueRecord:&candidate payloadBytes:0];
+    }
+
+    if ([object isKindOfClass:[NSDictionary class]])
+    {
+        NSDictionary* dictionary = object;
+        SDThemeEntry* entries = malloc(sizeof(SDThemeEntry) * MAX(dictionary.count, 1));
+        uint32_t count = 0;
+        for (id key in dictionary)
+        {
+            if (![key isKindOfClass:[NSString class]])
+            {
+                SDLogModuleWarning(kThemeManagerLogModuleName, @"Key %@ of theme %@ is not a string and will be ignored", key, self.name);
+                continue;
+            }
+            const SDThemeRecord* value = [self recordForObject:dictionary[key]];
+            if (value)
+            {
+                entries[count].keyID = [self identifierForString:key];
+                entries[count].value = value;
+                count++;
+            }
+        }
+        qsort(entries, count, sizeof(SDThemeEntry), SDThemeEntryCompare);
+
+        candidate.kind = SDThemeRecordKindDictionary;
+        candidate.count = count;
+        candidate.payload.entries = entries;
+        candidate.hash = SDThemeHashMix(candidate.kind, count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            candidate.hash = SDThemeHashMix(candidate.hash, ((uint64_t)entries[i].keyID << 32) | entries[i].value->hash);
+        }
+        const SDThemeRecord* record = [self uniqueRecord:&candidate payloadBytes:sizeof(SDThemeEntry) * count];
+        free(entries);
+        return record;
+    }
+
+    if ([object isKindOfClass:[NSArray class]])
+    {
+        NSArray* array = object;
+        const SDThemeRecord** items = malloc(sizeof(SDThemeRecord*) * MAX(array.count, 1));
+        uint32_t count = 0;
+        for (id item in array)
+        {
+            const SDThemeRecord* value = [self recordForObject:item];
+            if (value)
+            {
+                items[count++] = value;
+            }
+        }
+
+        candidate.kind = SDThemeRecordKindArray;
+        candidate.count = count;
+        candidate.payload.items = items;
+        candidate.hash = SDThemeHashMix(candidate.kind, count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            candidate.hash = SDThemeHashMix(candidate.hash, items[i]->hash);
+        }
+        const SDThemeRecord* record = [self uniqueRecord:&candidate payloadBytes:sizeof(SDThemeRecord*) * count];
+        free(items);
+        return record;
+    }
+
+    if (object)
+    {
+        // dates and data are kept as objects and never shared
+        [self.objects addObject:object];
+        SDThemeRecord* record = [self allocateBytes:sizeof(SDThemeRecord)];
+        memset(record, 0, sizeof(SDThemeRecord));
+        record->kind = SDThemeRecordKindObject;
+        record->object = (__bridge const void*)object;
+        record->bytes = sizeof(SDThemeRecord);
+        _recordCount++;
+        return record;
+    }
+    return NULL;
+}
+
+#pragma mark Materialization
+
+/**
+ * Creates the value of a new leaf record once, so that reading it never allocates. Numbers are retained by the layer, strings by the string table.
+ */
+- (const void*) materializedLeafOfRecord:(const SDThemeRecord*)record
+{
+    id object = nil;
+    switch (record->kind)
+    {
+        case SDThemeRecordKindString:
+            return (__bridge const void*)[self.stringTable stringForIdentifier:record->payload.stringID];
+        case SDThemeRecordKindInteger:
+            object = @(record->payload.integer);
+            break;
+        case SDThemeRecordKindReal:
+            object = @(record->payload.real);
+            break;
+        case SDThemeRecordKindBoolean:
+            return (__bridge const void*)(record->payload.integer ? @YES : @NO);
+        default:
+            return NULL;
+    }
+    [self.objects addObject:object];
+    return (__bridge const void*)object;
+}
+
+- (id) objectForRecord:(const SDThemeRecord*)record
+{
+    switch (record->kind)
+    {
+        case SDThemeRecordKindDictionary:
+            return [[SDThemeCompactDictionary alloc] initWithRecord:record layer:self];
+        case SDThemeRecordKindArray:
+            return [[SDThemeCompactArray alloc] initWithRecord:record layer:self];
+        default:
+            return (__bridge id)record->object;
+    }
+}
+
+@end
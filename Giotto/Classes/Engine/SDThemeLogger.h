@@ -1,6 +1,6 @@
 
 
-#import <UIKit/UIKit.h>
+#import <Foundation/Foundation.h>
 
 // This code is compatible with our logger "Blabber".
 #define kThemeManagerLogModuleName @"Giotto"
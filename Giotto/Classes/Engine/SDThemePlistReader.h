@@ -0,0 +1,46 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Reads a theme plist in a single pass, without building the property list of the file first.
+ *
+ * The values of the top level keys in copiedKeys (eg. "Constants") are copied in the theme, while the entries of all the other top level dictionaries (the groups of styles) are added directly to a single dictionary under mergedKey. An entry whose key is already in the merged dictionary is reported and ignored, so the first one in the file wins.
+ * Binary plists are decoded from their offset table, sharing the strings referenced more than once (eg. repeated keys); XML plists are read with an event based parser.
+ */
+@interface SDThemePlistReader : NSObject
+
+- (instancetype) initWithCopiedKeys:(NSSet<NSString*>*)copiedKeys mergedKey:(NSString*)mergedKey;
+
+/**
+ * Called for each duplicated entry, with the key and the name of the group in which it is duplicated.
+ */
+@property (nonatomic, copy) void (^duplicateHandler)(NSString* key, NSString* group);
+
+/**
+ * Called for each top level key not in copiedKeys whose value is not a dictionary. The value is ignored.
+ */
+@property (nonatomic, copy) void (^invalidValueHandler)(NSString* key);
+
+/**
+ * Reads a theme.
+ *
+ * @param data the contents of a binary or XML plist
+ *
+ * @return the theme, or nil if the data is not a binary or XML plist with a dictionary at the top level, or it is not valid
+ */
+- (NSDictionary*) themeWithData:(NSData*)data;
+
+@end
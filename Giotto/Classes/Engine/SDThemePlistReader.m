@@ -0,0 +1,685 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemePlistReader.h"
+
+#define BINARY_PLIST_HEADER     "bplist00"
+#define BINARY_PLIST_TRAILER_SIZE 32
+#define MAXIMUM_DEPTH           512
+
+typedef NS_ENUM(NSInteger, SDThemePlistFrameKind) {
+    SDThemePlistFrameKindValue = 0, // a dictionary or an array of a value
+    SDThemePlistFrameKindTop,       // the top level dictionary
+    SDThemePlistFrameKindGroup,     // a group of styles, whose entries go to the merged dictionary
+};
+
+/**
+ * A dictionary or an array open while reading an XML plist.
+ */
+@interface SDThemePlistFrame : NSObject
+
+@property (nonatomic, assign) SDThemePlistFrameKind kind;
+// nil for the top level dictionary and the groups
+@property (nonatomic, strong) id container;
+@property (nonatomic, copy) NSString* pendingKey;
+@property (nonatomic, copy) NSString* groupName;
+
+@end
+
+@implementation SDThemePlistFrame
+@end
+
+
+@interface SDThemePlistReader () <NSXMLParserDelegate>
+{
+    // binary plist being read
+    const uint8_t* _bytes;
+    NSUInteger _length;
+    uint8_t _offsetSize;
+    uint8_t _referenceSize;
+    uint64_t _objectCount;
+    uint64_t _offsetTableOffset;
+    
+    // XML plist being read
+    NSInteger _skipDepth;
+    BOOL _failed;
+}
+
+@property (nonatomic, copy) NSSet<NSString*>* copiedKeys;
+@property (nonatomic, copy) NSString* mergedKey;
+
+@property (nonatomic, strong) NSMutableDictionary* theme;
+@property (nonatomic, strong) NSMutableDictionary* merged;
+
+// strings of a binary plist by object reference, NSNull if not decoded yet
+@property (nonatomic, strong) NSMutableArray* strings;
+
+@property (nonatomic, strong) NSMutableArray<SDThemePlistFrame*>* frames;
+@property (nonatomic, strong) NSMutableString* text;
+@property (nonatomic, strong) NSDateFormatter* dateFormatter;
+
+@end
+
+@implementation SDThemePlistReader
+
+- (instancetype) initWithCopiedKeys:(NSSet<NSString*>*)copiedKeys mergedKey:(NSString*)mergedKey
+{
+    self = [super init];
+    if (self)
+    {
+        self.copiedKeys = copiedKeys;
+        self.mergedKey = mergedKey;
+    }
+    return self;
+}
+
+- (NSDictionary*) themeWithData:(NSData*)data
+{
+    if (data.length < 8)
+    {
+        return nil;
+    }
+    
+    self.theme = [NSMutableDictionary new];
+    self.merged = [NSMutableDictionary new];
+    BOOL read = NO;
+    if (memcmp(data.bytes, BINARY_PLIST_HEADER, 8) == 0)
+    {
+        read = [self readBinaryData:data];
+    }
+    else if ([self isXMLData:data])
+    {
+        read = [self readXMLData:data];
+    }
+    
+    NSMutableDictionary* theme = self.theme;
+    theme[self.mergedKey] = self.merged;
+    self.theme = nil;
+    self.merged = nil;
+    return read ? theme : nil;
+}
+
+/**
+ * Adds an entry of a group to the merged dictionary, unless it is duplicated.
+ *
+ * @return NO if the key is already in the merged dictionary
+ */
+- (BOOL) canMergeKey:(NSString*)key ofGroup:(NSString*)group
+{
+    if (self.merged[key] != nil)
+    {
+        if (self.duplicateHandler)
+        {
+            self.duplicateHandler(key, group);
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (void) reportInvalidValueForKey:(NSString*)key
+{
+    if (self.invalidValueHandler)
+    {
+        self.invalidValueHandler(key);
+    }
+}
+
+#pragma mark - Binary
+
+static uint64_t SDThemeReadBigEndian(const uint8_t* bytes, NSUInteger size)
+{
+    uint64_t value = 0;
+    for (NSUInteger index = 0; index < size; index++)
+    {
+        value = (value << 8) | bytes[index];
+    }
+    return value;
+}
+
+- (BOOL) readBinaryData:(NSData*)data
+{
+    if (data.length < 8 + BINARY_PLIST_TRAILER_SIZE)
+    {
+        return NO;
+    }
+    _bytes = data.bytes;
+    _length = data.length;
+    
+    const uint8_t* trailer = _bytes + _length - BINARY_PLIST_TRAILER_SIZE;
+    _offsetSize = trailer[6];
+    _referenceSize = trailer[7];
+    _objectCount = SDThemeReadBigEndian(trailer + 8, 8);
+    uint64_t topObject = SDThemeReadBigEndian(trailer + 16, 8);
+    _offsetTableOffset = SDThemeReadBigEndian(trailer + 24, 8);
+    if (_offsetSize < 1 || _offsetSize > 8 || _referenceSize < 1 || _referenceSize > 8 || topObject >= _objectCount ||
+        _objectCount > _length || _offsetTableOffset > _length - BINARY_PLIST_TRAILER_SIZE ||
+        _objectCount * _offsetSize > _length - BINARY_PLIST_TRAILER_SIZE - _offsetTableOffset)
+    {
+        return NO;
+    }
+    
+    self.strings = [NSMutableArray arrayWithCapacity:(NSUInteger)_objectCount];
+    for (uint64_t index = 0; index < _objectCount; index++)
+    {
+        [self.strings addObject:[NSNull null]];
+    }
+    
+    BOOL read = [self readBinaryTopObject:topObject];
+    self.strings = nil;
+    _bytes = NULL;
+    return read;
+}
+
+- (BOOL) readBinaryTopObject:(uint64_t)topObject
+{
+    uint8_t type, info;
+    NSUInteger position;
+    uint64_t count;
+    if (![self getType:&type info:&info position:&position ofObject:topObject] || type != 0xD || ![self readLengthWithInfo:info position:&position length:&count])
+    {
+        return NO;
+    }
+    if (count > ((NSUInteger)_offsetTableOffset - position) / (2 * _referenceSize))
+    {
+        return NO;
+    }
+    
+    for (uint64_t index = 0; index < count; index++)
+    {
+        NSString* key = [self objectAtReference:position + index * _referenceSize depth:1];
+        uint64_t valueObject = SDThemeReadBigEndian(_bytes + position + (count + index) * _referenceSize, _referenceSize);
+        if (![key isKindOfClass:[NSString class]])
+        {
+            return NO;
+        }
+        
+        if ([self.copiedKeys containsObject:key])
+        {
+            id value = [self objectWithReference:valueObject depth:1];
+            if (!value)
+            {
+                return NO;
+            }
+            self.theme[key] = value;
+            continue;
+        }
+        
+        // a group of styles: only the entries that are not duplicated are decoded
+        uint8_t groupType, groupInfo;
+        NSUInteger groupPosition;
+        uint64_t groupCount;
+        if (![self getType:&groupType info:&groupInfo position:&groupPosition ofObject:valueObject])
+        {
+            return NO;
+        }
+        if (groupType != 0xD)
+        {
+            [self reportInvalidValueForKey:key];
+            continue;
+        }
+        if (![self readLengthWithInfo:groupInfo position:&groupPosition length:&groupCount] || groupCount > ((NSUInteger)_offsetTableOffset - groupPosition) / (2 * _referenceSize))
+        {
+            return NO;
+        }
+        for (uint64_t groupIndex = 0; groupIndex < groupCount; groupIndex++)
+        {
+            NSString* styleKey = [self objectAtReference:groupPosition + groupIndex * _referenceSize depth:2];
+            if (![styleKey isKindOfClass:[NSString class]])
+            {
+                return NO;
+            }
+            if ([self canMergeKey:styleKey ofGroup:key])
+            {
+                id style = [self objectAtReference:groupPosition + (groupCount + groupIndex) * _referenceSize depth:2];
+                if (!style)
+                {
+                    return NO;
+                }
+                self.merged[styleKey] = style;
+            }
+        }
+    }
+    return YES;
+}
+
+/**
+ * Finds the marker of an object.
+ *
+ * @return NO if the reference or the offset are out of the data
+ */
+- (BOOL) getType:(uint8_t*)type info:(uint8_t*)info position:(NSUInteger*)position ofObject:(uint64_t)object
+{
+    if (object >= _objectCount)
+    {
+        return NO;
+    }
+    uint64_t offset = SDThemeReadBigEndian(_bytes + _offsetTableOffset + object * _offsetSize, _offsetSize);
+    if (offset < 8 || offset >= _offsetTableOffset)
+    {
+        return NO;
+    }
+    *type = _bytes[offset] >> 4;
+    *info = _bytes[offset] & 0x0F;
+    *position = (NSUInteger)offset + 1;
+    return YES;
+}
+
+/**
+ * Reads the length of a string, data or collection, stored in the marker or in the integer that follows it.
+ */
+- (BOOL) readLengthWithInfo:(uint8_t)info position:(NSUInteger*)position length:(uint64_t*)length
+{
+    if (info != 0x0F)
+    {
+        *length = info;
+        return YES;
+    }
+    if (*position >= _offsetTableOffset || (_bytes[*position] >> 4) != 0x1)
+    {
+        return NO;
+    }
+    NSUInteger size = 1 << (_bytes[*position] & 0x0F);
+    if (size > 8 || *position + 1 + size > _offsetTableOffset)
+    {
+        return NO;
+    }
+    *length = SDThemeReadBigEndian(_bytes + *position + 1, size);
+    *position += 1 + size;
+    return YES;
+}
+
+- (id) objectAtReference:(NSUInteger)position depth:(NSUInteger)depth
+{
+    return [self objectWithReference:SDThemeReadBigEndian(_bytes + position, _referenceSize) depth:depth];
+}
+
+/**
+ * Decodes an object and its contents.
+ *
+ * @return the object, or nil if it is not valid
+ */
+- (id) objectWithReference:(uint64_t)object depth:(NSUInteger)depth
+{
+    uint8_t type, info;
+    NSUInteger position;
+    if (depth > MAXIMUM_DEPTH || ![self getType:&type info:&info position:&position ofObject:object])
+    {
+        return nil;
+    }
+    NSUInteger available = (NSUInteger)_offsetTableOffset - position;
+    
+    switch (type)
+    {
+        case 0x0:
+        {
+            return info == 0x8 ? @NO : (info == 0x9 ? @YES : nil);
+        }
+        case 0x1:
+        {
+            NSUInteger size = 1 << info;
+            if (size > 16 || size > available)
+            {
+                return nil;
+            }
+            if (size == 16)
+            {
+                // only the low 64 bits are kept, like NSPropertyListSerialization
+                return @((long long)SDThemeReadBigEndian(_bytes + position + 8, 8));
+            }
+            uint64_t value = SDThemeReadBigEndian(_bytes + position, size);
+            return size == 8 ? @((long long)value) : @((unsigned long long)value);
+        }
+        case 0x2:
+        {
+            NSUInteger size = 1 << info;
+            if ((size != 4 && size != 8) || size > available)
+            {
+                return nil;
+            }
+            uint64_t bits = SDThemeReadBigEndian(_bytes + position, size);
+            if (size == 4)
+            {
+                uint32_t bits32 = (uint32_t)bits;
+                float value;
+                memcpy(&value, &bits32, sizeof(value));
+                return @(value);
+            }
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return @(value);
+        }
+        case 0x3:
+        {
+            if (info != 0x3 || available < 8)
+            {
+                return nil;
+            }
+            uint64_t bits = SDThemeReadBigEndian(_bytes + position, 8);
+            double interval;
+            memcpy(&interval, &bits, sizeof(interval));
+            return [NSDate dateWithTimeIntervalSinceReferenceDate:interval];
+        }
+        case 0x4:
+        case 0x5:
+        case 0x6:
+        {
+            if (type != 0x4 && self.strings[(NSUInteger)object] != [NSNull null])
+            {
+                // strings referenced more than once are shared
+                return self.strings[(NSUInteger)object];
+            }
+            uint64_t length;
+            if (![self readLengthWithInfo:info position:&position length:&length])
+            {
+                return nil;
+            }
+            uint64_t size = type == 0x6 ? length * 2 : length;
+            if (size > (NSUInteger)_offsetTableOffset - position)
+            {
+                return nil;
+            }
+            if (type == 0x4)
+            {
+                return [NSData dataWithBytes:_bytes + position length:(NSUInteger)size];
+            }
+            NSString* string = [[NSString alloc] initWithBytes:_bytes + position length:(NSUInteger)size encoding:(type == 0x5 ? NSASCIIStringEncoding : NSUTF16BigEndianStringEncoding)];
+            if (string)
+            {
+                self.strings[(NSUInteger)object] = string;
+            }
+            return string;
+        }
+        case 0xA:
+        case 0xD:
+        {
+            uint64_t count;
+            if (![self readLengthWithInfo:info position:&position length:&count])
+            {
+                return nil;
+            }
+            NSUInteger referenceCount = type == 0xD ? 2 : 1;
+            if (count > ((NSUInteger)_offsetTableOffset - position) / (referenceCount * _referenceSize))
+            {
+                return nil;
+            }
+            
+            if (type == 0xA)
+            {
+                NSMutableArray* array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+                for (uint64_t index = 0; index < count; index++)
+                {
+                    id element = [self objectAtReference:position + index * _referenceSize depth:depth + 1];
+                    if (!element)
+                    {
+                        return nil;
+                    }
+                    [array addObject:element];
+                }
+                return array;
+            }
+            
+            NSMutableDictionary* dictionary = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+            for (uint64_t index = 0; index < count; index++)
+            {
+                NSString* key = [self objectAtReference:position + index * _referenceSize depth:depth + 1];
+                id value = [self objectAtReference:position + (count + index) * _referenceSize depth:depth + 1];
+                if (![key isKindOfClass:[NSString class]] || !value)
+                {
+                    return nil;
+                }
+                dictionary[key] = value;
+            }
+            return dictionary;
+        }
+        default:
+            // UIDs and sets are not used by property lists
+            return nil;
+    }
+}
+
+#pragma mark - XML
+
+- (BOOL) isXMLData:(NSData*)data
+{
+    NSUInteger length = MIN(data.length, (NSUInteger)256);
+    NSString* prefix = [[NSString alloc] initWithBytes:data.bytes length:length encoding:NSASCIIStringEncoding];
+    return [prefix rangeOfString:@"<?xml"].location != NSNotFound || [prefix rangeOfString:@"<plist"].location != NSNotFound;
+}
+
+- (BOOL) readXMLData:(NSData*)data
+{
+    self.frames = [NSMutableArray new];
+    self.text = nil;
+    _skipDepth = 0;
+    _failed = NO;
+    
+    NSXMLParser* parser = [[NSXMLParser alloc] initWithData:data];
+    parser.delegate = self;
+    BOOL parsed = [parser parse] && !_failed;
+    
+    self.frames = nil;
+    self.text = nil;
+    return parsed;
+}
+
+- (void) failWithParser:(NSXMLParser*)parser
+{
+    _failed = YES;
+    [parser abortParsing];
+}
+
+- (void) parser:(NSXMLParser*)parser didStartElement:(NSString*)elementName namespaceURI:(NSString*)namespaceURI qualifiedName:(NSString*)qName attributes:(NSDictionary<NSString*, NSString*>*)attributeDict
+{
+    BOOL isContainer = [elementName isEqualToString:@"dict"] || [elementName isEqualToString:@"array"];
+    if (_skipDepth > 0)
+    {
+        _skipDepth += isContainer ? 1 : 0;
+        return;
+    }
+    
+    if (isContainer)
+    {
+        [self openContainer:elementName parser:parser];
+    }
+    else if ([elementName isEqualToString:@"true"] || [elementName isEqualToString:@"false"])
+    {
+        [self addValue:@([elementName isEqualToString:@"true"]) parser:parser];
+    }
+    else if (![elementName isEqualToString:@"plist"])
+    {
+        self.text = [NSMutableString new];
+    }
+}
+
+- (void) openContainer:(NSString*)elementName parser:(NSXMLParser*)parser
+{
+    BOOL isDictionary = [elementName isEqualToString:@"dict"];
+    SDThemePlistFrame* parent = self.frames.lastObject;
+    SDThemePlistFrame* frame = [SDThemePlistFrame new];
+    
+    if (!parent)
+    {
+        if (!isDictionary)
+        {
+            [self failWithParser:parser];
+            return;
+        }
+        frame.kind = SDThemePlistFrameKindTop;
+    }
+    else if (self.frames.count > MAXIMUM_DEPTH)
+    {
+        [self failWithParser:parser];
+        return;
+    }
+    else if (parent.kind == SDThemePlistFrameKindTop && ![self.copiedKeys containsObject:parent.pendingKey])
+    {
+        if (!isDictionary)
+        {
+            [self reportInvalidValueForKey:parent.pendingKey];
+            _skipDepth = 1;
+            return;
+        }
+        frame.kind = SDThemePlistFrameKindGroup;
+        frame.groupName = parent.pendingKey;
+    }
+    else if (parent.kind == SDThemePlistFrameKindGroup && ![self canMergeKey:parent.pendingKey ofGroup:parent.groupName])
+    {
+        _skipDepth = 1;
+        return;
+    }
+    else
+    {
+        frame.container = isDictionary ? [NSMutableDictionary new] : [NSMutableArray new];
+    }
+    [self.frames addObject:frame];
+}
+
+- (void) parser:(NSXMLParser*)parser foundCharacters:(NSString*)string
+{
+    if (_skipDepth == 0)
+    {
+        [self.text appendString:string];
+    }
+}
+
+- (void) parser:(NSXMLParser*)parser didEndElement:(NSString*)elementName namespaceURI:(NSString*)namespaceURI qualifiedName:(NSString*)qName
+{
+    if (_skipDepth > 0)
+    {
+        if ([elementName isEqualToString:@"dict"] || [elementName isEqualToString:@"array"])
+        {
+            _skipDepth--;
+        }
+        return;
+    }
+    
+    NSString* text = self.text;
+    self.text = nil;
+    
+    if ([elementName isEqualToString:@"dict"] || [elementName isEqualToString:@"array"])
+    {
+        SDThemePlistFrame* frame = self.frames.lastObject;
+        [self.frames removeLastObject];
+        if (frame.kind == SDThemePlistFrameKindValue)
+        {
+            [self addValue:frame.container parser:parser];
+        }
+    }
+    else if ([elementName isEqualToString:@"key"])
+    {
+        self.frames.lastObject.pendingKey = text ?: @"";
+    }
+    else if ([elementName isEqualToString:@"string"])
+    {
+        [self addValue:[text copy] ?: @"" parser:parser];
+    }
+    else if ([elementName isEqualToString:@"integer"])
+    {
+        [self addValue:@([[text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] longLongValue]) parser:parser];
+    }
+    else if ([elementName isEqualToString:@"real"])
+    {
+        [self addValue:@([text doubleValue]) parser:parser];
+    }
+    else if ([elementName isEqualToString:@"data"])
+    {
+        NSData* data = [[NSData alloc] initWithBase64EncodedString:text ?: @"" options:NSDataBase64DecodingIgnoreUnknownCharacters];
+        if (data)
+        {
+            [self addValue:data parser:parser];
+        }
+        else
+        {
+            [self failWithParser:parser];
+        }
+    }
+    else if ([elementName isEqualToString:@"date"])
+    {
+        if (!self.dateFormatter)
+        {
+            self.dateFormatter = [NSDateFormatter new];
+            self.dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+            self.dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+            self.dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss'Z'";
+        }
+        NSDate* date = text ? [self.dateFormatter dateFromString:text] : nil;
+        if (date)
+        {
+            [self addValue:date parser:parser];
+        }
+        else
+        {
+            [self failWithParser:parser];
+        }
+    }
+}
+
+/**
+ * Adds a complete value to the dictionary or the array currently open.
+ */
+- (void) addValue:(id)value parser:(NSXMLParser*)parser
+{
+    SDThemePlistFrame* frame = self.frames.lastObject;
+    switch (frame.kind)
+    {
+        case SDThemePlistFrameKindTop:
+            if ([self.copiedKeys containsObject:frame.pendingKey])
+            {
+                self.theme[frame.pendingKey] = value;
+            }
+            else
+            {
+                [self reportInvalidValueForKey:frame.pendingKey];
+            }
+            break;
+        case SDThemePlistFrameKindGroup:
+        {
+            if (!frame.pendingKey)
+            {
+                [self failWithParser:parser];
+                break;
+            }
+            // the duplicates of dictionaries and arrays are found when they open, and they are not read
+            BOOL checked = [value isKindOfClass:[NSDictionary class]] || [value isKindOfClass:[NSArray class]];
+            if (checked || [self canMergeKey:frame.pendingKey ofGroup:frame.groupName])
+            {
+                self.merged[frame.pendingKey] = value;
+            }
+            break;
+        }
+        case SDThemePlistFrameKindValue:
+            if ([frame.container isKindOfClass:[NSMutableArray class]])
+            {
+                [frame.container addObject:value];
+            }
+            else if (frame.pendingKey)
+            {
+                frame.container[frame.pendingKey] = value;
+            }
+            else
+            {
+                [self failWithParser:parser];
+            }
+            break;
+    }
+    frame.pendingKey = nil;
+}
+
+- (void) parser:(NSXMLParser*)parser parseErrorOccurred:(NSError*)parseError
+{
+    _failed = YES;
+}
+
+@end
@@ -0,0 +1,71 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A single property write produced by the resolution of a style: the final value (constants and conventions already resolved) and where to write it.
+ */
+@interface SDThemeWrite : NSObject
+
++ (instancetype) writeWithValue:(id)value keyPath:(NSString*)keyPath target:(NSArray<NSString*>*)target validatingType:(BOOL)validateType;
+
+// keyPaths leading from the styled object to the written one (eg. a nested style for "titleLabel"), empty for the styled object itself
+@property (nonatomic, copy, readonly) NSArray<NSString*>* target;
+@property (nonatomic, copy, readonly) NSString* keyPath;
+// the final value, nil for the null convention
+@property (nonatomic, strong, readonly) id value;
+// YES if the value came from a string, so that its type is checked when validatesValueTypes is enabled
+@property (nonatomic, assign, readonly) BOOL validatesType;
+
+@end
+
+/**
+ * The immutable result of the resolution of a style and of its variants: the ordered list of writes to perform on the object.
+ * It is produced by SDThemeManager, also on a background queue, and committed on the main thread with applyResolvedStyle:toObject:.
+ */
+@interface SDThemeResolvedStyle : NSObject
+
+- (instancetype) initWithStyleName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames writes:(NSArray<SDThemeWrite*>*)writes generation:(NSUInteger)generation;
+
+@property (nonatomic, copy, readonly) NSString* styleName;
+// variants included in the writes
+@property (nonatomic, copy, readonly) NSArray<NSString*>* variantStyleNames;
+@property (nonatomic, copy, readonly) NSArray<SDThemeWrite*>* writes;
+// generation of the themes the style has been resolved with
+@property (nonatomic, assign, readonly) NSUInteger generation;
+
+@end
+
+/**
+ * The styles already resolved and merged with their variants, keyed by style name and by the variants matching the current variant values, so that applying a style again commits its writes without resolving it.
+ * The entries are valid only for the generation of the themes they have been resolved with. Thread safe.
+ */
+@interface SDThemeResolvedStyleCache : NSObject
+
+/**
+ * Returns the resolved style with the given variants, or nil if it has not been resolved yet with the given generation of the themes.
+ */
+- (SDThemeResolvedStyle*) resolvedStyleWithName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames generation:(NSUInteger)generation;
+
+- (void) setResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle;
+
+/**
+ * Removes all the versions of the given styles, eg. the ones having a variant for a dimension that changed.
+ */
+- (void) removeResolvedStylesWithNames:(NSSet<NSString*>*)styleNames;
+
+- (void) removeAllResolvedStyles;
+
+@end
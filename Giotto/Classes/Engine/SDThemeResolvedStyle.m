@@ -0,0 +1,154 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeResolvedStyle.h"
+
+@interface SDThemeWrite ()
+
+@property (nonatomic, copy) NSArray<NSString*>* target;
+@property (nonatomic, copy) NSString* keyPath;
+@property (nonatomic, strong) id value;
+@property (nonatomic, assign) BOOL validatesType;
+
+@end
+
+@implementation SDThemeWrite
+
++ (instancetype) writeWithValue:(id)value keyPath:(NSString*)keyPath target:(NSArray<NSString*>*)target validatingType:(BOOL)validateType
+{
+    SDThemeWrite* write = [SDThemeWrite new];
+    write.value = value;
+    write.keyPath = keyPath;
+    write.target = target ?: @[];
+    write.validatesType = validateType;
+    return write;
+}
+
+- (NSString*) description
+{
+    NSString* fullKeyPath = self.target.count > 0 ? [NSString stringWithFormat:@"%@.%@", [self.target componentsJoinedByString:@"."], self.keyPath] : self.keyPath;
+    return [NSString stringWithFormat:@"%@ = %@", fullKeyPath, self.value];
+}
+
+@end
+
+
+@interface SDThemeResolvedStyle ()
+
+@property (nonatomic, copy) NSString* styleName;
+@property (nonatomic, copy) NSArray<NSString*>* variantStyleNames;
+@property (nonatomic, copy) NSArray<SDThemeWrite*>* writes;
+@property (nonatomic, assign) NSUInteger generation;
+
+@end
+
+@implementation SDThemeResolvedStyle
+
+- (instancetype) initWithStyleName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames writes:(NSArray<SDThemeWrite*>*)writes generation:(NSUInteger)generation
+{
+    self = [super init];
+    if (self)
+    {
+        self.styleName = styleName;
+        self.variantStyleNames = variantStyleNames ?: @[];
+        self.writes = writes ?: @[];
+        self.generation = generation;
+    }
+    return self;
+}
+
+- (NSString*) description
+{
+    return [NSString stringWithFormat:@"<%@ %@: %@>", NSStringFromClass([self class]), self.styleName, self.writes];
+}
+
+@end
+
+
+@interface SDThemeResolvedStyleCache ()
+
+// resolved styles by style name and by variant key
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableDictionary<NSString*, SDThemeResolvedStyle*>*>* resolvedStyles;
+
+@end
+
+@implementation SDThemeResolvedStyleCache
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.resolvedStyles = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+/**
+ * The variants matching the current variant values identify the values the style depends on.
+ */
+- (NSString*) variantKeyForVariantStyleNames:(NSArray<NSString*>*)variantStyleNames
+{
+    return [variantStyleNames ?: @[] componentsJoinedByString:@","];
+}
+
+- (SDThemeResolvedStyle*) resolvedStyleWithName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames generation:(NSUInteger)generation
+{
+    if (!styleName)
+    {
+        return nil;
+    }
+    SDThemeResolvedStyle* resolvedStyle = nil;
+    @synchronized (self)
+    {
+        resolvedStyle = self.resolvedStyles[styleName][[self variantKeyForVariantStyleNames:variantStyleNames]];
+    }
+    return resolvedStyle.generation == generation ? resolvedStyle : nil;
+}
+
+- (void) setResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle
+{
+    if (!resolvedStyle.styleName)
+    {
+        return;
+    }
+    @synchronized (self)
+    {
+        NSMutableDictionary<NSString*, SDThemeResolvedStyle*>* versions = self.resolvedStyles[resolvedStyle.styleName];
+        if (!versions)
+        {
+            versions = [NSMutableDictionary new];
+            self.resolvedStyles[resolvedStyle.styleName] = versions;
+        }
+        versions[[self variantKeyForVariantStyleNames:resolvedStyle.variantStyleNames]] = resolvedStyle;
+    }
+}
+
+- (void) removeResolvedStylesWithNames:(NSSet<NSString*>*)styleNames
+{
+    @synchronized (self)
+    {
+        [self.resolvedStyles removeObjectsForKeys:styleNames.allObjects ?: @[]];
+    }
+}
+
+- (void) removeAllResolvedStyles
+{
+    @synchronized (self)
+    {
+        [self.resolvedStyles removeAllObjects];
+    }
+}
+
+@end
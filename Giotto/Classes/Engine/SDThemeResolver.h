@@ -0,0 +1,161 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#import <Foundation/Foundation.h>
+#import "SDThemeExpression.h"
+#import "SDThemeResolvedStyle.h"
+#import "SDThemeValue.h"
+
+@class SDThemeTracer;
+@class SDThemeUsageLog;
+
+/**
+ * Resolves the values of a stack of theme layers, without UIKit: lookup of constants and styles through the layers, constant expressions, conventions and styles resolved into writes.
+ * The conventions produce the values of SDThemeValue (colors, fonts, geometries and backgrounds), NSNumber for the enums and the values of the registered conventions; SDThemeManager turns them into UIKit objects through valueConverter.
+ *
+ * The resolver is not thread safe. The reads (lookups, resolutions) can run concurrently on any thread only as long as every change (themes, defaultTheme, resolveConstantExpressions) runs as a barrier: the owner runs the reads from other threads on a concurrent queue and the changes as barriers on it, like SDThemeManager does with resolutionQueue.
+ */
+@interface SDThemeResolver : NSObject <SDThemeExpressionContext>
+
+/**
+ * The prefixes of the built-in conventions, that cannot be registered by the application.
+ */
++ (NSArray<NSString*>*) builtInConventionPrefixes;
+
+/**
+ * @return the built-in convention the string uses, or nil
+ */
++ (NSString*) conventionIdentifierInString:(NSString*)string;
+
+/**
+ * @return the signature of the conventions and of the enums registered now and of the build of the application, whose code defines the parsers
+ */
++ (NSString*) conventionSignature;
+
+/**
+ * The concurrent queue the owner reads the resolver on. When set, the changes assert in debug builds that they run as barriers on it.
+ */
+@property (nonatomic, strong) dispatch_queue_t resolutionQueue;
+
+/**
+ * The layers in priority order: a value is read from the first layer defining it. The last one is usually the default theme. Must be changed as a barrier.
+ */
+@property (nonatomic, copy) NSArray<NSDictionary*>* themes;
+
+/**
+ * The layer the styles with "_inherit" inherit from. Must be changed as a barrier.
+ */
+@property (nonatomic, strong) NSDictionary* defaultTheme;
+
+@property (atomic, strong) SDThemeTracer* tracer;
+@property (atomic, strong) SDThemeUsageLog* usageLog;
+
+/**
+ * Returns the color of the asset catalog with the given name, or nil. Looked up before the hexadecimal formats. When nil only the hexadecimal colors are known.
+ */
+@property (nonatomic, copy) SDThemeColorValue* (^namedColorProvider)(NSString* name);
+
+/**
+ * Converts the final value of every write coming from a string (eg. a SDThemeColorValue into an UIColor). When nil the writes keep the values of the engine.
+ */
+@property (nonatomic, copy) id (^valueConverter)(id value);
+
+#pragma mark Constants
+
+/**
+ * Evaluates all the constants defined by an expression, in dependency order. Call it every time the constants of the themes change.
+ * Only the value of a constant in the theme with the highest priority is considered. Constants involved in a cycle are reported as errors and have no value. Must run as a barrier.
+ */
+- (void) resolveConstantExpressions;
+
+/**
+ * Errors found by the last resolveConstantExpressions.
+ */
+@property (nonatomic, strong, readonly) NSArray<NSError*>* constantExpressionErrors;
+
+/**
+ * @return the evaluated value of the constant if it is defined by an expression, NSNull if the expression can't be evaluated, nil if the constant is not an expression.
+ */
+- (id) resolvedValueForConstant:(NSString*)constantName;
+
+/**
+ * @return the value of the constant with its convention resolved, or nil if the constant does not exist
+ */
+- (id) valueForConstantWithName:(NSString*)constantName;
+
+/**
+ * Like valueForConstantWithName:, but returns the string itself if the constant does not exist.
+ */
+- (id) constantValueForString:(NSString*)string;
+
+#pragma mark Conventions
+
+/**
+ * @return the value of the convention used by the string, nil for the null convention or for a convention without a valid value, the string itself if it uses no convention
+ */
+- (id) valueForConventionalString:(NSString*)string;
+
+/**
+ * @return the named color or the color in the RRGGBBAA, RRGGBB, RGBA or RGB hexadecimal format, or nil
+ */
+- (SDThemeColorValue*) colorValueForString:(NSString*)string;
+
+/**
+ * Parses the strings of the registered conventions and of the enum convention found in a value of a theme, so they are ready when the styles are applied.
+ *
+ * @param value the value
+ * @param values filled with the parsed values that can be stored in the compiled cache, by string
+ */
+- (void) parseRegisteredConventionsInValue:(id)value storingValuesIn:(NSMutableDictionary<NSString*, id>*)values;
+
+#pragma mark Styles
+
+- (id) valueForKeyPath:(NSString*)keyPath fromDefaultTheme:(BOOL)fromDefault;
+
+/**
+ * @return the value of the style in the themes as it is, a dictionary or a string
+ */
+- (id) getThemeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault;
+
+/**
+ * @return the dictionary of the style, following a style convention, or nil if it does not exist
+ */
+- (NSDictionary*) themeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault;
+
+/**
+ * Resolves the dictionary of a style into the list of writes to perform, in application order.
+ *
+ * @param style The style to resolve.
+ * @param target The keyPaths leading from the styled object to the object the style is applied to.
+ * @param writes The list the writes are added to.
+ */
+- (void) resolveDictionary:(NSDictionary*)style atTarget:(NSArray<NSString*>*)target intoWrites:(NSMutableArray<SDThemeWrite*>*)writes;
+
+/**
+ * Resolves a style and the given variants, reporting an error if the style does not exist.
+ */
+- (NSArray<SDThemeWrite*>*) writesForStyleWithName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames;
+
+/**
+ * @return the dictionary of the style merged with its "_inherit" and "_superstyle" chain, with the values not resolved
+ */
+- (NSDictionary*) mergedValueForStyle:(NSString*)style;
+
+/**
+ * @return the name of the first theme layer containing the given keyPath, for the tracer.
+ */
+- (NSString*) layerNameForKeyPath:(NSString*)keyPath;
+
+@end
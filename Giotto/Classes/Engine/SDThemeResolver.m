@@ -0,0 +1,984 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#import "SDThemeResolver.h"
+#import "SDThemeLogger.h"
+#import "SDThemeLayer.h"
+#import "SDThemeTracer.h"
+#import "SDThemeUsageLog.h"
+#import "SDThemeSharedStore.h"
+#import "SDThemeConventionRegistry.h"
+#import "SDThemeEnumRegistry.h"
+#import "SDThemeVariantIndex.h"
+
+#define CONSTANTS_KEY            @"Constants"
+#define STYLES_KEY               @"Styles"
+
+#define COLOR_IDENTIFIERS        @[@"color:", @"c:"]
+#define STYLE_IDENTIFIERS        @[@"style:", @"s:"]
+#define FONT_IDENTIFIERS         @[@"font:", @"f:"]
+#define NULL_IDENTIFIERS         @[@"null", @"NULL", @"Null", @"nil", @"Nil"]
+#define BACKGROUND_IDENTIFIERS   @[@"background:", @"bg:"]
+
+#define SIZE_IDENTIFIER          @"size:"
+#define POINT_IDENTIFIER         @"point:"
+#define RECT_IDENTIFIER          @"rect:"
+#define EDGE_IDENTIFIER          @"edge:"
+#define ENUM_IDENTIFIER          @"enum:"
+
+// conventions whose value depends only on the string
+#define THEME_INDEPENDENT_IDENTIFIERS @[POINT_IDENTIFIER, SIZE_IDENTIFIER, RECT_IDENTIFIER, EDGE_IDENTIFIER, ENUM_IDENTIFIER]
+
+#define SUPERSTYLE_KEY           @"_superstyle"
+#define INHERIT_FROM_DEFAULT_THEME @"_inherit"
+
+// name of the layers that are not compiled, the modifies
+#define DYNAMIC_LAYER_NAME       @"theme_dynamic"
+
+// the tracer is read once, so that a begin and its end go to the same tracer
+#define TRACE_BEGIN(tracer, nm, cat, kp, cls, lyr) [tracer beginEventWithName:(nm) category:(cat) keyPath:(kp) targetClass:(cls) layer:(lyr)]
+#define TRACE_END(tracer, nm, cat)                 [tracer endEventWithName:(nm) category:(cat)]
+
+// the changes must not run concurrently with the reads: checked where libdispatch can tell a barrier, in debug builds
+#if DEBUG && defined(__APPLE__)
+#define ASSERT_BARRIER(queue) if (queue) { if (@available(iOS 10.0, macOS 10.12, tvOS 10.0, watchOS 3.0, *)) { dispatch_assert_queue_barrier(queue); } }
+#else
+#define ASSERT_BARRIER(queue)
+#endif
+
+@interface SDThemeResolver ()
+
+// values of the constants defined by an expression, evaluated when the themes change
+@property (nonatomic, strong) NSDictionary<NSString*, id>* resolvedConstants;
+@property (nonatomic, strong) NSArray<NSError*>* constantExpressionErrors;
+
+@end
+
+@implementation SDThemeResolver
+
++ (NSArray<NSString*>*) builtInConventionPrefixes
+{
+    static NSArray<NSString*>* builtInPrefixes = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        builtInPrefixes = [[[[[COLOR_IDENTIFIERS arrayByAddingObjectsFromArray:STYLE_IDENTIFIERS] arrayByAddingObjectsFromArray:FONT_IDENTIFIERS] arrayByAddingObjectsFromArray:BACKGROUND_IDENTIFIERS] arrayByAddingObjectsFromArray:THEME_INDEPENDENT_IDENTIFIERS] copy];
+    });
+    return builtInPrefixes;
+}
+
++ (NSString*) conventionSignature
+{
+    NSString* build = [NSBundle mainBundle].infoDictionary[(NSString*)kCFBundleVersionKey] ?: @"";
+    return [NSString stringWithFormat:@"%@|%@|%@", build,
+            [[SDThemeConventionRegistry sharedRegistry].prefixes componentsJoinedByString:@","],
+            [[SDThemeEnumRegistry sharedRegistry].names componentsJoinedByString:@","]];
+}
+
+#pragma mark - Layers
+
+- (void) setThemes:(NSArray<NSDictionary*>*)themes
+{
+    ASSERT_BARRIER(self.resolutionQueue);
+    _themes = [themes copy];
+}
+
+- (void) setDefaultTheme:(NSDictionary*)defaultTheme
+{
+    ASSERT_BARRIER(self.resolutionQueue);
+    _defaultTheme = defaultTheme;
+}
+
+#pragma mark - Constant expressions
+
+- (void) resolveConstantExpressions
+{
+    ASSERT_BARRIER(self.resolutionQueue);
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, @"constantExpressions", SDThemeTraceCategoryLoad, nil, Nil, nil);
+    [self evaluateConstantExpressions];
+    TRACE_END(tracer, @"constantExpressions", SDThemeTraceCategoryLoad);
+}
+
+- (void) evaluateConstantExpressions
+{
+    NSMutableDictionary<NSString*, SDThemeExpression*>* expressions = [NSMutableDictionary new];
+    NSMutableSet<NSString*>* visitedConstants = [NSMutableSet new];
+    NSMutableArray<NSError*>* errors = [NSMutableArray new];
+    
+    for (NSDictionary* theme in self.themes)
+    {
+        NSDictionary* constants = theme[CONSTANTS_KEY];
+        if (![constants isKindOfClass:[NSDictionary class]])
+        {
+            continue;
+        }
+        [constants enumerateKeysAndObjectsUsingBlock:^(NSString* name, id value, BOOL* stop) {
+            if ([visitedConstants containsObject:name])
+            {
+                // overridden by a theme with higher priority
+                return;
+            }
+            [visitedConstants addObject:name];
+            if ([SDThemeExpression isExpressionValue:value])
+            {
+                NSError* error = nil;
+                SDThemeExpression* expression = [SDThemeExpression expressionWithString:value error:&error];
+                if (expression)
+                {
+                    expressions[name] = expression;
+                }
+                else
+                {
+                    [errors addObject:error];
+                }
+            }
+        }];
+    }
+    
+    // sorts the expressions so that every constant follows the ones it references
+    NSMutableArray<NSString*>* evaluationOrder = [NSMutableArray new];
+    NSMutableDictionary<NSString*, NSNumber*>* states = [NSMutableDictionary new];
+    NSMutableSet<NSString*>* cyclicConstants = [NSMutableSet new];
+    for (NSString* name in [expressions.allKeys sortedArrayUsingSelector:@selector(compare:)])
+    {
+        [self sortConstantExpression:name expressions:expressions path:[NSMutableArray new] states:states order:evaluationOrder cyclicConstants:cyclicConstants errors:errors];
+    }
+    
+    // evaluates in order: the values of the referenced expressions are already available
+    NSMutableDictionary<NSString*, id>* resolvedConstants = [NSMutableDictionary new];
+    self.resolvedConstants = resolvedConstants;
+    for (NSString* name in evaluationOrder)
+    {
+        if ([cyclicConstants containsObject:name])
+        {
+            resolvedConstants[name] = [NSNull null];
+            continue;
+        }
+        NSError* error = nil;
+        id value = [expressions[name] evaluateWithContext:self error:&error];
+        if (value)
+        {
+            resolvedConstants[name] = value;
+        }
+        else
+        {
+            resolvedConstants[name] = [NSNull null];
+            [errors addObject:error];
+        }
+    }
+    self.resolvedConstants = [resolvedConstants copy];
+    self.constantExpressionErrors = [errors copy];
+    
+    for (NSError* error in errors)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"%@", error.localizedDescription);
+    }
+}
+
+- (void) sortConstantExpression:(NSString*)name
+                    expressions:(NSDictionary<NSString*, SDThemeExpression*>*)expressions
+                           path:(NSMutableArray<NSString*>*)path
+                         states:(NSMutableDictionary<NSString*, NSNumber*>*)states
+                          order:(NSMutableArray<NSString*>*)order
+                cyclicConstants:(NSMutableSet<NSString*>*)cyclicConstants
+                         errors:(NSMutableArray<NSError*>*)errors
+{
+    // states: nil = not visited, NO = visiting, YES = sorted
+    NSNumber* state = states[name];
+    if (state.boolValue)
+    {
+        return;
+    }
+    if (state != nil)
+    {
+        NSArray<NSString*>* cycle = [path subarrayWithRange:NSMakeRange([path indexOfObject:name], path.count - [path indexOfObject:name])];
+        [cyclicConstants addObjectsFromArray:cycle];
+        NSString* message = [NSString stringWithFormat:@"Cycle between constant expressions: %@ -> %@", [cycle componentsJoinedByString:@" -> "], name];
+        [errors addObject:[NSError errorWithDomain:SDThemeExpressionErrorDomain code:SDThemeExpressionErrorCycle userInfo:@{ NSLocalizedDescriptionKey: message }]];
+        return;
+    }
+    
+    states[name] = @NO;
+    [path addObject:name];
+    for (NSString* reference in [expressions[name].references.allObjects sortedArrayUsingSelector:@selector(compare:)])
+    {
+        if (expressions[reference])
+        {
+            [self sortConstantExpression:reference expressions:expressions path:path states:states order:order cyclicConstants:cyclicConstants errors:errors];
+        }
+    }
+    [path removeLastObject];
+    states[name] = @YES;
+    [order addObject:name];
+}
+
+- (id) resolvedValueForConstant:(NSString*)constantName
+{
+    return constantName ? self.resolvedConstants[constantName] : nil;
+}
+
+#pragma mark SDThemeExpressionContext
+
+- (id) valueForExpressionReference:(NSString*)reference
+{
+    return [self valueForConstantWithName:reference];
+}
+
+- (SDThemeColorValue*) colorForExpressionLiteral:(NSString*)literal
+{
+    return [self colorValueForString:literal];
+}
+
+#pragma mark - Constants
+
+- (id) valueForConstantWithName:(NSString*)constantName
+{
+    id resolvedValue = [self resolvedValueForConstant:constantName];
+    if (resolvedValue)
+    {
+        [self.usageLog recordConstantWithName:constantName];
+        return resolvedValue == [NSNull null] ? nil : resolvedValue;
+    }
+    
+    id constantValue = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, constantName] fromDefaultTheme:NO];
+    
+    // if I do not find a constant I return nil
+    if (!constantValue)
+    {
+        return nil;
+    }
+    
+    [self.usageLog recordConstantWithName:constantName];
+    
+    // If the value is a string, look for any conventions, otherwise I return the value
+    if ([constantValue isKindOfClass:[NSString class]])
+    {
+        return [self valueForConventionalString:constantValue];
+    }
+    else
+    {
+        return constantValue;
+    }
+}
+
+/**
+ * Finds the value of a Constant constants constant or, if not found, the string passed as a argument
+ *
+ * @param string The name of the constant to be found.
+ *
+ * @resurn the value of a Constants constant constant or, if not found, the passed string as argument
+ *
+ * @discussion This method differs from valueForConstantWithName: because it returns the passed string if you do not find the constant. This method must always be used for internal logic.
+ */
+- (id) constantValueForString:(NSString*)string
+{
+    id resolvedValue = [self resolvedValueForConstant:string];
+    if (resolvedValue)
+    {
+        [self.usageLog recordConstantWithName:string];
+        return resolvedValue == [NSNull null] ? nil : resolvedValue;
+    }
+    
+    id constantValue = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, string] fromDefaultTheme:NO];
+    
+    // if I do not find a constant string return
+    if (!constantValue)
+    {
+        return string;
+    }
+    
+    [self.usageLog recordConstantWithName:string];
+    
+    // If the value is a string, look for any conventions, otherwise I return the value
+    if ([constantValue isKindOfClass:[NSString class]])
+    {
+        return [self valueForConventionalString:constantValue];
+    }
+    else
+    {
+        return constantValue;
+    }
+}
+
+#pragma mark - Conventions
+
+/**
+ * Look for any conventions in the past string and return a conforming value to the convention or the passed string if there are no known conventions.
+ *
+ * @param string The string to be parsed.
+ *
+ * @return A value consistent with the agreement found. If it finds a convention that is not respected or the NULL convention nil returns. If it does not find any convention, it returns string.
+ */
+- (id) valueForConventionalString:(NSString*)string
+{
+    // conventions registered by the application, parsed once and shared like colors and geometries
+    NSString* prefix = nil;
+    SDThemeConventionParser parser = [[SDThemeConventionRegistry sharedRegistry] parserForString:string prefix:&prefix];
+    if (parser)
+    {
+        return [[SDThemeSharedStore sharedStore] conventionValueForString:string compute:^id{
+            id value = parser([string substringFromIndex:prefix.length]);
+            if (!value)
+            {
+                SDLogModuleError(kThemeManagerLogModuleName, @"'%@' convention used without a valid value. Given value: %@", prefix, string);
+            }
+            return value;
+        }];
+    }
+    
+    NSString* convention = [SDThemeResolver conventionIdentifierInString:string];
+    
+    // colors and geometries do not depend on the themes: they are parsed once and shared by all the managers
+    if ([COLOR_IDENTIFIERS containsObject:convention] || [THEME_INDEPENDENT_IDENTIFIERS containsObject:convention])
+    {
+        return [[SDThemeSharedStore sharedStore] conventionValueForString:string compute:^id{
+            return [self valueForConventionalString:string convention:convention];
+        }];
+    }
+    return [self valueForConventionalString:string convention:convention];
+}
+
+- (id) valueForConventionalString:(NSString*)string convention:(NSString*)convention
+{
+    // style convention:
+    if ([STYLE_IDENTIFIERS containsObject:convention])
+    {
+        @try
+        {
+            NSString* styleName = [string substringFromIndex:convention.length];
+            NSArray* styles = [styleName componentsSeparatedByString:@","];
+            NSMutableDictionary* styleDictionary = [NSMutableDictionary dictionary];
+            for (NSString* style in styles)
+            {
+                [styleDictionary addEntriesFromDictionary:[self themeStyleForKey:style fromDefaultTheme:NO]];
+            }
+            return [styleDictionary copy];
+        }
+        @catch (NSException* exception)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'style:' convention used without a valid value. Given value: %@", string);
+            return nil;
+        }
+    }
+    // font convention:
+    if ([FONT_IDENTIFIERS containsObject:convention])
+    {
+        @try
+        {
+            // aspected string: "font:<FONT_NAME>,<FONT_SIZE>" o "f:<FONT_NAME>,<FONT_SIZE>"
+            NSString* fontSpecs = [string substringFromIndex:convention.length];
+            NSArray* specs = [fontSpecs componentsSeparatedByString:@","];
+            NSString* fontName = [self constantValueForString:specs[0]];
+            float fontSize = [[self constantValueForString:specs[1]] floatValue];
+            SDThemeFontValue* font = [SDThemeFontValue fontWithName:fontName size:fontSize];
+            // the string depends on the constants of the themes: the fonts are shared by their resolved name and size instead, so that all the managers use one UIFont for each
+            NSString* fontKey = [NSString stringWithFormat:@"%@%ld|%@,%g", FONT_IDENTIFIERS.lastObject, (long)font.kind, font.name ?: @"", font.size];
+            return [[SDThemeSharedStore sharedStore] conventionValueForString:fontKey compute:^id{
+                return font;
+            }];
+        }
+        @catch (NSException* exception)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'font:' convention used without a valid value. Given value: %@. Expected value format: 'font:<FONT_NAME>,<FONT_SIZE>'", string);
+            return nil;
+        }
+    }
+    // color convention:
+    if ([COLOR_IDENTIFIERS containsObject:convention])
+    {
+        @try
+        {
+            NSString* colorValue = [string substringFromIndex:convention.length];
+            SDThemeColorValue* color = [self colorValueForString:colorValue];
+            if (!color)
+            {
+                SDLogModuleError(kThemeManagerLogModuleName, @"'color:' convention used without a valid value. Given value: %@. Expected value format: 'color:<RRGGBB>' or 'color:<RRGGBBAA>'", string);
+            }
+            return color;
+        }
+        @catch (NSException* exception)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'color:' convention used without a valid value. Given value: %@. Expected value format: 'color:<RRGGBB>' or 'color:<RRGGBBAA>'", string);
+            return nil;
+        }
+    }
+    // null convention
+    if ([NULL_IDENTIFIERS containsObject:convention])
+    {
+        return nil;
+    }
+    // background convention:
+    if ([BACKGROUND_IDENTIFIERS containsObject:convention])
+    {
+        @try
+        {
+            // aspected string: "background:<FILL_COLOR>,<CORNER_RADIUS>[,<BORDER_WIDTH>,<BORDER_COLOR>[,<TINT_COLOR>]]"
+            NSString* backgroundSpecs = [string substringFromIndex:convention.length];
+            NSArray* specs = [backgroundSpecs componentsSeparatedByString:@","];
+            SDThemeColorValue* fillColor = [self colorForBackgroundSpec:specs[0]];
+            double cornerRadius = [[self constantValueForString:specs[1]] doubleValue];
+            double borderWidth = specs.count > 3 ? [[self constantValueForString:specs[2]] doubleValue] : 0.0;
+            SDThemeColorValue* borderColor = specs.count > 3 ? [self colorForBackgroundSpec:specs[3]] : nil;
+            SDThemeColorValue* tintColor = specs.count > 4 ? [self colorForBackgroundSpec:specs[4]] : nil;
+            return [SDThemeBackgroundValue backgroundWithFillColor:fillColor cornerRadius:cornerRadius borderWidth:borderWidth borderColor:borderColor tintColor:tintColor];
+        }
+        @catch (NSException* exception)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'background:' convention used without a valid value. Given value: %@. Expected value format: 'background:<FILL_COLOR>,<CORNER_RADIUS>[,<BORDER_WIDTH>,<BORDER_COLOR>[,<TINT_COLOR>]]'", string);
+            return nil;
+        }
+    }
+    // enum convention:
+    if ([convention isEqualToString:ENUM_IDENTIFIER])
+    {
+        // aspected string: "enum:<ENUM_NAME>.<CASE>" or, for an option set, "enum:<ENUM_NAME>.<CASE>|<CASE>..."
+        NSNumber* value = [[SDThemeEnumRegistry sharedRegistry] valueForSpecs:[string substringFromIndex:convention.length]];
+        if (!value)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'enum:' convention used with an unknown enum or case. Given value: %@. Expected value format: 'enum:<ENUM_NAME>.<CASE>' or 'enum:<ENUM_NAME>.<CASE>|<CASE>'", string);
+        }
+        return value;
+    }
+    // geometry conventions:
+    // aspected strings: "point:<X_VALUE>,<Y_VALUE>", "size:<WIDTH_VALUE>,<HEIGHT_VALUE>", "rect:<X_VALUE>,<Y_VALUE>,<WIDTH_VALUE>,<HEIGHT_VALUE>", "edge:<TOP_VALUE>,<LEFT_VALUE>,<BOTTOM_VALUE>,<RIGHT_VALUE>"
+    static NSDictionary<NSString*, NSNumber*>* geometryTypes = nil;
+    static NSDictionary<NSString*, NSString*>* geometryFormats = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        geometryTypes = @{ POINT_IDENTIFIER: @(SDThemeGeometryTypePoint), SIZE_IDENTIFIER: @(SDThemeGeometryTypeSize), RECT_IDENTIFIER: @(SDThemeGeometryTypeRect), EDGE_IDENTIFIER: @(SDThemeGeometryTypeEdgeInsets) };
+        geometryFormats = @{ POINT_IDENTIFIER: @"'point:<X_VALUE>,<Y_VALUE>'", SIZE_IDENTIFIER: @"'size:<WIDTH_VALUE>,<HEIGHT_VALUE>'", RECT_IDENTIFIER: @"'rect:<X_VALUE>,<Y_VALUE>,<WIDTH_VALUE>,<HEIGHT_VALUE>'", EDGE_IDENTIFIER: @"'edge:<TOP_VALUE>,<LEFT_VALUE>,<BOTTOM_VALUE>,<RIGHT_VALUE>'" };
+    });
+    NSNumber* geometryType = convention ? geometryTypes[convention] : nil;
+    if (geometryType)
+    {
+        SDThemeGeometryValue* geometry = [SDThemeGeometryValue geometryWithType:geometryType.integerValue string:[string substringFromIndex:convention.length]];
+        if (!geometry)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"'%@' convention used without a valid value. Given value: %@. Expected value format: %@", convention, string, geometryFormats[convention]);
+        }
+        return geometry;
+    }
+    
+    return string;
+}
+
+- (SDThemeColorValue*) colorValueForString:(NSString*)string
+{
+    // Try to retrieve color from assets by using the same name
+    SDThemeColorValue* (^namedColorProvider)(NSString*) = self.namedColorProvider;
+    SDThemeColorValue* namedColor = namedColorProvider && string ? namedColorProvider(string) : nil;
+    if (namedColor)
+    {
+        return namedColor;
+    }
+    
+    // Interprets the color from the string in the RRBBGGAA format (red, green, blue, alpha)
+    SDThemeColorValue* color = [SDThemeColorValue colorWithHexString:string];
+    if (!color)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Color string %@ in wrong format", string);
+    }
+    return color;
+}
+
+/**
+ * Resolves a color of the background convention: a constant, a value with the color convention, or a color string.
+ *
+ * @param spec the component of the convention, trimmed of the spaces
+ *
+ * @return the color, or nil if spec is empty or null
+ */
+- (SDThemeColorValue*) colorForBackgroundSpec:(NSString*)spec
+{
+    spec = [spec stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if (spec.length == 0 || [NULL_IDENTIFIERS containsObject:spec])
+    {
+        return nil;
+    }
+    
+    id value = [self constantValueForString:spec];
+    if ([value isKindOfClass:[NSString class]])
+    {
+        // "c:RRGGBB" or a plain color string
+        value = [self valueForConventionalString:value];
+    }
+    if ([value isKindOfClass:[SDThemeColorValue class]])
+    {
+        return value;
+    }
+    return [value isKindOfClass:[NSString class]] ? [self colorValueForString:value] : nil;
+}
+
+/**
+ * Find conventions in the past string
+ *
+ * @param string the string to be parsed
+ *
+ * @return Returns the found agreement or nil.
+ */
++ (NSString*) conventionIdentifierInString:(NSString*)string
+{
+    static NSSet<NSString*>* builtInPrefixes = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        builtInPrefixes = [NSSet setWithArray:[self builtInConventionPrefixes]];
+    });
+    
+    // the common case, a string starting with the prefix of a convention, is found with a single lookup
+    NSRange colon = [string rangeOfString:@":"];
+    if (colon.location != NSNotFound)
+    {
+        NSString* prefix = [string substringToIndex:NSMaxRange(colon)];
+        if ([builtInPrefixes containsObject:prefix])
+        {
+            return prefix;
+        }
+    }
+    
+    // stle convention
+    for (NSString* convention in STYLE_IDENTIFIERS)
+    {
+        if ([string hasPrefix:convention])
+        {
+            return convention;
+        }
+    }
+    
+    // font convention
+    for (NSString* convention in FONT_IDENTIFIERS)
+    {
+        if ([string hasPrefix:convention])
+        {
+            return convention;
+        }
+    }
+    
+    // color convention
+    for (NSString* convention in COLOR_IDENTIFIERS)
+    {
+        if ([string hasPrefix:convention])
+        {
+            return convention;
+        }
+    }
+    
+    // background convention
+    for (NSString* convention in BACKGROUND_IDENTIFIERS)
+    {
+        if ([string hasPrefix:convention])
+        {
+            return convention;
+        }
+    }
+    
+    // null convention
+    for (NSString* convention in NULL_IDENTIFIERS)
+    {
+        if ([string hasPrefix:convention])
+        {
+            return convention;
+        }
+    }
+    
+    // CGPoint convention
+    if ([[string lowercaseString] rangeOfString:POINT_IDENTIFIER].location != NSNotFound)
+    {
+        return POINT_IDENTIFIER;
+    }
+    
+    // CGSize convention
+    if ([[string lowercaseString] rangeOfString:SIZE_IDENTIFIER].location != NSNotFound)
+    {
+        return SIZE_IDENTIFIER;
+    }
+    
+    // CGRect convention
+    if ([[string lowercaseString] rangeOfString:RECT_IDENTIFIER].location != NSNotFound)
+    {
+        return RECT_IDENTIFIER;
+    }
+    
+    // UIEdgeInsets convention
+    if ([[string lowercaseString] rangeOfString:EDGE_IDENTIFIER].location != NSNotFound)
+    {
+        return EDGE_IDENTIFIER;
+    }
+    
+    return nil;
+}
+
+- (void) parseRegisteredConventionsInValue:(id)value storingValuesIn:(NSMutableDictionary<NSString*, id>*)values
+{
+    if ([value isKindOfClass:[NSString class]])
+    {
+        if (values[value])
+        {
+            return;
+        }
+        NSString* prefix = nil;
+        if ([value hasPrefix:ENUM_IDENTIFIER] || [[SDThemeConventionRegistry sharedRegistry] parserForString:value prefix:&prefix])
+        {
+            id parsedValue = [self valueForConventionalString:value];
+            // the values of the application's conventions that are not property list objects are parsed again at the first use
+            if (parsedValue && [NSPropertyListSerialization propertyList:parsedValue isValidForFormat:NSPropertyListBinaryFormat_v1_0])
+            {
+                values[value] = parsedValue;
+            }
+        }
+    }
+    else if ([value isKindOfClass:[NSDictionary class]])
+    {
+        for (id subvalue in [value allValues])
+        {
+            [self parseRegisteredConventionsInValue:subvalue storingValuesIn:values];
+        }
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        for (id subvalue in value)
+        {
+            [self parseRegisteredConventionsInValue:subvalue storingValuesIn:values];
+        }
+    }
+}
+
+#pragma mark - Styles
+
+- (id) valueForKeyPath:(NSString*)keyPath fromDefaultTheme:(BOOL)fromDefault
+{
+    NSString* value;
+    
+    if (fromDefault)
+    {
+        value = [self.defaultTheme valueForKeyPath:keyPath];
+    }
+    else
+    {
+        for (NSDictionary* currentTheme in self.themes)
+        {
+            // you search for the key in all the themes you have set, sorted (the last is the default theme)
+            // The first match stops the search and returns the result
+            value = [currentTheme valueForKeyPath:keyPath];
+            if (value)
+            {
+                break;
+            }
+        }
+    }
+    
+    return value;
+}
+
+- (id) getThemeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault
+{
+    // style is searched in the "Styles" group
+    id style = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", STYLES_KEY, key] fromDefaultTheme:fromDefault];
+    if (style)
+    {
+        [self.usageLog recordStyleWithName:key];
+    }
+    return style;
+}
+
+/**
+ * Search the past style first in the Interfaces group and (as fallback) in the plist Styles group.
+ *
+ * @param key Name of style to search.
+ *
+ * @return The style dictionary or nil if this does not exist.
+ */
+- (NSDictionary*) themeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault
+{
+    // Style is searched in the "interfaces" group
+    id style = [self getThemeStyleForKey:key fromDefaultTheme:fromDefault];
+    
+    if ([style isKindOfClass:[NSString class]])
+    {
+        id value = [self valueForConventionalString:style];
+        
+        if (![value isKindOfClass:[NSDictionary class]])
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@' for key %@", style, key);
+            return nil;
+        }
+        else
+        {
+            return value;
+        }
+    }
+    else
+    {
+        if (!style)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@' for key %@", style, key);
+        }
+        return style;
+    }
+}
+
+#pragma mark Resolution
+
+- (void) resolveDictionary:(NSDictionary*)style atTarget:(NSArray<NSString*>*)target intoWrites:(NSMutableArray<SDThemeWrite*>*)writes
+{
+    if (!style)
+    {
+        return;
+    }
+    
+    // eventual inheritance from the default theme
+    NSString* inheritstyleName = style[INHERIT_FROM_DEFAULT_THEME];
+    if (inheritstyleName.length > 0)
+    {
+        NSDictionary* superstyle = [self themeStyleForKey:inheritstyleName fromDefaultTheme:YES];
+        [self resolveDictionary:superstyle atTarget:target intoWrites:writes];
+    }
+    
+    // Application of a possible _superstyle
+    NSString* superstyleName = style[SUPERSTYLE_KEY];
+    
+    if (superstyleName.length > 0)
+    {
+        NSArray* styles = [superstyleName componentsSeparatedByString:@","];
+        for (NSString* styleName in styles)
+        {
+            NSDictionary* superstyle = [self themeStyleForKey:styleName fromDefaultTheme:NO];
+            [self resolveDictionary:superstyle atTarget:target intoWrites:writes];
+        }
+    }
+    
+    // normalize the style by parsing the keys
+    NSDictionary* normalizedStyle = [self normalizeDictionary:style];
+    
+    // Resolve the values ​​of the properties listed in the dictionary
+    for (NSString* key in normalizedStyle.allKeys)
+    {
+        if ([key isEqualToString:SUPERSTYLE_KEY] || [key isEqualToString:INHERIT_FROM_DEFAULT_THEME] || [key isEqualToString:VARIANT_OF_KEY])
+        {
+            continue;
+        }
+        
+        [self resolveValue:normalizedStyle[key] forKeyPath:key atTarget:target intoWrites:writes];
+    }
+}
+
+/**
+ * Resolves a single value of a style: conventions and constants are replaced by their final value and grafted styles are resolved for the object at the keyPath.
+ *
+ * @param value The value to resolve.
+ * @param keyPath The property keyPath to be valued.
+ * @param target The keyPaths leading from the styled object to the object owning the property.
+ * @param writes The list the writes are added to.
+ */
+- (void) resolveValue:(id)value forKeyPath:(NSString*)keyPath atTarget:(NSArray<NSString*>*)target intoWrites:(NSMutableArray<SDThemeWrite*>*)writes
+{
+    @try {
+        // if the value is a dictionary then it is a grafted style, so I apply the style grafted to the object at the keyPath
+        if ([value isKindOfClass:[NSDictionary class]])
+        {
+            [self resolveDictionary:value atTarget:[target arrayByAddingObject:keyPath] intoWrites:writes];
+        }
+        // if the value is a string can be a constant name or one of the possible conventions
+        else if ([value isKindOfClass:[NSString class]])
+        {
+            SDThemeTracer* tracer = self.tracer;
+            TRACE_BEGIN(tracer, value, SDThemeTraceCategoryResolve, keyPath, Nil, tracer ? [self layerNameForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, value]] : nil);
+            // control the conventions
+            id finalValue = [self valueForConventionalString:value];
+            if ([finalValue respondsToSelector:@selector(isEqualToString:)] && [finalValue isEqualToString:value])
+            {
+                // did not find any conventions. I look for constants
+                finalValue = [self constantValueForString:value];
+            }
+            TRACE_END(tracer, value, SDThemeTraceCategoryResolve);
+            
+            // If the final value is a dictionary of a style, then resolve it as a grafted style
+            if ([finalValue isKindOfClass:[NSDictionary class]])
+            {
+                [self resolveValue:finalValue forKeyPath:keyPath atTarget:target intoWrites:writes];
+            }
+            // otherwise I write the value to the past keypath
+            else
+            {
+                id (^valueConverter)(id) = self.valueConverter;
+                [writes addObject:[SDThemeWrite writeWithValue:valueConverter ? valueConverter(finalValue) : finalValue keyPath:keyPath target:target validatingType:YES]];
+            }
+        }
+        else
+        {
+            [writes addObject:[SDThemeWrite writeWithValue:value keyPath:keyPath target:target validatingType:NO]];
+        }
+    }
+    @catch (NSException* exception)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Cannot resolve value %@ for keyPath %@", value, keyPath);
+    }
+}
+
+- (NSArray<SDThemeWrite*>*) writesForStyleWithName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variantStyleNames
+{
+    NSMutableArray<SDThemeWrite*>* writes = [NSMutableArray new];
+    NSDictionary* style = [self themeStyleForKey:styleName fromDefaultTheme:NO];
+    if (!style)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@'", styleName);
+        return writes;
+    }
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, styleName, SDThemeTraceCategoryResolve, nil, Nil, tracer ? [self layerNameForKeyPath:[NSString stringWithFormat:@"%@.%@", STYLES_KEY, styleName]] : nil);
+    [self resolveDictionary:style atTarget:@[] intoWrites:writes];
+    for (NSString* variantStyleName in variantStyleNames)
+    {
+        [self resolveDictionary:[self themeStyleForKey:variantStyleName fromDefaultTheme:NO] atTarget:@[] intoWrites:writes];
+    }
+    TRACE_END(tracer, styleName, SDThemeTraceCategoryResolve);
+    return writes;
+}
+
+/**
+ * Normalize past dictionary by parsing all its keys.
+ * First divides all keys that are represented by keyPaths lists divided by ",".
+ * For all keypaths thus obtained, normalizes the first level.
+ *
+ *  Example -
+ * The dictionary:
+ *
+ *  { "view.layer.borderWidth,view2.layer.borderWidth" : 2} viene trasformato in
+ *
+ *  {
+ *      "view"  : { "layer.borderWidth" : 2 },
+ *      "view2" : { "layer.borderWidth" : 2 }
+ *  }
+ *
+ *  @param dictionary dictionary to normalize.
+ *
+ *  @return normalized dictionary.
+ */
+- (NSDictionary*) normalizeDictionary:(NSDictionary*)dictionary
+{
+    NSMutableDictionary* normalizedDictionary = [NSMutableDictionary dictionary];
+    
+    // look at all the passwords in the dictionary keyPaths
+    for (NSString* originalKeyPaths in dictionary.allKeys)
+    {
+        // divides arrays expressed with ","
+        NSArray* keyPaths = [originalKeyPaths componentsSeparatedByString:@","];
+        
+        for (NSString* keyPath in keyPaths)
+        {
+            // if the key is a keyPath, it finds the part before the first "." Which becomes the new key. Its value is a dictionary to which the next part of the original keyPath, associated with the original value, is added as a key.
+
+            NSInteger dotIndex = [keyPath rangeOfString:@"."].location;
+            if (dotIndex != NSNotFound)
+            {
+                NSString* normalizedKey = [keyPath substringToIndex:dotIndex];
+                NSString* subKeyPath = [keyPath substringFromIndex:dotIndex + 1];
+                NSDictionary* normalizedValue = nil;
+                
+                // Avoid that more key-paths associated with the standard key overwrite each other
+                id currentValue = normalizedDictionary[normalizedKey];
+                if (currentValue != nil &&
+                    [currentValue isKindOfClass:[NSDictionary class]])
+                {
+                    NSMutableDictionary* unionOfValues = [NSMutableDictionary dictionaryWithDictionary:currentValue];
+                    unionOfValues[subKeyPath] = dictionary[originalKeyPaths];
+                    normalizedValue = [NSDictionary dictionaryWithDictionary:unionOfValues];
+                }
+                else
+                {
+                    normalizedValue = @{ subKeyPath : dictionary[originalKeyPaths] };
+                }
+                
+                normalizedDictionary[normalizedKey] = normalizedValue;
+            }
+            else
+            {
+                // the dictionary is already normalized
+                normalizedDictionary[keyPath] = dictionary[originalKeyPaths];
+            }
+        }
+    }
+    
+    return [NSDictionary dictionaryWithDictionary:normalizedDictionary];
+}
+
+#pragma mark Utils
+
+- (NSDictionary*) mergedValueForStyle:(NSString*)style
+{
+    NSString* keyPath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, style];
+    
+    NSMutableDictionary* mergedDictionary = [NSMutableDictionary new];
+    [self mergedStyleDictionary:mergedDictionary forKeypath:keyPath insideThemes:self.themes];
+    return mergedDictionary;
+}
+
+- (void) mergedStyleDictionary:(NSMutableDictionary*)styleDictionary forKeypath:(NSString*)keypath insideThemes:(NSArray<NSDictionary*>*)themes
+{
+    NSDictionary* theme = themes.firstObject;
+    NSDictionary* currentThemeStyle = [theme valueForKeyPath:keypath];
+    
+    NSString* inheritedStyle = [currentThemeStyle valueForKey:INHERIT_FROM_DEFAULT_THEME];
+    if(inheritedStyle.length > 0 && themes.count > 1)
+    {
+        // inheritance styles works only on default_theme
+        NSString* inheritedKeypath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, inheritedStyle];
+        [self mergedStyleDictionary:styleDictionary forKeypath:inheritedKeypath insideThemes:@[themes.lastObject]];
+    }
+    
+    NSString* superStyle = [currentThemeStyle valueForKey:SUPERSTYLE_KEY];
+    if(superStyle.length > 0)
+    {
+        // try superstyle on current theme
+        NSString* superstyleKeypath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, superStyle];
+        if(superstyleKeypath.length > 0)
+        {
+            [self mergedStyleDictionary:styleDictionary forKeypath:superstyleKeypath insideThemes:themes];
+        }
+        else
+        {
+            // if not exist goes back to previous themes
+            if(themes.count > 1)
+            {
+                NSMutableArray* remainingThemes = themes.mutableCopy;
+                [remainingThemes removeObjectAtIndex:0];
+                [self mergedStyleDictionary:styleDictionary forKeypath:superstyleKeypath insideThemes:remainingThemes];
+            }
+        }
+    }
+    
+    // set all keys (expect _inherit and _superstyle)
+    NSMutableArray<NSString*>* keyToSet = currentThemeStyle.allKeys.mutableCopy;
+    [keyToSet removeObjectsInArray:@[INHERIT_FROM_DEFAULT_THEME, SUPERSTYLE_KEY, VARIANT_OF_KEY]];
+    for(NSString* key in keyToSet)
+    {
+        id value = currentThemeStyle[key];
+        [styleDictionary setValue:value forKey:key];
+    }
+}
+
+- (NSString*) layerNameForKeyPath:(NSString*)keyPath
+{
+    for (NSDictionary* theme in self.themes)
+    {
+        if ([theme valueForKeyPath:keyPath] != nil)
+        {
+            SDThemeLayer* layer = [SDThemeLayer layerOfDictionary:theme];
+            return layer ? layer.name : DYNAMIC_LAYER_NAME;
+        }
+    }
+    return nil;
+}
+
+@end
@@ -0,0 +1,66 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * State shared by all the theme manager instances of the process: the compiled theme layers, that are immutable, and the values of the conventions that do not depend on the themes (colors and geometries) and the fonts, by resolved name and size.
+ * Every manager keeps only its own stack of layers and its dynamic theme, so an additional manager costs only its differences.
+ *
+ * The store is thread safe.
+ */
+@interface SDThemeSharedStore : NSObject
+
++ (instancetype) sharedStore;
+
+/**
+ * Returns the compiled layer of the theme file at the given path, compiling it with the given block if the file is not in the store or changed since it was compiled.
+ * The default theme is kept for the whole life of the process; the other layers as long as a manager uses them.
+ *
+ * @param path the path of the theme file
+ * @param retained if YES the layer is kept even if no manager uses it
+ * @param compile the block compiling the file, returning nil if the file is not valid
+ *
+ * @return the compiled theme dictionary or nil
+ */
+- (NSDictionary*) compiledThemeAtPath:(NSString*)path retained:(BOOL)retained compile:(NSDictionary* (^)(void))compile;
+
+/**
+ * Returns the value of a convention that does not depend on the themes, computing it with the given block the first time.
+ *
+ * @param string the conventional string (eg. "c:FF0000")
+ * @param compute the block computing the value, returning nil if the string is not valid
+ *
+ * @return the value or nil
+ */
+- (id) conventionValueForString:(NSString*)string compute:(id (^)(void))compute;
+
+/**
+ * Adds values of conventions computed before, eg. the ones stored with a compiled theme, so they are not computed again.
+ *
+ * @param values the values by conventional string
+ */
+- (void) addConventionValues:(NSDictionary<NSString*, id>*)values;
+
+/**
+ * Discards the values of the conventions computed so far, eg. when the parser of a convention changes.
+ */
+- (void) removeAllConventionValues;
+
+/**
+ * @return the number of compiled layers currently in the store.
+ */
+- (NSUInteger) compiledThemeCount;
+
+@end
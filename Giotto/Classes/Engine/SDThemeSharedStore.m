@@ -0,0 +1,142 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeSharedStore.h"
+#import <pthread.h>
+
+@interface SDThemeSharedStore ()
+{
+    pthread_mutex_t _lock;
+}
+
+// compiled layers by path, released when no manager uses them
+@property (nonatomic, strong) NSMapTable<NSString*, NSDictionary*>* compiledThemes;
+// layers kept for the whole life of the process (the default theme)
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSDictionary*>* retainedThemes;
+// modification date of the file each layer was compiled from
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSDate*>* modificationDates;
+
+@property (nonatomic, strong) NSCache<NSString*, id>* conventionValues;
+
+@end
+
+@implementation SDThemeSharedStore
+
++ (instancetype) sharedStore
+{
+    static dispatch_once_t pred;
+    static id sharedStoreInstance_ = nil;
+
+    dispatch_once(&pred, ^{
+        sharedStoreInstance_ = [[self alloc] init];
+    });
+
+    return sharedStoreInstance_;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        pthread_mutex_init(&_lock, NULL);
+        self.compiledThemes = [NSMapTable strongToWeakObjectsMapTable];
+        self.retainedThemes = [NSMutableDictionary new];
+        self.modificationDates = [NSMutableDictionary new];
+        self.conventionValues = [NSCache new];
+        self.conventionValues.name = @"it.sysdata.giotto.conventions";
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (NSDictionary*) compiledThemeAtPath:(NSString*)path retained:(BOOL)retained compile:(NSDictionary* (^)(void))compile
+{
+    if (!path)
+    {
+        return compile();
+    }
+    NSDate* modificationDate = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil].fileModificationDate;
+
+    pthread_mutex_lock(&_lock);
+    NSDictionary* theme = [self.compiledThemes objectForKey:path];
+    BOOL upToDate = theme && modificationDate && [self.modificationDates[path] isEqualToDate:modificationDate];
+    pthread_mutex_unlock(&_lock);
+    if (upToDate)
+    {
+        return theme;
+    }
+
+    // compiled outside the lock: two managers loading the same file at the same time may both compile it, the last one is stored
+    theme = compile();
+    if (!theme)
+    {
+        return nil;
+    }
+
+    pthread_mutex_lock(&_lock);
+    [self.compiledThemes setObject:theme forKey:path];
+    self.modificationDates[path] = modificationDate;
+    if (retained)
+    {
+        self.retainedThemes[path] = theme;
+    }
+    pthread_mutex_unlock(&_lock);
+    return theme;
+}
+
+- (id) conventionValueForString:(NSString*)string compute:(id (^)(void))compute
+{
+    if (!string)
+    {
+        return compute();
+    }
+    // NSCache is thread safe
+    id value = [self.conventionValues objectForKey:string];
+    if (!value)
+    {
+        value = compute();
+        if (value)
+        {
+            [self.conventionValues setObject:value forKey:string];
+        }
+    }
+    return value;
+}
+
+- (void) addConventionValues:(NSDictionary<NSString*, id>*)values
+{
+    [values enumerateKeysAndObjectsUsingBlock:^(NSString* string, id value, BOOL* stop) {
+        [self.conventionValues setObject:value forKey:string];
+    }];
+}
+
+- (void) removeAllConventionValues
+{
+    [self.conventionValues removeAllObjects];
+}
+
+- (NSUInteger) compiledThemeCount
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = self.compiledThemes.keyEnumerator.allObjects.count;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+@end
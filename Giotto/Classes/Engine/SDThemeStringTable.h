@@ -0,0 +1,68 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#define SDThemeStringNotFound UINT32_MAX
+
+/**
+ * Table of the strings (keys and string values) used by all the compiled theme layers.
+ * Every string is stored once and identified by an integer, so that layers can reference it with 4 bytes and share the same NSString instance.
+ *
+ * The strings of the layers are reference counted: a string is removed when the last layer using it is released, eg. after a hot reload or a change of the alternative themes, and its identifier is reused.
+ * The table is thread safe.
+ */
+@interface SDThemeStringTable : NSObject
+
++ (instancetype) sharedTable;
+
+/**
+ * Returns the identifier of the given string, adding it to the table if needed. The string is kept as long as the table.
+ */
+- (uint32_t) identifierForString:(NSString*)string;
+
+/**
+ * Returns the identifier of the given string, adding it to the table if needed, and increments its reference count.
+ */
+- (uint32_t) retainIdentifierForString:(NSString*)string;
+
+/**
+ * Decrements the reference count of the given identifiers, removing the strings that are no longer used.
+ *
+ * @param identifiers identifiers returned by retainIdentifierForString:, once for each call
+ * @param count the number of identifiers
+ */
+- (void) releaseIdentifiers:(const uint32_t*)identifiers count:(NSUInteger)count;
+
+/**
+ * Returns the identifier of the given string or SDThemeStringNotFound if the string is not in the table. It never adds strings.
+ */
+- (uint32_t) existingIdentifierForString:(NSString*)string;
+
+/**
+ * Returns the string with the given identifier or nil.
+ */
+- (NSString*) stringForIdentifier:(uint32_t)identifier;
+
+/**
+ * @return the number of strings in the table.
+ */
+- (NSUInteger) count;
+
+/**
+ * @return an estimation of the heap used by the table, in bytes.
+ */
+- (NSUInteger) memoryFootprint;
+
+@end
@@ -0,0 +1,221 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeStringTable.h"
+#import <pthread.h>
+
+// rough per-entry overhead of the NSString object, of the dictionary bucket and of the array slot
+#define STRING_ENTRY_OVERHEAD 48
+// reference count of the strings kept as long as the table
+#define PINNED_REFERENCE_COUNT UINT32_MAX
+
+@interface SDThemeStringTable ()
+{
+    pthread_rwlock_t _lock;
+    CFMutableDictionaryRef _identifiers;
+    // NSNull for the removed strings
+    NSMutableArray* _strings;
+    uint32_t* _referenceCounts;
+    NSUInteger _referenceCountCapacity;
+    // identifiers of the removed strings, reused before growing the table
+    NSMutableIndexSet* _freeIdentifiers;
+    NSUInteger _count;
+    NSUInteger _bytes;
+}
+@end
+
+@implementation SDThemeStringTable
+
++ (instancetype) sharedTable
+{
+    static dispatch_once_t pred;
+    static id sharedTableInstance_ = nil;
+
+    dispatch_once(&pred, ^{
+        sharedTableInstance_ = [[self alloc] init];
+    });
+
+    return sharedTableInstance_;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        pthread_rwlock_init(&_lock, NULL);
+        // values are the identifiers themselves, so no callbacks are needed for them
+        _identifiers = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+        _strings = [NSMutableArray new];
+        _freeIdentifiers = [NSMutableIndexSet new];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    CFRelease(_identifiers);
+    free(_referenceCounts);
+    pthread_rwlock_destroy(&_lock);
+}
+
+- (uint32_t) identifierForString:(NSString*)string
+{
+    return [self identifierForString:string retain:NO];
+}
+
+- (uint32_t) retainIdentifierForString:(NSString*)string
+{
+    return [self identifierForString:string retain:YES];
+}
+
+- (uint32_t) identifierForString:(NSString*)string retain:(BOOL)retain
+{
+    if (string == nil)
+    {
+        return SDThemeStringNotFound;
+    }
+    if (!retain)
+    {
+        uint32_t identifier = [self existingIdentifierForString:string];
+        if (identifier != SDThemeStringNotFound)
+        {
+            // pinned strings are never removed, a string already in the table is pinned below
+            pthread_rwlock_rdlock(&_lock);
+            BOOL pinned = _referenceCounts[identifier] == PINNED_REFERENCE_COUNT;
+            pthread_rwlock_unlock(&_lock);
+            if (pinned)
+            {
+                return identifier;
+            }
+        }
+    }
+
+    uint32_t identifier;
+    pthread_rwlock_wrlock(&_lock);
+    const void* value = NULL;
+    if (CFDictionaryGetValueIfPresent(_identifiers, (__bridge CFStringRef)string, &value))
+    {
+        identifier = (uint32_t)(uintptr_t)value;
+    }
+    else
+    {
+        NSString* storedString = [string copy];
+        if (_freeIdentifiers.count > 0)
+        {
+            identifier = (uint32_t)_freeIdentifiers.firstIndex;
+            [_freeIdentifiers removeIndex:identifier];
+            _strings[identifier] = storedString;
+        }
+        else
+        {
+            identifier = (uint32_t)_strings.count;
+            [_strings addObject:storedString];
+            if (_strings.count > _referenceCountCapacity)
+            {
+                _referenceCountCapacity = MAX(_referenceCountCapacity * 2, 1024);
+                _referenceCounts = realloc(_referenceCounts, _referenceCountCapacity * sizeof(uint32_t));
+            }
+        }
+        _referenceCounts[identifier] = 0;
+        CFDictionarySetValue(_identifiers, (__bridge CFStringRef)storedString, (const void*)(uintptr_t)identifier);
+        _count++;
+        _bytes += [storedString lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + STRING_ENTRY_OVERHEAD;
+    }
+    if (!retain)
+    {
+        _referenceCounts[identifier] = PINNED_REFERENCE_COUNT;
+    }
+    else if (_referenceCounts[identifier] != PINNED_REFERENCE_COUNT)
+    {
+        _referenceCounts[identifier]++;
+    }
+    pthread_rwlock_unlock(&_lock);
+    return identifier;
+}
+
+- (void) releaseIdentifiers:(const uint32_t*)identifiers count:(NSUInteger)count
+{
+    if (count == 0)
+    {
+        return;
+    }
+    pthread_rwlock_wrlock(&_lock);
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        uint32_t identifier = identifiers[i];
+        if (identifier >= _strings.count || _referenceCounts[identifier] == 0 || _referenceCounts[identifier] == PINNED_REFERENCE_COUNT)
+        {
+            continue;
+        }
+        if (--_referenceCounts[identifier] == 0)
+        {
+            NSString* string = _strings[identifier];
+            _bytes -= [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + STRING_ENTRY_OVERHEAD;
+            CFDictionaryRemoveValue(_identifiers, (__bridge CFStringRef)string);
+            _strings[identifier] = [NSNull null];
+            [_freeIdentifiers addIndex:identifier];
+            _count--;
+        }
+    }
+    pthread_rwlock_unlock(&_lock);
+}
+
+- (uint32_t) existingIdentifierForString:(NSString*)string
+{
+    if (string == nil)
+    {
+        return SDThemeStringNotFound;
+    }
+
+    uint32_t identifier = SDThemeStringNotFound;
+    const void* value = NULL;
+    pthread_rwlock_rdlock(&_lock);
+    if (CFDictionaryGetValueIfPresent(_identifiers, (__bridge CFStringRef)string, &value))
+    {
+        identifier = (uint32_t)(uintptr_t)value;
+    }
+    pthread_rwlock_unlock(&_lock);
+    return identifier;
+}
+
+- (NSString*) stringForIdentifier:(uint32_t)identifier
+{
+    NSString* string = nil;
+    pthread_rwlock_rdlock(&_lock);
+    if (identifier < _strings.count && _referenceCounts[identifier] > 0)
+    {
+        string = _strings[identifier];
+    }
+    pthread_rwlock_unlock(&_lock);
+    return string;
+}
+
+- (NSUInteger) count
+{
+    pthread_rwlock_rdlock(&_lock);
+    NSUInteger count = _count;
+    pthread_rwlock_unlock(&_lock);
+    return count;
+}
+
+- (NSUInteger) memoryFootprint
+{
+    pthread_rwlock_rdlock(&_lock);
+    NSUInteger bytes = _bytes;
+    pthread_rwlock_unlock(&_lock);
+    return bytes;
+}
+
+@end
@@ -0,0 +1,71 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(uint8_t, SDThemeTraceCategory) {
+    SDThemeTraceCategoryApply = 0,  // application of styles and batches
+    SDThemeTraceCategoryResolve,    // resolution of values, constants and conventions
+    SDThemeTraceCategoryWrite,      // writes to the objects
+    SDThemeTraceCategoryLoad,       // loading, compaction and reload of the themes
+    SDThemeTraceCategoryApp,        // spans added by the app
+};
+
+/**
+ * Records nested begin / end events in a fixed size ring buffer and exports them in the Chrome trace event format (chrome://tracing, Perfetto).
+ *
+ * Recording is lock free: every event reserves a slot with an atomic increment and publishes it with a sequence number, so it can be used from any thread; when the buffer is full the oldest events are overwritten.
+ * Timestamps are the microseconds of mach_absolute_time() (of CLOCK_MONOTONIC outside of Apple platforms), so spans recorded by the app with the same clock (or with beginEventWithName:... and SDThemeTraceCategoryApp) line up.
+ */
+@interface SDThemeTracer : NSObject
+
+/**
+ * @param capacity the number of events kept, rounded up to a power of two
+ */
+- (instancetype) initWithCapacity:(NSUInteger)capacity;
+
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+/**
+ * Records the beginning of a span.
+ *
+ * @param name the name of the span (eg. the style name)
+ * @param category the category of the span
+ * @param keyPath the keyPath involved, or nil
+ * @param targetClass the class of the object involved, or Nil
+ * @param layer the name of the theme layer that supplied the value, or nil
+ */
+- (void) beginEventWithName:(NSString*)name category:(SDThemeTraceCategory)category keyPath:(NSString*)keyPath targetClass:(Class)targetClass layer:(NSString*)layer;
+
+/**
+ * Records the end of the span opened by the last beginEventWithName:... with the same name on the current thread.
+ */
+- (void) endEventWithName:(NSString*)name category:(SDThemeTraceCategory)category;
+
+/**
+ * Discards all the recorded events.
+ */
+- (void) clear;
+
+/**
+ * @return the recorded events as a Chrome trace JSON object ({"traceEvents": [...]}), oldest first.
+ */
+- (NSData*) chromeTraceData;
+
+/**
+ * Writes chromeTraceData to a file.
+ */
+- (BOOL) writeChromeTraceToFile:(NSString*)path error:(NSError**)error;
+
+@end
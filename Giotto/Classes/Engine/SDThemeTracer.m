@@ -0,0 +1,231 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeTracer.h"
+#import "SDThemeStringTable.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct {
+    // index of the event + 1 once the slot is completely written, 0 while it is being written
+    _Atomic(uint64_t) sequence;
+    uint64_t timestamp;
+    __unsafe_unretained Class targetClass;
+    uint32_t nameID;
+    uint32_t keyPathID;
+    uint32_t layerID;
+    uint32_t threadID;
+    SDThemeTraceCategory category;
+    char phase;
+} SDThemeTraceEvent;
+
+static const char* const SDThemeTraceCategoryNames[] = { "apply", "resolve", "write", "load", "app" };
+
+/**
+ * @return the ticks of a monotonic clock: mach_absolute_time on Apple platforms, where clock_gettime needs iOS 10, nanoseconds elsewhere
+ */
+static inline uint64_t SDThemeTraceTimestamp(void)
+{
+#if defined(__APPLE__)
+    return mach_absolute_time();
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * NSEC_PER_SEC + (uint64_t)time.tv_nsec;
+#endif
+}
+
+/**
+ * @return the identifier of the calling thread: its mach port on Apple platforms, elsewhere a number assigned at its first event
+ */
+static inline uint32_t SDThemeTraceThreadID(void)
+{
+#if defined(__APPLE__)
+    return pthread_mach_thread_np(pthread_self());
+#else
+    static _Atomic(uint32_t) lastThreadID;
+    static _Thread_local uint32_t threadID;
+    if (threadID == 0)
+    {
+        threadID = atomic_fetch_add_explicit(&lastThreadID, 1, memory_order_relaxed) + 1;
+    }
+    return threadID;
+#endif
+}
+
+@interface SDThemeTracer ()
+{
+    SDThemeTraceEvent* _events;
+    NSUInteger _mask;
+    _Atomic(uint64_t) _head;
+    // microseconds of a tick of SDThemeTraceTimestamp
+    double _microsecondsPerTick;
+}
+
+@property (nonatomic, assign) NSUInteger capacity;
+// names of the events, kept apart from the strings of the themes so that they do not keep them alive
+@property (nonatomic, strong) SDThemeStringTable* strings;
+
+@end
+
+@implementation SDThemeTracer
+
+- (instancetype) init
+{
+    return [self initWithCapacity:1 << 16];
+}
+
+- (instancetype) initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self)
+    {
+        NSUInteger roundedCapacity = 1;
+        while (roundedCapacity < MAX(capacity, 2))
+        {
+            roundedCapacity <<= 1;
+        }
+        self.capacity = roundedCapacity;
+        _mask = roundedCapacity - 1;
+        _events = calloc(roundedCapacity, sizeof(SDThemeTraceEvent));
+        atomic_init(&_head, 0);
+        self.strings = [SDThemeStringTable new];
+#if defined(__APPLE__)
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        _microsecondsPerTick = (double)timebase.numer / timebase.denom / 1000.0;
+#else
+        _microsecondsPerTick = 1 / 1000.0;
+#endif
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(_events);
+}
+
+#pragma mark Recording
+
+- (void) beginEventWithName:(NSString*)name category:(SDThemeTraceCategory)category keyPath:(NSString*)keyPath targetClass:(Class)targetClass layer:(NSString*)layer
+{
+    [self recordPhase:'B' name:name category:category keyPath:keyPath targetClass:targetClass layer:layer];
+}
+
+- (void) endEventWithName:(NSString*)name category:(SDThemeTraceCategory)category
+{
+    [self recordPhase:'E' name:name category:category keyPath:nil targetClass:Nil layer:nil];
+}
+
+- (void) recordPhase:(char)phase name:(NSString*)name category:(SDThemeTraceCategory)category keyPath:(NSString*)keyPath targetClass:(Class)targetClass layer:(NSString*)layer
+{
+    SDThemeStringTable* strings = self.strings;
+    uint64_t index = atomic_fetch_add_explicit(&_head, 1, memory_order_relaxed);
+    SDThemeTraceEvent* event = &_events[index & _mask];
+    
+    // the slot is invalid while it is being written
+    atomic_store_explicit(&event->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event->timestamp = SDThemeTraceTimestamp();
+    event->phase = phase;
+    event->category = category;
+    event->nameID = name ? [strings identifierForString:name] : SDThemeStringNotFound;
+    event->keyPathID = keyPath ? [strings identifierForString:keyPath] : SDThemeStringNotFound;
+    event->layerID = layer ? [strings identifierForString:layer] : SDThemeStringNotFound;
+    event->targetClass = targetClass;
+    event->threadID = SDThemeTraceThreadID();
+    atomic_store_explicit(&event->sequence, index + 1, memory_order_release);
+}
+
+- (void) clear
+{
+    // invalidated slots are skipped by the export, the head keeps growing
+    for (NSUInteger i = 0; i < self.capacity; i++)
+    {
+        atomic_store_explicit(&_events[i].sequence, 0, memory_order_release);
+    }
+}
+
+#pragma mark Export
+
+- (NSData*) chromeTraceData
+{
+    SDThemeStringTable* strings = self.strings;
+    uint64_t head = atomic_load_explicit(&_head, memory_order_acquire);
+    uint64_t first = head > self.capacity ? head - self.capacity : 0;
+    int pid = getpid();
+    
+    NSMutableArray<NSDictionary*>* traceEvents = [NSMutableArray new];
+    for (uint64_t index = first; index < head; index++)
+    {
+        SDThemeTraceEvent* slot = &_events[index & _mask];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != index + 1)
+        {
+            // not written yet or already overwritten
+            continue;
+        }
+        SDThemeTraceEvent event;
+        event.timestamp = slot->timestamp;
+        event.phase = slot->phase;
+        event.category = slot->category;
+        event.nameID = slot->nameID;
+        event.keyPathID = slot->keyPathID;
+        event.layerID = slot->layerID;
+        event.targetClass = slot->targetClass;
+        event.threadID = slot->threadID;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != index + 1)
+        {
+            // overwritten while it was being copied
+            continue;
+        }
+        
+        NSMutableDictionary* traceEvent = [NSMutableDictionary new];
+        traceEvent[@"name"] = [strings stringForIdentifier:event.nameID] ?: @"";
+        traceEvent[@"cat"] = @(SDThemeTraceCategoryNames[MIN(event.category, SDThemeTraceCategoryApp)]);
+        traceEvent[@"ph"] = [NSString stringWithFormat:@"%c", event.phase];
+        traceEvent[@"ts"] = @((double)event.timestamp * _microsecondsPerTick);
+        traceEvent[@"pid"] = @(pid);
+        traceEvent[@"tid"] = @(event.threadID);
+        
+        NSMutableDictionary* args = [NSMutableDictionary new];
+        args[@"keyPath"] = [strings stringForIdentifier:event.keyPathID];
+        args[@"layer"] = [strings stringForIdentifier:event.layerID];
+        if (event.targetClass)
+        {
+            args[@"class"] = NSStringFromClass(event.targetClass);
+        }
+        if (args.count > 0)
+        {
+            traceEvent[@"args"] = args;
+        }
+        [traceEvents addObject:traceEvent];
+    }
+    
+    return [NSJSONSerialization dataWithJSONObject:@{ @"traceEvents": traceEvents, @"displayTimeUnit": @"ms" } options:0 error:nil];
+}
+
+- (BOOL) writeChromeTraceToFile:(NSString*)path error:(NSError**)error
+{
+    return [[self chromeTraceData] writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+@end
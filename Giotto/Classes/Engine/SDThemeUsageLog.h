@@ -0,0 +1,46 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Records the names of the styles and of the constants read by a manager, to find the ones a theme can do without (see Scripts/strip_theme.py).
+ *
+ * Recording is thread safe, so the background resolutions are recorded too.
+ */
+@interface SDThemeUsageLog : NSObject
+
+- (void) recordStyleWithName:(NSString*)styleName;
+
+- (void) recordConstantWithName:(NSString*)constantName;
+
+@property (nonatomic, copy, readonly) NSSet<NSString*>* styleNames;
+@property (nonatomic, copy, readonly) NSSet<NSString*>* constantNames;
+
+/**
+ * Discards all the recorded names.
+ */
+- (void) clear;
+
+/**
+ * @return the recorded names as a JSON object ({"styles": [...], "constants": [...]}), sorted.
+ */
+- (NSData*) JSONData;
+
+/**
+ * Writes JSONData to a file.
+ */
+- (BOOL) writeToFile:(NSString*)path error:(NSError**)error;
+
+@end
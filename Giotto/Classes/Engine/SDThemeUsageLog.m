@@ -0,0 +1,109 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeUsageLog.h"
+#import <pthread.h>
+
+#define STYLES_JSON_KEY     @"styles"
+#define CONSTANTS_JSON_KEY  @"constants"
+
+@interface SDThemeUsageLog ()
+{
+    pthread_mutex_t _lock;
+}
+
+@property (nonatomic, strong) NSMutableSet<NSString*>* recordedStyleNames;
+@property (nonatomic, strong) NSMutableSet<NSString*>* recordedConstantNames;
+
+@end
+
+@implementation SDThemeUsageLog
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        pthread_mutex_init(&_lock, NULL);
+        self.recordedStyleNames = [NSMutableSet new];
+        self.recordedConstantNames = [NSMutableSet new];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void) recordStyleWithName:(NSString*)styleName
+{
+    if (!styleName)
+    {
+        return;
+    }
+    pthread_mutex_lock(&_lock);
+    [self.recordedStyleNames addObject:styleName];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void) recordConstantWithName:(NSString*)constantName
+{
+    if (!constantName)
+    {
+        return;
+    }
+    pthread_mutex_lock(&_lock);
+    [self.recordedConstantNames addObject:constantName];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSSet<NSString*>*) styleNames
+{
+    pthread_mutex_lock(&_lock);
+    NSSet<NSString*>* styleNames = [self.recordedStyleNames copy];
+    pthread_mutex_unlock(&_lock);
+    return styleNames;
+}
+
+- (NSSet<NSString*>*) constantNames
+{
+    pthread_mutex_lock(&_lock);
+    NSSet<NSString*>* constantNames = [self.recordedConstantNames copy];
+    pthread_mutex_unlock(&_lock);
+    return constantNames;
+}
+
+- (void) clear
+{
+    pthread_mutex_lock(&_lock);
+    [self.recordedStyleNames removeAllObjects];
+    [self.recordedConstantNames removeAllObjects];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSData*) JSONData
+{
+    NSArray<NSSortDescriptor*>* sort = @[[NSSortDescriptor sortDescriptorWithKey:@"self" ascending:YES]];
+    NSDictionary* log = @{ STYLES_JSON_KEY: [self.styleNames sortedArrayUsingDescriptors:sort],
+                           CONSTANTS_JSON_KEY: [self.constantNames sortedArrayUsingDescriptors:sort] };
+    return [NSJSONSerialization dataWithJSONObject:log options:NSJSONWritingPrettyPrinted error:nil];
+}
+
+- (BOOL) writeToFile:(NSString*)path error:(NSError**)error
+{
+    return [[self JSONData] writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+@end
@@ -0,0 +1,114 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * Platform independent values of the conventions, produced by the engine and turned into UIKit objects by SDThemeValue+UIKit.
+ * They are immutable.
+ */
+
+/**
+ * A color in the sRGB space, with components from 0 to 1.
+ */
+@interface SDThemeColorValue : NSObject <NSCopying>
+
+/**
+ * Parses a color in the RRGGBBAA, RRGGBB, RGBA or RGB hexadecimal format.
+ *
+ * @return the color, or nil if the string is not in one of the formats
+ */
++ (instancetype) colorWithHexString:(NSString*)string;
+
++ (instancetype) colorWithRed:(double)red green:(double)green blue:(double)blue alpha:(double)alpha;
+
+/**
+ * A color of the asset catalog of the application. The components are the ones of the color when it was looked up, used by the expressions, or 0 if the color has no RGB components (eg. a pattern); SDThemeValue+UIKit loads the color by name again.
+ */
++ (instancetype) colorWithName:(NSString*)name red:(double)red green:(double)green blue:(double)blue alpha:(double)alpha;
+
+// nil for the colors that are not named
+@property (nonatomic, copy, readonly) NSString* name;
+@property (nonatomic, assign, readonly) double red;
+@property (nonatomic, assign, readonly) double green;
+@property (nonatomic, assign, readonly) double blue;
+@property (nonatomic, assign, readonly) double alpha;
+
+@end
+
+
+typedef NS_ENUM(NSInteger, SDThemeFontKind) {
+    SDThemeFontKindNamed = 0,
+    SDThemeFontKindSystem,
+    SDThemeFontKindSystemBold,
+    SDThemeFontKindSystemItalic,
+};
+
+/**
+ * A font described by name and size. The names "system", "systemBold" and "systemItalic" (case insensitive) describe the system fonts.
+ */
+@interface SDThemeFontValue : NSObject <NSCopying>
+
++ (instancetype) fontWithName:(NSString*)name size:(double)size;
+
+@property (nonatomic, assign, readonly) SDThemeFontKind kind;
+// nil for the system fonts
+@property (nonatomic, copy, readonly) NSString* name;
+@property (nonatomic, assign, readonly) double size;
+
+@end
+
+
+typedef NS_ENUM(NSInteger, SDThemeGeometryType) {
+    SDThemeGeometryTypePoint = 0,   // x, y
+    SDThemeGeometryTypeSize,        // width, height
+    SDThemeGeometryTypeRect,        // x, y, width, height
+    SDThemeGeometryTypeEdgeInsets,  // top, left, bottom, right
+};
+
+/**
+ * A point, a size, a rect or edge insets.
+ */
+@interface SDThemeGeometryValue : NSObject <NSCopying>
+
+/**
+ * Parses the comma separated components of a geometry (eg. "10,20" for a point).
+ *
+ * @return the geometry, or nil if the string has less components than the type needs
+ */
++ (instancetype) geometryWithType:(SDThemeGeometryType)type string:(NSString*)string;
+
+@property (nonatomic, assign, readonly) SDThemeGeometryType type;
+// 2 or 4, by type
+@property (nonatomic, assign, readonly) NSUInteger componentCount;
+
+- (double) componentAtIndex:(NSUInteger)index;
+
+@end
+
+
+/**
+ * A resizable background image described by the background convention: fill color, corner radius and an optional border and tint color.
+ */
+@interface SDThemeBackgroundValue : NSObject <NSCopying>
+
++ (instancetype) backgroundWithFillColor:(SDThemeColorValue*)fillColor cornerRadius:(double)cornerRadius borderWidth:(double)borderWidth borderColor:(SDThemeColorValue*)borderColor tintColor:(SDThemeColorValue*)tintColor;
+
+@property (nonatomic, strong, readonly) SDThemeColorValue* fillColor;
+@property (nonatomic, assign, readonly) double cornerRadius;
+@property (nonatomic, assign, readonly) double borderWidth;
+@property (nonatomic, strong, readonly) SDThemeColorValue* borderColor;
+@property (nonatomic, strong, readonly) SDThemeColorValue* tintColor;
+
+@end
@@ -0,0 +1,299 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeValue.h"
+
+@interface SDThemeColorValue ()
+
+@property (nonatomic, copy) NSString* name;
+@property (nonatomic, assign) double red;
+@property (nonatomic, assign) double green;
+@property (nonatomic, assign) double blue;
+@property (nonatomic, assign) double alpha;
+
+@end
+
+@implementation SDThemeColorValue
+
++ (instancetype) colorWithHexString:(NSString*)string
+{
+    if (string.length != 6 && string.length != 8 && string.length != 3 && string.length != 4)
+    {
+        return nil;
+    }
+    
+    if (string.length == 3) // If you only specify the 3 RGB characters, they duplicate and set the alpha to the maximum
+    {
+        const char* chars = [string UTF8String];
+        string = [NSString stringWithFormat:@"%c%c%c%c%c%c%@", chars[0], chars[0], chars[1], chars[1], chars[2], chars[2], @"FF"];
+    }
+    else if (string.length == 4) // If you only specify 4 RGB characters, they all duplicate
+    {
+        const char* chars = [string UTF8String];
+        string = [NSString stringWithFormat:@"%c%c%c%c%c%c%c%c", chars[0], chars[0], chars[1], chars[1], chars[2], chars[2], chars[3], chars[3]];
+    }
+    else if (string.length == 6) // If you only specify the 6 RRGGBB characters, the alpha hangs up to the maximum
+    {
+        string = [string stringByAppendingString:@"FF"];
+    }
+    
+    NSScanner* scanner = [NSScanner scannerWithString:string];
+    
+    unsigned hex;
+    if (![scanner scanHexInt:&hex])
+    {
+        return nil;
+    }
+    int r = (hex >> 24) & 0xFF;
+    int g = (hex >> 16) & 0xFF;
+    int b = (hex >> 8) & 0xFF;
+    int a = (hex) & 0xFF;
+    
+    return [self colorWithRed:r / 255.0 green:g / 255.0 blue:b / 255.0 alpha:a / 255.0];
+}
+
++ (instancetype) colorWithRed:(double)red green:(double)green blue:(double)blue alpha:(double)alpha
+{
+    SDThemeColorValue* color = [self new];
+    color.red = red;
+    color.green = green;
+    color.blue = blue;
+    color.alpha = alpha;
+    return color;
+}
+
++ (instancetype) colorWithName:(NSString*)name red:(double)red green:(double)green blue:(double)blue alpha:(double)alpha
+{
+    SDThemeColorValue* color = [self colorWithRed:red green:green blue:blue alpha:alpha];
+    color.name = name;
+    return color;
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+- (BOOL) isEqual:(id)object
+{
+    if (![object isKindOfClass:[SDThemeColorValue class]])
+    {
+        return NO;
+    }
+    SDThemeColorValue* color = object;
+    return color.red == self.red && color.green == self.green && color.blue == self.blue && color.alpha == self.alpha && (color.name == self.name || [color.name isEqualToString:self.name]);
+}
+
+- (NSUInteger) hash
+{
+    return self.name.hash ^ (NSUInteger)(self.red * 255.0) << 24 ^ (NSUInteger)(self.green * 255.0) << 16 ^ (NSUInteger)(self.blue * 255.0) << 8 ^ (NSUInteger)(self.alpha * 255.0);
+}
+
+- (NSString*) description
+{
+    return [NSString stringWithFormat:@"<%@: %@%.3f %.3f %.3f %.3f>", NSStringFromClass([self class]), self.name ? [self.name stringByAppendingString:@" "] : @"", self.red, self.green, self.blue, self.alpha];
+}
+
+@end
+
+
+#define SYSTEM_FONT_NAME        @"system"
+#define SYSTEM_BOLD_FONT_NAME   @"systembold"
+#define SYSTEM_ITALIC_FONT_NAME @"systemitalic"
+
+@interface SDThemeFontValue ()
+
+@property (nonatomic, assign) SDThemeFontKind kind;
+@property (nonatomic, copy) NSString* name;
+@property (nonatomic, assign) double size;
+
+@end
+
+@implementation SDThemeFontValue
+
++ (instancetype) fontWithName:(NSString*)name size:(double)size
+{
+    SDThemeFontValue* font = [self new];
+    font.size = size;
+    NSString* lowercaseName = name.lowercaseString;
+    if ([lowercaseName isEqualToString:SYSTEM_FONT_NAME])
+    {
+        font.kind = SDThemeFontKindSystem;
+    }
+    else if ([lowercaseName isEqualToString:SYSTEM_BOLD_FONT_NAME])
+    {
+        font.kind = SDThemeFontKindSystemBold;
+    }
+    else if ([lowercaseName isEqualToString:SYSTEM_ITALIC_FONT_NAME])
+    {
+        font.kind = SDThemeFontKindSystemItalic;
+    }
+    else
+    {
+        font.kind = SDThemeFontKindNamed;
+        font.name = name;
+    }
+    return font;
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+- (BOOL) isEqual:(id)object
+{
+    if (![object isKindOfClass:[SDThemeFontValue class]])
+    {
+        return NO;
+    }
+    SDThemeFontValue* font = object;
+    return font.kind == self.kind && font.size == self.size && (font.name == self.name || [font.name isEqualToString:self.name]);
+}
+
+- (NSUInteger) hash
+{
+    return self.name.hash ^ (NSUInteger)self.kind ^ (NSUInteger)(self.size * 64.0);
+}
+
+- (NSString*) description
+{
+    return [NSString stringWithFormat:@"<%@: %@ %.1f>", NSStringFromClass([self class]), self.name ?: @(self.kind), self.size];
+}
+
+@end
+
+
+@interface SDThemeGeometryValue ()
+{
+    double _components[4];
+}
+
+@property (nonatomic, assign) SDThemeGeometryType type;
+@property (nonatomic, assign) NSUInteger componentCount;
+
+@end
+
+@implementation SDThemeGeometryValue
+
++ (instancetype) geometryWithType:(SDThemeGeometryType)type string:(NSString*)string
+{
+    NSUInteger componentCount = (type == SDThemeGeometryTypePoint || type == SDThemeGeometryTypeSize) ? 2 : 4;
+    NSArray<NSString*>* specs = [string componentsSeparatedByString:@","];
+    if (specs.count < componentCount)
+    {
+        return nil;
+    }
+    
+    SDThemeGeometryValue* geometry = [self new];
+    geometry.type = type;
+    geometry.componentCount = componentCount;
+    for (NSUInteger index = 0; index < componentCount; index++)
+    {
+        geometry->_components[index] = [specs[index] doubleValue];
+    }
+    return geometry;
+}
+
+- (double) componentAtIndex:(NSUInteger)index
+{
+    return index < self.componentCount ? _components[index] : 0.0;
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+- (BOOL) isEqual:(id)object
+{
+    if (![object isKindOfClass:[SDThemeGeometryValue class]])
+    {
+        return NO;
+    }
+    SDThemeGeometryValue* geometry = object;
+    if (geometry.type != self.type)
+    {
+        return NO;
+    }
+    for (NSUInteger index = 0; index < self.componentCount; index++)
+    {
+        if ([geometry componentAtIndex:index] != _components[index])
+        {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (NSUInteger) hash
+{
+    NSUInteger hash = (NSUInteger)self.type;
+    for (NSUInteger index = 0; index < self.componentCount; index++)
+    {
+        hash = hash * 31 + (NSUInteger)(NSInteger)(_components[index] * 64.0);
+    }
+    return hash;
+}
+
+@end
+
+
+@interface SDThemeBackgroundValue ()
+
+@property (nonatomic, strong) SDThemeColorValue* fillColor;
+@property (nonatomic, assign) double cornerRadius;
+@property (nonatomic, assign) double borderWidth;
+@property (nonatomic, strong) SDThemeColorValue* borderColor;
+@property (nonatomic, strong) SDThemeColorValue* tintColor;
+
+@end
+
+@implementation SDThemeBackgroundValue
+
++ (instancetype) backgroundWithFillColor:(SDThemeColorValue*)fillColor cornerRadius:(double)cornerRadius borderWidth:(double)borderWidth borderColor:(SDThemeColorValue*)borderColor tintColor:(SDThemeColorValue*)tintColor
+{
+    SDThemeBackgroundValue* background = [self new];
+    background.fillColor = fillColor;
+    background.cornerRadius = cornerRadius;
+    background.borderWidth = borderWidth;
+    background.borderColor = borderColor;
+    background.tintColor = tintColor;
+    return background;
+}
+
+- (id) copyWithZone:(NSZone*)zone
+{
+    return self;
+}
+
+- (BOOL) isEqual:(id)object
+{
+    if (![object isKindOfClass:[SDThemeBackgroundValue class]])
+    {
+        return NO;
+    }
+    SDThemeBackgroundValue* background = object;
+    return background.cornerRadius == self.cornerRadius && background.borderWidth == self.borderWidth
+        && (background.fillColor == self.fillColor || [background.fillColor isEqual:self.fillColor])
+        && (background.borderColor == self.borderColor || [background.borderColor isEqual:self.borderColor])
+        && (background.tintColor == self.tintColor || [background.tintColor isEqual:self.tintColor]);
+}
+
+- (NSUInteger) hash
+{
+    return self.fillColor.hash ^ self.borderColor.hash * 31 ^ self.tintColor.hash * 17 ^ (NSUInteger)(self.cornerRadius * 64.0) ^ (NSUInteger)(self.borderWidth * 64.0) << 16;
+}
+
+@end
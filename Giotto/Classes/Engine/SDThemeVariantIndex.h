@@ -0,0 +1,93 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+// key of a variant style naming its base style, eg. "CommonLabel_DARK" : { "_variantOf" : "CommonLabel", ... }
+#define VARIANT_OF_KEY @"_variantOf"
+
+/**
+ * Keeps track of the variant dimensions known by the theme manager (idiom, dark mode, size class, layout direction, app defined states...) and of the styles that declare a variant for them.
+ *
+ * A variant of a style is declared in the plist as a style named <style_name>_<VARIANT_VALUE> (eg. "CommonLabel_IPAD", "CommonLabel_DARK") with the name of the base style in its "_variantOf" key.
+ * Variants for more than one dimension can be combined in the same name (eg. "CommonLabel_IPAD_DARK"); combined variants are applied after the simple ones.
+ * Styles without "_variantOf" are never variants, whatever their name, so existing styles ending with a variant value (eg. "Banner_DARK") keep being plain styles.
+ *
+ * The index is built once for every set of themes, so that styles without variants are resolved with a single lookup.
+ * The variant styles to apply are cached for each style and are recomputed only when the value of a dimension used by that style changes.
+ *
+ * The index is thread safe, so that styles can be resolved outside the main thread.
+ */
+@interface SDThemeVariantIndex : NSObject
+
+/**
+ * Registers a variant dimension with all the values it can assume. Values are matched case sensitive against the suffix of the style names.
+ *
+ * @param dimension the name of the dimension
+ * @param values the values the dimension can assume. A value can not be shared between different dimensions.
+ */
+- (void) registerDimension:(NSString*)dimension withValues:(NSArray<NSString*>*)values;
+
+/**
+ * @return the registered dimensions, in registration order.
+ */
+- (NSArray<NSString*>*) dimensions;
+
+/**
+ * Sets the current value of a dimension.
+ *
+ * @param value the new value, or nil if the dimension has no value.
+ * @param dimension the name of a registered dimension
+ *
+ * @return the names of the styles having a variant for the given dimension, that must be re-applied to reflect the change. Empty if the value did not change.
+ */
+- (NSSet<NSString*>*) setValue:(NSString*)value forDimension:(NSString*)dimension;
+
+/**
+ * @return the current value of the given dimension or nil.
+ */
+- (NSString*) valueForDimension:(NSString*)dimension;
+
+/**
+ * Rebuilds the index from scratch with the given variant styles and clears all cached resolutions.
+ *
+ * @param baseStyleNames the names of the base styles declared by the "_variantOf" key of the variant styles of the loaded themes, by variant style name
+ */
+- (void) rebuildWithBaseStyleNames:(NSDictionary<NSString*, NSString*>*)baseStyleNames;
+
+/**
+ * Adds a single variant style to the index. Used when variant styles are declared at runtime.
+ *
+ * @param variantStyleName the name of the variant style, <style_name>_<VARIANT_VALUE>...
+ * @param styleName the name of the base style
+ */
+- (void) addVariantStyleName:(NSString*)variantStyleName ofStyle:(NSString*)styleName;
+
+/**
+ * @param styleName the name of a base style
+ *
+ * @return YES if at least one variant of the given style exists, for any dimension.
+ */
+- (BOOL) hasVariantsForStyle:(NSString*)styleName;
+
+/**
+ * Returns the variant style names that must be applied after the given style with the current values of the dimensions, in application order.
+ *
+ * @param styleName the name of a base style
+ *
+ * @return the ordered variant style names, or nil if the style has no matching variant.
+ */
+- (NSArray<NSString*>*) variantStyleNamesForStyle:(NSString*)styleName;
+
+@end
@@ -0,0 +1,312 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeVariantIndex.h"
+#import "SDThemeLogger.h"
+
+#define VARIANT_SEPARATOR @"_"
+
+/**
+ * A single variant style declared in the themes, with the dimension values it requires.
+ */
+@interface SDThemeStyleVariant : NSObject
+
+@property (nonatomic, copy) NSString* styleName;
+@property (nonatomic, copy) NSDictionary<NSString*, NSString*>* requirements;
+@property (nonatomic, assign) NSUInteger priority;
+
+@end
+
+@implementation SDThemeStyleVariant
+@end
+
+
+@interface SDThemeVariantIndex ()
+
+@property (nonatomic, strong) NSMutableArray<NSString*>* registeredDimensions;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSString*>* dimensionForValue;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSString*>* currentValues;
+
+@property (nonatomic, strong) NSDictionary<NSString*, NSString*>* baseStyleNames;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableArray<SDThemeStyleVariant*>*>* variantsByStyle;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableSet<NSString*>*>* stylesByDimension;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSArray<NSString*>*>* resolvedVariants;
+
+@end
+
+
+@implementation SDThemeVariantIndex
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.registeredDimensions = [NSMutableArray new];
+        self.dimensionForValue = [NSMutableDictionary new];
+        self.currentValues = [NSMutableDictionary new];
+        self.baseStyleNames = [NSDictionary dictionary];
+        self.variantsByStyle = [NSMutableDictionary new];
+        self.stylesByDimension = [NSMutableDictionary new];
+        self.resolvedVariants = [NSMutableDictionary new];
+    }
+    return self;
+}
+
+#pragma mark - Dimensions
+
+- (void) registerDimension:(NSString*)dimension withValues:(NSArray<NSString*>*)values
+{
+    @synchronized (self)
+    {
+        if (dimension.length == 0)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"Can't register a variant dimension without name");
+            return;
+        }
+
+        if (![self.registeredDimensions containsObject:dimension])
+        {
+            [self.registeredDimensions addObject:dimension];
+        }
+
+        for (NSString* value in values)
+        {
+            NSString* currentDimension = self.dimensionForValue[value];
+            if (currentDimension != nil && ![currentDimension isEqualToString:dimension])
+            {
+                SDLogModuleWarning(kThemeManagerLogModuleName, @"Variant value \"%@\" already registered for dimension \"%@\". It will be ignored for dimension \"%@\".", value, currentDimension, dimension);
+                continue;
+            }
+            self.dimensionForValue[value] = dimension;
+        }
+
+        // new values can complete the suffixes of the declared variant styles
+        [self rebuildWithBaseStyleNames:self.baseStyleNames];
+    }
+}
+
+- (NSArray<NSString*>*) dimensions
+{
+    @synchronized (self)
+    {
+        return [self.registeredDimensions copy];
+    }
+}
+
+- (NSSet<NSString*>*) setValue:(NSString*)value forDimension:(NSString*)dimension
+{
+    @synchronized (self)
+    {
+        if (![self.registeredDimensions containsObject:dimension])
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"Can't set value \"%@\" for unknown variant dimension \"%@\"", value, dimension);
+            return [NSSet set];
+        }
+
+        NSString* currentValue = self.currentValues[dimension];
+        if (currentValue == value || [currentValue isEqualToString:value])
+        {
+            return [NSSet set];
+        }
+
+        if (value)
+        {
+            self.currentValues[dimension] = value;
+        }
+        else
+        {
+            [self.currentValues removeObjectForKey:dimension];
+        }
+
+        // only the styles having a variant for this dimension must be resolved again
+        NSSet<NSString*>* affectedStyles = [self.stylesByDimension[dimension] copy] ?: [NSSet set];
+        [self.resolvedVariants removeObjectsForKeys:affectedStyles.allObjects];
+        return affectedStyles;
+    }
+}
+
+- (NSString*) valueForDimension:(NSString*)dimension
+{
+    @synchronized (self)
+    {
+        return self.currentValues[dimension];
+    }
+}
+
+#pragma mark - Index
+
+- (void) rebuildWithBaseStyleNames:(NSDictionary<NSString*, NSString*>*)baseStyleNames
+{
+    @synchronized (self)
+    {
+        self.baseStyleNames = [baseStyleNames copy] ?: [NSDictionary dictionary];
+        [self.variantsByStyle removeAllObjects];
+        [self.stylesByDimension removeAllObjects];
+        [self.resolvedVariants removeAllObjects];
+
+        [self.baseStyleNames enumerateKeysAndObjectsUsingBlock:^(NSString* variantStyleName, NSString* styleName, BOOL* stop) {
+            [self indexVariantStyleName:variantStyleName ofStyle:styleName];
+        }];
+    }
+}
+
+- (void) addVariantStyleName:(NSString*)variantStyleName ofStyle:(NSString*)styleName
+{
+    @synchronized (self)
+    {
+        if (variantStyleName.length == 0 || styleName.length == 0 || [self.baseStyleNames[variantStyleName] isEqualToString:styleName])
+        {
+            return;
+        }
+        NSMutableDictionary<NSString*, NSString*>* baseStyleNames = [self.baseStyleNames mutableCopy];
+        baseStyleNames[variantStyleName] = styleName;
+        if (self.baseStyleNames[variantStyleName])
+        {
+            // the variant moved to another base style
+            [self rebuildWithBaseStyleNames:baseStyleNames];
+            return;
+        }
+        self.baseStyleNames = baseStyleNames;
+        [self indexVariantStyleName:variantStyleName ofStyle:styleName];
+    }
+}
+
+/**
+ * Records a variant style declared with "_variantOf". The suffix of its name following the name of the base style must be made of registered variant values, one for each dimension.
+ */
+- (void) indexVariantStyleName:(NSString*)styleName ofStyle:(NSString*)baseName
+{
+    NSString* prefix = [baseName stringByAppendingString:VARIANT_SEPARATOR];
+    if (![styleName hasPrefix:prefix] || styleName.length == prefix.length)
+    {
+        SDLogModuleWarning(kThemeManagerLogModuleName, @"Variant style \"%@\" must be named %@<VARIANT_VALUE>. It will be ignored.", styleName, prefix);
+        return;
+    }
+
+    NSMutableDictionary<NSString*, NSString*>* requirements = [NSMutableDictionary new];
+    for (NSString* suffix in [[styleName substringFromIndex:prefix.length] componentsSeparatedByString:VARIANT_SEPARATOR])
+    {
+        NSString* dimension = self.dimensionForValue[suffix];
+        if (dimension == nil || requirements[dimension] != nil)
+        {
+            // the values of dimensions registered later are matched when they are registered
+            SDLogModuleVerbose(kThemeManagerLogModuleName, @"Variant style \"%@\" does not match the registered variant values", styleName);
+            return;
+        }
+        requirements[dimension] = suffix;
+    }
+
+    SDThemeStyleVariant* variant = [SDThemeStyleVariant new];
+    variant.styleName = styleName;
+    variant.requirements = requirements;
+    variant.priority = [self priorityForRequirements:requirements];
+
+    NSMutableArray<SDThemeStyleVariant*>* variants = self.variantsByStyle[baseName];
+    if (!variants)
+    {
+        variants = [NSMutableArray new];
+        self.variantsByStyle[baseName] = variants;
+    }
+    [variants addObject:variant];
+
+    // keeps variants in application order: simple variants first, in dimension registration order, then the combined ones
+    [variants sortUsingComparator:^NSComparisonResult(SDThemeStyleVariant* variant1, SDThemeStyleVariant* variant2) {
+        if (variant1.priority == variant2.priority)
+        {
+            return [variant1.styleName compare:variant2.styleName];
+        }
+        return variant1.priority < variant2.priority ? NSOrderedAscending : NSOrderedDescending;
+    }];
+
+    for (NSString* dimension in requirements)
+    {
+        NSMutableSet<NSString*>* styles = self.stylesByDimension[dimension];
+        if (!styles)
+        {
+            styles = [NSMutableSet new];
+            self.stylesByDimension[dimension] = styles;
+        }
+        [styles addObject:baseName];
+    }
+
+    [self.resolvedVariants removeObjectForKey:baseName];
+}
+
+- (NSUInteger) priorityForRequirements:(NSDictionary<NSString*, NSString*>*)requirements
+{
+    // the number of required dimensions weights more than the registration order of the dimensions
+    NSUInteger priority = requirements.count * (self.registeredDimensions.count + 1) * (self.registeredDimensions.count + 1);
+    for (NSString* dimension in requirements)
+    {
+        priority += [self.registeredDimensions indexOfObject:dimension];
+    }
+    return priority;
+}
+
+#pragma mark - Resolution
+
+- (BOOL) hasVariantsForStyle:(NSString*)styleName
+{
+    @synchronized (self)
+    {
+        return styleName != nil && self.variantsByStyle[styleName] != nil;
+    }
+}
+
+- (NSArray<NSString*>*) variantStyleNamesForStyle:(NSString*)styleName
+{
+    @synchronized (self)
+    {
+        if (styleName == nil)
+        {
+            return nil;
+        }
+
+        NSArray<SDThemeStyleVariant*>* variants = self.variantsByStyle[styleName];
+        if (!variants)
+        {
+            // fast path: almost no style has variants
+            return nil;
+        }
+
+        NSArray<NSString*>* resolved = self.resolvedVariants[styleName];
+        if (!resolved)
+        {
+            NSMutableArray<NSString*>* matchingNames = [NSMutableArray new];
+            for (SDThemeStyleVariant* variant in variants)
+            {
+                BOOL matches = YES;
+                for (NSString* dimension in variant.requirements)
+                {
+                    if (![self.currentValues[dimension] isEqualToString:variant.requirements[dimension]])
+                    {
+                        matches = NO;
+                        break;
+                    }
+                }
+                if (matches)
+                {
+                    [matchingNames addObject:variant.styleName];
+                }
+            }
+            resolved = [matchingNames copy];
+            self.resolvedVariants[styleName] = resolved;
+        }
+
+        return resolved.count > 0 ? resolved : nil;
+    }
+}
+
+@end
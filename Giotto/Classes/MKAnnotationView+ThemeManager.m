@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #import "MKAnnotationView+ThemeManager.h"
+#import "SDThemeImageCache.h"
 
 @implementation MKAnnotationView (ThemeManager)
 
@@ -20,7 +21,7 @@
 {
 	if ([keyPath isEqualToString:@"image"] && [value isKindOfClass:[NSString class]])
 	{
-		self.image = [UIImage imageNamed:value];
+		self.image = [[SDThemeImageCache sharedCache] imageNamed:value];
 	}
 	else if ([keyPath isEqualToString:@"centerOffset"] && [value isKindOfClass:[NSString class]])
 	{
@@ -47,4 +47,43 @@
 
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath;
 
+/**
+ * Groups keyPaths that must be committed with a single mutation of the object (eg. all the text attributes of a control state).
+ *
+ * @param keyPath the keyPath to be stylized
+ *
+ * @return the identifier of the batch the keyPath belongs to, or nil if the value is applied immediately.
+ *
+ * @discussion By default it returns nil. The values of all the keyPaths of the same batch sent to the object while a style is applied (superstyles included) are delivered together to applyThemeValues:forBatch: at the end of the application; if a keyPath is set more than once, only the last value is delivered.
+ */
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath;
+
+/**
+ * Applies all the values of a batch with a single mutation.
+ *
+ * @param values the values of the batch by keyPath. nil values are represented by NSNull.
+ * @param batchIdentifier the identifier returned by themeBatchIdentifierForKeyPath:
+ *
+ * @discussion By default it calls applyThemeValue:forKeyPath: for each value.
+ */
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier;
+
+/**
+ * When the theme manager skips redundant writes, tells whether a write of the same value written last time to the keyPath can be skipped.
+ *
+ * @param keyPath the keyPath to be stylized
+ *
+ * @return NO if the result of the write depends on state the theme manager does not know (eg. the placeholder text of a UITextField).
+ *
+ * @discussion By default it returns YES.
+ */
+- (BOOL) shouldSkipRedundantThemeValueForKeyPath:(NSString*)keyPath;
+
+/**
+ * Forgets the last value written by the theme manager to the keyPath, so that the next application writes it again. Call it when the property is changed outside the theme manager.
+ *
+ * @param keyPath the keyPath, or nil to forget all the values written to the object
+ */
+- (void) invalidateThemeShadowStateForKeyPath:(NSString*)keyPath;
+
 @end
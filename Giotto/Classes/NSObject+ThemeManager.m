@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #import "NSObject+ThemeManager.h"
+#import "SDThemeShadowState.h"
 
 @implementation NSObject (ThemeManager)
 
@@ -21,6 +22,35 @@
 	[self setValue:value forKeyPath:keyPath];
 }
 
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath
+{
+    return nil;
+}
+
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier
+{
+    [values enumerateKeysAndObjectsUsingBlock:^(NSString* keyPath, id value, BOOL* stop) {
+        [self applyThemeValue:(value == [NSNull null] ? nil : value) forKeyPath:keyPath];
+    }];
+}
+
+- (BOOL) shouldSkipRedundantThemeValueForKeyPath:(NSString*)keyPath
+{
+    return YES;
+}
+
+- (void) invalidateThemeShadowStateForKeyPath:(NSString*)keyPath
+{
+    if (keyPath)
+    {
+        [[SDThemeShadowState shadowStateOfObject:self create:NO] removeValueForKeyPath:keyPath];
+    }
+    else
+    {
+        [SDThemeShadowState removeShadowStateOfObject:self];
+    }
+}
+
 #pragma mark - ThemeManagerCustomizationProtocol
 
 - (BOOL) shouldApplyThemeCustomizationForKeyPath:(NSString*)keyPath
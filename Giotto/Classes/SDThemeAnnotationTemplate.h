@@ -0,0 +1,46 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <MapKit/MapKit.h>
+#import "SDThemeResolvedStyle.h"
+
+/**
+ * A style for annotation views resolved once and shared by all the views using it: the image is loaded once, the centerOffset parsed once, and the other writes are committed from the resolved style.
+ */
+@interface SDThemeAnnotationTemplate : NSObject
+
+- (instancetype) initWithResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle;
+
+@property (nonatomic, copy, readonly) NSString* styleName;
+// variants and generation of the themes the template has been built with
+@property (nonatomic, copy, readonly) NSArray<NSString*>* variantStyleNames;
+@property (nonatomic, assign, readonly) NSUInteger generation;
+
+// YES if the style sets the image
+@property (nonatomic, assign, readonly) BOOL hasImage;
+@property (nonatomic, strong, readonly) UIImage* image;
+
+// YES if the style sets the centerOffset
+@property (nonatomic, assign, readonly) BOOL hasCenterOffset;
+@property (nonatomic, assign, readonly) CGPoint centerOffset;
+
+// the writes of the style other than image and centerOffset (eg. layer settings), in application order
+@property (nonatomic, copy, readonly) NSArray<SDThemeWrite*>* writes;
+
+/**
+ * Sets the values of the template to an annotation view. The writes are committed by the theme manager.
+ */
+- (void) stampImageAndCenterOffsetOfAnnotationView:(MKAnnotationView*)annotationView;
+
+@end
@@ -0,0 +1,102 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeAnnotationTemplate.h"
+#import "SDThemeImageCache.h"
+
+#define IMAGE_KEY           @"image"
+#define CENTER_OFFSET_KEY   @"centerOffset"
+
+@interface SDThemeAnnotationTemplate ()
+
+@property (nonatomic, copy) NSString* styleName;
+@property (nonatomic, copy) NSArray<NSString*>* variantStyleNames;
+@property (nonatomic, assign) NSUInteger generation;
+@property (nonatomic, assign) BOOL hasImage;
+@property (nonatomic, strong) UIImage* image;
+@property (nonatomic, assign) BOOL hasCenterOffset;
+@property (nonatomic, assign) CGPoint centerOffset;
+@property (nonatomic, copy) NSArray<SDThemeWrite*>* writes;
+
+@end
+
+@implementation SDThemeAnnotationTemplate
+
+- (instancetype) initWithResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle
+{
+    self = [super init];
+    if (self)
+    {
+        self.styleName = resolvedStyle.styleName;
+        self.variantStyleNames = resolvedStyle.variantStyleNames;
+        self.generation = resolvedStyle.generation;
+        
+        NSMutableArray<SDThemeWrite*>* writes = [NSMutableArray new];
+        for (SDThemeWrite* write in resolvedStyle.writes)
+        {
+            // the last value of the superstyle chain wins
+            if (write.target.count == 0 && [write.keyPath isEqualToString:IMAGE_KEY])
+            {
+                self.hasImage = YES;
+                self.image = [write.value isKindOfClass:[NSString class]] ? [[SDThemeImageCache sharedCache] imageNamed:write.value] : ([write.value isKindOfClass:[UIImage class]] ? write.value : nil);
+            }
+            else if (write.target.count == 0 && [write.keyPath isEqualToString:CENTER_OFFSET_KEY])
+            {
+                self.hasCenterOffset = [self parseCenterOffset:write.value];
+            }
+            else
+            {
+                [writes addObject:write];
+            }
+        }
+        self.writes = writes;
+    }
+    return self;
+}
+
+/**
+ * Reads a centerOffset written with the point convention or, like MKAnnotationView+ThemeManager, as "<X>,<Y>".
+ */
+- (BOOL) parseCenterOffset:(id)value
+{
+    if ([value isKindOfClass:[NSValue class]] && strcmp([value objCType], @encode(CGPoint)) == 0)
+    {
+        self.centerOffset = [value CGPointValue];
+        return YES;
+    }
+    if ([value isKindOfClass:[NSString class]])
+    {
+        NSArray* values = [value componentsSeparatedByString:@","];
+        if (values.count == 2)
+        {
+            self.centerOffset = CGPointMake([values[0] floatValue], [values[1] floatValue]);
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (void) stampImageAndCenterOffsetOfAnnotationView:(MKAnnotationView*)annotationView
+{
+    if (self.hasImage && annotationView.image != self.image)
+    {
+        annotationView.image = self.image;
+    }
+    if (self.hasCenterOffset && !CGPointEqualToPoint(annotationView.centerOffset, self.centerOffset))
+    {
+        annotationView.centerOffset = self.centerOffset;
+    }
+}
+
+@end
@@ -0,0 +1,53 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * State of an application of styles in progress. It is created by the outermost application and collects the work that is deferred to its end.
+ */
+@interface SDThemeApplyContext : NSObject
+
+// number of nested applications sharing the context
+@property (nonatomic, assign) NSUInteger depth;
+
+// YES if the application runs inside a CATransaction opened by the outermost application
+@property (nonatomic, assign, getter=isTransactional) BOOL transactional;
+
+/**
+ * Adds a value to a batch of the given object. If the keyPath is already in the batch its value is replaced.
+ *
+ * @param value the value, or nil
+ * @param keyPath the keyPath of the value
+ * @param batchIdentifier the identifier of the batch
+ * @param object the object the batch will be applied to
+ */
+- (void) addValue:(id)value forKeyPath:(NSString*)keyPath toBatch:(NSString*)batchIdentifier ofObject:(NSObject*)object;
+
+/**
+ * Enumerates the batches collected so far, in the order in which they were opened, and removes them from the context.
+ */
+- (void) dequeueBatchesUsingBlock:(void (^)(NSObject* object, NSString* batchIdentifier, NSDictionary<NSString*, id>* values))block;
+
+/**
+ * Adds a root of the hierarchies touched by the application (a view or a layer), to be laid out once at its end. Adding the same root again has no effect.
+ */
+- (void) addLayoutRoot:(NSObject*)root;
+
+/**
+ * Enumerates the layout roots collected so far, in the order in which they were added, and removes them from the context.
+ */
+- (void) dequeueLayoutRootsUsingBlock:(void (^)(NSObject* root))block;
+
+@end
@@ -0,0 +1,118 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeApplyContext.h"
+
+@interface SDThemeBatch : NSObject
+
+@property (nonatomic, strong) NSObject* object;
+@property (nonatomic, copy) NSString* identifier;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, id>* values;
+
+@end
+
+@implementation SDThemeBatch
+@end
+
+
+@interface SDThemeApplyContext ()
+
+@property (nonatomic, strong) NSMutableArray<SDThemeBatch*>* batches;
+// batches by object (compared by identity) and identifier
+@property (nonatomic, strong) NSMapTable<NSObject*, NSMutableDictionary<NSString*, SDThemeBatch*>*>* batchesByObject;
+// roots to lay out, compared by identity
+@property (nonatomic, strong) NSMutableArray<NSObject*>* layoutRoots;
+@property (nonatomic, strong) NSHashTable<NSObject*>* layoutRootSet;
+
+@end
+
+@implementation SDThemeApplyContext
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.batches = [NSMutableArray new];
+        self.batchesByObject = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                         valueOptions:NSPointerFunctionsStrongMemory
+                                                             capacity:0];
+        self.layoutRoots = [NSMutableArray new];
+        self.layoutRootSet = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality capacity:0];
+    }
+    return self;
+}
+
+- (void) addValue:(id)value forKeyPath:(NSString*)keyPath toBatch:(NSString*)batchIdentifier ofObject:(NSObject*)object
+{
+    if (!object || !keyPath || !batchIdentifier)
+    {
+        return;
+    }
+
+    NSMutableDictionary<NSString*, SDThemeBatch*>* objectBatches = [self.batchesByObject objectForKey:object];
+    if (!objectBatches)
+    {
+        objectBatches = [NSMutableDictionary new];
+        [self.batchesByObject setObject:objectBatches forKey:object];
+    }
+
+    SDThemeBatch* batch = objectBatches[batchIdentifier];
+    if (!batch)
+    {
+        batch = [SDThemeBatch new];
+        batch.object = object;
+        batch.identifier = batchIdentifier;
+        batch.values = [NSMutableDictionary new];
+        objectBatches[batchIdentifier] = batch;
+        [self.batches addObject:batch];
+    }
+    batch.values[keyPath] = value ?: [NSNull null];
+}
+
+- (void) dequeueBatchesUsingBlock:(void (^)(NSObject* object, NSString* batchIdentifier, NSDictionary<NSString*, id>* values))block
+{
+    NSArray<SDThemeBatch*>* batches = self.batches;
+    self.batches = [NSMutableArray new];
+    [self.batchesByObject removeAllObjects];
+
+    for (SDThemeBatch* batch in batches)
+    {
+        block(batch.object, batch.identifier, [batch.values copy]);
+    }
+}
+
+- (void) addLayoutRoot:(NSObject*)root
+{
+    if (!root || [self.layoutRootSet containsObject:root])
+    {
+        return;
+    }
+    [self.layoutRootSet addObject:root];
+    [self.layoutRoots addObject:root];
+}
+
+- (void) dequeueLayoutRootsUsingBlock:(void (^)(NSObject* root))block
+{
+    NSArray<NSObject*>* layoutRoots = self.layoutRoots;
+    self.layoutRoots = [NSMutableArray new];
+    [self.layoutRootSet removeAllObjects];
+
+    for (NSObject* root in layoutRoots)
+    {
+        block(root);
+    }
+}
+
+@end
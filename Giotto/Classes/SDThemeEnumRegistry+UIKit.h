@@ -0,0 +1,25 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+#import "SDThemeEnumRegistry.h"
+
+@interface SDThemeEnumRegistry (UIKit)
+
+/**
+ * Registers the tables of the common UIKit enums and option sets, eg. UIViewContentMode, NSTextAlignment, NSLineBreakMode, UIKeyboardAppearance, UIViewAutoresizing. The cases are named like in Swift (eg. "scaleAspectFill").
+ */
+- (void) registerUIKitEnums;
+
+@end
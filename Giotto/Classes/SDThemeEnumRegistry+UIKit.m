@@ -0,0 +1,152 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeEnumRegistry+UIKit.h"
+
+@implementation SDThemeEnumRegistry (UIKit)
+
+- (void) registerUIKitEnums
+{
+    // Views
+    [self registerEnumWithName:@"UIViewContentMode" values:@{ @"scaleToFill": @(UIViewContentModeScaleToFill),
+                                                              @"scaleAspectFit": @(UIViewContentModeScaleAspectFit),
+                                                              @"scaleAspectFill": @(UIViewContentModeScaleAspectFill),
+                                                              @"redraw": @(UIViewContentModeRedraw),
+                                                              @"center": @(UIViewContentModeCenter),
+                                                              @"top": @(UIViewContentModeTop),
+                                                              @"bottom": @(UIViewContentModeBottom),
+                                                              @"left": @(UIViewContentModeLeft),
+                                                              @"right": @(UIViewContentModeRight),
+                                                              @"topLeft": @(UIViewContentModeTopLeft),
+                                                              @"topRight": @(UIViewContentModeTopRight),
+                                                              @"bottomLeft": @(UIViewContentModeBottomLeft),
+                                                              @"bottomRight": @(UIViewContentModeBottomRight) } optionSet:NO];
+    [self registerEnumWithName:@"UIViewAutoresizing" values:@{ @"none": @(UIViewAutoresizingNone),
+                                                               @"flexibleLeftMargin": @(UIViewAutoresizingFlexibleLeftMargin),
+                                                               @"flexibleWidth": @(UIViewAutoresizingFlexibleWidth),
+                                                               @"flexibleRightMargin": @(UIViewAutoresizingFlexibleRightMargin),
+                                                               @"flexibleTopMargin": @(UIViewAutoresizingFlexibleTopMargin),
+                                                               @"flexibleHeight": @(UIViewAutoresizingFlexibleHeight),
+                                                               @"flexibleBottomMargin": @(UIViewAutoresizingFlexibleBottomMargin) } optionSet:YES];
+    [self registerEnumWithName:@"CACornerMask" values:@{ @"layerMinXMinYCorner": @(kCALayerMinXMinYCorner),
+                                                         @"layerMaxXMinYCorner": @(kCALayerMaxXMinYCorner),
+                                                         @"layerMinXMaxYCorner": @(kCALayerMinXMaxYCorner),
+                                                         @"layerMaxXMaxYCorner": @(kCALayerMaxXMaxYCorner) } optionSet:YES];
+    
+    // Text
+    [self registerEnumWithName:@"NSTextAlignment" values:@{ @"left": @(NSTextAlignmentLeft),
+                                                            @"center": @(NSTextAlignmentCenter),
+                                                            @"right": @(NSTextAlignmentRight),
+                                                            @"justified": @(NSTextAlignmentJustified),
+                                                            @"natural": @(NSTextAlignmentNatural) } optionSet:NO];
+    [self registerEnumWithName:@"NSLineBreakMode" values:@{ @"byWordWrapping": @(NSLineBreakByWordWrapping),
+                                                            @"byCharWrapping": @(NSLineBreakByCharWrapping),
+                                                            @"byClipping": @(NSLineBreakByClipping),
+                                                            @"byTruncatingHead": @(NSLineBreakByTruncatingHead),
+                                                            @"byTruncatingTail": @(NSLineBreakByTruncatingTail),
+                                                            @"byTruncatingMiddle": @(NSLineBreakByTruncatingMiddle) } optionSet:NO];
+    [self registerEnumWithName:@"UIBaselineAdjustment" values:@{ @"alignBaselines": @(UIBaselineAdjustmentAlignBaselines),
+                                                                 @"alignCenters": @(UIBaselineAdjustmentAlignCenters),
+                                                                 @"none": @(UIBaselineAdjustmentNone) } optionSet:NO];
+    
+    // Text input
+    [self registerEnumWithName:@"UIKeyboardAppearance" values:@{ @"default": @(UIKeyboardAppearanceDefault),
+                                                                 @"dark": @(UIKeyboardAppearanceDark),
+                                                                 @"light": @(UIKeyboardAppearanceLight) } optionSet:NO];
+    [self registerEnumWithName:@"UIKeyboardType" values:@{ @"default": @(UIKeyboardTypeDefault),
+                                                           @"asciiCapable": @(UIKeyboardTypeASCIICapable),
+                                                           @"numbersAndPunctuation": @(UIKeyboardTypeNumbersAndPunctuation),
+                                                           @"URL": @(UIKeyboardTypeURL),
+                                                           @"numberPad": @(UIKeyboardTypeNumberPad),
+                                                           @"phonePad": @(UIKeyboardTypePhonePad),
+                                                           @"namePhonePad": @(UIKeyboardTypeNamePhonePad),
+                                                           @"emailAddress": @(UIKeyboardTypeEmailAddress),
+                                                           @"decimalPad": @(UIKeyboardTypeDecimalPad),
+                                                           @"twitter": @(UIKeyboardTypeTwitter),
+                                                           @"webSearch": @(UIKeyboardTypeWebSearch),
+                                                           @"asciiCapableNumberPad": @(UIKeyboardTypeASCIICapableNumberPad) } optionSet:NO];
+    [self registerEnumWithName:@"UIReturnKeyType" values:@{ @"default": @(UIReturnKeyDefault),
+                                                            @"go": @(UIReturnKeyGo),
+                                                            @"google": @(UIReturnKeyGoogle),
+                                                            @"join": @(UIReturnKeyJoin),
+                                                            @"next": @(UIReturnKeyNext),
+                                                            @"route": @(UIReturnKeyRoute),
+                                                            @"search": @(UIReturnKeySearch),
+                                                            @"send": @(UIReturnKeySend),
+                                                            @"yahoo": @(UIReturnKeyYahoo),
+                                                            @"done": @(UIReturnKeyDone),
+                                                            @"emergencyCall": @(UIReturnKeyEmergencyCall),
+                                                            @"continue": @(UIReturnKeyContinue) } optionSet:NO];
+    [self registerEnumWithName:@"UITextAutocapitalizationType" values:@{ @"none": @(UITextAutocapitalizationTypeNone),
+                                                                         @"words": @(UITextAutocapitalizationTypeWords),
+                                                                         @"sentences": @(UITextAutocapitalizationTypeSentences),
+                                                                         @"allCharacters": @(UITextAutocapitalizationTypeAllCharacters) } optionSet:NO];
+    [self registerEnumWithName:@"UITextBorderStyle" values:@{ @"none": @(UITextBorderStyleNone),
+                                                              @"line": @(UITextBorderStyleLine),
+                                                              @"bezel": @(UITextBorderStyleBezel),
+                                                              @"roundedRect": @(UITextBorderStyleRoundedRect) } optionSet:NO];
+    [self registerEnumWithName:@"UITextFieldViewMode" values:@{ @"never": @(UITextFieldViewModeNever),
+                                                                @"whileEditing": @(UITextFieldViewModeWhileEditing),
+                                                                @"unlessEditing": @(UITextFieldViewModeUnlessEditing),
+                                                                @"always": @(UITextFieldViewModeAlways) } optionSet:NO];
+    
+    // Controls
+    [self registerEnumWithName:@"UIControlContentHorizontalAlignment" values:@{ @"center": @(UIControlContentHorizontalAlignmentCenter),
+                                                                                @"left": @(UIControlContentHorizontalAlignmentLeft),
+                                                                                @"right": @(UIControlContentHorizontalAlignmentRight),
+                                                                                @"fill": @(UIControlContentHorizontalAlignmentFill) } optionSet:NO];
+    [self registerEnumWithName:@"UIControlContentVerticalAlignment" values:@{ @"center": @(UIControlContentVerticalAlignmentCenter),
+                                                                              @"top": @(UIControlContentVerticalAlignmentTop),
+                                                                              @"bottom": @(UIControlContentVerticalAlignmentBottom),
+                                                                              @"fill": @(UIControlContentVerticalAlignmentFill) } optionSet:NO];
+    [self registerEnumWithName:@"UIBarStyle" values:@{ @"default": @(UIBarStyleDefault),
+                                                       @"black": @(UIBarStyleBlack) } optionSet:NO];
+    
+    // Scroll views and tables
+    [self registerEnumWithName:@"UIScrollViewIndicatorStyle" values:@{ @"default": @(UIScrollViewIndicatorStyleDefault),
+                                                                       @"black": @(UIScrollViewIndicatorStyleBlack),
+                                                                       @"white": @(UIScrollViewIndicatorStyleWhite) } optionSet:NO];
+    [self registerEnumWithName:@"UIScrollViewKeyboardDismissMode" values:@{ @"none": @(UIScrollViewKeyboardDismissModeNone),
+                                                                            @"onDrag": @(UIScrollViewKeyboardDismissModeOnDrag),
+                                                                            @"interactive": @(UIScrollViewKeyboardDismissModeInteractive) } optionSet:NO];
+    [self registerEnumWithName:@"UITableViewCellSeparatorStyle" values:@{ @"none": @(UITableViewCellSeparatorStyleNone),
+                                                                          @"singleLine": @(UITableViewCellSeparatorStyleSingleLine),
+                                                                          @"singleLineEtched": @(UITableViewCellSeparatorStyleSingleLineEtched) } optionSet:NO];
+    [self registerEnumWithName:@"UITableViewCellSelectionStyle" values:@{ @"none": @(UITableViewCellSelectionStyleNone),
+                                                                          @"blue": @(UITableViewCellSelectionStyleBlue),
+                                                                          @"gray": @(UITableViewCellSelectionStyleGray),
+                                                                          @"default": @(UITableViewCellSelectionStyleDefault) } optionSet:NO];
+    [self registerEnumWithName:@"UITableViewCellAccessoryType" values:@{ @"none": @(UITableViewCellAccessoryNone),
+                                                                         @"disclosureIndicator": @(UITableViewCellAccessoryDisclosureIndicator),
+                                                                         @"detailDisclosureButton": @(UITableViewCellAccessoryDetailDisclosureButton),
+                                                                         @"checkmark": @(UITableViewCellAccessoryCheckmark),
+                                                                         @"detailButton": @(UITableViewCellAccessoryDetailButton) } optionSet:NO];
+    
+    // Stack views
+    [self registerEnumWithName:@"UILayoutConstraintAxis" values:@{ @"horizontal": @(UILayoutConstraintAxisHorizontal),
+                                                                   @"vertical": @(UILayoutConstraintAxisVertical) } optionSet:NO];
+    [self registerEnumWithName:@"UIStackViewDistribution" values:@{ @"fill": @(UIStackViewDistributionFill),
+                                                                    @"fillEqually": @(UIStackViewDistributionFillEqually),
+                                                                    @"fillProportionally": @(UIStackViewDistributionFillProportionally),
+                                                                    @"equalSpacing": @(UIStackViewDistributionEqualSpacing),
+                                                                    @"equalCentering": @(UIStackViewDistributionEqualCentering) } optionSet:NO];
+    [self registerEnumWithName:@"UIStackViewAlignment" values:@{ @"fill": @(UIStackViewAlignmentFill),
+                                                                 @"leading": @(UIStackViewAlignmentLeading),
+                                                                 @"firstBaseline": @(UIStackViewAlignmentFirstBaseline),
+                                                                 @"center": @(UIStackViewAlignmentCenter),
+                                                                 @"trailing": @(UIStackViewAlignmentTrailing),
+                                                                 @"lastBaseline": @(UIStackViewAlignmentLastBaseline) } optionSet:NO];
+}
+
+@end
@@ -0,0 +1,67 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+/**
+ * Typed handles of the constants and of the styles, generated from a theme plist by Scripts/generate_theme_handles.py.
+ * A handle is the index of the name in the tables registered with registerConstantHandleNames:count:styleHandleNames:count:, so it is resolved with an array access, without hashing or formatting strings.
+ */
+typedef struct {
+    uint32_t index;
+} SDThemeConstantHandle;
+
+typedef struct {
+    uint32_t index;
+} SDThemeStyleHandle;
+
+/**
+ * Caches the values of the constants and the dictionaries of the styles referenced by handles.
+ * The values are resolved on first access and kept until the themes change (see invalidate). Numbers and geometries are stored unboxed.
+ */
+@interface SDThemeHandleTable : NSObject
+
+/**
+ * @param constantNames the names of the constants, indexed by handle
+ * @param constantCount the number of constant names
+ * @param styleNames the names of the styles, indexed by handle
+ * @param styleCount the number of style names
+ * @param constantResolver returns the value of a constant, with conventions and expressions already resolved
+ * @param styleResolver returns the dictionary of a style
+ */
+- (instancetype) initWithConstantNames:(NSString* const*)constantNames
+                                 count:(NSUInteger)constantCount
+                            styleNames:(NSString* const*)styleNames
+                                 count:(NSUInteger)styleCount
+                      constantResolver:(id (^)(NSString* name))constantResolver
+                         styleResolver:(NSDictionary* (^)(NSString* name))styleResolver;
+
+/**
+ * Discards all the resolved values. Called every time the themes or the constants change.
+ */
+- (void) invalidate;
+
+- (NSString*) nameForConstantHandle:(SDThemeConstantHandle)handle;
+- (NSString*) nameForStyleHandle:(SDThemeStyleHandle)handle;
+
+- (id) valueForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGFloat) floatForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGPoint) pointForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGSize) sizeForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGRect) rectForConstantHandle:(SDThemeConstantHandle)handle;
+- (UIEdgeInsets) edgeInsetsForConstantHandle:(SDThemeConstantHandle)handle;
+
+- (NSDictionary*) styleForHandle:(SDThemeStyleHandle)handle;
+
+@end
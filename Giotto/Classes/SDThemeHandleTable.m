@@ -0,0 +1,230 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeHandleTable.h"
+#import "SDThemeLogger.h"
+
+typedef NS_ENUM(uint8_t, SDThemeHandleValueKind) {
+    SDThemeHandleValueKindNone = 0,
+    SDThemeHandleValueKindNumber,
+    SDThemeHandleValueKindPoint,
+    SDThemeHandleValueKindSize,
+    SDThemeHandleValueKindRect,
+    SDThemeHandleValueKindEdgeInsets,
+};
+
+typedef struct {
+    // generation of the table the slot has been resolved for, 0 if never resolved
+    uint64_t generation;
+    SDThemeHandleValueKind kind;
+    union {
+        CGFloat number;
+        CGPoint point;
+        CGSize size;
+        CGRect rect;
+        UIEdgeInsets edgeInsets;
+    } scalar;
+} SDThemeHandleSlot;
+
+@interface SDThemeHandleTable ()
+{
+    SDThemeHandleSlot* _constantSlots;
+    uint64_t* _styleGenerations;
+}
+
+@property (nonatomic, strong) NSArray<NSString*>* constantNames;
+@property (nonatomic, strong) NSArray<NSString*>* styleNames;
+// resolved values, NSNull if not resolved or nil
+@property (nonatomic, strong) NSMutableArray* constantValues;
+@property (nonatomic, strong) NSMutableArray* styleValues;
+@property (nonatomic, assign) uint64_t generation;
+@property (nonatomic, copy) id (^constantResolver)(NSString* name);
+@property (nonatomic, copy) NSDictionary* (^styleResolver)(NSString* name);
+
+@end
+
+@implementation SDThemeHandleTable
+
+- (instancetype) initWithConstantNames:(NSString* const*)constantNames
+                                 count:(NSUInteger)constantCount
+                            styleNames:(NSString* const*)styleNames
+                                 count:(NSUInteger)styleCount
+                      constantResolver:(id (^)(NSString* name))constantResolver
+                         styleResolver:(NSDictionary* (^)(NSString* name))styleResolver
+{
+    self = [super init];
+    if (self)
+    {
+        self.constantNames = constantCount > 0 ? [NSArray arrayWithObjects:constantNames count:constantCount] : @[];
+        self.styleNames = styleCount > 0 ? [NSArray arrayWithObjects:styleNames count:styleCount] : @[];
+        self.constantResolver = constantResolver;
+        self.styleResolver = styleResolver;
+        self.generation = 1;
+        
+        _constantSlots = calloc(MAX(constantCount, 1), sizeof(SDThemeHandleSlot));
+        _styleGenerations = calloc(MAX(styleCount, 1), sizeof(uint64_t));
+        self.constantValues = [NSMutableArray arrayWithCapacity:constantCount];
+        for (NSUInteger i = 0; i < constantCount; i++)
+        {
+            [self.constantValues addObject:[NSNull null]];
+        }
+        self.styleValues = [NSMutableArray arrayWithCapacity:styleCount];
+        for (NSUInteger i = 0; i < styleCount; i++)
+        {
+            [self.styleValues addObject:[NSNull null]];
+        }
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(_constantSlots);
+    free(_styleGenerations);
+}
+
+- (void) invalidate
+{
+    // the slots are resolved again lazily
+    self.generation++;
+}
+
+- (NSString*) nameForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return handle.index < self.constantNames.count ? self.constantNames[handle.index] : nil;
+}
+
+- (NSString*) nameForStyleHandle:(SDThemeStyleHandle)handle
+{
+    return handle.index < self.styleNames.count ? self.styleNames[handle.index] : nil;
+}
+
+#pragma mark Constants
+
+- (id) valueForConstantHandle:(SDThemeConstantHandle)handle
+{
+    if (![self resolveConstantHandle:handle])
+    {
+        return nil;
+    }
+    id value = self.constantValues[handle.index];
+    return value == [NSNull null] ? nil : value;
+}
+
+- (CGFloat) floatForConstantHandle:(SDThemeConstantHandle)handle
+{
+    SDThemeHandleSlot* slot = [self resolveConstantHandle:handle];
+    return (slot && slot->kind == SDThemeHandleValueKindNumber) ? slot->scalar.number : 0;
+}
+
+- (CGPoint) pointForConstantHandle:(SDThemeConstantHandle)handle
+{
+    SDThemeHandleSlot* slot = [self resolveConstantHandle:handle];
+    return (slot && slot->kind == SDThemeHandleValueKindPoint) ? slot->scalar.point : CGPointZero;
+}
+
+- (CGSize) sizeForConstantHandle:(SDThemeConstantHandle)handle
+{
+    SDThemeHandleSlot* slot = [self resolveConstantHandle:handle];
+    return (slot && slot->kind == SDThemeHandleValueKindSize) ? slot->scalar.size : CGSizeZero;
+}
+
+- (CGRect) rectForConstantHandle:(SDThemeConstantHandle)handle
+{
+    SDThemeHandleSlot* slot = [self resolveConstantHandle:handle];
+    return (slot && slot->kind == SDThemeHandleValueKindRect) ? slot->scalar.rect : CGRectZero;
+}
+
+- (UIEdgeInsets) edgeInsetsForConstantHandle:(SDThemeConstantHandle)handle
+{
+    SDThemeHandleSlot* slot = [self resolveConstantHandle:handle];
+    return (slot && slot->kind == SDThemeHandleValueKindEdgeInsets) ? slot->scalar.edgeInsets : UIEdgeInsetsZero;
+}
+
+/**
+ * @return the slot of the handle, resolved for the current generation, or NULL if the handle is not valid.
+ */
+- (SDThemeHandleSlot*) resolveConstantHandle:(SDThemeConstantHandle)handle
+{
+    if (handle.index >= self.constantNames.count)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Constant handle %u not registered", handle.index);
+        return NULL;
+    }
+    
+    SDThemeHandleSlot* slot = &_constantSlots[handle.index];
+    if (slot->generation == self.generation)
+    {
+        return slot;
+    }
+    
+    id value = self.constantResolver ? self.constantResolver(self.constantNames[handle.index]) : nil;
+    self.constantValues[handle.index] = value ?: [NSNull null];
+    
+    memset(slot, 0, sizeof(SDThemeHandleSlot));
+    slot->generation = self.generation;
+    if ([value isKindOfClass:[NSNumber class]] || [value isKindOfClass:[NSString class]])
+    {
+        // as themeFloatForKey:, numeric strings are accepted
+        slot->kind = SDThemeHandleValueKindNumber;
+        slot->scalar.number = [value doubleValue];
+    }
+    else if ([value isKindOfClass:[NSValue class]])
+    {
+        const char* type = [(NSValue*)value objCType];
+        if (strcmp(type, @encode(CGPoint)) == 0)
+        {
+            slot->kind = SDThemeHandleValueKindPoint;
+            slot->scalar.point = [value CGPointValue];
+        }
+        else if (strcmp(type, @encode(CGSize)) == 0)
+        {
+            slot->kind = SDThemeHandleValueKindSize;
+            slot->scalar.size = [value CGSizeValue];
+        }
+        else if (strcmp(type, @encode(CGRect)) == 0)
+        {
+            slot->kind = SDThemeHandleValueKindRect;
+            slot->scalar.rect = [value CGRectValue];
+        }
+        else if (strcmp(type, @encode(UIEdgeInsets)) == 0)
+        {
+            slot->kind = SDThemeHandleValueKindEdgeInsets;
+            slot->scalar.edgeInsets = [value UIEdgeInsetsValue];
+        }
+    }
+    return slot;
+}
+
+#pragma mark Styles
+
+- (NSDictionary*) styleForHandle:(SDThemeStyleHandle)handle
+{
+    if (handle.index >= self.styleNames.count)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Style handle %u not registered", handle.index);
+        return nil;
+    }
+    
+    if (_styleGenerations[handle.index] != self.generation)
+    {
+        NSDictionary* style = self.styleResolver ? self.styleResolver(self.styleNames[handle.index]) : nil;
+        self.styleValues[handle.index] = style ?: [NSNull null];
+        _styleGenerations[handle.index] = self.generation;
+    }
+    id style = self.styleValues[handle.index];
+    return style == [NSNull null] ? nil : style;
+}
+
+@end
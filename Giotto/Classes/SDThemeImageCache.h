@@ -0,0 +1,52 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+/**
+ * Images of the themes decoded ahead of time, shared by all the theme managers.
+ *
+ * +[UIImage imageNamed:] returns an image that is decoded on the main thread the first time it is drawn. The images decoded by the cache are bitmaps ready to be drawn, and the categories use them when they are available.
+ * The cache is bounded by the memory of the decoded bitmaps and thread safe.
+ */
+@interface SDThemeImageCache : NSObject
+
++ (instancetype) sharedCache;
+
+/**
+ * Maximum memory of the decoded images, in bytes. When it is exceeded the cache evicts some images. Default is 32 MB.
+ */
+@property (nonatomic, assign) NSUInteger maximumCost;
+
+/**
+ * Returns the decoded image with the given name if it is in the cache, otherwise the image returned by +[UIImage imageNamed:].
+ */
+- (UIImage*) imageNamed:(NSString*)name;
+
+/**
+ * @return the decoded image with the given name, or nil if it is not in the cache.
+ */
+- (UIImage*) cachedImageNamed:(NSString*)name;
+
+/**
+ * Loads and decodes the images with the given names on a background queue. The images already in the cache are skipped.
+ *
+ * @param names the names of the images
+ * @param completion called on the main thread when all the images are decoded, or nil
+ */
+- (void) decodeImagesNamed:(NSArray<NSString*>*)names completion:(void (^)(void))completion;
+
+- (void) removeAllImages;
+
+@end
@@ -0,0 +1,163 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeImageCache.h"
+
+#define DEFAULT_MAXIMUM_COST (32 * 1024 * 1024)
+
+@interface SDThemeImageCache ()
+
+@property (nonatomic, strong) NSCache<NSString*, UIImage*>* images;
+@property (nonatomic, strong) dispatch_queue_t decodeQueue;
+
+@end
+
+@implementation SDThemeImageCache
+
++ (instancetype) sharedCache
+{
+    static dispatch_once_t pred;
+    static id sharedCacheInstance_ = nil;
+
+    dispatch_once(&pred, ^{
+        sharedCacheInstance_ = [[self alloc] init];
+    });
+
+    return sharedCacheInstance_;
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.images = [NSCache new];
+        self.images.name = @"it.sysdata.giotto.images";
+        self.images.totalCostLimit = DEFAULT_MAXIMUM_COST;
+        self.decodeQueue = dispatch_queue_create("it.sysdata.giotto.images", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    }
+    return self;
+}
+
+- (NSUInteger) maximumCost
+{
+    return self.images.totalCostLimit;
+}
+
+- (void) setMaximumCost:(NSUInteger)maximumCost
+{
+    self.images.totalCostLimit = maximumCost;
+}
+
+- (UIImage*) imageNamed:(NSString*)name
+{
+    return [self cachedImageNamed:name] ?: [UIImage imageNamed:name];
+}
+
+- (UIImage*) cachedImageNamed:(NSString*)name
+{
+    return name ? [self.images objectForKey:name] : nil;
+}
+
+- (void) decodeImagesNamed:(NSArray<NSString*>*)names completion:(void (^)(void))completion
+{
+    NSArray<NSString*>* namesToDecode = [names copy];
+    dispatch_async(self.decodeQueue, ^{
+        for (NSString* name in namesToDecode)
+        {
+            @autoreleasepool
+            {
+                if ([self.images objectForKey:name])
+                {
+                    continue;
+                }
+                // imageNamed: is thread safe
+                UIImage* image = [self decodedImage:[UIImage imageNamed:name]];
+                if (image)
+                {
+                    CGImageRef cgImage = image.CGImage;
+                    NSUInteger cost = cgImage ? CGImageGetBytesPerRow(cgImage) * CGImageGetHeight(cgImage) : 0;
+                    [self.images setObject:image forKey:name cost:cost];
+                }
+            }
+        }
+        
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), completion);
+        }
+    });
+}
+
+- (void) removeAllImages
+{
+    [self.images removeAllObjects];
+}
+
+#pragma mark - Decoding
+
+/**
+ * Draws an image into a bitmap, keeping its scale, orientation, rendering mode, cap insets and layout direction.
+ *
+ * @return the decoded image, the image itself if it cannot be decoded (eg. an animated image), or nil if image is nil
+ */
+- (UIImage*) decodedImage:(UIImage*)image
+{
+    CGImageRef cgImage = image.CGImage;
+    if (!cgImage || image.images.count > 0)
+    {
+        return image;
+    }
+    if (@available(iOS 13.0, *))
+    {
+        if (image.isSymbolImage)
+        {
+            // drawn from vectors with the configuration of the view
+            return image;
+        }
+    }
+    
+    size_t width = CGImageGetWidth(cgImage);
+    size_t height = CGImageGetHeight(cgImage);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpace, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+    CGColorSpaceRelease(colorSpace);
+    if (!context)
+    {
+        return image;
+    }
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), cgImage);
+    CGImageRef decodedCGImage = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    if (!decodedCGImage)
+    {
+        return image;
+    }
+    
+    UIImage* decodedImage = [UIImage imageWithCGImage:decodedCGImage scale:image.scale orientation:image.imageOrientation];
+    CGImageRelease(decodedCGImage);
+    
+    decodedImage = [decodedImage imageWithRenderingMode:image.renderingMode];
+    if (!UIEdgeInsetsEqualToEdgeInsets(image.capInsets, UIEdgeInsetsZero))
+    {
+        decodedImage = [decodedImage resizableImageWithCapInsets:image.capInsets resizingMode:image.resizingMode];
+    }
+    if (image.flipsForRightToLeftLayoutDirection)
+    {
+        decodedImage = [decodedImage imageFlippedForRightToLeftLayoutDirection];
+    }
+    return decodedImage;
+}
+
+@end
@@ -0,0 +1,53 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * An application of styles split into steps and run a chunk per frame, driven by a display link, without exceeding a time budget per frame.
+ * It is returned by applyStyleWithName:toObject:frameBudget:completion: of SDThemeManager and can be cancelled at any time.
+ */
+@interface SDThemeIncrementalApply : NSObject
+
+/**
+ * @param steps the steps, in execution order
+ * @param frameBudget the time that the steps can take in each frame, in seconds. At least a step is run for each frame.
+ * @param performer runs a chunk of steps (eg. inside a single application of styles)
+ * @param validity called before each chunk: if it returns NO the application is cancelled
+ * @param completion called once, on the main thread, with YES if all the steps have been run or NO if the application has been cancelled
+ */
+- (instancetype) initWithSteps:(NSArray<dispatch_block_t>*)steps
+                   frameBudget:(NSTimeInterval)frameBudget
+                     performer:(void (^)(dispatch_block_t chunk))performer
+                      validity:(BOOL (^)(void))validity
+                    completion:(void (^)(BOOL finished))completion;
+
+/**
+ * Runs the first chunk immediately, then a chunk for each frame. Must be called on the main thread.
+ */
+- (void) start;
+
+/**
+ * Stops the application: the remaining steps are not run and the completion is called with NO. Has no effect if the application already ended.
+ */
+- (void) cancel;
+
+@property (nonatomic, assign, readonly, getter=isFinished) BOOL finished;
+@property (nonatomic, assign, readonly, getter=isCancelled) BOOL cancelled;
+
+// number of steps run so far
+@property (nonatomic, assign, readonly) NSUInteger completedStepCount;
+@property (nonatomic, assign, readonly) NSUInteger stepCount;
+
+@end
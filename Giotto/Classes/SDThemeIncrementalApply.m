@@ -0,0 +1,145 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeIncrementalApply.h"
+#import <QuartzCore/QuartzCore.h>
+
+@interface SDThemeIncrementalApply ()
+
+@property (nonatomic, copy) NSArray<dispatch_block_t>* steps;
+@property (nonatomic, assign) NSTimeInterval frameBudget;
+@property (nonatomic, copy) void (^performer)(dispatch_block_t chunk);
+@property (nonatomic, copy) BOOL (^validity)(void);
+@property (nonatomic, copy) void (^completion)(BOOL finished);
+
+// retains the application until it ends
+@property (nonatomic, strong) CADisplayLink* displayLink;
+
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, assign) BOOL cancelled;
+@property (nonatomic, assign) NSUInteger completedStepCount;
+@property (nonatomic, assign) NSUInteger stepCount;
+
+@end
+
+@implementation SDThemeIncrementalApply
+
+- (instancetype) initWithSteps:(NSArray<dispatch_block_t>*)steps
+                   frameBudget:(NSTimeInterval)frameBudget
+                     performer:(void (^)(dispatch_block_t chunk))performer
+                      validity:(BOOL (^)(void))validity
+                    completion:(void (^)(BOOL finished))completion
+{
+    self = [super init];
+    if (self)
+    {
+        self.steps = steps ?: @[];
+        self.stepCount = self.steps.count;
+        self.frameBudget = frameBudget;
+        self.performer = performer;
+        self.validity = validity;
+        self.completion = completion;
+    }
+    return self;
+}
+
+- (void) start
+{
+    if (self.displayLink || self.finished || self.cancelled)
+    {
+        return;
+    }
+    // the first chunk is committed with the current frame
+    [self runChunk];
+    if (!self.finished && !self.cancelled)
+    {
+        self.displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayLinkDidFire:)];
+        [self.displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+}
+
+- (void) cancel
+{
+    if (self.finished || self.cancelled)
+    {
+        return;
+    }
+    self.cancelled = YES;
+    [self end];
+}
+
+- (void) displayLinkDidFire:(CADisplayLink*)displayLink
+{
+    [self runChunk];
+}
+
+- (void) runChunk
+{
+    if (self.validity && !self.validity())
+    {
+        [self cancel];
+        return;
+    }
+    
+    dispatch_block_t chunk = ^{
+        CFTimeInterval deadline = CACurrentMediaTime() + self.frameBudget;
+        // at least a step per frame, so that the application always progresses; a step can cancel the application
+        while (!self.cancelled && self.completedStepCount < self.steps.count)
+        {
+            self.steps[self.completedStepCount]();
+            self.completedStepCount++;
+            if (CACurrentMediaTime() >= deadline)
+            {
+                break;
+            }
+        }
+    };
+    
+    if (self.completedStepCount < self.steps.count)
+    {
+        if (self.performer)
+        {
+            self.performer(chunk);
+        }
+        else
+        {
+            chunk();
+        }
+    }
+    
+    if (!self.cancelled && self.completedStepCount >= self.steps.count)
+    {
+        self.finished = YES;
+        [self end];
+    }
+}
+
+- (void) end
+{
+    [self.displayLink invalidate];
+    self.displayLink = nil;
+    
+    void (^completion)(BOOL) = self.completion;
+    // releases the captured objects
+    self.steps = @[];
+    self.performer = nil;
+    self.validity = nil;
+    self.completion = nil;
+    if (completion)
+    {
+        completion(self.finished);
+    }
+}
+
+@end
@@ -14,6 +14,15 @@
 
 #import <UIKit/UIKit.h>
 #import "SDThemeLogger.h"
+#import "SDThemeLayer.h"
+#import "SDThemeHandleTable.h"
+#import "SDThemeResolvedStyle.h"
+#import "SDThemeTracer.h"
+#import "SDThemeUsageLog.h"
+#import "SDThemeIncrementalApply.h"
+#import "SDThemeConventionRegistry.h"
+#import "SDThemeTypeValidator.h"
+#import "SDThemeImageCache.h"
 
 #pragma mark - THEME MANAGER
 
@@ -36,6 +45,7 @@
 [[SDThemeManager sharedManager] themeFontForKey: key andSize: size]
 
 @class SDThemeManager;
+@class MKAnnotationView;
 
 SDThemeManager* themeManagerSharedInstance();
 
@@ -43,17 +53,84 @@ id SDThemeManagerValueForConstant(NSString* key);
 
 void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
 
+// variants targeting a given manager instance; a nil manager targets the shared one
+id SDThemeManagerValueForConstantInManager(SDThemeManager* manager, NSString* key);
+
+void SDThemeManagerApplyStyleInManager(SDThemeManager* manager, NSString* key, NSObject* object);
+
+#pragma mark - Handles
+
+#define themeColorForHandle(handle) \
+[[SDThemeManager sharedManager] colorForConstantHandle: handle]
+
+#define themeFontForHandle(handle) \
+[[SDThemeManager sharedManager] fontForConstantHandle: handle]
+
+#define themeFloatForHandle(handle) \
+[[SDThemeManager sharedManager] floatForConstantHandle: handle]
+
+id SDThemeManagerValueForConstantHandle(SDThemeConstantHandle handle);
+
+void SDThemeManagerApplyStyleHandle(SDThemeStyleHandle handle, NSObject* object);
+
+id SDThemeManagerValueForConstantHandleInManager(SDThemeManager* manager, SDThemeConstantHandle handle);
+
+void SDThemeManagerApplyStyleHandleInManager(SDThemeManager* manager, SDThemeStyleHandle handle, NSObject* object);
+
 #define THEME_DEFAULT_PLIST_NAME @"theme_default"
 
+#pragma mark - Apply options
+
+typedef NS_OPTIONS(NSUInteger, SDThemeApplyOptions) {
+    SDThemeApplyOptionNone        = 0,
+    // The styles are applied inside a single CATransaction with the implicit actions disabled and each root view touched is laid out once at the end
+    SDThemeApplyOptionTransaction = 1 << 0,
+    // Like SDThemeApplyOptionTransaction, but the changes are animated (animatable view and layer properties, and the final layout pass), for deliberate theme transitions
+    SDThemeApplyOptionAnimated    = 1 << 1,
+};
+
+#pragma mark - Variants
+
+/**
+ * Built-in variant dimensions. A variant of a style is declared in the plist as a style named <style_name>_<VARIANT_VALUE> and is applied after the base style when the dimension has that value.
+ */
+extern NSString* const SDThemeVariantDimensionIdiom;             // IPHONE, IPAD
+extern NSString* const SDThemeVariantDimensionUserInterfaceStyle; // LIGHT, DARK
+extern NSString* const SDThemeVariantDimensionSizeClass;          // COMPACT, REGULAR (horizontal size class)
+extern NSString* const SDThemeVariantDimensionLayoutDirection;    // LTR, RTL
+
+/**
+ * Posted when the value of a variant dimension changes. The userInfo contains the dimension (SDThemeVariantDimensionKey) and the names of the styles having a variant for it (SDThemeAffectedStylesKey), the only ones that need to be applied again.
+ */
+extern NSString* const SDThemeManagerVariantDidChangeNotification;
+extern NSString* const SDThemeVariantDimensionKey;
+extern NSString* const SDThemeAffectedStylesKey;
+
+/**
+ * Posted when a watched theme file is reloaded and some constants or styles changed. The userInfo contains the path of the file (SDThemeReloadedPathKey), the names of the affected styles (SDThemeAffectedStylesKey) and of the affected constants (SDThemeAffectedConstantsKey).
+ */
+extern NSString* const SDThemeManagerThemeDidReloadNotification;
+extern NSString* const SDThemeAffectedConstantsKey;
+extern NSString* const SDThemeReloadedPathKey;
+
+/**
+ * Posted when a convention or an enum is registered or unregistered. Every manager discards what it resolved with the previous parsers, as when its themes change, before the notification is delivered to the other observers.
+ */
+extern NSString* const SDThemeManagerConventionsDidChangeNotification;
+
 /**
  
  * This class allows you to manage key files with key / value logic and some utility to access values ​​by typing them (UIColor, int, float, NSNumber)
  * Must always be a default theme (theme_default.plist)
  * You can specify multiple theme files in order of priority using setAlternativeThemes: and specifying an array of NSString, names of different plist files
- * To modify the logic of access to themes, for example, by specifying events or specific states (eg Logged / Un Logged), you need to overwrite the valueForKey motto:
+ * To modify the logic of access to themes, for example, by specifying events or specific states (eg Logged / Un Logged), register a variant dimension with registerVariantDimension:withValues: and declare the <style_name>_<VARIANT_VALUE> styles in the plist, with the name of the base style in their "_variantOf" key. Overwriting the valueForKey method is still possible, but it disables any caching.
  *
  * We recommend using the ReflectableEnum library - https://github.com/fastred/ReflectableEnum - to have comfortably key theme names in order to avoid creating a million definitions (see the Zoppas Stone project for reference). Specifically, create an ENUM by typology (colors, images, dimensions, fonts, ...)
  * To access the value contained in the theme file, you must specify a key
+ *
+ * Besides the shared manager, independent managers can be created with initWithIdentifier: (eg. one for each brand shown at the same time, or one for each scene). Each manager has its own alternative themes, modifies and variants, while the compiled default theme, the alternative themes loaded by more managers and the parsed colors and geometries are shared.
+ *
+ * Threading: the themes are changed (alternative themes, modifies, variant dimensions, hot reload) and the styles are applied on the main thread. The changes are barriers on an internal concurrent queue: the background resolutions (resolveStylesWithNames:completion:, decodeImagesForStylesWithNames:completion:) and the reads from other threads (textAttributesForStyleWithName:) run on it concurrently with each other, and wait only for a change in progress. A change waits for the resolutions and the reads already started.
  */
 
 
@@ -77,8 +154,31 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
  */
 - (void) setAlternativeThemesWithPaths:(NSArray<NSString*>*)alternativeThemePaths;
 
+/**
+ * Maximum size, in bytes, of the on-disk cache of the parsed themes. Default is 4 MB; 0 disables the cache.
+ * The themes loaded from a plist are stored in a binary form, next to the file of the modifies, keyed by the hash of the plist content: the next launches read them without parsing the plist. Invalid entries are discarded and written again in the background; when the cache exceeds its size the least recently used entries are removed.
+ */
+@property (nonatomic, assign) NSUInteger compiledThemeCacheSize;
+
+/**
+ * Removes all the entries of the on-disk cache of the parsed themes.
+ */
+- (void) removeCompiledThemes;
+
 + (instancetype) sharedManager;
 
+/**
+ * Creates a manager independent from the shared one. It starts with the default theme, compiled once for all the managers.
+ *
+ * @param identifier identifies the manager: its modifies are persisted in a file of its own. Managers with the same identifier, or with a nil identifier like the shared manager, share the file of the modifies.
+ */
+- (instancetype) initWithIdentifier:(NSString*)identifier;
+
+/**
+ * The identifier given at creation, nil for the shared manager.
+ */
+@property (nonatomic, copy, readonly) NSString* identifier;
+
 #pragma mark - Old methods for retro-compatibility
 /**
  * This method accesses all others to retrieve information from theme files
@@ -106,6 +206,59 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
  */
 - (void) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object;
 
+/**
+ * Applies a style with the given options. When called during another application (eg. from a block passed to performApplyWithOptions:usingBlock:) the options of the outermost application are used.
+ *
+ * @param styleName The name of a plist Styles dictionary or Interfaces element.
+ * @param object The object to which the theme is to be applied
+ * @param options how the changes are committed
+ */
+- (void) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object options:(SDThemeApplyOptions)options;
+
+/**
+ * Performs all the applications of styles done by the block as a single one: with SDThemeApplyOptionTransaction a full screen is committed in one transaction and laid out once.
+ *
+ * @param options how the changes are committed
+ * @param block the block applying the styles
+ */
+- (void) performApplyWithOptions:(SDThemeApplyOptions)options usingBlock:(void (^)(void))block;
+
+/**
+ * Options used by applyStyleWithName:toObject:. Default is SDThemeApplyOptionNone.
+ */
+@property (nonatomic, assign) SDThemeApplyOptions defaultApplyOptions;
+
+/**
+ * Duration of the applications done with SDThemeApplyOptionAnimated. Default is 0.25 seconds.
+ */
+@property (nonatomic, assign) NSTimeInterval animatedApplyDuration;
+
+/**
+ * If YES, the last value written to each keyPath of an object is recorded on the object and writing the same value again is skipped, avoiding redisplays, text layouts and image decodes when a style is applied again. Default is NO.
+ * If a property is changed outside the theme manager, call invalidateThemeShadowStateForKeyPath: on the object before applying the style again.
+ */
+@property (nonatomic, assign) BOOL skipsRedundantWrites;
+
+/**
+ * Number of writes skipped by skipsRedundantWrites.
+ */
+@property (nonatomic, assign, readonly) NSUInteger skippedWriteCount;
+
+/**
+ * If YES, the values resolved from strings are checked against the type of the properties they set, and the mismatches are logged as errors. Each combination of class of the object, keyPath and class of the value is checked only once. Default is YES in DEBUG, NO otherwise.
+ */
+@property (nonatomic, assign) BOOL validatesValueTypes;
+
+/**
+ * Checks the values of styles against the declared type of the properties they set, without applying them, eg. in a unit test or a debug menu.
+ * The keyPaths whose type cannot be found (eg. keys handled by the categories, or properties of the elements of an array) are not checked.
+ *
+ * @param classesByStyleName the class of the objects each style is applied to, by style name
+ *
+ * @return an error of SDThemeTypeValidationErrorDomain for each keyPath whose value does not match the type of its property
+ */
+- (NSArray<NSError*>*) valueTypeErrorsForStylesWithClasses:(NSDictionary<NSString*, Class>*)classesByStyleName;
+
 /**
  * Utility method to retrieve the value associated with a constant.
  *
@@ -115,8 +268,216 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
  */
 - (id) valueForConstantWithName:(NSString*)constantName;
 
+/**
+ * Errors found evaluating the constants defined by an expression ("= <expression>"), including the cycles between constants. Updated every time the themes change.
+ */
+@property (nonatomic, strong, readonly) NSArray<NSError*>* constantExpressionErrors;
+
+#pragma mark Conventions
+
+/**
+ * Registers a convention for the values of all the managers (eg. "shadow:" or "gradient:"). The strings starting with the prefix are parsed once, when the themes are loaded or the first time they are used, and the parsed value is shared like the colors and the geometries.
+ * Register the conventions on the main thread, preferably before the themes are used: registering a prefix again replaces its parser and discards the values parsed before, and all the managers resolve their styles and constants again (see SDThemeManagerConventionsDidChangeNotification).
+ *
+ * @param prefix the prefix, ending with ":" and without other ":"; the prefixes of the built-in conventions cannot be registered
+ * @param parser the block parsing the part of the string that follows the prefix into an immutable value. It must depend only on the string, and it can be called on any thread.
+ *
+ * @return NO if the prefix is not valid
+ */
++ (BOOL) registerConventionWithPrefix:(NSString*)prefix parser:(SDThemeConventionParser)parser;
+
++ (void) unregisterConventionWithPrefix:(NSString*)prefix;
+
+/**
+ * Registers the table of an enum of the application for the "enum:" convention, eg. "enum:CardLayout.compact". The values are resolved once, when the themes are loaded, and shared by all the managers. The common UIKit enums are registered by default (see SDThemeEnumRegistry+UIKit.h).
+ *
+ * @param name the name of the enum, without "." and "|"
+ * @param values the values of the cases, by name; the names are compared ignoring the case
+ * @param optionSet YES if more cases can be combined with "|"
+ *
+ * @return NO if the name or the values are not valid
+ */
++ (BOOL) registerEnumWithName:(NSString*)name values:(NSDictionary<NSString*, NSNumber*>*)values optionSet:(BOOL)optionSet;
+
++ (void) unregisterEnumWithName:(NSString*)name;
+
+#pragma mark Rules
+
+/**
+ * Applies the styles of the rules declared in the Rules dictionary of the themes to the given view and to all its descendants, with a single traversal of the hierarchy.
+ * Rules map a selector to a style name (or to a comma separated list of names), eg. "UITableViewCell UILabel.title" : "CellTitle". See SDThemeRuleIndex for the selector syntax and the order in which the styles are applied.
+ *
+ * @param view the root of the hierarchy, eg. a window
+ */
+- (void) applyStyleRulesToView:(UIView*)view;
+
+/**
+ * @return the names of the styles of the rules matching the given view, in application order.
+ */
+- (NSArray<NSString*>*) styleNamesMatchingView:(UIView*)view;
+
+#pragma mark Two-phase application
+
+/**
+ * Resolves styles on a background queue: lookup, superstyles, normalization, constants, conventions and the creation of colors and fonts. Only the setters are left to applyResolvedStyle:toObject:.
+ * Useful to prepare the styles of the next screen, eg. during a push animation. Must be called on the main thread.
+ *
+ * @param styleNames the names of the styles to resolve, with their current variants
+ * @param completion called on the main thread with the resolved styles, by name
+ */
+- (void) resolveStylesWithNames:(NSArray<NSString*>*)styleNames completion:(void (^)(NSDictionary<NSString*, SDThemeResolvedStyle*>* resolvedStyles))completion;
+
+/**
+ * Resolves a style synchronously on the main thread. The result can be applied to many objects.
+ */
+- (SDThemeResolvedStyle*) resolvedStyleWithName:(NSString*)styleName;
+
+/**
+ * Commits a resolved style to an object: only the setters run. If the themes, the constants or the variants changed after the resolution, the current version of the style is applied instead.
+ *
+ * @param resolvedStyle a style resolved by this manager
+ * @param object the object to which the style is to be applied
+ */
+- (void) applyResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle toObject:(NSObject*)object;
+
+#pragma mark Incremental application
+
+/**
+ * Applies a style a chunk per frame, without exceeding the given time budget in each frame, so that styling a large hierarchy does not block the UI. The targets of the style that are visible or contain the first responder are styled first.
+ * The application is cancelled if the object is deallocated, or if the themes or the variants change before it ends. Must be called on the main thread.
+ *
+ * @param styleName the name of the style
+ * @param object the object to which the style is to be applied
+ * @param frameBudget the time the application can take in each frame, in seconds (eg. 0.004)
+ * @param completion called with YES when the whole style has been applied, or with NO if the application has been cancelled
+ *
+ * @return the application in progress, that can be cancelled
+ */
+- (SDThemeIncrementalApply*) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object frameBudget:(NSTimeInterval)frameBudget completion:(void (^)(BOOL finished))completion;
+
+#pragma mark Text attributes
+
+/**
+ * Returns the attributes of an NSAttributedString drawn like a label with the given style, eg. to measure text outside the main thread.
+ * They include the font, the textColor, a paragraph style (textAlignment, lineBreakMode, lineHeight, lineSpacing, paragraphSpacing) and the kerning (kern) of the style and of its current variants. kern, lineHeight, lineSpacing and paragraphSpacing are also applied to labels, through their attributed text.
+ * The dictionary is immutable and cached until the themes or the variants change, so all the callers share it. Can be called from any thread.
+ *
+ * @param styleName the name of the style
+ *
+ * @return the text attributes
+ */
+- (NSDictionary<NSAttributedStringKey, id>*) textAttributesForStyleWithName:(NSString*)styleName;
+
+#pragma mark Images
+
+/**
+ * Returns the names of the images set by the "image" and "backgroundImage" keys (also for a control state) of the given styles, their superstyles, their grafted styles and their current variants.
+ *
+ * @param styleNames the names of the styles, or nil for all the styles of the themes
+ *
+ * @return the names of the images
+ */
+- (NSSet<NSString*>*) imageNamesForStylesWithNames:(NSArray<NSString*>*)styleNames;
+
+/**
+ * Loads and decodes on a background queue the images referenced by the given styles into SDThemeImageCache, so that applying the styles does not decode them on the main thread (eg. before pushing a screen with many illustrations).
+ *
+ * @param styleNames the names of the styles, or nil for all the styles of the themes
+ * @param completion called on the main thread when the images are ready, or nil
+ */
+- (void) decodeImagesForStylesWithNames:(NSArray<NSString*>*)styleNames completion:(void (^)(void))completion;
+
+#pragma mark Annotation views
+
+/**
+ * Applies a style to a dequeued annotation view from a template shared by all the views with that style: the style is resolved once, its image is loaded once and shared, and its centerOffset is parsed once. The other keys (eg. layer settings) are committed like by applyResolvedStyle:toObject:.
+ * The view is remembered, without retaining it, until another annotation style is applied to it. Must be called on the main thread, typically in mapView:viewForAnnotation:.
+ *
+ * @param styleName the name of the style
+ * @param annotationView the view to which the style is to be applied
+ */
+- (void) applyAnnotationStyleWithName:(NSString*)styleName toAnnotationView:(MKAnnotationView*)annotationView;
+
+/**
+ * Applies again the annotation styles to all the live annotation views, as a single transaction; each template is rebuilt once. It is done automatically when the alternative themes change, a variant changes or a theme file is reloaded; call it after changing modifies or constants.
+ */
+- (void) refreshAnnotationViews;
+
+#pragma mark Handles
+
+/**
+ * Registers the names referenced by the typed handles generated with Scripts/generate_theme_handles.py. The generated header contains an inline function that calls this method with its tables: call it once at startup, before using the handles.
+ *
+ * @param constantNames the names of the constants, indexed by SDThemeConstantHandle
+ * @param constantCount the number of constant names
+ * @param styleNames the names of the styles, indexed by SDThemeStyleHandle
+ * @param styleCount the number of style names
+ */
+- (void) registerConstantHandleNames:(NSString* const*)constantNames count:(NSUInteger)constantCount styleHandleNames:(NSString* const*)styleNames count:(NSUInteger)styleCount;
+
+/**
+ * Getters by handle. The values are resolved once and cached until the themes or the constants change; the scalar getters return unboxed values (0 or the zero geometry if the constant has a different type).
+ */
+- (id) valueForConstantHandle:(SDThemeConstantHandle)handle;
+- (UIColor*) colorForConstantHandle:(SDThemeConstantHandle)handle;
+- (UIFont*) fontForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGFloat) floatForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGPoint) pointForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGSize) sizeForConstantHandle:(SDThemeConstantHandle)handle;
+- (CGRect) rectForConstantHandle:(SDThemeConstantHandle)handle;
+- (UIEdgeInsets) edgeInsetsForConstantHandle:(SDThemeConstantHandle)handle;
+
+/**
+ * Applies the style referenced by the given handle, like applyStyleWithName:toObject:. The style dictionary is looked up once and cached until the themes change.
+ */
+- (void) applyStyleWithHandle:(SDThemeStyleHandle)handle toObject:(NSObject*)object;
+
+#pragma mark Variants
+
+/**
+ * Registers an app defined variant dimension (eg. a Logged / Not Logged state).
+ * After the registration, a style named <style_name>_<VALUE> is applied after <style_name> when the dimension has the value VALUE. Variants of different dimensions can be combined in the same style name (eg. <style_name>_IPAD_DARK).
+ *
+ * @param dimension the name of the dimension
+ * @param values all the values the dimension can assume. Each value must be unique among all the dimensions.
+ */
+- (void) registerVariantDimension:(NSString*)dimension withValues:(NSArray<NSString*>*)values;
+
+/**
+ * Sets the current value of a variant dimension. Only the styles having a variant for the given dimension need to be applied again; if the value changes SDThemeManagerVariantDidChangeNotification is posted.
+ *
+ * @param value one of the values registered for the dimension, or nil to disable all its variants.
+ * @param dimension the name of a registered dimension
+ *
+ * @return the names of the styles that have a variant for the dimension and should be applied again.
+ */
+- (NSSet<NSString*>*) setVariant:(NSString*)value forDimension:(NSString*)dimension;
+
+/**
+ * @return the current value of the given variant dimension or nil.
+ */
+- (NSString*) variantForDimension:(NSString*)dimension;
+
+/**
+ * Updates the built-in dimensions (user interface style, size class and layout direction) with the values of the given trait collection. Call it from traitCollectionDidChange:.
+ *
+ * @param traitCollection the current trait collection
+ *
+ * @return the names of the styles that have a variant for the changed dimensions and should be applied again.
+ */
+- (NSSet<NSString*>*) updateVariantsWithTraitCollection:(UITraitCollection*)traitCollection;
+
 #pragma mark Utils
 
+/**
+ * When set, the application of the styles (styles, resolution of the values with the layer supplying them, writes and batches) and the loading of the themes are recorded as nested spans. Export them with chromeTraceData. Default is nil: tracing costs a nil check.
+ */
+@property (atomic, strong) SDThemeTracer* tracer;
+
+/**
+ * When set, the names of the styles and of the constants read by the manager are recorded, eg. during a UI test run, and can be given to Scripts/strip_theme.py with the references in the sources. Default is nil: recording costs a nil check.
+ */
+@property (atomic, strong) SDThemeUsageLog* usageLog;
 
 /**
  * Debug method that returns the merged dictionary for a given style. It shows alla merged values as you aspect to be performed when the style will be applied. The dictionary is merged following the inheritance and the superstyle chain.
@@ -128,6 +489,19 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
 
 - (NSDictionary*) mergedValueForStyle:(NSString*)style;
 
+/**
+ * Returns the memory used by the loaded themes, one element for each layer in priority order (the last is the default theme).
+ * The themes are stored in a compact form: keys and strings are shared by all the layers through a single string table and the values that are identical to the ones of another layer are stored once. The layer of the modifies done at runtime is not compacted and is not listed.
+ *
+ * @return the footprint of each compacted layer
+ */
+- (NSArray<SDThemeLayerFootprint*>*) themeMemoryFootprint;
+
+/**
+ * @return the memory used by the string table shared by all the layers, in bytes. The strings of the layers that are no longer used are removed.
+ */
+- (NSUInteger) themeStringTableMemoryFootprint;
+
 
 #pragma mark Dynamic behaviour
 
@@ -189,6 +563,30 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object);
  */
 - (void) resetModifies;
 
+#pragma mark Hot reload
+
+/**
+ * Starts watching the files of the themes: the default theme, the alternative themes and the file of the modifies. Meant for development, eg. to edit a theme while the app is running in the simulator.
+ * When a file changes only that layer is loaded again and diffed key by key with the previous version: the styles that changed, or that depend on a changed constant or style, are applied again to the objects they have been applied to since watching started.
+ */
+- (void) startWatchingThemeFiles;
+
+/**
+ * Stops watching the files of the themes and forgets the objects the styles have been applied to.
+ */
+- (void) stopWatchingThemeFiles;
+
+@property (nonatomic, assign, readonly, getter=isWatchingThemeFiles) BOOL watchingThemeFiles;
+
+/**
+ * Loads again the theme at the given path, that must be one of the loaded themes, and applies again the affected styles. Called automatically for the watched files.
+ *
+ * @param path the path of the theme file
+ *
+ * @return the names of the affected styles
+ */
+- (NSSet<NSString*>*) reloadThemeFileAtPath:(NSString*)path;
+
 /**
  Load the plist theme file data from given path
  
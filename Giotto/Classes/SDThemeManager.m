@@ -14,6 +14,27 @@
 
 #import "SDThemeManager.h"
 #import "NSObject+ThemeManager.h"
+#import "SDThemeVariantIndex.h"
+#import "SDThemeLayer.h"
+#import "SDThemeStringTable.h"
+#import "SDThemeResolver.h"
+#import "SDThemeApplyContext.h"
+#import "SDThemeFileWatcher.h"
+#import "SDThemeDependencyIndex.h"
+#import "SDThemeResolvedStyle.h"
+#import "SDThemeTracer.h"
+#import "SDThemeShadowState.h"
+#import "SDThemeSharedStore.h"
+#import "SDThemeCompiledCache.h"
+#import "SDThemeRuleIndex.h"
+#import "UIView+ThemeManager.h"
+#import "SDThemeTextAttributes.h"
+#import "SDThemeIncrementalApply.h"
+#import "SDThemeConventionRegistry.h"
+#import "SDThemeValue+UIKit.h"
+#import "SDThemePlistReader.h"
+#import "SDThemeAnnotationTemplate.h"
+#import "SDThemeEnumRegistry+UIKit.h"
 
 #ifndef IS_IPAD
 #define IS_IPAD ( UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad )
@@ -22,22 +43,11 @@
 #define FORMAT_VERSION_KEY       @"formatVersion"
 #define CONSTANTS_KEY            @"Constants"
 #define STYLES_KEY               @"Styles"
+#define RULES_KEY                @"Rules"
 
-#define COLOR_IDENTIFIERS        @[@"color:", @"c:"]
-#define STYLE_IDENTIFIERS        @[@"style:", @"s:"]
-#define FONT_IDENTIFIERS         @[@"font:", @"f:"]
-#define NULL_IDENTIFIERS         @[@"null", @"NULL", @"Null", @"nil", @"Nil"]
+// keys whose value is the name of an image
+#define IMAGE_KEYS               @[@"image", @"backgroundImage"]
 
-#define SIZE_IDENTIFIER          @"size:"
-#define POINT_IDENTIFIER         @"point:"
-#define RECT_IDENTIFIER          @"rect:"
-#define EDGE_IDENTIFIER          @"edge:"
-
-#define SYSTEM_FONT_NAME        @"system"
-#define SYSTEM_BOLD_FONT_NAME   @"systembold"
-#define SYSTEM_ITALIC_FONT_NAME @"systemitalic"
-
-#define SUPERSTYLE_KEY           @"_superstyle"
 #define INHERIT_FROM_DEFAULT_THEME @"_inherit"
 
 #define XCODE_COLORS_ESCAPE      @"\033["
@@ -45,22 +55,74 @@
 
 #define IPHONE_VARIANT           @"IPHONE"
 #define IPAD_VARIANT             @"IPAD"
+#define LIGHT_VARIANT            @"LIGHT"
+#define DARK_VARIANT             @"DARK"
+#define COMPACT_VARIANT          @"COMPACT"
+#define REGULAR_VARIANT          @"REGULAR"
+#define LTR_VARIANT              @"LTR"
+#define RTL_VARIANT              @"RTL"
 
 #define THEME_DYNAMIC_NAME       @"theme_dynamic"
+#define COMPILED_THEMES_DIRECTORY_NAME  @"giotto_compiled_themes"
+#define COMPILED_THEMES_DEFAULT_SIZE    (4 * 1024 * 1024)
+
+// views with a lower alpha, like UIKit does for hit testing, are not visible: their writes are not anticipated by the incremental application
+#define INCREMENTAL_APPLY_VISIBLE_ALPHA (0.01)
+
+// the tracer is read once, so that a begin and its end go to the same tracer
+#define TRACE_BEGIN(tracer, nm, cat, kp, cls, lyr) [tracer beginEventWithName:(nm) category:(cat) keyPath:(kp) targetClass:(cls) layer:(lyr)]
+#define TRACE_END(tracer, nm, cat)                 [tracer endEventWithName:(nm) category:(cat)]
+
+NSString* const SDThemeVariantDimensionIdiom = @"idiom";
+NSString* const SDThemeVariantDimensionUserInterfaceStyle = @"userInterfaceStyle";
+NSString* const SDThemeVariantDimensionSizeClass = @"sizeClass";
+NSString* const SDThemeVariantDimensionLayoutDirection = @"layoutDirection";
+
+NSString* const SDThemeManagerVariantDidChangeNotification = @"SDThemeManagerVariantDidChangeNotification";
+NSString* const SDThemeVariantDimensionKey = @"dimension";
+NSString* const SDThemeAffectedStylesKey = @"affectedStyles";
+
+NSString* const SDThemeManagerThemeDidReloadNotification = @"SDThemeManagerThemeDidReloadNotification";
+NSString* const SDThemeAffectedConstantsKey = @"affectedConstants";
+NSString* const SDThemeReloadedPathKey = @"path";
+
+NSString* const SDThemeManagerConventionsDidChangeNotification = @"SDThemeManagerConventionsDidChangeNotification";
 
 SDThemeManager* themeManagerSharedInstance(){
     return [SDThemeManager sharedManager];
 }
 
 id SDThemeManagerValueForConstant(NSString* key){
-    return [themeManagerSharedInstance() valueForConstantWithName: key];
+    return SDThemeManagerValueForConstantInManager(themeManagerSharedInstance(), key);
 }
 void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
-    [themeManagerSharedInstance() applyStyleWithName: key toObject: object];
+    SDThemeManagerApplyStyleInManager(themeManagerSharedInstance(), key, object);
+}
+
+id SDThemeManagerValueForConstantHandle(SDThemeConstantHandle handle){
+    return SDThemeManagerValueForConstantHandleInManager(themeManagerSharedInstance(), handle);
+}
+void SDThemeManagerApplyStyleHandle(SDThemeStyleHandle handle, NSObject* object){
+    SDThemeManagerApplyStyleHandleInManager(themeManagerSharedInstance(), handle, object);
+}
+
+id SDThemeManagerValueForConstantInManager(SDThemeManager* manager, NSString* key){
+    return [manager ?: themeManagerSharedInstance() valueForConstantWithName: key];
+}
+void SDThemeManagerApplyStyleInManager(SDThemeManager* manager, NSString* key, NSObject* object){
+    [manager ?: themeManagerSharedInstance() applyStyleWithName: key toObject: object];
+}
+
+id SDThemeManagerValueForConstantHandleInManager(SDThemeManager* manager, SDThemeConstantHandle handle){
+    return [manager ?: themeManagerSharedInstance() valueForConstantHandle: handle];
+}
+void SDThemeManagerApplyStyleHandleInManager(SDThemeManager* manager, SDThemeStyleHandle handle, NSObject* object){
+    [manager ?: themeManagerSharedInstance() applyStyleWithHandle: handle toObject: object];
 }
 
 @interface SDThemeManager ()
 
+@property (nonatomic, copy) NSString* identifier;
 
 @property (nonatomic, strong) NSDictionary* defaultTheme;
 @property (nonatomic, strong) NSMutableDictionary* dynamicTheme;
@@ -69,9 +131,59 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 
 @property (nonatomic, strong) NSString* pathForDynamicTheme;
 
+@property (nonatomic, strong) SDThemeVariantIndex* variantIndex;
+
+// lookup of the values through the themes, constant expressions and conventions, without UIKit
+@property (nonatomic, strong) SDThemeResolver* resolver;
+
+// context of the application of styles in progress, nil when no style is being applied
+@property (nonatomic, strong) SDThemeApplyContext* applyContext;
+
+// paths of the alternative themes, in priority order, and the themes loaded from them
+@property (nonatomic, strong) NSArray<NSString*>* alternativeThemePaths;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSDictionary*>* alternativeThemesByPath;
+
+// hot reload, all nil when the theme files are not watched
+@property (nonatomic, strong) NSArray<SDThemeFileWatcher*>* themeFileWatchers;
+@property (nonatomic, strong) SDThemeDependencyIndex* dependencyIndex;
+// styles applied to each object, in application order
+@property (nonatomic, strong) NSMapTable<NSObject*, NSMutableOrderedSet<NSString*>*>* appliedStyles;
+
+// values referenced by the registered handles
+@property (nonatomic, strong) SDThemeHandleTable* handleTable;
+
+// writes skipped because the object already had the value
+@property (nonatomic, assign) NSUInteger skippedWriteCount;
+
+// combinations of class, keyPath and value class already checked by validatesValueTypes
+@property (nonatomic, strong) SDThemeTypeValidator* typeValidator;
+
+// rules of all the themes, built when first used after a change of the themes
+@property (nonatomic, strong) SDThemeRuleIndex* ruleIndex;
+
+// text attributes of the styles, read from any thread
+@property (nonatomic, strong) SDThemeTextAttributesCache* textAttributesCache;
+
+// writes of the styles merged with their variants, reused by the following applications
+@property (nonatomic, strong) SDThemeResolvedStyleCache* resolvedStyleCache;
+
+// parsed themes persisted between launches, nil if disabled
+@property (nonatomic, strong) SDThemeCompiledCache* compiledCache;
+
+// annotation views and the names of their styles, and the templates of the styles by name
+@property (nonatomic, strong) NSMapTable<MKAnnotationView*, NSString*>* annotationViews;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, SDThemeAnnotationTemplate*>* annotationTemplates;
+
+// incremented every time the themes, the constants or the variants change
+@property (nonatomic, assign) NSUInteger themeGeneration;
+// concurrent queue of the background resolutions and of the reads from other threads; the changes to the themes are barriers on it
+@property (nonatomic, strong) dispatch_queue_t resolutionQueue;
+
 @end
 
 
+static const void* const SDThemeResolutionQueueKey = &SDThemeResolutionQueueKey;
+
 @implementation SDThemeManager
 
 #pragma mark - Singleton Pattern
@@ -90,10 +202,17 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 #pragma mark - Load methods
 
 - (id) init
+{
+    return [self initWithIdentifier:nil];
+}
+
+- (instancetype) initWithIdentifier:(NSString*)identifier
 {
     self = [super init];
     if (self)
     {
+        self.identifier = identifier;
+        self.resolver = [self newResolver];
         
 #if BLABBER
         SDLogLevel logLevel = SDLogLevelWarning;
@@ -104,7 +223,29 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
         [[SDLogger sharedLogger] setLogLevel:logLevel forModuleWithName:self.loggerModuleName];
 #endif
         
-        self.pathForDynamicTheme = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject stringByAppendingPathComponent:THEME_DYNAMIC_NAME];
+        self.animatedApplyDuration = 0.25;
+#if DEBUG
+        self.validatesValueTypes = YES;
+#endif
+        self.typeValidator = [SDThemeTypeValidator new];
+        self.textAttributesCache = [SDThemeTextAttributesCache new];
+        self.resolvedStyleCache = [SDThemeResolvedStyleCache new];
+        static dispatch_once_t enumsOnceToken;
+        dispatch_once(&enumsOnceToken, ^{
+            [[SDThemeEnumRegistry sharedRegistry] registerUIKitEnums];
+        });
+        self.annotationViews = [NSMapTable weakToStrongObjectsMapTable];
+        self.annotationTemplates = [NSMutableDictionary new];
+        self.resolutionQueue = dispatch_queue_create("it.sysdata.giotto.resolution", DISPATCH_QUEUE_CONCURRENT);
+        dispatch_queue_set_specific(self.resolutionQueue, SDThemeResolutionQueueKey, (__bridge void*)self, NULL);
+        self.resolver.resolutionQueue = self.resolutionQueue;
+        // observed before the first load, so that no registration is missed
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(conventionsDidChange:) name:SDThemeManagerConventionsDidChangeNotification object:nil];
+        // every identifier persists its modifies in its own file
+        NSString* dynamicThemeName = identifier.length > 0 ? [NSString stringWithFormat:@"%@_%@", THEME_DYNAMIC_NAME, identifier] : THEME_DYNAMIC_NAME;
+        self.pathForDynamicTheme = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject stringByAppendingPathComponent:dynamicThemeName];
+        self.compiledCache = [[SDThemeCompiledCache alloc] initWithDirectory:[self compiledThemesDirectory] maximumSize:COMPILED_THEMES_DEFAULT_SIZE];
+        [self setupVariantIndex];
         [self loadDefaultTheme];
         
     }
@@ -112,9 +253,134 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 }
 
 
+- (SDThemeResolver*) newResolver
+{
+    SDThemeResolver* resolver = [SDThemeResolver new];
+    resolver.namedColorProvider = ^SDThemeColorValue*(NSString* name) {
+        if (@available(iOS 11, *)) {
+            UIColor* assetsColor = [UIColor colorNamed:name];
+            CGFloat red, green, blue, alpha;
+            if (assetsColor && [assetsColor getRed:&red green:&green blue:&blue alpha:&alpha])
+            {
+                return [SDThemeColorValue colorWithName:name red:red green:green blue:blue alpha:alpha];
+            }
+            if (assetsColor)
+            {
+                // eg. a pattern: the name still loads the color of the catalog as it is, the hexadecimal formats must not reinterpret it
+                return [SDThemeColorValue colorWithName:name red:0 green:0 blue:0 alpha:CGColorGetAlpha(assetsColor.CGColor)];
+            }
+        }
+        return nil;
+    };
+    // the values of the engine become UIKit objects once, when they are written
+    resolver.valueConverter = ^id(id value) {
+        return SDThemeUIKitObject(value);
+    };
+    return resolver;
+}
+
+- (void) setupVariantIndex
+{
+    self.variantIndex = [SDThemeVariantIndex new];
+    [self.variantIndex registerDimension:SDThemeVariantDimensionIdiom withValues:@[IPHONE_VARIANT, IPAD_VARIANT]];
+    [self.variantIndex registerDimension:SDThemeVariantDimensionUserInterfaceStyle withValues:@[LIGHT_VARIANT, DARK_VARIANT]];
+    [self.variantIndex registerDimension:SDThemeVariantDimensionSizeClass withValues:@[COMPACT_VARIANT, REGULAR_VARIANT]];
+    [self.variantIndex registerDimension:SDThemeVariantDimensionLayoutDirection withValues:@[LTR_VARIANT, RTL_VARIANT]];
+    
+    [self.variantIndex setValue:IS_IPAD ? IPAD_VARIANT : IPHONE_VARIANT forDimension:SDThemeVariantDimensionIdiom];
+    NSString* language = [NSLocale preferredLanguages].firstObject;
+    BOOL isRightToLeft = language && [NSLocale characterDirectionForLanguage:language] == NSLocaleLanguageDirectionRightToLeft;
+    [self.variantIndex setValue:isRightToLeft ? RTL_VARIANT : LTR_VARIANT forDimension:SDThemeVariantDimensionLayoutDirection];
+}
+
+- (void) setThemes:(NSArray*)themes
+{
+    [self performThemeMutation:^{
+        self->_themes = themes;
+        [self themesDidChange];
+        [self rebuildVariantIndex];
+        [self resolveConstantExpressions];
+    }];
+}
+
+/**
+ * Runs a change of the themes or of the constants as a barrier on the resolution queue. The background resolutions and reads use the themes without locks, so the change waits for the ones in progress, and the following ones wait for the change.
+ * The changes are made on the main thread; a change cannot be started from a read.
+ */
+- (void) performThemeMutation:(dispatch_block_t)mutation
+{
+    if (dispatch_get_specific(SDThemeResolutionQueueKey) == (__bridge void*)self)
+    {
+        mutation();
+    }
+    else
+    {
+        dispatch_barrier_sync(self.resolutionQueue, mutation);
+    }
+}
+
+/**
+ * Reads the themes from any thread. The read runs concurrently with the background resolutions and the other reads, and waits only for a change in progress.
+ */
+- (void) performThemeRead:(dispatch_block_t)read
+{
+    if (dispatch_get_specific(SDThemeResolutionQueueKey) == (__bridge void*)self)
+    {
+        read();
+    }
+    else
+    {
+        dispatch_sync(self.resolutionQueue, read);
+    }
+}
+
+/**
+ * Discards everything resolved with the previous version of the themes.
+ */
+- (void) themesDidChange
+{
+    self.resolver.themes = self.themes;
+    self.resolver.defaultTheme = self.defaultTheme;
+    self.themeGeneration++;
+    [self.handleTable invalidate];
+    [self.resolvedStyleCache removeAllResolvedStyles];
+    self.ruleIndex = nil;
+}
+
+- (void) rebuildVariantIndex
+{
+    // only the styles marked with "_variantOf" are variants, the first theme declaring a style wins
+    NSMutableDictionary<NSString*, NSString*>* baseStyleNames = [NSMutableDictionary new];
+    NSMutableSet<NSString*>* declaredStyleNames = [NSMutableSet new];
+    for (NSDictionary* theme in self.themes)
+    {
+        NSDictionary* styles = theme[STYLES_KEY];
+        if (![styles isKindOfClass:[NSDictionary class]])
+        {
+            continue;
+        }
+        [styles enumerateKeysAndObjectsUsingBlock:^(NSString* styleName, NSDictionary* style, BOOL* stop) {
+            if ([declaredStyleNames containsObject:styleName] || ![style isKindOfClass:[NSDictionary class]])
+            {
+                return;
+            }
+            [declaredStyleNames addObject:styleName];
+            NSString* baseStyleName = style[VARIANT_OF_KEY];
+            if ([baseStyleName isKindOfClass:[NSString class]])
+            {
+                baseStyleNames[styleName] = baseStyleName;
+            }
+        }];
+    }
+    [self.variantIndex rebuildWithBaseStyleNames:baseStyleNames];
+}
+
 - (void) loadDefaultTheme
 {
-    self.defaultTheme = [self loadThemeFromPlist:THEME_DEFAULT_PLIST_NAME];
+    // compiled once and shared by all the managers
+    self.defaultTheme = [[SDThemeSharedStore sharedStore] compiledThemeAtPath:[self defaultThemePath] retained:YES compile:^NSDictionary*{
+        return [self compactTheme:[self loadThemeFromPlist:THEME_DEFAULT_PLIST_NAME] withName:THEME_DEFAULT_PLIST_NAME sharingWithThemes:nil];
+    }];
     if (self.defaultTheme)
     {
         if ([[NSFileManager defaultManager] fileExistsAtPath:self.pathForDynamicTheme]) {
@@ -133,12 +399,36 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 {
     if(!_dynamicTheme)
     {
-        _dynamicTheme = [NSMutableDictionary dictionaryWithDictionary:[self loadThemeFromPlistData:[self loadPlistDataAtPath:self.pathForDynamicTheme] atPath:self.pathForDynamicTheme]];
-        [_dynamicTheme setValue:@2 forKey:@"formatVersion"];
+        _dynamicTheme = [self loadDynamicTheme];
     }
     return _dynamicTheme;
 }
 
+- (NSMutableDictionary*) loadDynamicTheme
+{
+    NSDictionary* theme = [self loadThemeFromPlistData:[self loadPlistDataAtPath:self.pathForDynamicTheme] atPath:self.pathForDynamicTheme];
+    // without saved modifies the layer starts empty
+    return [self mutableDynamicThemeWithTheme:theme ?: @{}];
+}
+
+/**
+ * Reads again the modifies saved in the file, eg. by a tool editing it.
+ *
+ * @return the new dynamic theme, or nil if the file can't be read or parsed, so that the current modifies are kept
+ */
+- (NSMutableDictionary*) reloadDynamicTheme
+{
+    NSDictionary* theme = [self loadThemeFromPlistData:[self loadPlistDataAtPath:self.pathForDynamicTheme] atPath:self.pathForDynamicTheme];
+    return theme ? [self mutableDynamicThemeWithTheme:theme] : nil;
+}
+
+- (NSMutableDictionary*) mutableDynamicThemeWithTheme:(NSDictionary*)theme
+{
+    NSMutableDictionary* dynamicTheme = [theme mutableCopy];
+    [dynamicTheme setValue:@2 forKey:@"formatVersion"];
+    return dynamicTheme;
+}
+
 - (NSDictionary*) loadThemeFromPlist:(NSString*)plistName
 {
     NSString* path = [[NSBundle mainBundle] pathForResource:plistName ofType:@"plist"];
@@ -157,9 +447,75 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
  * @return The theme dictionary loaded or nil
  */
 - (NSDictionary*) loadThemeFromPlistData:(NSData*)data atPath:(NSString*)path
+{
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, @"load", SDThemeTraceCategoryLoad, nil, Nil, path.lastPathComponent);
+    // the modifies change at runtime and are not cached
+    BOOL cacheable = self.compiledCache && data && ![path isEqualToString:self.pathForDynamicTheme];
+    // with no registered convention and no enum there is nothing to parse in advance
+    BOOL parseConventions = ![SDThemeConventionRegistry sharedRegistry].isEmpty || ![SDThemeEnumRegistry sharedRegistry].isEmpty;
+    NSString* conventionSignature = parseConventions ? [SDThemeResolver conventionSignature] : nil;
+    NSDictionary<NSString*, id>* conventionValues = nil;
+    NSDictionary* theme = cacheable ? [self.compiledCache themeForSourceData:data conventionSignature:conventionSignature conventionValues:&conventionValues] : nil;
+    BOOL compiled = NO;
+    if (!theme)
+    {
+        theme = [self parseThemeFromPlistData:data atPath:path];
+        compiled = YES;
+    }
+    if (theme && parseConventions)
+    {
+        if (conventionValues)
+        {
+            // parsed when the theme was compiled: the tree is not walked again
+            [[SDThemeSharedStore sharedStore] addConventionValues:conventionValues];
+        }
+        else
+        {
+            NSMutableDictionary<NSString*, id>* parsedValues = [NSMutableDictionary new];
+            [self.resolver parseRegisteredConventionsInValue:theme storingValuesIn:parsedValues];
+            conventionValues = parsedValues;
+            // an entry compiled with other conventions is written again with the new values
+            compiled = YES;
+        }
+    }
+    if (cacheable && theme && compiled)
+    {
+        [self.compiledCache storeTheme:theme conventionValues:conventionValues conventionSignature:conventionSignature forSourceData:data];
+    }
+    TRACE_END(tracer, @"load", SDThemeTraceCategoryLoad);
+    return theme;
+}
+
+- (NSDictionary*) parseThemeFromPlistData:(NSData*)data atPath:(NSString*)path
 {
     if ([[NSFileManager defaultManager] fileExistsAtPath:path])
     {
+        // binary and XML plists in the current format are read in a single pass, directly into the final structure
+        SDThemePlistReader* reader = [[SDThemePlistReader alloc] initWithCopiedKeys:[NSSet setWithObjects:FORMAT_VERSION_KEY, CONSTANTS_KEY, RULES_KEY, nil] mergedKey:STYLES_KEY];
+        // reported only if the theme is in the current format
+        NSMutableArray<dispatch_block_t>* reports = [NSMutableArray new];
+        reader.duplicateHandler = ^(NSString* key, NSString* group) {
+            [reports addObject:^{
+                SDLogModuleWarning(kThemeManagerLogModuleName, @"Duplicate key \"%@\" into dictionary \"%@\" of theme %@. Duplica key will be ignored.", key, group, path.lastPathComponent);
+            }];
+        };
+        reader.invalidValueHandler = ^(NSString* key) {
+            [reports addObject:^{
+                SDLogModuleError(kThemeManagerLogModuleName, @"Value not allowed for key \"%@\" in theme %@", key, path.lastPathComponent);
+            }];
+        };
+        NSDictionary* streamedTheme = [reader themeWithData:data];
+        if (streamedTheme && [streamedTheme[FORMAT_VERSION_KEY] intValue] >= 2)
+        {
+            for (dispatch_block_t report in reports)
+            {
+                report();
+            }
+            return streamedTheme;
+        }
+        
+        // themes in the old format, or in a format the reader does not handle, are converted from the whole property list
         NSError *error;
         NSPropertyListFormat format;
         NSDictionary* plist = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:&format error:&error];
@@ -175,9 +531,9 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
         
         for (NSString* key in [plistDict allKeys])
         {
-            if ([key isEqualToString:FORMAT_VERSION_KEY] || [key isEqualToString:CONSTANTS_KEY])
+            if ([key isEqualToString:FORMAT_VERSION_KEY] || [key isEqualToString:CONSTANTS_KEY] || [key isEqualToString:RULES_KEY])
             {
-                // copy in the theme the values ​​of "formatVersion" and "Constants"
+                // copy in the theme the values ​​of "formatVersion", "Constants" and "Rules"
                 theme[key] = plistDict[key];
             }
             else
@@ -237,18 +593,121 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
     if ([[NSFileManager defaultManager] fileExistsAtPath:self.pathForDynamicTheme]) {
         [themesNew addObject:self.dynamicTheme];
     }
+    NSMutableArray<NSDictionary*>* compactThemes = [NSMutableArray arrayWithObject:self.defaultTheme];
+    NSMutableArray<NSString*>* loadedPaths = [NSMutableArray new];
+    self.alternativeThemesByPath = [NSMutableDictionary new];
     for (NSString* path in alternativeThemePaths)
     {
         // for each path indicated, if it exists, add the topic to the array of themes in the specified order
-        NSDictionary* theme = [self loadThemeFromPlistData:[self loadPlistDataAtPath:path] atPath:path];
+        // the alternative themes share the identical values with the default theme and with the previous alternative themes; a layer already compiled by another manager is reused
+        NSDictionary* theme = [[SDThemeSharedStore sharedStore] compiledThemeAtPath:path retained:NO compile:^NSDictionary*{
+            return [self compactTheme:[self loadThemeFromPlistData:[self loadPlistDataAtPath:path] atPath:path] withName:path.lastPathComponent sharingWithThemes:compactThemes];
+        }];
         if (theme)
         {
+            [compactThemes addObject:theme];
             [themesNew addObject:theme];
+            [loadedPaths addObject:path];
+            self.alternativeThemesByPath[path] = theme;
         }
     }
+    self.alternativeThemePaths = loadedPaths;
     // Finally, you enter the default theme
     [themesNew addObject:self.defaultTheme];
     self.themes = [NSArray arrayWithArray:themesNew];
+    [self refreshAnnotationViewsWithStyles:nil];
+    
+    if (self.isWatchingThemeFiles)
+    {
+        // the watched files changed
+        [self startWatchingThemeFiles];
+    }
+}
+
+/**
+ * Converts a loaded theme into its compact representation.
+ *
+ * @param theme the theme returned by loadThemeFromPlistData:atPath:
+ * @param name the name of the theme, for diagnostics
+ * @param themes compact themes already loaded, whose values can be shared by the new one
+ *
+ * @return the compact theme, or nil if theme is nil
+ */
+- (NSDictionary*) compactTheme:(NSDictionary*)theme withName:(NSString*)name sharingWithThemes:(NSArray<NSDictionary*>*)themes
+{
+    if (!theme)
+    {
+        return nil;
+    }
+    NSMutableArray<SDThemeLayer*>* layers = [NSMutableArray new];
+    for (NSDictionary* sharedTheme in themes)
+    {
+        SDThemeLayer* layer = [SDThemeLayer layerOfDictionary:sharedTheme];
+        if (layer)
+        {
+            [layers addObject:layer];
+        }
+    }
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, @"compact", SDThemeTraceCategoryLoad, nil, Nil, name);
+    NSDictionary* compactTheme = [SDThemeLayer layerWithTheme:theme name:name sharingWithLayers:layers].dictionary;
+    TRACE_END(tracer, @"compact", SDThemeTraceCategoryLoad);
+    return compactTheme;
+}
+
+- (NSUInteger) compiledThemeCacheSize
+{
+    return self.compiledCache.maximumSize;
+}
+
+- (void) setCompiledThemeCacheSize:(NSUInteger)compiledThemeCacheSize
+{
+    if (compiledThemeCacheSize == 0)
+    {
+        self.compiledCache = nil;
+        return;
+    }
+    if (!self.compiledCache)
+    {
+        self.compiledCache = [[SDThemeCompiledCache alloc] initWithDirectory:[self compiledThemesDirectory] maximumSize:compiledThemeCacheSize];
+    }
+    self.compiledCache.maximumSize = compiledThemeCacheSize;
+}
+
+- (void) removeCompiledThemes
+{
+    if (self.compiledCache)
+    {
+        // after the writes in progress
+        [self.compiledCache removeAllThemes];
+    }
+    else
+    {
+        [[NSFileManager defaultManager] removeItemAtPath:[self compiledThemesDirectory] error:nil];
+    }
+}
+
+/**
+ * The compiled themes are kept next to the file of the modifies. Their entries are keyed by content, so all the managers share the directory.
+ */
+- (NSString*) compiledThemesDirectory
+{
+    return [[self.pathForDynamicTheme stringByDeletingLastPathComponent] stringByAppendingPathComponent:COMPILED_THEMES_DIRECTORY_NAME];
+}
+
+#pragma mark - Constant expressions
+
+/**
+ * Evaluates all the constants defined by an expression, in dependency order, and stores their values.
+ */
+- (void) resolveConstantExpressions
+{
+    [self.resolver resolveConstantExpressions];
+}
+
+- (NSArray<NSError*>*) constantExpressionErrors
+{
+    return self.resolver.constantExpressionErrors;
 }
 
 #pragma mark - SDLoggerModuleProtocol
@@ -275,771 +734,1315 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 
 - (void) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object
 {
-    [self applyStyleWithName:styleName toObject:object withVariant:nil];
-    if (IS_IPAD)
+    [self applyStyleWithName:styleName toObject:object options:self.defaultApplyOptions];
+}
+
+- (void) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object options:(SDThemeApplyOptions)options
+{
+    [self performApplyWithOptions:options usingBlock:^{
+        [self commitStyleWithName:styleName toObject:object];
+        [self didApplyStyleWithName:styleName toObject:object];
+    }];
+}
+
+/**
+ * Commits the writes of a style merged with its variants matching the current dimensions (idiom, user interface style...). The style is resolved once for each combination of variants and generation of the themes.
+ */
+- (void) commitStyleWithName:(NSString*)styleName toObject:(NSObject*)object
+{
+    SDThemeResolvedStyle* resolvedStyle = [self resolvedStyleWithName:styleName];
+    SDLogModuleVerbose(kThemeManagerLogModuleName, @"Start to applying style: %@", styleName);
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, styleName, SDThemeTraceCategoryApply, nil, [object class], tracer ? [self.resolver layerNameForKeyPath:[NSString stringWithFormat:@"%@.%@", STYLES_KEY, styleName]] : nil);
+    TRACE_BEGIN(tracer, @"commit", SDThemeTraceCategoryWrite, nil, [object class], nil);
+    [self commitWrites:resolvedStyle.writes toObject:object];
+    TRACE_END(tracer, @"commit", SDThemeTraceCategoryWrite);
+    TRACE_END(tracer, styleName, SDThemeTraceCategoryApply);
+}
+
+/**
+ * Completes the application of a base style and its variants: records the object for the hot reload and the final layout pass.
+ */
+- (void) didApplyStyleWithName:(NSString*)styleName toObject:(NSObject*)object
+{
+    if (self.appliedStyles && styleName && object)
+    {
+        [self recordStyle:styleName appliedToObject:object];
+    }
+    
+    if (self.applyContext.isTransactional)
+    {
+        [self.applyContext addLayoutRoot:[self layoutRootOfObject:object]];
+    }
+}
+
+- (void) performApplyWithOptions:(SDThemeApplyOptions)options usingBlock:(void (^)(void))block
+{
+    if (!block)
+    {
+        return;
+    }
+    
+    void (^apply)(void) = ^{
+        [self beginApplyWithOptions:options];
+        block();
+        [self endApply];
+    };
+    
+    if ((options & SDThemeApplyOptionAnimated) && !self.applyContext)
     {
-        // Looks for the iPad version of the style and applies it
-        [self applyStyleWithName:styleName toObject:object withVariant:IPAD_VARIANT];
+        // view backed layers animate only inside an animation block
+        [UIView animateWithDuration:self.animatedApplyDuration
+                              delay:0
+                            options:UIViewAnimationOptionBeginFromCurrentState | UIViewAnimationOptionAllowUserInteraction
+                         animations:apply
+                         completion:nil];
     }
     else
     {
-        // Looks for the iPhone style version and applies it
-        [self applyStyleWithName:styleName toObject:object withVariant:IPHONE_VARIANT];
+        apply();
     }
 }
 
 /**
  *  @discussion
  *  CAUTION:
- *  This public method differs from the constantValueForString private method: because it returns nil when the constant does not exist.
+ *  This public method differs from the constantValueForString: method of the resolver: because it returns nil when the constant does not exist.
  *  Do not use for internal logic.
  */
 - (id) valueForConstantWithName:(NSString*)constantName
 {
-    id constantValue = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, constantName]];
+    return SDThemeUIKitObject([self.resolver valueForConstantWithName:constantName]);
+}
+
+#pragma mark Variants
+
+- (void) registerVariantDimension:(NSString*)dimension withValues:(NSArray<NSString*>*)values
+{
+    [self performThemeMutation:^{
+        [self.variantIndex registerDimension:dimension withValues:values];
+        [self variantsDidChange];
+    }];
+}
+
+- (NSSet<NSString*>*) setVariant:(NSString*)value forDimension:(NSString*)dimension
+{
+    NSSet<NSString*>* affectedStyles = [self changeVariant:value forDimension:dimension];
+    [self refreshAnnotationViewsWithStyles:affectedStyles];
+    return affectedStyles;
+}
+
+/**
+ * Changes the value of a dimension and posts SDThemeManagerVariantDidChangeNotification, without refreshing the annotation views.
+ */
+- (NSSet<NSString*>*) changeVariant:(NSString*)value forDimension:(NSString*)dimension
+{
+    __block NSSet<NSString*>* affectedStyles = nil;
+    [self performThemeMutation:^{
+        affectedStyles = [self.variantIndex setValue:value forDimension:dimension];
+        if (affectedStyles.count > 0)
+        {
+            [self variantsDidChange];
+        }
+    }];
+    if (affectedStyles.count > 0)
+    {
+        [[NSNotificationCenter defaultCenter] postNotificationName:SDThemeManagerVariantDidChangeNotification
+                                                            object:self
+                                                          userInfo:@{ SDThemeVariantDimensionKey: dimension,
+                                                                      SDThemeAffectedStylesKey: affectedStyles }];
+    }
+    return affectedStyles;
+}
+
+/**
+ * Discards everything resolved with the previous variants, like a change of the themes: the resolutions in progress on other threads are outdated by the new generation. Must run inside performThemeMutation:.
+ */
+- (void) variantsDidChange
+{
+    self.themeGeneration++;
+    // the resolved styles of the previous generation can't be used anymore
+    [self.resolvedStyleCache removeAllResolvedStyles];
+}
+
+- (NSString*) variantForDimension:(NSString*)dimension
+{
+    return [self.variantIndex valueForDimension:dimension];
+}
+
+- (NSSet<NSString*>*) updateVariantsWithTraitCollection:(UITraitCollection*)traitCollection
+{
+    NSMutableSet<NSString*>* affectedStyles = [NSMutableSet new];
     
-    // if I do not find a constant I return nil
-    if (!constantValue)
+    if (@available(iOS 12.0, *))
     {
-        return nil;
+        NSString* userInterfaceStyle = nil;
+        if (traitCollection.userInterfaceStyle == UIUserInterfaceStyleDark)
+        {
+            userInterfaceStyle = DARK_VARIANT;
+        }
+        else if (traitCollection.userInterfaceStyle == UIUserInterfaceStyleLight)
+        {
+            userInterfaceStyle = LIGHT_VARIANT;
+        }
+        [affectedStyles unionSet:[self changeVariant:userInterfaceStyle forDimension:SDThemeVariantDimensionUserInterfaceStyle]];
     }
     
-    // If the value is a string, look for any conventions, otherwise I return the value
-    if ([constantValue isKindOfClass:[NSString class]])
+    NSString* sizeClass = nil;
+    if (traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassCompact)
     {
-        return [self valueForConventionalString:constantValue];
+        sizeClass = COMPACT_VARIANT;
     }
-    else
+    else if (traitCollection.horizontalSizeClass == UIUserInterfaceSizeClassRegular)
     {
-        return constantValue;
+        sizeClass = REGULAR_VARIANT;
     }
-}
-
-#pragma mark - Old methods for retro-compatibility
-
-- (id) valueForKey:(NSString*)key
-{
-    NSString* value;
+    [affectedStyles unionSet:[self changeVariant:sizeClass forDimension:SDThemeVariantDimensionSizeClass]];
     
-    for (NSDictionary* currentTheme in self.themes)
+    if (@available(iOS 10.0, *))
     {
-        // you search for the key in all the topics you set, sorted (the last is the default theme)
-        // The first match stops the search and returns the result
-        value = [currentTheme valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, key]];
-        if (value)
+        if (traitCollection.layoutDirection != UITraitEnvironmentLayoutDirectionUnspecified)
         {
-            break;
+            NSString* layoutDirection = traitCollection.layoutDirection == UITraitEnvironmentLayoutDirectionRightToLeft ? RTL_VARIANT : LTR_VARIANT;
+            [affectedStyles unionSet:[self changeVariant:layoutDirection forDimension:SDThemeVariantDimensionLayoutDirection]];
         }
     }
     
-    return value;
+    // the annotation views are refreshed once for all the dimensions
+    [self refreshAnnotationViewsWithStyles:affectedStyles];
+    return affectedStyles;
 }
 
-- (float) themeFloatForKey:(NSString*)key
+#pragma mark Conventions
+
++ (BOOL) registerConventionWithPrefix:(NSString*)prefix parser:(SDThemeConventionParser)parser
 {
-    NSNumber* themeValue = [self themeNumberForKey:key];
-    
-    if (themeValue)
+    if (!prefix || [[SDThemeResolver builtInConventionPrefixes] containsObject:prefix])
     {
-        return [themeValue floatValue];
+        SDLogModuleError(kThemeManagerLogModuleName, @"Can't register convention %@: the prefix is used by a built-in convention", prefix);
+        return NO;
     }
-    return 0;
+    if (![[SDThemeConventionRegistry sharedRegistry] registerPrefix:prefix parser:parser])
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Can't register convention %@: the prefix must end with ':' and not contain other ':'", prefix);
+        return NO;
+    }
+    [self conventionsDidChange];
+    return YES;
 }
 
-- (int) themeIntegerForKey:(NSString*)key
++ (void) unregisterConventionWithPrefix:(NSString*)prefix
 {
-    NSNumber* themeValue = [self themeNumberForKey:key];
-    
-    if (themeValue)
+    [[SDThemeConventionRegistry sharedRegistry] unregisterPrefix:prefix];
+    [self conventionsDidChange];
+}
+
++ (BOOL) registerEnumWithName:(NSString*)name values:(NSDictionary<NSString*, NSNumber*>*)values optionSet:(BOOL)optionSet
+{
+    if (![[SDThemeEnumRegistry sharedRegistry] registerEnumWithName:name values:values optionSet:optionSet])
     {
-        return [themeValue intValue];
+        SDLogModuleError(kThemeManagerLogModuleName, @"Can't register enum %@: the name must not contain '.' or '|' and the values must be numbers by name", name);
+        return NO;
     }
-    return 0;
+    [self conventionsDidChange];
+    return YES;
 }
 
-- (NSNumber*) themeNumberForKey:(NSString*)key
++ (void) unregisterEnumWithName:(NSString*)name
 {
-    NSNumber* themeValue = [self valueForKey:key];
-    
-    return themeValue;
+    [[SDThemeEnumRegistry sharedRegistry] unregisterEnumWithName:name];
+    [self conventionsDidChange];
 }
 
-- (UIColor*) themeColorForKey:(NSString*)key
+/**
+ * Discards the values parsed by the previous parsers and tables, shared by all the managers, and the values the managers resolved with them.
+ */
++ (void) conventionsDidChange
 {
-    NSString* themeValue = [self valueForKey:key];
-    
-    id color = [self valueForConventionalString:themeValue];
-    
-    if ([color isKindOfClass:[UIColor class]])
-    {
-        return color;
-    }
-    return [self colorForString:themeValue];
+    [[SDThemeSharedStore sharedStore] removeAllConventionValues];
+    [[NSNotificationCenter defaultCenter] postNotificationName:SDThemeManagerConventionsDidChangeNotification object:nil];
 }
 
-- (UIFont*) themeFontForKey:(NSString*)key andSize:(CGFloat)fontSize
+/**
+ * A new generation invalidates the handle table, the resolved styles, the text attributes and the annotation templates. The signature of the compiled cache is computed again at each load, so the themes loaded from now on are not read from entries parsed with the previous conventions.
+ */
+- (void) conventionsDidChange:(NSNotification*)notification
 {
-    NSString* themeValue = [self valueForKey:key];
-    id font = [self valueForConventionalString:themeValue];
-    
-    if ([font isKindOfClass:[UIFont class]])
-    {
-        return [font fontWithSize:fontSize];
-    }
-    return [UIFont fontWithName:themeValue size:fontSize];
+    [self performThemeMutation:^{
+        [self themesDidChange];
+        // the expressions can combine values of the conventions
+        [self resolveConstantExpressions];
+    }];
 }
 
-#pragma mark - Utils
+#pragma mark Validation
 
-- (void) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object withVariant:(NSString*)variant
+- (NSArray<NSError*>*) valueTypeErrorsForStylesWithClasses:(NSDictionary<NSString*, Class>*)classesByStyleName
 {
-    NSString* finalStyleName = variant.length > 0 ? [NSString stringWithFormat:@"%@_%@", styleName, variant] : styleName;
-    
-    if (variant.length > 0 && [self getThemeStyleForKey:finalStyleName] == nil)
+    NSMutableArray<NSError*>* errors = [NSMutableArray new];
+    [self performThemeRead:^{
+        for (NSString* styleName in [classesByStyleName.allKeys sortedArrayUsingSelector:@selector(compare:)])
+        {
+            Class styleClass = classesByStyleName[styleName];
+            NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+            for (SDThemeWrite* write in [self.resolver writesForStyleWithName:styleName variantStyleNames:variants])
+            {
+                NSString* targetKeyPath = [write.target componentsJoinedByString:@"."];
+                Class targetClass = targetKeyPath.length > 0 ? [SDThemeTypeValidator classOfKeyPath:targetKeyPath ofClass:styleClass] : styleClass;
+                BOOL known = NO;
+                NSString* expectedType = targetClass ? [SDThemeTypeValidator mismatchOfValue:write.value forKeyPath:write.keyPath ofClass:targetClass known:&known] : nil;
+                if (expectedType)
+                {
+                    NSString* keyPath = targetKeyPath.length > 0 ? [NSString stringWithFormat:@"%@.%@", targetKeyPath, write.keyPath] : write.keyPath;
+                    NSString* message = [NSString stringWithFormat:@"Style %@: keypath %@ of %@ expects %@, the value is %@", styleName, keyPath, NSStringFromClass(styleClass), expectedType, NSStringFromClass([write.value class])];
+                    [errors addObject:[NSError errorWithDomain:SDThemeTypeValidationErrorDomain code:SDThemeTypeValidationErrorMismatch userInfo:@{ NSLocalizedDescriptionKey: message }]];
+                }
+            }
+        }
+    }];
+    return errors;
+}
+
+#pragma mark Rules
+
+- (void) applyStyleRulesToView:(UIView*)view
+{
+    SDThemeRuleIndex* ruleIndex = [self currentRuleIndex];
+    if (!view || ruleIndex.ruleCount == 0)
     {
-        // If the variant is requested but does not exist, it stops
         return;
     }
-    // retrieves the indicated style
-    NSDictionary* style = [self themeStyleForKey:finalStyleName];
     
-    // If I did not find a style with the past name, I stop signaling an error
-    if (!style)
+    [self performApplyWithOptions:self.defaultApplyOptions usingBlock:^{
+        // a single depth first traversal; the subviews are read after the styles of their superview are applied
+        NSMutableArray<UIView*>* stack = [NSMutableArray arrayWithObject:view];
+        while (stack.count > 0)
+        {
+            UIView* currentView = stack.lastObject;
+            [stack removeLastObject];
+            for (NSString* styleName in [ruleIndex styleNamesForView:currentView])
+            {
+                [self applyStyleWithName:styleName toObject:currentView];
+            }
+            [stack addObjectsFromArray:currentView.subviews.reverseObjectEnumerator.allObjects];
+        }
+    }];
+}
+
+- (NSArray<NSString*>*) styleNamesMatchingView:(UIView*)view
+{
+    return [[self currentRuleIndex] styleNamesForView:view];
+}
+
+/**
+ * @return the index of the rules of the loaded themes. A rule of a theme overrides the rule with the same selector of the themes with lower priority.
+ */
+- (SDThemeRuleIndex*) currentRuleIndex
+{
+    if (!self.ruleIndex)
     {
-        SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@'", finalStyleName);
-        return;
+        NSMutableDictionary<NSString*, id>* rules = [NSMutableDictionary new];
+        for (NSDictionary* theme in self.themes.reverseObjectEnumerator)
+        {
+            NSDictionary* themeRules = theme[RULES_KEY];
+            if ([themeRules isKindOfClass:[NSDictionary class]])
+            {
+                [rules addEntriesFromDictionary:themeRules];
+            }
+        }
+        self.ruleIndex = [[SDThemeRuleIndex alloc] initWithRules:rules];
     }
-    SDLogModuleVerbose(kThemeManagerLogModuleName, @"Start to applying style: %@", finalStyleName);
-    [self applyDictionary:style toObject:object];
+    return self.ruleIndex;
 }
 
-- (id) getThemeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault
+#pragma mark Two-phase application
+
+- (void) resolveStylesWithNames:(NSArray<NSString*>*)styleNames completion:(void (^)(NSDictionary<NSString*, SDThemeResolvedStyle*>* resolvedStyles))completion
 {
-    // style is searched in the "Styles" group
-    id style = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", STYLES_KEY, key] fromDefaultTheme:fromDefault];
-    return style;
+    // the variants are looked up now: the resolved styles match the variants current at the request
+    NSMutableDictionary<NSString*, NSArray<NSString*>*>* variantStyleNames = [NSMutableDictionary new];
+    for (NSString* styleName in styleNames)
+    {
+        variantStyleNames[styleName] = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+    }
+    NSUInteger generation = self.themeGeneration;
+    
+    dispatch_async(self.resolutionQueue, ^{
+        NSMutableDictionary<NSString*, SDThemeResolvedStyle*>* resolvedStyles = [NSMutableDictionary new];
+        [variantStyleNames enumerateKeysAndObjectsUsingBlock:^(NSString* styleName, NSArray<NSString*>* variants, BOOL* stop) {
+            resolvedStyles[styleName] = [self resolvedStyleWithName:styleName variantStyleNames:variants generation:generation];
+        }];
+        
+        if (completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion([resolvedStyles copy]);
+            });
+        }
+    });
 }
 
-- (id) getThemeStyleForKey:(NSString*)key
+- (SDThemeResolvedStyle*) resolvedStyleWithName:(NSString*)styleName
 {
-    return [self getThemeStyleForKey:key fromDefaultTheme:NO];
+    NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+    return [self resolvedStyleWithName:styleName variantStyleNames:variants generation:self.themeGeneration];
 }
 
 /**
- * Converts old themes to make them compatible with the new version of ThemeManager.
- *
- * @param theme Dictionary containing the old theme.
- *
- * @return dictionary converted to new specifications.
+ * Returns the style merged with the given variants from the cache, resolving it if needed.
  */
-- (NSDictionary*) convertThemeForCompatibility:(NSDictionary*)theme
+- (SDThemeResolvedStyle*) resolvedStyleWithName:(NSString*)styleName variantStyleNames:(NSArray<NSString*>*)variants generation:(NSUInteger)generation
 {
-    int version = [[theme objectForKey:FORMAT_VERSION_KEY] intValue];
+    SDThemeResolvedStyle* resolvedStyle = [self.resolvedStyleCache resolvedStyleWithName:styleName variantStyleNames:variants generation:generation];
+    if (resolvedStyle)
+    {
+        return resolvedStyle;
+    }
+    NSArray<SDThemeWrite*>* writes = [self.resolver writesForStyleWithName:styleName variantStyleNames:variants];
+    resolvedStyle = [[SDThemeResolvedStyle alloc] initWithStyleName:styleName variantStyleNames:variants writes:writes generation:generation];
+    if (writes.count > 0)
+    {
+        // missing styles are resolved again, so that each application reports them
+        [self.resolvedStyleCache setResolvedStyle:resolvedStyle];
+    }
+    return resolvedStyle;
+}
+
+- (void) applyResolvedStyle:(SDThemeResolvedStyle*)resolvedStyle toObject:(NSObject*)object
+{
+    if (!resolvedStyle)
+    {
+        return;
+    }
     
-    if (version < 2)
+    NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:resolvedStyle.styleName] ?: @[];
+    if (resolvedStyle.generation != self.themeGeneration || ![resolvedStyle.variantStyleNames isEqualToArray:variants])
     {
-        // loaded theme is of the old type, for compatibility it loads everything inside the key of the constants
-        return @{ CONSTANTS_KEY: theme };
+        // the themes or the variants changed after the resolution
+        SDLogModuleInfo(kThemeManagerLogModuleName, @"Resolved style %@ is outdated, applying the current version", resolvedStyle.styleName);
+        [self applyStyleWithName:resolvedStyle.styleName toObject:object];
+        return;
     }
-    return theme;
+    
+    [self performApplyWithOptions:self.defaultApplyOptions usingBlock:^{
+        [self commitWrites:resolvedStyle.writes toObject:object];
+        [self didApplyStyleWithName:resolvedStyle.styleName toObject:object];
+    }];
 }
 
-/**
- * Performs a RRGGBBAA or RRGGBB hexadecimal string and converts it into an UIColor.
- *
- * @param color RRGGBBAA hexadecimal string or RRGGBB.
- *
- * @return a UIColor or nil if the past string does not meet the required format.
- */
-- (UIColor*) colorForString:(NSString*)color
+#pragma mark Incremental application
+
+- (SDThemeIncrementalApply*) applyStyleWithName:(NSString*)styleName toObject:(NSObject*)object frameBudget:(NSTimeInterval)frameBudget completion:(void (^)(BOOL finished))completion
 {
-    // Try to retrieve color from assets by using the same name
-    if (@available(iOS 11, *)) {
-        UIColor* assetsColor = [UIColor colorNamed:color];
-        if (assetsColor)
+    SDThemeResolvedStyle* resolvedStyle = [self resolvedStyleWithName:styleName];
+    NSUInteger generation = self.themeGeneration;
+    
+    // the last write of each keyPath of each target wins: once the others are dropped, the writes can be reordered
+    NSMutableDictionary<NSString*, NSNumber*>* lastWriteIndexes = [NSMutableDictionary new];
+    [resolvedStyle.writes enumerateObjectsUsingBlock:^(SDThemeWrite* write, NSUInteger index, BOOL* stop) {
+        lastWriteIndexes[[self incrementalKeyForTarget:write.target keyPath:write.keyPath]] = @(index);
+    }];
+    
+    // a step for each target, with all its writes
+    NSMutableArray<NSString*>* targetKeys = [NSMutableArray new];
+    NSMutableDictionary<NSString*, NSMutableArray<SDThemeWrite*>*>* writesByTarget = [NSMutableDictionary new];
+    [resolvedStyle.writes enumerateObjectsUsingBlock:^(SDThemeWrite* write, NSUInteger index, BOOL* stop) {
+        if ([lastWriteIndexes[[self incrementalKeyForTarget:write.target keyPath:write.keyPath]] unsignedIntegerValue] != index)
+        {
+            return;
+        }
+        NSString* targetKey = [self incrementalKeyForTarget:write.target keyPath:nil];
+        if (!writesByTarget[targetKey])
         {
-            return assetsColor;
+            writesByTarget[targetKey] = [NSMutableArray new];
+            [targetKeys addObject:targetKey];
         }
+        [writesByTarget[targetKey] addObject:write];
+    }];
+    
+    // the targets that are visible or contain the first responder are styled first
+    NSMutableArray<dispatch_block_t>* prioritySteps = [NSMutableArray new];
+    NSMutableArray<dispatch_block_t>* steps = [NSMutableArray new];
+    for (NSString* targetKey in targetKeys)
+    {
+        NSArray<SDThemeWrite*>* writes = writesByTarget[targetKey];
+        NSMutableArray<NSObject*>* objects = [NSMutableArray new];
+        [self collectObjectsAtTarget:writes.firstObject.target fromIndex:0 ofObject:object value:writes.firstObject.value intoArray:objects];
+        
+        BOOL priority = NO;
+        // held weakly, the views can be deallocated during the application
+        NSPointerArray* targetObjects = [NSPointerArray weakObjectsPointerArray];
+        for (NSObject* targetObject in objects)
+        {
+            [targetObjects addPointer:(__bridge void*)targetObject];
+            priority = priority || [self isPriorityObjectForIncrementalApply:targetObject];
+        }
+        
+        dispatch_block_t step = ^{
+            for (NSObject* targetObject in targetObjects.allObjects)
+            {
+                for (SDThemeWrite* write in writes)
+                {
+                    @try
+                    {
+                        [self writeValue:write.value toKeyPath:write.keyPath ofObject:targetObject validatingType:write.validatesType];
+                    }
+                    @catch (NSException* exception)
+                    {
+                        SDLogModuleError(kThemeManagerLogModuleName, @"Cannot apply value %@ to keyPath %@ to object of class %@", write.value, write.keyPath, NSStringFromClass([targetObject class]));
+                    }
+                }
+            }
+        };
+        [priority ? prioritySteps : steps addObject:step];
     }
+    [prioritySteps addObjectsFromArray:steps];
     
-    // Interprets the color from the string in the RRBBGGAA format (red, green, blue, alpha)
-    if (color.length != 6 && color.length != 8 && color.length != 3 && color.length != 4)
+    __weak NSObject* weakObject = object;
+    __weak typeof(self) weakSelf = self;
+    SDThemeIncrementalApply* incrementalApply = [[SDThemeIncrementalApply alloc] initWithSteps:prioritySteps frameBudget:frameBudget performer:^(dispatch_block_t chunk) {
+        // each chunk is a complete application: batches and layout are committed with its frame
+        [weakSelf performApplyWithOptions:weakSelf.defaultApplyOptions usingBlock:chunk];
+    } validity:^BOOL{
+        // stops if the object is gone or the style changed
+        SDThemeManager* strongSelf = weakSelf;
+        NSArray<NSString*>* variants = [strongSelf.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+        return strongSelf && weakObject != nil && strongSelf.themeGeneration == generation && [variants isEqualToArray:resolvedStyle.variantStyleNames];
+    } completion:^(BOOL finished) {
+        NSObject* strongObject = weakObject;
+        if (finished && strongObject)
+        {
+            [weakSelf didApplyStyleWithName:styleName toObject:strongObject];
+        }
+        if (completion)
+        {
+            completion(finished);
+        }
+    }];
+    [incrementalApply start];
+    return incrementalApply;
+}
+
+- (NSString*) incrementalKeyForTarget:(NSArray<NSString*>*)target keyPath:(NSString*)keyPath
+{
+    NSString* targetKey = [target componentsJoinedByString:@"."];
+    return keyPath ? [NSString stringWithFormat:@"%@|%@", targetKey, keyPath] : targetKey;
+}
+
+/**
+ * @return YES if the object is a view inside the first responder, or a visible view whose frame, converted into its window, intersects the bounds of the window.
+ */
+- (BOOL) isPriorityObjectForIncrementalApply:(NSObject*)object
+{
+    if (![object isKindOfClass:[UIView class]])
     {
-        SDLogModuleError(kThemeManagerLogModuleName, @"Color string %@ in wrong format", color);
-        return nil;
+        return NO;
     }
-    
-    if (color.length == 3) // If you only specify the 3 RGB characters, they duplicate and set the alpha to the maximum
+    UIView* view = (UIView*)object;
+    BOOL visible = YES;
+    for (UIView* ancestor = view; ancestor; ancestor = ancestor.superview)
     {
-        const char* chars = [color UTF8String];
-        color = [NSString stringWithFormat:@"%c%c%c%c%c%c%@", chars[0], chars[0], chars[1], chars[1], chars[2], chars[2], @"FF"];
+        if (ancestor.isFirstResponder)
+        {
+            return YES;
+        }
+        // a hidden or transparent ancestor hides the view too
+        visible = visible && !ancestor.isHidden && ancestor.alpha > INCREMENTAL_APPLY_VISIBLE_ALPHA;
     }
-    else if (color.length == 4) // If you only specify 4 RGB characters, they all duplicate
+    UIWindow* window = view.window;
+    if (!window || !visible)
     {
-        const char* chars = [color UTF8String];
-        color = [NSString stringWithFormat:@"%c%c%c%c%c%c%c%c", chars[0], chars[0], chars[1], chars[1], chars[2], chars[2], chars[3], chars[3]];
+        return NO;
     }
-    else if (color.length == 6) // If you only specify the 6 RRGGBB characters, the alpha hangs up to the maximum
+    CGRect frameInWindow = view.superview ? [view.superview convertRect:view.frame toView:window] : view.frame;
+    return CGRectIntersectsRect(frameInWindow, window.bounds);
+}
+
+#pragma mark Text attributes
+
+- (NSDictionary<NSAttributedStringKey, id>*) textAttributesForStyleWithName:(NSString*)styleName
+{
+    if (!styleName)
     {
-        color = [color stringByAppendingString:@"FF"];
+        return nil;
     }
     
-    NSScanner* scanner = [NSScanner scannerWithString:color];
+    __block NSDictionary<NSAttributedStringKey, id>* attributes = nil;
+    dispatch_block_t resolve = ^{
+        // the variants are read with the generation, so that a variant changing meanwhile is not cached with the new generation
+        NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+        NSUInteger generation = self.themeGeneration;
+        attributes = [self.textAttributesCache attributesForStyleName:styleName generation:generation variantStyleNames:variants];
+        if (attributes)
+        {
+            return;
+        }
+        // only the values written to the styled object itself: the last write of a keyPath wins
+        NSMutableDictionary<NSString*, id>* values = [NSMutableDictionary new];
+        for (SDThemeWrite* write in [self.resolver writesForStyleWithName:styleName variantStyleNames:variants])
+        {
+            if (write.target.count == 0)
+            {
+                values[write.keyPath] = write.value;
+            }
+        }
+        attributes = [SDThemeTextAttributes attributesWithValues:values];
+        [self.textAttributesCache setAttributes:attributes forStyleName:styleName generation:generation variantStyleNames:variants];
+    };
     
-    unsigned hex;
-    if (![scanner scanHexInt:&hex])
+    if ([NSThread isMainThread])
     {
-        return nil;
+        resolve();
     }
-    int r = (hex >> 24) & 0xFF;
-    int g = (hex >> 16) & 0xFF;
-    int b = (hex >> 8) & 0xFF;
-    int a = (hex) & 0xFF;
-    
-    return [UIColor colorWithRed:r / 255.0f green:g / 255.0f blue:b / 255.0f alpha:a / 255.0f];
+    else
+    {
+        // outside the main thread the themes are read on the resolution queue, where the changes are barriers
+        [self performThemeRead:resolve];
+    }
+    return attributes;
 }
 
-- (id) valueForKeyPath:(NSString*)keyPath
+#pragma mark Images
+
+- (NSSet<NSString*>*) imageNamesForStylesWithNames:(NSArray<NSString*>*)styleNames
 {
-    return [self valueForKeyPath:keyPath fromDefaultTheme:NO];
+    NSMutableSet<NSString*>* imageNames = [NSMutableSet new];
+    [self performThemeRead:^{
+        [imageNames unionSet:[self resolvedImageNamesForStylesWithNames:styleNames]];
+    }];
+    return imageNames;
 }
 
-- (id) valueForKeyPath:(NSString*)keyPath fromDefaultTheme:(BOOL)fromDefault
+- (void) decodeImagesForStylesWithNames:(NSArray<NSString*>*)styleNames completion:(void (^)(void))completion
 {
-    NSString* value;
-    
-    if (fromDefault)
+    dispatch_async(self.resolutionQueue, ^{
+        NSSet<NSString*>* imageNames = [self resolvedImageNamesForStylesWithNames:styleNames];
+        [[SDThemeImageCache sharedCache] decodeImagesNamed:imageNames.allObjects completion:completion];
+    });
+}
+
+/**
+ * Resolves the styles and collects the image names they write. Must run on the resolution queue.
+ */
+- (NSSet<NSString*>*) resolvedImageNamesForStylesWithNames:(NSArray<NSString*>*)styleNames
+{
+    if (!styleNames)
     {
-        value = [self.defaultTheme valueForKeyPath:keyPath];
+        NSMutableSet<NSString*>* allStyleNames = [NSMutableSet new];
+        for (NSDictionary* theme in self.themes)
+        {
+            NSDictionary* styles = theme[STYLES_KEY];
+            if ([styles isKindOfClass:[NSDictionary class]])
+            {
+                [allStyleNames addObjectsFromArray:styles.allKeys];
+            }
+        }
+        styleNames = allStyleNames.allObjects;
     }
-    else
+    
+    NSMutableSet<NSString*>* imageNames = [NSMutableSet new];
+    for (NSString* styleName in styleNames)
     {
-        for (NSDictionary* currentTheme in self.themes)
+        NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+        for (SDThemeWrite* write in [self.resolver writesForStyleWithName:styleName variantStyleNames:variants])
         {
-            // you search for the key in all the themes you have set, sorted (the last is the default theme)
-            // The first match stops the search and returns the result
-            value = [currentTheme valueForKeyPath:keyPath];
-            if (value)
+            // without the state prefix (eg. "highlighted:image")
+            NSRange statePrefix = [write.keyPath rangeOfString:@":" options:NSBackwardsSearch];
+            NSString* key = statePrefix.location == NSNotFound ? write.keyPath : [write.keyPath substringFromIndex:NSMaxRange(statePrefix)];
+            if ([IMAGE_KEYS containsObject:key] && [write.value isKindOfClass:[NSString class]] && [write.value length] > 0)
             {
-                break;
+                [imageNames addObject:write.value];
             }
         }
     }
+    return imageNames;
+}
+
+#pragma mark Annotation views
+
+- (void) applyAnnotationStyleWithName:(NSString*)styleName toAnnotationView:(MKAnnotationView*)annotationView
+{
+    if (!styleName || !annotationView)
+    {
+        return;
+    }
     
-    return value;
+    // a reused view takes the style of its new annotation
+    [self.annotationViews setObject:styleName forKey:annotationView];
+    SDThemeAnnotationTemplate* template = [self annotationTemplateWithName:styleName];
+    [self performApplyWithOptions:self.defaultApplyOptions usingBlock:^{
+        [self stampAnnotationView:annotationView withTemplate:template];
+    }];
+}
+
+- (void) refreshAnnotationViews
+{
+    [self refreshAnnotationViewsWithStyles:nil];
 }
 
 /**
- * Search the past style first in the Interfaces group and (as fallback) in the plist Styles group.
- *
- * @param key Name of style to search.
- *
- * @return The style dictionary or nil if this does not exist.
+ * Stamps again the live annotation views whose style is affected by the given styles, nil for all, in a single transaction.
  */
-- (NSDictionary*) themeStyleForKey:(NSString*)key fromDefaultTheme:(BOOL)fromDefault
+- (void) refreshAnnotationViewsWithStyles:(NSSet<NSString*>*)styles
 {
-    // Style is searched in the "interfaces" group
-    id style = [self getThemeStyleForKey:key fromDefaultTheme:fromDefault];
-    
-    if ([style isKindOfClass:[NSString class]])
+    if (self.annotationViews.count == 0 || (styles && styles.count == 0))
     {
-        id value = [self valueForConventionalString:style];
-        
-        if (![value isKindOfClass:[NSDictionary class]])
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@' for key %@", style, key);
-            return nil;
-        }
-        else
+        return;
+    }
+    
+    NSArray<MKAnnotationView*>* annotationViews = self.annotationViews.keyEnumerator.allObjects;
+    [self performApplyWithOptions:SDThemeApplyOptionTransaction usingBlock:^{
+        for (MKAnnotationView* annotationView in annotationViews)
         {
-            return value;
+            NSString* styleName = [self.annotationViews objectForKey:annotationView];
+            if (styleName && (!styles || [self isStyle:styleName affectedByStyles:styles]))
+            {
+                // the first view of each style rebuilds its template, the others share it
+                [self stampAnnotationView:annotationView withTemplate:[self annotationTemplateWithName:styleName]];
+            }
         }
+    }];
+}
+
+/**
+ * @return the template of a style, built again if the themes, the constants or the variants changed since it was built.
+ */
+- (SDThemeAnnotationTemplate*) annotationTemplateWithName:(NSString*)styleName
+{
+    SDThemeAnnotationTemplate* template = self.annotationTemplates[styleName];
+    NSArray<NSString*>* variants = [self.variantIndex variantStyleNamesForStyle:styleName] ?: @[];
+    if (!template || template.generation != self.themeGeneration || ![template.variantStyleNames isEqualToArray:variants])
+    {
+        template = [[SDThemeAnnotationTemplate alloc] initWithResolvedStyle:[self resolvedStyleWithName:styleName]];
+        self.annotationTemplates[styleName] = template;
     }
-    else
+    return template;
+}
+
+- (void) stampAnnotationView:(MKAnnotationView*)annotationView withTemplate:(SDThemeAnnotationTemplate*)template
+{
+    [template stampImageAndCenterOffsetOfAnnotationView:annotationView];
+    [self commitWrites:template.writes toObject:annotationView];
+    
+    if (self.applyContext.isTransactional)
     {
-        if (!style)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"Style not found with name '%@' for key %@", style, key);
-        }
-        return style;
+        [self.applyContext addLayoutRoot:[self layoutRootOfObject:annotationView]];
     }
 }
 
-- (NSDictionary*) themeStyleForKey:(NSString*)key
+#pragma mark Handles
+
+- (void) registerConstantHandleNames:(NSString* const*)constantNames count:(NSUInteger)constantCount styleHandleNames:(NSString* const*)styleNames count:(NSUInteger)styleCount
 {
-    return [self themeStyleForKey:key fromDefaultTheme:NO];
+    __weak typeof(self) weakSelf = self;
+    self.handleTable = [[SDThemeHandleTable alloc] initWithConstantNames:constantNames
+                                                                   count:constantCount
+                                                              styleNames:styleNames
+                                                                   count:styleCount
+                                                        constantResolver:^id(NSString* name) {
+                                                            return [weakSelf valueForConstantWithName:name];
+                                                        }
+                                                           styleResolver:^NSDictionary*(NSString* name) {
+                                                               return [weakSelf themeStyleForKey:name];
+                                                           }];
 }
 
-/**
- * Applies the dictionary of a style to the past object
- *
- * @param style The style to apply.
- * @param object The object to which style is to be applied.
- */
-- (void) applyDictionary:(NSDictionary*)style toObject:(NSObject*)object
+- (id) valueForConstantHandle:(SDThemeConstantHandle)handle
 {
-    if ([object isKindOfClass:[NSArray class]])
+    return [self.handleTable valueForConstantHandle:handle];
+}
+
+- (UIColor*) colorForConstantHandle:(SDThemeConstantHandle)handle
+{
+    id color = [self.handleTable valueForConstantHandle:handle];
+    return [color isKindOfClass:[UIColor class]] ? color : nil;
+}
+
+- (UIFont*) fontForConstantHandle:(SDThemeConstantHandle)handle
+{
+    id font = [self.handleTable valueForConstantHandle:handle];
+    return [font isKindOfClass:[UIFont class]] ? font : nil;
+}
+
+- (CGFloat) floatForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return [self.handleTable floatForConstantHandle:handle];
+}
+
+- (CGPoint) pointForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return [self.handleTable pointForConstantHandle:handle];
+}
+
+- (CGSize) sizeForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return [self.handleTable sizeForConstantHandle:handle];
+}
+
+- (CGRect) rectForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return [self.handleTable rectForConstantHandle:handle];
+}
+
+- (UIEdgeInsets) edgeInsetsForConstantHandle:(SDThemeConstantHandle)handle
+{
+    return [self.handleTable edgeInsetsForConstantHandle:handle];
+}
+
+- (void) applyStyleWithHandle:(SDThemeStyleHandle)handle toObject:(NSObject*)object
+{
+    NSDictionary* style = [self.handleTable styleForHandle:handle];
+    if (!style)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Style not found for handle %u", handle.index);
+        return;
+    }
+    
+    NSString* styleName = [self.handleTable nameForStyleHandle:handle];
+    [self performApplyWithOptions:self.defaultApplyOptions usingBlock:^{
+        [self commitStyleWithName:styleName toObject:object];
+        [self didApplyStyleWithName:styleName toObject:object];
+    }];
+}
+
+#pragma mark Hot reload
+
+- (BOOL) isWatchingThemeFiles
+{
+    return self.themeFileWatchers != nil;
+}
+
+- (void) startWatchingThemeFiles
+{
+    for (SDThemeFileWatcher* watcher in self.themeFileWatchers)
     {
-        NSArray* array = (NSArray*)object;
-        for (id element in array)
+        [watcher stop];
+    }
+    
+    if (!self.appliedStyles)
+    {
+        self.appliedStyles = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    self.dependencyIndex = [[SDThemeDependencyIndex alloc] initWithConstantsKey:CONSTANTS_KEY stylesKey:STYLES_KEY];
+    
+    NSMutableArray<SDThemeFileWatcher*>* watchers = [NSMutableArray new];
+    __weak typeof(self) weakSelf = self;
+    for (NSString* path in [self themeFilePaths])
+    {
+        [self.dependencyIndex indexTheme:[self loadedThemeForPath:path] forLayer:path];
+        
+        SDThemeFileWatcher* watcher = [[SDThemeFileWatcher alloc] initWithPath:path queue:dispatch_get_main_queue() handler:^(NSString* changedPath) {
+            [weakSelf reloadThemeFileAtPath:changedPath];
+        }];
+        [watcher start];
+        [watchers addObject:watcher];
+    }
+    self.themeFileWatchers = watchers;
+}
+
+- (void) stopWatchingThemeFiles
+{
+    for (SDThemeFileWatcher* watcher in self.themeFileWatchers)
+    {
+        [watcher stop];
+    }
+    self.themeFileWatchers = nil;
+    self.dependencyIndex = nil;
+    self.appliedStyles = nil;
+}
+
+- (NSSet<NSString*>*) reloadThemeFileAtPath:(NSString*)path
+{
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, @"reload", SDThemeTraceCategoryLoad, nil, Nil, path.lastPathComponent);
+    NSSet<NSString*>* affectedStyles = [self reloadLayerAtPath:path];
+    TRACE_END(tracer, @"reload", SDThemeTraceCategoryLoad);
+    return affectedStyles;
+}
+
+- (NSSet<NSString*>*) reloadLayerAtPath:(NSString*)path
+{
+    // the new version is read and compiled before the change, without touching the current themes
+    NSDictionary* oldTheme = [self loadedThemeForPath:path];
+    NSDictionary* newTheme = nil;
+    NSMutableDictionary* newDynamicTheme = nil;
+    BOOL isDynamicTheme = [path isEqualToString:self.pathForDynamicTheme];
+    
+    if (isDynamicTheme)
+    {
+        newDynamicTheme = [self reloadDynamicTheme];
+        newTheme = newDynamicTheme;
+    }
+    else if ([path isEqualToString:[self defaultThemePath]])
+    {
+        newTheme = [[SDThemeSharedStore sharedStore] compiledThemeAtPath:path retained:YES compile:^NSDictionary*{
+            return [self compactTheme:[self loadThemeFromPlistData:[self loadPlistDataAtPath:path] atPath:path] withName:THEME_DEFAULT_PLIST_NAME sharingWithThemes:nil];
+        }];
+    }
+    else if (self.alternativeThemesByPath[path])
+    {
+        // the layer shares its values with the same themes used when it was loaded first
+        NSMutableArray<NSDictionary*>* sharedThemes = [NSMutableArray arrayWithObject:self.defaultTheme];
+        for (NSString* alternativePath in self.alternativeThemePaths)
         {
-            [self applyDictionary:style toObject:element];
+            if ([alternativePath isEqualToString:path])
+            {
+                break;
+            }
+            [sharedThemes addObject:self.alternativeThemesByPath[alternativePath]];
         }
+        newTheme = [[SDThemeSharedStore sharedStore] compiledThemeAtPath:path retained:NO compile:^NSDictionary*{
+            return [self compactTheme:[self loadThemeFromPlistData:[self loadPlistDataAtPath:path] atPath:path] withName:path.lastPathComponent sharingWithThemes:sharedThemes];
+        }];
     }
     else
     {
-        // eventual inheritance from the default theme
-        NSString* inheritstyleName = style[INHERIT_FROM_DEFAULT_THEME];
-        if (inheritstyleName.length > 0)
+        SDLogModuleWarning(kThemeManagerLogModuleName, @"Can't reload %@: it is not a loaded theme", path.lastPathComponent);
+        return [NSSet set];
+    }
+    
+    if (!newTheme)
+    {
+        // eg. the file is being written: the current version is kept until a valid one is saved
+        SDLogModuleWarning(kThemeManagerLogModuleName, @"Can't reload theme %@, the previous version is kept", path.lastPathComponent);
+        return [NSSet set];
+    }
+    
+    // the themes, the variant index and the dependency index change together, so a background resolution never sees them out of sync
+    NSMutableSet<NSString*>* changedConstants = [NSMutableSet new];
+    NSMutableSet<NSString*>* changedStyles = [NSMutableSet new];
+    [self performThemeMutation:^{
+        // key by key diff against the previous version
+        [changedConstants unionSet:[SDThemeDependencyIndex changedKeysFromDictionary:oldTheme[CONSTANTS_KEY] toDictionary:newTheme[CONSTANTS_KEY]]];
+        [changedStyles unionSet:[SDThemeDependencyIndex changedKeysFromDictionary:oldTheme[STYLES_KEY] toDictionary:newTheme[STYLES_KEY]]];
+        BOOL variantIndexChanged = ![[NSSet setWithArray:[oldTheme[STYLES_KEY] allKeys] ?: @[]] isEqualToSet:[NSSet setWithArray:[newTheme[STYLES_KEY] allKeys] ?: @[]]];
+        // a style can become a variant, or stop being one, without changing name
+        for (NSString* styleName in changedStyles)
         {
-            NSDictionary* superstyle = [self themeStyleForKey:inheritstyleName fromDefaultTheme:YES];
-            [self applyDictionary:superstyle toObject:object];
+            if (variantIndexChanged)
+            {
+                break;
+            }
+            id oldStyle = oldTheme[STYLES_KEY][styleName];
+            id newStyle = newTheme[STYLES_KEY][styleName];
+            id oldBaseStyleName = [oldStyle isKindOfClass:[NSDictionary class]] ? oldStyle[VARIANT_OF_KEY] : nil;
+            id newBaseStyleName = [newStyle isKindOfClass:[NSDictionary class]] ? newStyle[VARIANT_OF_KEY] : nil;
+            variantIndexChanged = oldBaseStyleName != newBaseStyleName && ![oldBaseStyleName isEqual:newBaseStyleName];
         }
         
-        // Application of a possible _superstyle
-        NSString* superstyleName = style[SUPERSTYLE_KEY];
-        
-        if (superstyleName.length > 0)
+        // replaces only the reloaded layer
+        NSMutableArray* themes = [NSMutableArray arrayWithArray:self.themes];
+        NSUInteger index = oldTheme ? [themes indexOfObjectIdenticalTo:oldTheme] : NSNotFound;
+        if (index != NSNotFound)
         {
-            NSArray* styles = [superstyleName componentsSeparatedByString:@","];
-            for (NSString* styleName in styles)
-            {
-                NSDictionary* superstyle = [self themeStyleForKey:styleName fromDefaultTheme:NO];
-                [self applyDictionary:superstyle toObject:object];
-            }
+            themes[index] = newTheme;
+        }
+        else if (isDynamicTheme)
+        {
+            [themes insertObject:newTheme atIndex:0];
         }
         
-        // normalize the style by parsing the keys
-        NSDictionary* normalizedStyle = [self normalizeDictionary:style];
+        if (isDynamicTheme)
+        {
+            self->_dynamicTheme = newDynamicTheme;
+        }
+        else if (oldTheme && oldTheme == self.defaultTheme)
+        {
+            self.defaultTheme = newTheme;
+        }
+        else if (self.alternativeThemesByPath[path])
+        {
+            self.alternativeThemesByPath[path] = newTheme;
+        }
         
-        // Apply values ​​to the properties listed in the dictionary
-        for (NSString* key in normalizedStyle.allKeys)
+        // the setter would rebuild everything
+        self->_themes = [NSArray arrayWithArray:themes];
+        [self themesDidChange];
+        if (changedConstants.count > 0)
         {
-            if ([key isEqualToString:SUPERSTYLE_KEY] || [key isEqualToString:INHERIT_FROM_DEFAULT_THEME])
-            {
-                continue;
-            }
-            
-            [self applyValue:normalizedStyle[key] toKeyPath:key ofObject:object];
+            [self resolveConstantExpressions];
+        }
+        if (variantIndexChanged)
+        {
+            [self rebuildVariantIndex];
         }
+        [self.dependencyIndex indexTheme:newTheme forLayer:path];
+        
+        // follows the references to the changed names (superstyles, constants used by styles and expressions)
+        [self.dependencyIndex expandChangedConstants:changedConstants styles:changedStyles];
+    }];
+    
+    if (changedConstants.count == 0 && changedStyles.count == 0)
+    {
+        return [NSSet set];
+    }
+    SDLogModuleInfo(kThemeManagerLogModuleName, @"Reloaded theme %@: %lu constants and %lu styles affected", path.lastPathComponent, (unsigned long)changedConstants.count, (unsigned long)changedStyles.count);
+    
+    [self reapplyStyles:changedStyles];
+    [self refreshAnnotationViewsWithStyles:changedStyles];
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:SDThemeManagerThemeDidReloadNotification
+                                                        object:self
+                                                      userInfo:@{ SDThemeReloadedPathKey: path,
+                                                                  SDThemeAffectedStylesKey: [changedStyles copy],
+                                                                  SDThemeAffectedConstantsKey: [changedConstants copy] }];
+    return changedStyles;
+}
+
+#pragma mark - Old methods for retro-compatibility
+
+- (id) valueForKey:(NSString*)key
+{
+    id resolvedValue = [self.resolver resolvedValueForConstant:key];
+    if (resolvedValue)
+    {
+        [self.usageLog recordConstantWithName:key];
+        return resolvedValue == [NSNull null] ? nil : SDThemeUIKitObject(resolvedValue);
+    }
+    
+    // you search for the key in all the topics you set, sorted (the last is the default theme)
+    NSString* value = [self.resolver valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, key] fromDefaultTheme:NO];
+    if (value)
+    {
+        [self.usageLog recordConstantWithName:key];
+    }
+    
+    return value;
+}
+
+- (float) themeFloatForKey:(NSString*)key
+{
+    NSNumber* themeValue = [self themeNumberForKey:key];
+    
+    if (themeValue)
+    {
+        return [themeValue floatValue];
+    }
+    return 0;
+}
+
+- (int) themeIntegerForKey:(NSString*)key
+{
+    NSNumber* themeValue = [self themeNumberForKey:key];
+    
+    if (themeValue)
+    {
+        return [themeValue intValue];
+    }
+    return 0;
+}
+
+- (NSNumber*) themeNumberForKey:(NSString*)key
+{
+    NSNumber* themeValue = [self valueForKey:key];
+    
+    return themeValue;
+}
+
+- (UIColor*) themeColorForKey:(NSString*)key
+{
+    NSString* themeValue = [self valueForKey:key];
+    
+    id color = SDThemeUIKitObject([self.resolver valueForConventionalString:themeValue]);
+    
+    if ([color isKindOfClass:[UIColor class]])
+    {
+        return color;
+    }
+    return SDThemeUIKitObject([self.resolver colorValueForString:themeValue]);
+}
+
+- (UIFont*) themeFontForKey:(NSString*)key andSize:(CGFloat)fontSize
+{
+    NSString* themeValue = [self valueForKey:key];
+    id font = SDThemeUIKitObject([self.resolver valueForConventionalString:themeValue]);
+    
+    if ([font isKindOfClass:[UIFont class]])
+    {
+        return [font fontWithSize:fontSize];
     }
+    return [UIFont fontWithName:themeValue size:fontSize];
 }
 
+#pragma mark - Utils
+
 /**
- * Normalize past dictionary by parsing all its keys.
- * First divides all keys that are represented by keyPaths lists divided by ",".
- * For all keypaths thus obtained, normalizes the first level.
- *
- *  Example -
- * The dictionary:
- *
- *  { "view.layer.borderWidth,view2.layer.borderWidth" : 2} viene trasformato in
- *
- *  {
- *      "view"  : { "layer.borderWidth" : 2 },
- *      "view2" : { "layer.borderWidth" : 2 }
- *  }
- *
- *  @param dictionary dictionary to normalize.
- *
- *  @return normalized dictionary.
+ * Opens an application of styles. Nested applications share the context, and the options, of the outermost one.
  */
-- (NSDictionary*) normalizeDictionary:(NSDictionary*)dictionary
+- (void) beginApplyWithOptions:(SDThemeApplyOptions)options
 {
-    NSMutableDictionary* normalizedDictionary = [NSMutableDictionary dictionary];
-    
-    // look at all the passwords in the dictionary keyPaths
-    for (NSString* originalKeyPaths in dictionary.allKeys)
+    if (!self.applyContext)
     {
-        // divides arrays expressed with ","
-        NSArray* keyPaths = [originalKeyPaths componentsSeparatedByString:@","];
+        self.applyContext = [SDThemeApplyContext new];
         
-        for (NSString* keyPath in keyPaths)
+        if (options & (SDThemeApplyOptionTransaction | SDThemeApplyOptionAnimated))
         {
-            // if the key is a keyPath, it finds the part before the first "." Which becomes the new key. Its value is a dictionary to which the next part of the original keyPath, associated with the original value, is added as a key.
-
-            NSInteger dotIndex = [keyPath rangeOfString:@"."].location;
-            if (dotIndex != NSNotFound)
+            self.applyContext.transactional = YES;
+            [CATransaction begin];
+            if (options & SDThemeApplyOptionAnimated)
             {
-                NSString* normalizedKey = [keyPath substringToIndex:dotIndex];
-                NSString* subKeyPath = [keyPath substringFromIndex:dotIndex + 1];
-                NSDictionary* normalizedValue = nil;
-                
-                // Avoid that more key-paths associated with the standard key overwrite each other
-                id currentValue = normalizedDictionary[normalizedKey];
-                if (currentValue != nil &&
-                    [currentValue isKindOfClass:[NSDictionary class]])
-                {
-                    NSMutableDictionary* unionOfValues = [NSMutableDictionary dictionaryWithDictionary:currentValue];
-                    unionOfValues[subKeyPath] = dictionary[originalKeyPaths];
-                    normalizedValue = [NSDictionary dictionaryWithDictionary:unionOfValues];
-                }
-                else
-                {
-                    normalizedValue = @{ subKeyPath : dictionary[originalKeyPaths] };
-                }
-                
-                normalizedDictionary[normalizedKey] = normalizedValue;
+                [CATransaction setAnimationDuration:self.animatedApplyDuration];
             }
             else
             {
-                // the dictionary is already normalized
-                normalizedDictionary[keyPath] = dictionary[originalKeyPaths];
+                [CATransaction setDisableActions:YES];
             }
         }
     }
-    
-    return [NSDictionary dictionaryWithDictionary:normalizedDictionary];
+    self.applyContext.depth++;
 }
 
 /**
- * Applies a single value to a given keyPath of the past object.
- *
- * @param value The value to apply.
- * @param keyPath The property keyPath to be valued.
- * @param object The object you want to highlight the property indicated in 'keyPath'.
+ * Closes an application of styles. When the outermost application ends, the batched values are committed to their objects.
  */
-- (void) applyValue:(id)value toKeyPath:(NSString*)keyPath ofObject:(NSObject*)object
+- (void) endApply
 {
-    @try {
-        // if the value is a dictionary then it is a grafted style, so I apply the style grafted to
-        if ([value isKindOfClass:[NSDictionary class]])
+    SDThemeApplyContext* context = self.applyContext;
+    if (!context || --context.depth > 0)
+    {
+        return;
+    }
+    self.applyContext = nil;
+    
+    SDThemeTracer* tracer = self.tracer;
+    [context dequeueBatchesUsingBlock:^(NSObject* object, NSString* batchIdentifier, NSDictionary<NSString*, id>* values) {
+        @try
         {
-            NSObject* objectForKeyPath = [object valueForKeyPath:keyPath];
-            [self applyDictionary:value toObject:objectForKeyPath];
+            SDLogModuleVerbose(kThemeManagerLogModuleName, @"Applying values: %@ of batch: %@ to object of class: %@", values, batchIdentifier, NSStringFromClass([object class]));
+            TRACE_BEGIN(tracer, batchIdentifier, SDThemeTraceCategoryWrite, nil, [object class], nil);
+            [object applyThemeValues:values forBatch:batchIdentifier];
+            TRACE_END(tracer, batchIdentifier, SDThemeTraceCategoryWrite);
         }
-        // if the value is a string can be a constant name or one of the possible conventions
-        else if ([value isKindOfClass:[NSString class]])
+        @catch (NSException* exception)
         {
-            // control the conventions
-            id finalValue = [self valueForConventionalString:value];
-            if ([finalValue respondsToSelector:@selector(isEqualToString:)] && [finalValue isEqualToString:value])
-            {
-                // did not find any conventions. I look for constants
-                finalValue = [self constantValueForString:value];
-            }
-            
-            // If the final value is a dictionary of a style, then call the method to apply it
-            if ([finalValue isKindOfClass:[NSDictionary class]])
-            {
-                [self applyValue:finalValue toKeyPath:keyPath ofObject:object];
-            }
-            // otherwise I apply the value to the past keypath
-            else
-            {
-#if DEBUG
-                NSString* initialClassName = [self classNameForKey:keyPath ofObject:object];
-#endif
-                SDLogModuleVerbose(kThemeManagerLogModuleName, @"Applying value: %@ to keyPath: %@ of object of class: %@", finalValue, keyPath, NSStringFromClass([object class]));
-                if ([object respondsToSelector:@selector(shouldApplyThemeCustomizationForKeyPath:)] &&
-                    [object shouldApplyThemeCustomizationForKeyPath:keyPath])
-                {
-                    [object applyCustomizationOfThemeValue:finalValue forKeyPath:keyPath];
-                }
-                else
-                {
-                    [object applyThemeValue:finalValue forKeyPath:keyPath];
-                }
-#if DEBUG
-                NSString* finalClassName = [self classNameForKey:keyPath ofObject:object];
-                if (![finalClassName isEqualToString:initialClassName] && finalClassName != nil && initialClassName != nil)
-                {
-                    // unfortunately it is not possible to retrieve the property class if the property is nil, so you have to skip the cases where initial or final are nil
-                    SDLogModuleError(kThemeManagerLogModuleName, @"Possible error: object at keypath %@ of object %@ changed type from %@ to %@", keyPath, NSStringFromClass([object class]), initialClassName, finalClassName);
-                }
-#endif
-            }
+            SDLogModuleError(kThemeManagerLogModuleName, @"Cannot apply values %@ of batch %@ to object of class %@", values, batchIdentifier, NSStringFromClass([object class]));
         }
-        else
-        {
-            SDLogModuleVerbose(kThemeManagerLogModuleName, @"Applying value: %@ to keyPath: %@ of object of class: %@", value, keyPath, NSStringFromClass([object class]));
-            if ([object respondsToSelector:@selector(shouldApplyThemeCustomizationForKeyPath:)] &&
-                [object shouldApplyThemeCustomizationForKeyPath:keyPath])
+    }];
+    
+    if (context.isTransactional)
+    {
+        // The invalidations done by the setters are resolved with a single layout pass for each root, inside the transaction
+        [context dequeueLayoutRootsUsingBlock:^(NSObject* root) {
+            if ([root isKindOfClass:[UIView class]])
             {
-                [object applyCustomizationOfThemeValue:value forKeyPath:keyPath];
+                [(UIView*)root layoutIfNeeded];
             }
-            else
+            else if ([root isKindOfClass:[CALayer class]])
             {
-                [object applyThemeValue:value forKeyPath:keyPath];
+                [(CALayer*)root layoutIfNeeded];
             }
+        }];
+        [CATransaction commit];
+    }
+}
+
+/**
+ * @return the topmost view or layer containing the given object, nil if the object is neither a view nor a layer.
+ */
+- (NSObject*) layoutRootOfObject:(NSObject*)object
+{
+    if ([object isKindOfClass:[UIView class]])
+    {
+        UIView* view = (UIView*)object;
+        while (view.superview)
+        {
+            view = view.superview;
         }
+        return view;
     }
-    @catch (NSException* exception)
+    if ([object isKindOfClass:[CALayer class]])
     {
-        SDLogModuleError(kThemeManagerLogModuleName, @"Cannot apply value %@ to keyPath %@ to object of class %@", value, keyPath, object ? NSStringFromClass([object class]) : @"<nil>");
+        CALayer* layer = (CALayer*)object;
+        while (layer.superlayer)
+        {
+            layer = layer.superlayer;
+        }
+        // a layer backing a view is laid out through its view
+        return [layer.delegate isKindOfClass:[UIView class]] ? (UIView*)layer.delegate : layer;
     }
+    return nil;
 }
 
 /**
- * Finds the value of a Constant constants constant or, if not found, the string passed as a argument
- *
- * @param string The name of the constant to be found.
+ * Converts old themes to make them compatible with the new version of ThemeManager.
  *
- * @resurn the value of a Constants constant constant or, if not found, the passed string as argument
+ * @param theme Dictionary containing the old theme.
  *
- * @discussion This private method differs from the public method valueForConstantWithName: because it returns the passed string if you do not find the constant. This method must always be used for internal logic.
+ * @return dictionary converted to new specifications.
  */
-- (id) constantValueForString:(NSString*)string
+- (NSDictionary*) convertThemeForCompatibility:(NSDictionary*)theme
 {
-    id constantValue = [self valueForKeyPath:[NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, string]];
-    
-    // if I do not find a constant string return
-    if (!constantValue)
-    {
-        return string;
-    }
+    int version = [[theme objectForKey:FORMAT_VERSION_KEY] intValue];
     
-    // If the value is a string, look for any conventions, otherwise I return the value
-    if ([constantValue isKindOfClass:[NSString class]])
-    {
-        return [self valueForConventionalString:constantValue];
-    }
-    else
+    if (version < 2)
     {
-        return constantValue;
+        // loaded theme is of the old type, for compatibility it loads everything inside the key of the constants
+        return @{ CONSTANTS_KEY: theme };
     }
+    return theme;
+}
+
+- (id) valueForKeyPath:(NSString*)keyPath
+{
+    return [self.resolver valueForKeyPath:keyPath fromDefaultTheme:NO];
 }
 
+- (NSDictionary*) themeStyleForKey:(NSString*)key
+{
+    return [self.resolver themeStyleForKey:key fromDefaultTheme:NO];
+}
+
+#pragma mark Commit
+
 /**
- * Look for any conventions in the past string and return a conforming value to the convention or the passed string if there are no known conventions.
- *
- * @param string The string to be parsed.
+ * Performs resolved writes on an object. Must run on the main thread.
  *
- * @return A value consistent with the agreement found. If it finds a convention that is not respected or the NULL convention nil returns. If it does not find any convention, it returns string.
+ * @param writes The writes, in application order.
+ * @param object The styled object. If it is an array the writes are performed on each element.
  */
-- (id) valueForConventionalString:(NSString*)string
+- (void) commitWrites:(NSArray<SDThemeWrite*>*)writes toObject:(NSObject*)object
 {
-    NSString* convention = [SDThemeManager conventionIdentifierInString:string];
+    // the writes of the same grafted style share the target, that is looked up once
+    NSArray<NSString*>* currentTarget = nil;
+    NSArray<NSObject*>* currentObjects = nil;
     
-    // style convention:
-    if ([STYLE_IDENTIFIERS containsObject:convention])
+    for (SDThemeWrite* write in writes)
     {
-        @try
-        {
-            NSString* styleName = [string substringFromIndex:convention.length];
-            NSArray* styles = [styleName componentsSeparatedByString:@","];
-            NSMutableDictionary* styleDictionary = [NSMutableDictionary dictionary];
-            for (NSString* style in styles)
-            {
-                [styleDictionary addEntriesFromDictionary:[self themeStyleForKey:style]];
-            }
-            return [styleDictionary copy];
-        }
-        @catch (NSException* exception)
+        if (write.target != currentTarget)
         {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'style:' convention used without a valid value. Given value: %@", string);
-            return nil;
+            currentTarget = write.target;
+            NSMutableArray<NSObject*>* objects = [NSMutableArray new];
+            [self collectObjectsAtTarget:currentTarget fromIndex:0 ofObject:object value:write.value intoArray:objects];
+            currentObjects = objects;
         }
-    }
-    // font convention:
-    if ([FONT_IDENTIFIERS containsObject:convention])
-    {
-        @try
+        
+        for (NSObject* targetObject in currentObjects)
         {
-            // aspected string: "font:<FONT_NAME>,<FONT_SIZE>" o "f:<FONT_NAME>,<FONT_SIZE>"
-            NSString* fontSpecs = [string substringFromIndex:convention.length];
-            NSArray* specs = [fontSpecs componentsSeparatedByString:@","];
-            NSString* fontName = [self constantValueForString:specs[0]];
-            float fontSize = [[self constantValueForString:specs[1]] floatValue];
-            if ([fontName.lowercaseString isEqualToString:SYSTEM_FONT_NAME])
+            @try
             {
-                return [UIFont systemFontOfSize:fontSize];
+                [self writeValue:write.value toKeyPath:write.keyPath ofObject:targetObject validatingType:write.validatesType];
             }
-            if ([fontName.lowercaseString isEqualToString:SYSTEM_BOLD_FONT_NAME])
-            {
-                return [UIFont boldSystemFontOfSize:fontSize];
-            }
-            if ([fontName.lowercaseString isEqualToString:SYSTEM_ITALIC_FONT_NAME])
-            {
-                return [UIFont italicSystemFontOfSize:fontSize];
-            }
-            UIFont* font = [UIFont fontWithName:fontName size:fontSize];
-            return font;
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'font:' convention used without a valid value. Given value: %@. Expected value format: 'font:<FONT_NAME>,<FONT_SIZE>'", string);
-            return nil;
-        }
-    }
-    // color convention:
-    if ([COLOR_IDENTIFIERS containsObject:convention])
-    {
-        @try
-        {
-            NSString* colorValue = [string substringFromIndex:convention.length];
-            UIColor* color = [self colorForString:colorValue];
-            if (!color)
+            @catch (NSException* exception)
             {
-                SDLogModuleError(kThemeManagerLogModuleName, @"'color:' convention used without a valid value. Given value: %@. Expected value format: 'color:<RRGGBB>' or 'color:<RRGGBBAA>'", string);
+                SDLogModuleError(kThemeManagerLogModuleName, @"Cannot apply value %@ to keyPath %@ to object of class %@", write.value, write.keyPath, NSStringFromClass([targetObject class]));
             }
-            return color;
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'color:' convention used without a valid value. Given value: %@. Expected value format: 'color:<RRGGBB>' or 'color:<RRGGBBAA>'", string);
-            return nil;
         }
     }
-    // null convention
-    if ([NULL_IDENTIFIERS containsObject:convention])
+}
+
+/**
+ * Follows the keyPaths of a target starting from the styled object. Arrays found along the way are expanded, so that the style is applied to each element.
+ */
+- (void) collectObjectsAtTarget:(NSArray<NSString*>*)target fromIndex:(NSUInteger)index ofObject:(NSObject*)object value:(id)value intoArray:(NSMutableArray<NSObject*>*)objects
+{
+    if (!object)
     {
-        return nil;
+        return;
     }
-    // point convention:
-    if ([convention isEqualToString:POINT_IDENTIFIER])
+    if ([object isKindOfClass:[NSArray class]])
     {
-        @try
+        for (NSObject* element in (NSArray*)object)
         {
-            // aspected string: "point:<X_VALUE>,<Y_VALUE>"
-            NSString* pointSpecs = [string substringFromIndex:convention.length];
-            NSArray* specs = [pointSpecs componentsSeparatedByString:@","];
-            CGFloat x = [specs[0] floatValue];
-            CGFloat y = [specs[1] floatValue];
-            CGPoint point = CGPointMake(x, y);
-            return [NSValue valueWithCGPoint:point];
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'point:' convention used without a valid value. Given value: %@. Expected value format: 'point:<X_VALUE>,<Y_VALUE>'", string);
-            return nil;
+            [self collectObjectsAtTarget:target fromIndex:index ofObject:element value:value intoArray:objects];
         }
+        return;
     }
-    // size convention:
-    if ([convention isEqualToString:SIZE_IDENTIFIER])
+    if (index == target.count)
     {
-        @try
-        {
-            // aspected string: "size:<WIDTH_VALUE>,<HEIGHT_VALUE>"
-            NSString* sizeSpecs = [string substringFromIndex:convention.length];
-            NSArray* specs = [sizeSpecs componentsSeparatedByString:@","];
-            CGFloat width = [specs[0] floatValue];
-            CGFloat height = [specs[1] floatValue];
-            CGSize size = CGSizeMake(width, height);
-            return [NSValue valueWithCGSize:size];
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'size:' convention used without a valid value. Given value: %@. Expected value format: 'size:<WIDTH_VALUE>,<HEIGHT_VALUE>'", string);
-            return nil;
-        }
+        [objects addObject:object];
+        return;
     }
-    // rect convention:
-    if ([convention isEqualToString:RECT_IDENTIFIER])
+    
+    NSObject* child = nil;
+    @try
     {
-        @try
-        {
-            // aspected string: "rect:<X_VALUE>,<Y_VALUE>,<WIDTH_VALUE>,<HEIGHT_VALUE>"
-            NSString* rectSpecs = [string substringFromIndex:convention.length];
-            NSArray* specs = [rectSpecs componentsSeparatedByString:@","];
-            CGFloat x = [specs[0] floatValue];
-            CGFloat y = [specs[1] floatValue];
-            CGFloat width = [specs[2] floatValue];
-            CGFloat height = [specs[3] floatValue];
-            CGRect rect = CGRectMake(x, y, width, height);
-            return [NSValue valueWithCGRect:rect];
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'rect:' convention used without a valid value. Given value: %@. Expected value format: 'rect:<X_VALUE>,<Y_VALUE>,<WIDTH_VALUE>,<HEIGHT_VALUE>'", string);
-            return nil;
-        }
+        child = [object valueForKeyPath:target[index]];
     }
-    // edge convention:
-    if ([convention isEqualToString:EDGE_IDENTIFIER])
+    @catch (NSException* exception)
     {
-        @try
-        {
-            // aspected string: "edge:<TOP_VALUE>,<LEFT_VALUE>,<BOTTOM_VALUE>,<RIGHT_VALUE>"
-            NSString* edgeSpecs = [string substringFromIndex:convention.length];
-            NSArray* specs = [edgeSpecs componentsSeparatedByString:@","];
-            CGFloat top = [specs[0] floatValue];
-            CGFloat left = [specs[1] floatValue];
-            CGFloat bottom = [specs[2] floatValue];
-            CGFloat right = [specs[3] floatValue];
-            UIEdgeInsets edge = UIEdgeInsetsMake(top, left, bottom, right);
-            return [NSValue valueWithUIEdgeInsets:edge];
-        }
-        @catch (NSException* exception)
-        {
-            SDLogModuleError(kThemeManagerLogModuleName, @"'edge:' convention used without a valid value. Given value: %@. Expected value format: 'edge:<TOP_VALUE>,<LEFT_VALUE>,<BOTTOM_VALUE>,<RIGHT_VALUE>'", string);
-            return nil;
-        }
+        SDLogModuleError(kThemeManagerLogModuleName, @"Cannot apply value %@ to keyPath %@ to object of class %@", value, target[index], NSStringFromClass([object class]));
+        return;
     }
-    
-    return string;
+    [self collectObjectsAtTarget:target fromIndex:index + 1 ofObject:child value:value intoArray:objects];
 }
 
 /**
- * Find conventions in the past string
- *
- * @param string the string to be parsed
+ * Writes a final value to the object, through the customization protocol or the applyThemeValue:forKeyPath: method of its category.
+ * If the object groups the keyPath in a batch and a style is being applied, the value is collected and committed with the rest of the batch at the end of the application.
  *
- * @return Returns the found agreement or nil.
+ * @param value The final value to apply.
+ * @param keyPath The property keyPath to be valued.
+ * @param object The object to modify.
+ * @param validateType If validatesValueTypes is YES, checks the value against the type of the property.
  */
-+ (NSString*) conventionIdentifierInString:(NSString*)string
+- (void) writeValue:(id)value toKeyPath:(NSString*)keyPath ofObject:(NSObject*)object validatingType:(BOOL)validateType
 {
-    // stle convention
-    for (NSString* convention in STYLE_IDENTIFIERS)
+    SDThemeShadowState* shadowState = nil;
+    if (self.skipsRedundantWrites && [object shouldSkipRedundantThemeValueForKeyPath:keyPath])
     {
-        if ([string hasPrefix:convention])
+        shadowState = [SDThemeShadowState shadowStateOfObject:object create:YES];
+        if ([shadowState containsValue:value forKeyPath:keyPath])
         {
-            return convention;
+            self.skippedWriteCount++;
+            return;
         }
     }
     
-    // font convention
-    for (NSString* convention in FONT_IDENTIFIERS)
+    BOOL customized = [object respondsToSelector:@selector(shouldApplyThemeCustomizationForKeyPath:)] && [object shouldApplyThemeCustomizationForKeyPath:keyPath];
+    
+    NSString* batchIdentifier = (!customized && self.applyContext) ? [object themeBatchIdentifierForKeyPath:keyPath] : nil;
+    if (batchIdentifier)
     {
-        if ([string hasPrefix:convention])
-        {
-            return convention;
-        }
+        [self.applyContext addValue:value forKeyPath:keyPath toBatch:batchIdentifier ofObject:object];
+        [shadowState recordValue:value forKeyPath:keyPath];
+        return;
     }
     
-    // color convention
-    for (NSString* convention in COLOR_IDENTIFIERS)
+    NSString* initialClassName = nil;
+    BOOL validatesType = validateType && self.validatesValueTypes && [self.typeValidator shouldValidateKeyPath:keyPath ofClass:[object class] valueClass:[value class]];
+    if (validatesType)
     {
-        if ([string hasPrefix:convention])
+        BOOL known = NO;
+        NSString* expectedType = [SDThemeTypeValidator mismatchOfValue:value forKeyPath:keyPath ofClass:[object class] known:&known];
+        if (expectedType)
         {
-            return convention;
+            SDLogModuleError(kThemeManagerLogModuleName, @"Possible error: value of class %@ written to keypath %@ of object %@, that expects %@", NSStringFromClass([value class]), keyPath, NSStringFromClass([object class]), expectedType);
         }
-    }
-    
-    // null convention
-    for (NSString* convention in NULL_IDENTIFIERS)
-    {
-        if ([string hasPrefix:convention])
+        if (!known)
         {
-            return convention;
+            // the type of the property is not declared: compare the class of its value before and after the write
+            initialClassName = [self classNameForKey:keyPath ofObject:object];
         }
     }
-    
-    // CGPoint convention
-    if ([[string lowercaseString] rangeOfString:POINT_IDENTIFIER].location != NSNotFound)
-    {
-        return POINT_IDENTIFIER;
-    }
-    
-    // CGSize convention
-    if ([[string lowercaseString] rangeOfString:SIZE_IDENTIFIER].location != NSNotFound)
+    SDLogModuleVerbose(kThemeManagerLogModuleName, @"Applying value: %@ to keyPath: %@ of object of class: %@", value, keyPath, NSStringFromClass([object class]));
+    SDThemeTracer* tracer = self.tracer;
+    TRACE_BEGIN(tracer, keyPath, SDThemeTraceCategoryWrite, keyPath, [object class], nil);
+    @try
     {
-        return SIZE_IDENTIFIER;
+        if (customized)
+        {
+            [object applyCustomizationOfThemeValue:value forKeyPath:keyPath];
+        }
+        else
+        {
+            [object applyThemeValue:value forKeyPath:keyPath];
+        }
     }
-    
-    // CGRect convention
-    if ([[string lowercaseString] rangeOfString:RECT_IDENTIFIER].location != NSNotFound)
+    @finally
     {
-        return RECT_IDENTIFIER;
+        TRACE_END(tracer, keyPath, SDThemeTraceCategoryWrite);
     }
-    
-    // UIEdgeInsets convention
-    if ([[string lowercaseString] rangeOfString:EDGE_IDENTIFIER].location != NSNotFound)
+    // not recorded if the write throws
+    [shadowState recordValue:value forKeyPath:keyPath];
+    if (initialClassName)
     {
-        return EDGE_IDENTIFIER;
+        NSString* finalClassName = [self classNameForKey:keyPath ofObject:object];
+        if (![finalClassName isEqualToString:initialClassName] && finalClassName != nil)
+        {
+            // unfortunately it is not possible to retrieve the property class if the property is nil, so you have to skip the cases where initial or final are nil
+            SDLogModuleError(kThemeManagerLogModuleName, @"Possible error: object at keypath %@ of object %@ changed type from %@ to %@", keyPath, NSStringFromClass([object class]), initialClassName, finalClassName);
+        }
     }
-    
-    return nil;
 }
 
 - (NSString*) classNameForKey:(NSString*)key ofObject:(NSObject*)object
@@ -1077,58 +2080,151 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
         SDLogError(@"Can't retreive merged value for missing style");
         return nil;
     }
-    NSString* keyPath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, style];
-    
-    NSMutableDictionary* mergedDictionary = [NSMutableDictionary new];
-    [self mergedStyleDictionary:mergedDictionary forKeypath:keyPath insideThemes:self.themes];
-    return mergedDictionary;
+    return [self.resolver mergedValueForStyle:style];
 }
 
-- (void) mergedStyleDictionary:(NSMutableDictionary*)styleDictionary forKeypath:(NSString*)keypath insideThemes:(NSArray<NSDictionary*>*)themes
+- (NSArray<SDThemeLayerFootprint*>*) themeMemoryFootprint
 {
-    NSDictionary* theme = themes.firstObject;
-    NSDictionary* currentThemeStyle = [theme valueForKeyPath:keypath];
-    
-    NSString* inheritedStyle = [currentThemeStyle valueForKey:INHERIT_FROM_DEFAULT_THEME];
-    if(inheritedStyle.length > 0 && themes.count > 1)
-    {
-        // inheritance styles works only on default_theme
-        NSString* inheritedKeypath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, inheritedStyle];
-        [self mergedStyleDictionary:styleDictionary forKeypath:inheritedKeypath insideThemes:@[themes.lastObject]];
-    }
-    
-    NSString* superStyle = [currentThemeStyle valueForKey:SUPERSTYLE_KEY];
-    if(superStyle.length > 0)
+    NSMutableArray<SDThemeLayerFootprint*>* footprints = [NSMutableArray new];
+    for (NSDictionary* theme in self.themes)
     {
-        // try superstyle on current theme
-        NSString* superstyleKeypath = [NSString stringWithFormat:@"%@.%@", STYLES_KEY, superStyle];
-        if(superstyleKeypath.length > 0)
+        SDThemeLayer* layer = [SDThemeLayer layerOfDictionary:theme];
+        if (layer)
         {
-            [self mergedStyleDictionary:styleDictionary forKeypath:superstyleKeypath insideThemes:themes];
+            [footprints addObject:layer.footprint];
         }
-        else
+    }
+    return footprints;
+}
+
+- (NSUInteger) themeStringTableMemoryFootprint
+{
+    return [SDThemeStringTable sharedTable].memoryFootprint;
+}
+
+#pragma mark Tracing utils
+
+// the resolver records the resolutions and the reads, so the tracer and the usage log are its own
+
+- (SDThemeTracer*) tracer
+{
+    return self.resolver.tracer;
+}
+
+- (void) setTracer:(SDThemeTracer*)tracer
+{
+    self.resolver.tracer = tracer;
+}
+
+- (SDThemeUsageLog*) usageLog
+{
+    return self.resolver.usageLog;
+}
+
+- (void) setUsageLog:(SDThemeUsageLog*)usageLog
+{
+    self.resolver.usageLog = usageLog;
+}
+
+#pragma mark Hot reload utils
+
+- (NSString*) defaultThemePath
+{
+    return [[NSBundle mainBundle] pathForResource:THEME_DEFAULT_PLIST_NAME ofType:@"plist"];
+}
+
+/**
+ * @return the paths of the files of all the layers that can be reloaded, in priority order.
+ */
+- (NSArray<NSString*>*) themeFilePaths
+{
+    NSMutableArray<NSString*>* paths = [NSMutableArray new];
+    if (self.pathForDynamicTheme)
+    {
+        [paths addObject:self.pathForDynamicTheme];
+    }
+    [paths addObjectsFromArray:self.alternativeThemePaths ?: @[]];
+    if ([self defaultThemePath])
+    {
+        [paths addObject:[self defaultThemePath]];
+    }
+    return paths;
+}
+
+/**
+ * @return the theme currently used for the file at the given path, or nil.
+ */
+- (NSDictionary*) loadedThemeForPath:(NSString*)path
+{
+    if ([path isEqualToString:self.pathForDynamicTheme])
+    {
+        return (_dynamicTheme && [self.themes indexOfObjectIdenticalTo:_dynamicTheme] != NSNotFound) ? _dynamicTheme : nil;
+    }
+    if ([path isEqualToString:[self defaultThemePath]])
+    {
+        return self.defaultTheme;
+    }
+    return self.alternativeThemesByPath[path];
+}
+
+- (void) recordStyle:(NSString*)styleName appliedToObject:(NSObject*)object
+{
+    NSMutableOrderedSet<NSString*>* styles = [self.appliedStyles objectForKey:object];
+    if (!styles)
+    {
+        styles = [NSMutableOrderedSet new];
+        [self.appliedStyles setObject:styles forKey:object];
+    }
+    // the last application wins over the previous ones
+    [styles removeObject:styleName];
+    [styles addObject:styleName];
+}
+
+/**
+ * Applies again the given styles to the objects they have been applied to. The styles applied to an object after an affected one are applied again too, to keep their priority.
+ */
+- (void) reapplyStyles:(NSSet<NSString*>*)styles
+{
+    if (styles.count == 0 || self.appliedStyles.count == 0)
+    {
+        return;
+    }
+    
+    NSArray<NSObject*>* objects = self.appliedStyles.keyEnumerator.allObjects;
+    [self performApplyWithOptions:SDThemeApplyOptionTransaction usingBlock:^{
+        for (NSObject* object in objects)
         {
-            // if not exist goes back to previous themes
-            if(themes.count > 1)
+            NSArray<NSString*>* objectStyles = [[self.appliedStyles objectForKey:object] array];
+            NSUInteger firstAffectedIndex = [objectStyles indexOfObjectPassingTest:^BOOL(NSString* styleName, NSUInteger idx, BOOL* stop) {
+                return [self isStyle:styleName affectedByStyles:styles];
+            }];
+            
+            for (NSUInteger i = firstAffectedIndex; i < objectStyles.count; i++)
             {
-                NSMutableArray* remainingThemes = themes.mutableCopy;
-                [remainingThemes removeObjectAtIndex:0];
-                [self mergedStyleDictionary:styleDictionary forKeypath:superstyleKeypath insideThemes:remainingThemes];
+                [self applyStyleWithName:objectStyles[i] toObject:object];
             }
         }
+    }];
+}
+
+/**
+ * @return YES if the style, or one of its current variants, is among the given styles.
+ */
+- (BOOL) isStyle:(NSString*)styleName affectedByStyles:(NSSet<NSString*>*)styles
+{
+    if ([styles containsObject:styleName])
+    {
+        return YES;
     }
-    
-    // set all keys (expect _inherit and _superstyle)
-    NSMutableArray<NSString*>* keyToSet = currentThemeStyle.allKeys.mutableCopy;
-    [keyToSet removeObjectsInArray:@[INHERIT_FROM_DEFAULT_THEME, SUPERSTYLE_KEY]];
-    for(NSString* key in keyToSet)
+    for (NSString* variantStyleName in [self.variantIndex variantStyleNamesForStyle:styleName])
     {
-        id value = currentThemeStyle[key];
-        [styleDictionary setValue:value forKey:key];
+        if ([styles containsObject:variantStyleName])
+        {
+            return YES;
+        }
     }
+    return NO;
 }
-    
-
 
 #pragma mark Dynamic behaviour
 
@@ -1141,7 +2237,13 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
     }
     
     NSString* constantPath = [NSString stringWithFormat:@"%@.%@", CONSTANTS_KEY, constant];
-    [self setDynamicValue:value forKeyPath:constantPath intoDictionary:self.dynamicTheme];
+    [self performThemeMutation:^{
+        [self setDynamicValue:value forKeyPath:constantPath intoDictionary:self.dynamicTheme];
+        [self themesDidChange];
+        
+        // expressions may depend on the modified constant
+        [self resolveConstantExpressions];
+    }];
 }
 
 
@@ -1160,7 +2262,15 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
     }
     
     NSString* globalPath = [NSString stringWithFormat:@"%@.%@.%@", STYLES_KEY, style, keyPath];
-    [self setDynamicValue:value forKeyPath:globalPath intoDictionary:self.dynamicTheme];
+    [self performThemeMutation:^{
+        [self setDynamicValue:value forKeyPath:globalPath intoDictionary:self.dynamicTheme];
+        [self themesDidChange];
+        // the style may be a new variant declared at runtime
+        if ([keyPath isEqualToString:VARIANT_OF_KEY] && [value isKindOfClass:[NSString class]])
+        {
+            [self.variantIndex addVariantStyleName:style ofStyle:value];
+        }
+    }];
 }
 
 - (id) modifiedValuesForConstant:(NSString*)constant
@@ -1275,7 +2385,10 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
     
     NSString* globalPath = [NSString stringWithFormat:@"%@.%@.%@", STYLES_KEY, style, INHERIT_FROM_DEFAULT_THEME];
     NSString* inheritanceValue = inheritanceEnable ? style : nil;
-    [self setDynamicValue:inheritanceValue forKeyPath:globalPath intoDictionary:self.dynamicTheme];
+    [self performThemeMutation:^{
+        [self setDynamicValue:inheritanceValue forKeyPath:globalPath intoDictionary:self.dynamicTheme];
+        [self themesDidChange];
+    }];
 }
 
 - (BOOL) isInheritanceEnabledForStyle:(NSString*)style
@@ -1297,8 +2410,15 @@ void SDThemeManagerApplyStyle (NSString* key, NSObject* object){
 
 - (void)resetModifies
 {
-    [self.dynamicTheme removeAllObjects];
-    [self.dynamicTheme setValue:@2 forKey:@"formatVersion"];
+    // like setThemes:, the variant index changes with the themes
+    [self performThemeMutation:^{
+        NSMutableDictionary* dynamicTheme = self.dynamicTheme;
+        [dynamicTheme removeAllObjects];
+        [dynamicTheme setValue:@2 forKey:@"formatVersion"];
+        [self themesDidChange];
+        [self resolveConstantExpressions];
+        [self rebuildVariantIndex];
+    }];
 }
 
 
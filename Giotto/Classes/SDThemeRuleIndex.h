@@ -0,0 +1,41 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+/**
+ * Index of the style rules of the themes. A rule associates a selector to one or more styles, that are applied to every view matching the selector.
+ *
+ * A selector is a list of compound selectors separated by spaces, each one qualifying a descendant of the previous one (eg. "UITableViewCell UILabel.title"). A compound selector is made of an optional class name (matching its subclasses too) or "*", followed by any number of ".<style class>" (see themeStyleClass of UIView) and "#<accessibility identifier>".
+ *
+ * Rules are indexed by the last compound selector: by accessibility identifier, style class or class name. Each view checks only the rules of its identifier, of its style classes and of its class hierarchy.
+ * The styles of the rules matching a view are applied in order of specificity (identifiers, then style classes, then class names, like CSS), and in selector order when equal.
+ */
+@interface SDThemeRuleIndex : NSObject
+
+/**
+ * Compiles the given rules.
+ *
+ * @param rules the style names, as a string (comma separated names) or an array, by selector
+ */
+- (instancetype) initWithRules:(NSDictionary<NSString*, id>*)rules;
+
+@property (nonatomic, assign, readonly) NSUInteger ruleCount;
+
+/**
+ * @return the names of the styles of the rules matching the given view, in application order.
+ */
+- (NSArray<NSString*>*) styleNamesForView:(UIView*)view;
+
+@end
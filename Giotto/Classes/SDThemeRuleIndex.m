@@ -0,0 +1,341 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeRuleIndex.h"
+#import "UIView+ThemeManager.h"
+#import "SDThemeLogger.h"
+
+#define UNIVERSAL_SELECTOR @"*"
+
+@interface SDThemeSelectorPart : NSObject
+
+@property (nonatomic, copy) NSString* className;
+// Nil if the class name is not given, or if it is not a class of the app (the part never matches)
+@property (nonatomic, assign) Class partClass;
+@property (nonatomic, copy) NSString* identifier;
+@property (nonatomic, copy) NSArray<NSString*>* styleClasses;
+
+@end
+
+@implementation SDThemeSelectorPart
+
+- (BOOL) matchesView:(UIView*)view
+{
+    if (self.className && (!self.partClass || ![view isKindOfClass:self.partClass]))
+    {
+        return NO;
+    }
+    if (self.identifier && ![self.identifier isEqualToString:view.accessibilityIdentifier])
+    {
+        return NO;
+    }
+    if (self.styleClasses.count > 0)
+    {
+        NSArray<NSString*>* viewStyleClasses = view.themeStyleClasses;
+        for (NSString* styleClass in self.styleClasses)
+        {
+            if (![viewStyleClasses containsObject:styleClass])
+            {
+                return NO;
+            }
+        }
+    }
+    return YES;
+}
+
+@end
+
+
+@interface SDThemeRule : NSObject
+
+@property (nonatomic, copy) NSString* selector;
+// compound selectors, from the outermost ancestor to the view
+@property (nonatomic, copy) NSArray<SDThemeSelectorPart*>* parts;
+@property (nonatomic, copy) NSArray<NSString*>* styleNames;
+@property (nonatomic, assign) NSUInteger specificity;
+
+@end
+
+@implementation SDThemeRule
+
+- (BOOL) matchesView:(UIView*)view
+{
+    if (![self.parts.lastObject matchesView:view])
+    {
+        return NO;
+    }
+    // each qualifier must match an ancestor of the view matched by the following one
+    UIView* ancestor = view.superview;
+    for (NSInteger i = (NSInteger)self.parts.count - 2; i >= 0; i--)
+    {
+        while (ancestor && ![self.parts[i] matchesView:ancestor])
+        {
+            ancestor = ancestor.superview;
+        }
+        if (!ancestor)
+        {
+            return NO;
+        }
+        ancestor = ancestor.superview;
+    }
+    return YES;
+}
+
+@end
+
+
+@interface SDThemeRuleIndex ()
+
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableArray<SDThemeRule*>*>* rulesByIdentifier;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableArray<SDThemeRule*>*>* rulesByStyleClass;
+@property (nonatomic, strong) NSMutableDictionary<NSString*, NSMutableArray<SDThemeRule*>*>* rulesByClassName;
+@property (nonatomic, strong) NSMutableArray<SDThemeRule*>* universalRules;
+// rules of each class and of its superclasses
+@property (nonatomic, strong) NSMapTable<Class, NSArray<SDThemeRule*>*>* rulesByClass;
+@property (nonatomic, assign) NSUInteger ruleCount;
+
+@end
+
+@implementation SDThemeRuleIndex
+
+- (instancetype) initWithRules:(NSDictionary<NSString*, id>*)rules
+{
+    self = [super init];
+    if (self)
+    {
+        self.rulesByIdentifier = [NSMutableDictionary new];
+        self.rulesByStyleClass = [NSMutableDictionary new];
+        self.rulesByClassName = [NSMutableDictionary new];
+        self.universalRules = [NSMutableArray new];
+        self.rulesByClass = [NSMapTable strongToStrongObjectsMapTable];
+        
+        // sorted, so that rules with the same specificity are applied in a stable order
+        for (NSString* selector in [rules.allKeys sortedArrayUsingSelector:@selector(compare:)])
+        {
+            SDThemeRule* rule = [self ruleWithSelector:selector styles:rules[selector]];
+            if (rule)
+            {
+                [self addRule:rule];
+            }
+        }
+    }
+    return self;
+}
+
+#pragma mark Compilation
+
+- (SDThemeRule*) ruleWithSelector:(NSString*)selector styles:(id)styles
+{
+    NSMutableArray<NSString*>* styleNames = [NSMutableArray new];
+    NSArray* names = [styles isKindOfClass:[NSArray class]] ? styles : ([styles isKindOfClass:[NSString class]] ? [styles componentsSeparatedByString:@","] : nil);
+    for (id name in names)
+    {
+        if ([name isKindOfClass:[NSString class]])
+        {
+            NSString* styleName = [name stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+            if (styleName.length > 0)
+            {
+                [styleNames addObject:styleName];
+            }
+        }
+    }
+    if (styleNames.count == 0)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Rule '%@' has no styles", selector);
+        return nil;
+    }
+    
+    NSMutableArray<SDThemeSelectorPart*>* parts = [NSMutableArray new];
+    NSUInteger specificity = 0;
+    for (NSString* component in [selector componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]])
+    {
+        if (component.length == 0)
+        {
+            continue;
+        }
+        SDThemeSelectorPart* part = [self partWithString:component];
+        if (!part)
+        {
+            SDLogModuleError(kThemeManagerLogModuleName, @"Invalid selector '%@' in rules", selector);
+            return nil;
+        }
+        specificity += (part.identifier ? 10000 : 0) + part.styleClasses.count * 100 + (part.className ? 1 : 0);
+        [parts addObject:part];
+    }
+    if (parts.count == 0)
+    {
+        SDLogModuleError(kThemeManagerLogModuleName, @"Empty selector in rules");
+        return nil;
+    }
+    
+    SDThemeRule* rule = [SDThemeRule new];
+    rule.selector = selector;
+    rule.parts = parts;
+    rule.styleNames = styleNames;
+    rule.specificity = specificity;
+    return rule;
+}
+
+/**
+ * Parses a compound selector: [<class name>|*](.<style class>|#<identifier>)*
+ */
+- (SDThemeSelectorPart*) partWithString:(NSString*)string
+{
+    SDThemeSelectorPart* part = [SDThemeSelectorPart new];
+    NSMutableArray<NSString*>* styleClasses = [NSMutableArray new];
+    NSCharacterSet* separators = [NSCharacterSet characterSetWithCharactersInString:@".#"];
+    NSScanner* scanner = [NSScanner scannerWithString:string];
+    scanner.charactersToBeSkipped = nil;
+    
+    NSString* className = nil;
+    if (![scanner scanString:UNIVERSAL_SELECTOR intoString:NULL] && [scanner scanUpToCharactersFromSet:separators intoString:&className])
+    {
+        part.className = className;
+        part.partClass = NSClassFromString(className);
+        if (!part.partClass)
+        {
+            SDLogModuleWarning(kThemeManagerLogModuleName, @"Unknown class %@ in rules", className);
+        }
+    }
+    while (!scanner.isAtEnd)
+    {
+        BOOL isIdentifier = [scanner scanString:@"#" intoString:NULL];
+        if (!isIdentifier && ![scanner scanString:@"." intoString:NULL])
+        {
+            return nil;
+        }
+        NSString* name = nil;
+        if (![scanner scanUpToCharactersFromSet:separators intoString:&name])
+        {
+            return nil;
+        }
+        if (isIdentifier)
+        {
+            part.identifier = name;
+        }
+        else
+        {
+            [styleClasses addObject:name];
+        }
+    }
+    part.styleClasses = styleClasses;
+    return part;
+}
+
+- (void) addRule:(SDThemeRule*)rule
+{
+    SDThemeSelectorPart* keyPart = rule.parts.lastObject;
+    if (keyPart.identifier)
+    {
+        [self addRule:rule forKey:keyPart.identifier toDictionary:self.rulesByIdentifier];
+    }
+    else if (keyPart.styleClasses.count > 0)
+    {
+        // a view having all the style classes of the part has the first one too
+        [self addRule:rule forKey:keyPart.styleClasses.firstObject toDictionary:self.rulesByStyleClass];
+    }
+    else if (keyPart.className)
+    {
+        [self addRule:rule forKey:keyPart.className toDictionary:self.rulesByClassName];
+    }
+    else
+    {
+        [self.universalRules addObject:rule];
+    }
+    self.ruleCount++;
+}
+
+- (void) addRule:(SDThemeRule*)rule forKey:(NSString*)key toDictionary:(NSMutableDictionary<NSString*, NSMutableArray<SDThemeRule*>*>*)dictionary
+{
+    NSMutableArray<SDThemeRule*>* rules = dictionary[key];
+    if (!rules)
+    {
+        rules = [NSMutableArray new];
+        dictionary[key] = rules;
+    }
+    [rules addObject:rule];
+}
+
+#pragma mark Matching
+
+- (NSArray<NSString*>*) styleNamesForView:(UIView*)view
+{
+    if (self.ruleCount == 0 || !view)
+    {
+        return @[];
+    }
+    
+    NSMutableArray<SDThemeRule*>* matchingRules = [NSMutableArray new];
+    void (^match)(NSArray<SDThemeRule*>*) = ^(NSArray<SDThemeRule*>* candidates) {
+        for (SDThemeRule* rule in candidates)
+        {
+            if ([rule matchesView:view])
+            {
+                [matchingRules addObject:rule];
+            }
+        }
+    };
+    
+    // every rule is in a single bucket, so no rule is matched twice
+    if (view.accessibilityIdentifier)
+    {
+        match(self.rulesByIdentifier[view.accessibilityIdentifier]);
+    }
+    for (NSString* styleClass in view.themeStyleClasses)
+    {
+        match(self.rulesByStyleClass[styleClass]);
+    }
+    match([self rulesForClass:[view class]]);
+    match(self.universalRules);
+    
+    if (matchingRules.count == 0)
+    {
+        return @[];
+    }
+    [matchingRules sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(SDThemeRule* rule1, SDThemeRule* rule2) {
+        if (rule1.specificity != rule2.specificity)
+        {
+            return rule1.specificity < rule2.specificity ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return [rule1.selector compare:rule2.selector];
+    }];
+    
+    NSMutableArray<NSString*>* styleNames = [NSMutableArray new];
+    for (SDThemeRule* rule in matchingRules)
+    {
+        [styleNames addObjectsFromArray:rule.styleNames];
+    }
+    return styleNames;
+}
+
+/**
+ * @return the rules keyed by the name of the given class or of one of its superclasses, computed once for each class.
+ */
+- (NSArray<SDThemeRule*>*) rulesForClass:(Class)class
+{
+    NSArray<SDThemeRule*>* rules = [self.rulesByClass objectForKey:class];
+    if (!rules)
+    {
+        NSMutableArray<SDThemeRule*>* classRules = [NSMutableArray new];
+        for (Class currentClass = class; currentClass; currentClass = [currentClass superclass])
+        {
+            [classRules addObjectsFromArray:self.rulesByClassName[NSStringFromClass(currentClass)] ?: @[]];
+        }
+        rules = classRules;
+        [self.rulesByClass setObject:rules forKey:class];
+    }
+    return rules;
+}
+
+@end
@@ -0,0 +1,45 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/**
+ * The last values written by the theme manager to the keyPaths of an object, attached to the object itself.
+ * Values are compared by identity and then, only for value-like classes (strings, numbers, values, colors, fonts), with isEqual:; other objects (eg. images) are compared by identity only, because their equality can be expensive.
+ */
+@interface SDThemeShadowState : NSObject
+
+/**
+ * @param object the styled object
+ * @param create YES to attach a new state if the object has none
+ *
+ * @return the state of the object, or nil
+ */
++ (instancetype) shadowStateOfObject:(NSObject*)object create:(BOOL)create;
+
+/**
+ * Detaches the state from the object.
+ */
++ (void) removeShadowStateOfObject:(NSObject*)object;
+
+/**
+ * @return YES if the last value written to the keyPath is the given one.
+ */
+- (BOOL) containsValue:(id)value forKeyPath:(NSString*)keyPath;
+
+- (void) recordValue:(id)value forKeyPath:(NSString*)keyPath;
+
+- (void) removeValueForKeyPath:(NSString*)keyPath;
+
+@end
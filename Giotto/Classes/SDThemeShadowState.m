@@ -0,0 +1,106 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeShadowState.h"
+#import <UIKit/UIKit.h>
+#import <objc/runtime.h>
+
+static char SDThemeShadowStateKey;
+
+static BOOL SDThemeShadowValuesEqual(id value1, id value2)
+{
+    if (value1 == value2)
+    {
+        return YES;
+    }
+    if (!value1 || !value2 || [value1 class] != [value2 class])
+    {
+        return NO;
+    }
+    // cheap equality only: comparing images or arbitrary objects could cost more than the write
+    if ([value1 isKindOfClass:[NSString class]] || [value1 isKindOfClass:[NSValue class]] || [value1 isKindOfClass:[UIColor class]] || [value1 isKindOfClass:[UIFont class]])
+    {
+        return [value1 isEqual:value2];
+    }
+    return NO;
+}
+
+@interface SDThemeShadowState ()
+
+@property (nonatomic, strong) NSMutableDictionary<NSString*, id>* values;
+
+@end
+
+@implementation SDThemeShadowState
+
++ (instancetype) shadowStateOfObject:(NSObject*)object create:(BOOL)create
+{
+    if (!object)
+    {
+        return nil;
+    }
+    SDThemeShadowState* state = objc_getAssociatedObject(object, &SDThemeShadowStateKey);
+    if (!state && create)
+    {
+        state = [SDThemeShadowState new];
+        objc_setAssociatedObject(object, &SDThemeShadowStateKey, state, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return state;
+}
+
++ (void) removeShadowStateOfObject:(NSObject*)object
+{
+    if (object)
+    {
+        objc_setAssociatedObject(object, &SDThemeShadowStateKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+}
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.values = [NSMutableDictionary dictionaryWithCapacity:4];
+    }
+    return self;
+}
+
+- (BOOL) containsValue:(id)value forKeyPath:(NSString*)keyPath
+{
+    id storedValue = self.values[keyPath];
+    if (!storedValue)
+    {
+        return NO;
+    }
+    return SDThemeShadowValuesEqual(storedValue == [NSNull null] ? nil : storedValue, value);
+}
+
+- (void) recordValue:(id)value forKeyPath:(NSString*)keyPath
+{
+    if (keyPath)
+    {
+        self.values[keyPath] = value ?: [NSNull null];
+    }
+}
+
+- (void) removeValueForKeyPath:(NSString*)keyPath
+{
+    if (keyPath)
+    {
+        [self.values removeObjectForKey:keyPath];
+    }
+}
+
+@end
@@ -0,0 +1,54 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+
+// keys of a style that only affect the text attributes (there is no UILabel property for them)
+extern NSString* const SDThemeTextKeyKern;
+extern NSString* const SDThemeTextKeyLineHeight;
+extern NSString* const SDThemeTextKeyLineSpacing;
+extern NSString* const SDThemeTextKeyParagraphSpacing;
+
+/**
+ * Builds the attributes of an NSAttributedString from the values of a style: font, textColor, textAlignment, lineBreakMode and the text keys (kern, lineHeight, lineSpacing, paragraphSpacing).
+ */
+@interface SDThemeTextAttributes : NSObject
+
+/**
+ * @return YES if the keyPath is one of the text keys, that are not properties of the labels.
+ */
++ (BOOL) isTextKey:(NSString*)keyPath;
+
+/**
+ * Returns the attributes for the given values of a style. Values of other keys are ignored.
+ *
+ * @param values the values by keyPath
+ *
+ * @return an immutable dictionary of attributes, with an immutable paragraph style if any paragraph setting is given
+ */
++ (NSDictionary<NSAttributedStringKey, id>*) attributesWithValues:(NSDictionary<NSString*, id>*)values;
+
+@end
+
+
+/**
+ * Thread safe cache of the text attributes of the styles. An entry is valid for the generation of the themes and the variants it was built with.
+ */
+@interface SDThemeTextAttributesCache : NSObject
+
+- (NSDictionary<NSAttributedStringKey, id>*) attributesForStyleName:(NSString*)styleName generation:(NSUInteger)generation variantStyleNames:(NSArray<NSString*>*)variantStyleNames;
+
+- (void) setAttributes:(NSDictionary<NSAttributedStringKey, id>*)attributes forStyleName:(NSString*)styleName generation:(NSUInteger)generation variantStyleNames:(NSArray<NSString*>*)variantStyleNames;
+
+@end
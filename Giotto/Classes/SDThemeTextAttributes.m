@@ -0,0 +1,142 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeTextAttributes.h"
+
+NSString* const SDThemeTextKeyKern = @"kern";
+NSString* const SDThemeTextKeyLineHeight = @"lineHeight";
+NSString* const SDThemeTextKeyLineSpacing = @"lineSpacing";
+NSString* const SDThemeTextKeyParagraphSpacing = @"paragraphSpacing";
+
+@implementation SDThemeTextAttributes
+
++ (BOOL) isTextKey:(NSString*)keyPath
+{
+    return [keyPath isEqualToString:SDThemeTextKeyKern] ||
+           [keyPath isEqualToString:SDThemeTextKeyLineHeight] ||
+           [keyPath isEqualToString:SDThemeTextKeyLineSpacing] ||
+           [keyPath isEqualToString:SDThemeTextKeyParagraphSpacing];
+}
+
++ (NSDictionary<NSAttributedStringKey, id>*) attributesWithValues:(NSDictionary<NSString*, id>*)values
+{
+    NSMutableDictionary<NSAttributedStringKey, id>* attributes = [NSMutableDictionary new];
+    if ([values[@"font"] isKindOfClass:[UIFont class]])
+    {
+        attributes[NSFontAttributeName] = values[@"font"];
+    }
+    if ([values[@"textColor"] isKindOfClass:[UIColor class]])
+    {
+        attributes[NSForegroundColorAttributeName] = values[@"textColor"];
+    }
+    if ([values[SDThemeTextKeyKern] isKindOfClass:[NSNumber class]])
+    {
+        attributes[NSKernAttributeName] = values[SDThemeTextKeyKern];
+    }
+    
+    NSMutableParagraphStyle* paragraphStyle = [NSMutableParagraphStyle new];
+    BOOL hasParagraphStyle = NO;
+    if ([values[@"textAlignment"] isKindOfClass:[NSNumber class]])
+    {
+        paragraphStyle.alignment = (NSTextAlignment)[values[@"textAlignment"] integerValue];
+        hasParagraphStyle = YES;
+    }
+    if ([values[@"lineBreakMode"] isKindOfClass:[NSNumber class]])
+    {
+        paragraphStyle.lineBreakMode = (NSLineBreakMode)[values[@"lineBreakMode"] integerValue];
+        hasParagraphStyle = YES;
+    }
+    if ([values[SDThemeTextKeyLineHeight] isKindOfClass:[NSNumber class]])
+    {
+        CGFloat lineHeight = [values[SDThemeTextKeyLineHeight] doubleValue];
+        paragraphStyle.minimumLineHeight = lineHeight;
+        paragraphStyle.maximumLineHeight = lineHeight;
+        hasParagraphStyle = YES;
+    }
+    if ([values[SDThemeTextKeyLineSpacing] isKindOfClass:[NSNumber class]])
+    {
+        paragraphStyle.lineSpacing = [values[SDThemeTextKeyLineSpacing] doubleValue];
+        hasParagraphStyle = YES;
+    }
+    if ([values[SDThemeTextKeyParagraphSpacing] isKindOfClass:[NSNumber class]])
+    {
+        paragraphStyle.paragraphSpacing = [values[SDThemeTextKeyParagraphSpacing] doubleValue];
+        hasParagraphStyle = YES;
+    }
+    if (hasParagraphStyle)
+    {
+        attributes[NSParagraphStyleAttributeName] = [paragraphStyle copy];
+    }
+    return [attributes copy];
+}
+
+@end
+
+
+@interface SDThemeTextAttributesEntry : NSObject
+
+@property (nonatomic, assign) NSUInteger generation;
+@property (nonatomic, copy) NSArray<NSString*>* variantStyleNames;
+@property (nonatomic, copy) NSDictionary<NSAttributedStringKey, id>* attributes;
+
+@end
+
+@implementation SDThemeTextAttributesEntry
+@end
+
+
+@interface SDThemeTextAttributesCache ()
+
+// NSCache is thread safe
+@property (nonatomic, strong) NSCache<NSString*, SDThemeTextAttributesEntry*>* entries;
+
+@end
+
+@implementation SDThemeTextAttributesCache
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        self.entries = [NSCache new];
+        self.entries.name = @"it.sysdata.giotto.textattributes";
+    }
+    return self;
+}
+
+- (NSDictionary<NSAttributedStringKey, id>*) attributesForStyleName:(NSString*)styleName generation:(NSUInteger)generation variantStyleNames:(NSArray<NSString*>*)variantStyleNames
+{
+    SDThemeTextAttributesEntry* entry = styleName ? [self.entries objectForKey:styleName] : nil;
+    if (entry && entry.generation == generation && [entry.variantStyleNames isEqualToArray:variantStyleNames ?: @[]])
+    {
+        return entry.attributes;
+    }
+    return nil;
+}
+
+- (void) setAttributes:(NSDictionary<NSAttributedStringKey, id>*)attributes forStyleName:(NSString*)styleName generation:(NSUInteger)generation variantStyleNames:(NSArray<NSString*>*)variantStyleNames
+{
+    if (!styleName || !attributes)
+    {
+        return;
+    }
+    SDThemeTextAttributesEntry* entry = [SDThemeTextAttributesEntry new];
+    entry.generation = generation;
+    entry.variantStyleNames = variantStyleNames ?: @[];
+    entry.attributes = attributes;
+    [self.entries setObject:entry forKey:styleName];
+}
+
+@end
@@ -0,0 +1,60 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+extern NSString* const SDThemeTypeValidationErrorDomain;
+
+typedef NS_ENUM(NSInteger, SDThemeTypeValidationError) {
+    SDThemeTypeValidationErrorMismatch = 1,
+};
+
+/**
+ * Checks that the values written by the styles match the type of the properties they set.
+ *
+ * The types are read from the declared properties of the classes, so a check does not need an instance and its result depends only on the class of the object, the keyPath and the class of the value: each combination is checked once.
+ * An instance must be used by a single thread.
+ */
+@interface SDThemeTypeValidator : NSObject
+
+/**
+ * Marks a combination as validated.
+ *
+ * @return YES the first time the combination is passed, NO if it has already been validated.
+ */
+- (BOOL) shouldValidateKeyPath:(NSString*)keyPath ofClass:(Class)objectClass valueClass:(Class)valueClass;
+
+/**
+ * Forgets the combinations validated so far.
+ */
+- (void) reset;
+
+/**
+ * Checks a value against the declared type of the property at a keyPath.
+ *
+ * @param value the value, nil is compatible with every property
+ * @param keyPath the keyPath, relative to objectClass
+ * @param objectClass the class of the object the value is written to
+ * @param known set to NO if the type of the property cannot be found (eg. a keyPath handled by a category), in which case the method returns nil
+ *
+ * @return a description of the expected type if the value does not match it, otherwise nil
+ */
++ (NSString*) mismatchOfValue:(id)value forKeyPath:(NSString*)keyPath ofClass:(Class)objectClass known:(BOOL*)known;
+
+/**
+ * @return the declared class of the object property at a keyPath, or Nil if it cannot be found.
+ */
++ (Class) classOfKeyPath:(NSString*)keyPath ofClass:(Class)objectClass;
+
+@end
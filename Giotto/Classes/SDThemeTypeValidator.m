@@ -0,0 +1,171 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeTypeValidator.h"
+#import <UIKit/UIKit.h>
+#import <objc/runtime.h>
+
+NSString* const SDThemeTypeValidationErrorDomain = @"SDThemeTypeValidationErrorDomain";
+
+@interface SDThemeTypeValidator ()
+
+// keyPaths by class of the object, each one with the classes of the values already validated
+@property (nonatomic, strong) NSMapTable<Class, NSMutableDictionary<NSString*, NSHashTable*>*>* validatedKeyPaths;
+
+@end
+
+@implementation SDThemeTypeValidator
+
+- (instancetype) init
+{
+    self = [super init];
+    if (self)
+    {
+        [self reset];
+    }
+    return self;
+}
+
+- (BOOL) shouldValidateKeyPath:(NSString*)keyPath ofClass:(Class)objectClass valueClass:(Class)valueClass
+{
+    if (!keyPath || !objectClass)
+    {
+        return NO;
+    }
+    
+    NSMutableDictionary<NSString*, NSHashTable*>* keyPaths = [self.validatedKeyPaths objectForKey:objectClass];
+    if (!keyPaths)
+    {
+        keyPaths = [NSMutableDictionary new];
+        [self.validatedKeyPaths setObject:keyPaths forKey:objectClass];
+    }
+    NSHashTable* valueClasses = keyPaths[keyPath];
+    if (!valueClasses)
+    {
+        valueClasses = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality capacity:1];
+        keyPaths[keyPath] = valueClasses;
+    }
+    
+    // nil values are recorded with the class of NSNull
+    Class recordedClass = valueClass ?: [NSNull class];
+    if ([valueClasses containsObject:recordedClass])
+    {
+        return NO;
+    }
+    [valueClasses addObject:recordedClass];
+    return YES;
+}
+
+- (void) reset
+{
+    // classes are never deallocated, they are compared by pointer
+    self.validatedKeyPaths = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                                       valueOptions:NSPointerFunctionsStrongMemory
+                                                           capacity:0];
+}
+
+#pragma mark - Types
+
+/**
+ * @return the type encoding of a declared property, or nil.
+ */
++ (NSString*) typeEncodingOfProperty:(NSString*)name ofClass:(Class)objectClass
+{
+    objc_property_t property = class_getProperty(objectClass, name.UTF8String);
+    if (!property)
+    {
+        return nil;
+    }
+    char* type = property_copyAttributeValue(property, "T");
+    NSString* typeEncoding = type ? [NSString stringWithUTF8String:type] : nil;
+    free(type);
+    return typeEncoding;
+}
+
+/**
+ * @return the class of an object type encoding (eg. @"UIColor"), or Nil for id, protocols and unknown classes.
+ */
++ (Class) classOfTypeEncoding:(NSString*)typeEncoding
+{
+    if (![typeEncoding hasPrefix:@"@\""] || typeEncoding.length < 4)
+    {
+        return Nil;
+    }
+    NSString* className = [typeEncoding substringWithRange:NSMakeRange(2, typeEncoding.length - 3)];
+    NSRange protocols = [className rangeOfString:@"<"];
+    if (protocols.location != NSNotFound)
+    {
+        className = [className substringToIndex:protocols.location];
+    }
+    return className.length > 0 ? NSClassFromString(className) : Nil;
+}
+
++ (Class) classOfKeyPath:(NSString*)keyPath ofClass:(Class)objectClass
+{
+    Class currentClass = objectClass;
+    for (NSString* key in [keyPath componentsSeparatedByString:@"."])
+    {
+        currentClass = currentClass ? [self classOfTypeEncoding:[self typeEncodingOfProperty:key ofClass:currentClass]] : Nil;
+    }
+    return currentClass;
+}
+
++ (NSString*) mismatchOfValue:(id)value forKeyPath:(NSString*)keyPath ofClass:(Class)objectClass known:(BOOL*)known
+{
+    *known = NO;
+    NSRange lastDot = [keyPath rangeOfString:@"." options:NSBackwardsSearch];
+    Class ownerClass = lastDot.location == NSNotFound ? objectClass : [self classOfKeyPath:[keyPath substringToIndex:lastDot.location] ofClass:objectClass];
+    NSString* key = lastDot.location == NSNotFound ? keyPath : [keyPath substringFromIndex:lastDot.location + 1];
+    NSString* typeEncoding = ownerClass ? [self typeEncodingOfProperty:key ofClass:ownerClass] : nil;
+    if (typeEncoding.length == 0)
+    {
+        return nil;
+    }
+    *known = YES;
+    if (!value)
+    {
+        return nil;
+    }
+    
+    unichar type = [typeEncoding characterAtIndex:0];
+    if (type == '@')
+    {
+        Class propertyClass = [self classOfTypeEncoding:typeEncoding];
+        return (!propertyClass || [value isKindOfClass:propertyClass]) ? nil : NSStringFromClass(propertyClass);
+    }
+    if ([typeEncoding hasPrefix:@"^{CGColor="])
+    {
+        // converted by CALayer+ThemeManager
+        return [value isKindOfClass:[UIColor class]] ? nil : @"UIColor";
+    }
+    if (strchr("cCsSiIlLqQfdB", type) != NULL)
+    {
+        return [value isKindOfClass:[NSNumber class]] ? nil : @"NSNumber";
+    }
+    if (type == '{')
+    {
+        NSRange equal = [typeEncoding rangeOfString:@"="];
+        NSString* structName = [typeEncoding substringWithRange:NSMakeRange(1, (equal.location == NSNotFound ? typeEncoding.length - 1 : equal.location) - 1)];
+        if ([value isKindOfClass:[NSValue class]] && ![value isKindOfClass:[NSNumber class]] && [@([value objCType]) hasPrefix:[NSString stringWithFormat:@"{%@=", structName]])
+        {
+            return nil;
+        }
+        return structName;
+    }
+    // other types (pointers, selectors...) are not checked
+    *known = NO;
+    return nil;
+}
+
+@end
@@ -0,0 +1,59 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <UIKit/UIKit.h>
+#import "SDThemeValue.h"
+
+/**
+ * UIKit objects of the platform independent values of the engine.
+ */
+
+/**
+ * @return the UIKit object of a value of the engine (UIColor, UIFont, NSValue or UIImage), or the value itself if it is not a value of the engine.
+ * The object is created once for every value, that the engine shares between the resolutions.
+ */
+extern id SDThemeUIKitObject(id value);
+
+@interface SDThemeColorValue (UIKit)
+
+/**
+ * @return the color of the asset catalog for the named colors (iOS 11 and later), otherwise the color of the components
+ */
+- (UIColor*) UIColor;
+
+@end
+
+@interface SDThemeFontValue (UIKit)
+
+/**
+ * @return the font, or nil if no font has the name
+ */
+- (UIFont*) UIFont;
+
+@end
+
+@interface SDThemeGeometryValue (UIKit)
+
+/**
+ * @return a NSValue of CGPoint, CGSize, CGRect or UIEdgeInsets
+ */
+- (NSValue*) UIValue;
+
+@end
+
+@interface SDThemeBackgroundValue (UIKit)
+
+- (UIImage*) UIImage;
+
+@end
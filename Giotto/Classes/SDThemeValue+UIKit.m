@@ -0,0 +1,124 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SDThemeValue+UIKit.h"
+#import <objc/runtime.h>
+#import "UIImage+Giotto.h"
+
+static const void* const SDThemeUIKitObjectKey = &SDThemeUIKitObjectKey;
+
+id SDThemeUIKitObject(id value)
+{
+    if (![value isKindOfClass:[SDThemeColorValue class]] && ![value isKindOfClass:[SDThemeFontValue class]] && ![value isKindOfClass:[SDThemeGeometryValue class]] && ![value isKindOfClass:[SDThemeBackgroundValue class]])
+    {
+        return value;
+    }
+    id object = objc_getAssociatedObject(value, SDThemeUIKitObjectKey);
+    if (object)
+    {
+        return object == [NSNull null] ? nil : object;
+    }
+    
+    if ([value isKindOfClass:[SDThemeColorValue class]])
+    {
+        object = [value UIColor];
+    }
+    else if ([value isKindOfClass:[SDThemeFontValue class]])
+    {
+        object = [value UIFont];
+    }
+    else if ([value isKindOfClass:[SDThemeGeometryValue class]])
+    {
+        object = [value UIValue];
+    }
+    else
+    {
+        object = [value UIImage];
+    }
+    // values are immutable: two threads converting the same value at once store equal objects
+    objc_setAssociatedObject(value, SDThemeUIKitObjectKey, object ?: [NSNull null], OBJC_ASSOCIATION_RETAIN);
+    return object;
+}
+
+@implementation SDThemeColorValue (UIKit)
+
+- (UIColor*) UIColor
+{
+    if (self.name)
+    {
+        if (@available(iOS 11, *))
+        {
+            UIColor* assetsColor = [UIColor colorNamed:self.name];
+            if (assetsColor)
+            {
+                return assetsColor;
+            }
+        }
+    }
+    return [UIColor colorWithRed:self.red green:self.green blue:self.blue alpha:self.alpha];
+}
+
+@end
+
+
+@implementation SDThemeFontValue (UIKit)
+
+- (UIFont*) UIFont
+{
+    switch (self.kind)
+    {
+        case SDThemeFontKindSystem:
+            return [UIFont systemFontOfSize:self.size];
+        case SDThemeFontKindSystemBold:
+            return [UIFont boldSystemFontOfSize:self.size];
+        case SDThemeFontKindSystemItalic:
+            return [UIFont italicSystemFontOfSize:self.size];
+        case SDThemeFontKindNamed:
+            return [UIFont fontWithName:self.name size:self.size];
+    }
+    return nil;
+}
+
+@end
+
+
+@implementation SDThemeGeometryValue (UIKit)
+
+- (NSValue*) UIValue
+{
+    switch (self.type)
+    {
+        case SDThemeGeometryTypePoint:
+            return [NSValue valueWithCGPoint:CGPointMake([self componentAtIndex:0], [self componentAtIndex:1])];
+        case SDThemeGeometryTypeSize:
+            return [NSValue valueWithCGSize:CGSizeMake([self componentAtIndex:0], [self componentAtIndex:1])];
+        case SDThemeGeometryTypeRect:
+            return [NSValue valueWithCGRect:CGRectMake([self componentAtIndex:0], [self componentAtIndex:1], [self componentAtIndex:2], [self componentAtIndex:3])];
+        case SDThemeGeometryTypeEdgeInsets:
+            return [NSValue valueWithUIEdgeInsets:UIEdgeInsetsMake([self componentAtIndex:0], [self componentAtIndex:1], [self componentAtIndex:2], [self componentAtIndex:3])];
+    }
+    return nil;
+}
+
+@end
+
+
+@implementation SDThemeBackgroundValue (UIKit)
+
+- (UIImage*) UIImage
+{
+    return [UIImage resizableImageWithFillColor:SDThemeUIKitObject(self.fillColor) cornerRadius:self.cornerRadius borderWidth:self.borderWidth borderColor:SDThemeUIKitObject(self.borderColor) tintColor:SDThemeUIKitObject(self.tintColor)];
+}
+
+@end
@@ -15,29 +15,16 @@
 #import "UIButton+ThemeManager.h"
 #import "NSObject+ThemeManager.h"
 #import "UIImage+Giotto.h"
+#import "SDThemeImageCache.h"
+
+#define STATE_BATCH_PREFIX @"state:"
 
 @implementation UIButton (ThemeManager)
 
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
 {
-	NSString* cleanKeyPath = keyPath;
 	UIControlState controlState = UIControlStateNormal;
-
-	if ([keyPath hasPrefix:SELECTED_STATE_PREFIX])
-	{
-		cleanKeyPath = [keyPath substringFromIndex:SELECTED_STATE_PREFIX.length];
-		controlState = UIControlStateSelected;
-	}
-	else if ([keyPath hasPrefix:DISABLED_STATE_PREFIX])
-	{
-		cleanKeyPath = [keyPath substringFromIndex:DISABLED_STATE_PREFIX.length];
-		controlState = UIControlStateDisabled;
-	}
-	else if ([keyPath hasPrefix:HIGHLIGHTED_STATE_PREFIX])
-	{
-		cleanKeyPath = [keyPath substringFromIndex:HIGHLIGHTED_STATE_PREFIX.length];
-		controlState = UIControlStateHighlighted;
-	}
+	NSString* cleanKeyPath = [self themeKeyPath:keyPath controlState:&controlState];
 
 	if ([cleanKeyPath isEqualToString:@"titleColor"])
 	{
@@ -45,11 +32,16 @@
 	}
 	else if ([cleanKeyPath isEqualToString:@"image"])
 	{
-		[self setImage:[UIImage imageNamed:value] forState:controlState];
+		[self setImage:[[SDThemeImageCache sharedCache] imageNamed:value] forState:controlState];
 	}
     else if ([cleanKeyPath isEqualToString:@"backgroundImageWithColor"])
     {
         [self setBackgroundImage:[UIImage imageWithColor:value] forState:controlState];
+    }
+    else if ([cleanKeyPath isEqualToString:@"backgroundImage"])
+    {
+        // an image generated by the background convention, or the name of an image
+        [self setBackgroundImage:([value isKindOfClass:[NSString class]] ? [[SDThemeImageCache sharedCache] imageNamed:value] : value) forState:controlState];
     }
 	else
 	{
@@ -57,4 +49,62 @@
 	}
 }
 
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath
+{
+    UIControlState controlState = UIControlStateNormal;
+    NSString* cleanKeyPath = [self themeKeyPath:keyPath controlState:&controlState];
+    if ([cleanKeyPath isEqualToString:@"titleColor"] || [cleanKeyPath isEqualToString:@"image"] || [cleanKeyPath isEqualToString:@"backgroundImageWithColor"] || [cleanKeyPath isEqualToString:@"backgroundImage"])
+    {
+        // the per state values overridden along the superstyle chain are set only once, together
+        return [NSString stringWithFormat:@"%@%lu", STATE_BATCH_PREFIX, (unsigned long)controlState];
+    }
+    return [super themeBatchIdentifierForKeyPath:keyPath];
+}
+
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier
+{
+    if (![batchIdentifier hasPrefix:STATE_BATCH_PREFIX])
+    {
+        [super applyThemeValues:values forBatch:batchIdentifier];
+        return;
+    }
+    
+    [UIView performWithoutAnimation:^{
+        [values enumerateKeysAndObjectsUsingBlock:^(NSString* keyPath, id value, BOOL* stop) {
+            [self applyThemeValue:(value == [NSNull null] ? nil : value) forKeyPath:keyPath];
+        }];
+    }];
+}
+
+/**
+ * Removes the state prefix from the keyPath.
+ *
+ * @param keyPath the keyPath, possibly starting with a state prefix
+ * @param controlState set to the state indicated by the prefix
+ *
+ * @return the keyPath without the state prefix
+ */
+- (NSString*) themeKeyPath:(NSString*)keyPath controlState:(UIControlState*)controlState
+{
+	NSString* cleanKeyPath = keyPath;
+	*controlState = UIControlStateNormal;
+
+	if ([keyPath hasPrefix:SELECTED_STATE_PREFIX])
+	{
+		cleanKeyPath = [keyPath substringFromIndex:SELECTED_STATE_PREFIX.length];
+		*controlState = UIControlStateSelected;
+	}
+	else if ([keyPath hasPrefix:DISABLED_STATE_PREFIX])
+	{
+		cleanKeyPath = [keyPath substringFromIndex:DISABLED_STATE_PREFIX.length];
+		*controlState = UIControlStateDisabled;
+	}
+	else if ([keyPath hasPrefix:HIGHLIGHTED_STATE_PREFIX])
+	{
+		cleanKeyPath = [keyPath substringFromIndex:HIGHLIGHTED_STATE_PREFIX.length];
+		*controlState = UIControlStateHighlighted;
+	}
+    return cleanKeyPath;
+}
+
 @end
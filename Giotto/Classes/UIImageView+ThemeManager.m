@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #import "UIImageView+ThemeManager.h"
+#import "SDThemeImageCache.h"
 #import "NSObject+ThemeManager.h"
 
 @implementation UIImageView (ThemeManager)
@@ -27,7 +28,7 @@
         }
         else
         {
-            self.image = [UIImage imageNamed:value];
+            self.image = [[SDThemeImageCache sharedCache] imageNamed:value];
         }
     }
     else
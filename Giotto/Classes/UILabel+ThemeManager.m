@@ -0,0 +1,77 @@
+// Copyright 2017 Sysdata S.p.A.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "UILabel+ThemeManager.h"
+#import "NSObject+ThemeManager.h"
+#import "SDThemeTextAttributes.h"
+
+#define TEXT_ATTRIBUTES_BATCH @"textAttributes"
+
+@implementation UILabel (ThemeManager)
+
+- (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
+{
+    if ([SDThemeTextAttributes isTextKey:keyPath])
+    {
+        if (value)
+        {
+            [self applyThemeValues:@{ keyPath: value } forBatch:TEXT_ATTRIBUTES_BATCH];
+        }
+    }
+    else
+    {
+        [super applyThemeValue:value forKeyPath:keyPath];
+    }
+}
+
+- (BOOL) shouldSkipRedundantThemeValueForKeyPath:(NSString*)keyPath
+{
+    if ([SDThemeTextAttributes isTextKey:keyPath])
+    {
+        // the attributes are lost when the text changes
+        return NO;
+    }
+    return [super shouldSkipRedundantThemeValueForKeyPath:keyPath];
+}
+
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath
+{
+    if ([SDThemeTextAttributes isTextKey:keyPath])
+    {
+        // kerning and paragraph settings are applied with a single attributed string
+        return TEXT_ATTRIBUTES_BATCH;
+    }
+    return [super themeBatchIdentifierForKeyPath:keyPath];
+}
+
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier
+{
+    if ([batchIdentifier isEqualToString:TEXT_ATTRIBUTES_BATCH])
+    {
+        // batches are committed after the other values of the style: font, color, alignment and line break mode are already the ones of the style
+        NSMutableDictionary<NSString*, id>* textValues = [NSMutableDictionary dictionaryWithDictionary:values];
+        textValues[@"font"] = self.font;
+        textValues[@"textColor"] = self.textColor;
+        textValues[@"textAlignment"] = @(self.textAlignment);
+        textValues[@"lineBreakMode"] = @(self.lineBreakMode);
+        NSDictionary* attributes = [SDThemeTextAttributes attributesWithValues:textValues];
+        self.attributedText = [[NSAttributedString alloc] initWithString:self.text ?: @"" attributes:attributes];
+    }
+    else
+    {
+        [super applyThemeValues:values forBatch:batchIdentifier];
+    }
+}
+
+@end
@@ -15,52 +15,128 @@
 #import "UISegmentedControl+ThemeManager.h"
 #import "NSObject+ThemeManager.h"
 #import "UIImage+Giotto.h"
+#import "SDThemeLogger.h"
+
+#define TITLE_TEXT_ATTRIBUTES_BATCH_PREFIX @"titleTextAttributes:"
 
 @implementation UISegmentedControl (ThemeManager)
 
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
 {
-    NSString* cleanKeyPath = keyPath;
     UIControlState controlState = UIControlStateNormal;
     UIBarMetrics barMetrics = UIBarMetricsDefault;
+    NSString* cleanKeyPath = [self themeKeyPath:keyPath controlState:&controlState];
+    
+    if ([cleanKeyPath isEqualToString:@"backgroundImageWithColor"])
+    {
+        [self setBackgroundImage:[UIImage imageWithColor:value] forState:controlState barMetrics:barMetrics];
+    }
+    else if ([cleanKeyPath isEqualToString:@"backgroundImage"])
+    {
+        [self setBackgroundImage:value forState:controlState barMetrics:barMetrics];
+    }
+    else if ([self themeTextAttributeNameForKeyPath:cleanKeyPath value:value] != nil)
+    {
+        [self applyThemeValues:@{ keyPath: value } forBatch:[self themeBatchIdentifierForKeyPath:keyPath]];
+    }
+    else
+    {
+        [super applyThemeValue:value forKeyPath:keyPath];
+    }
+}
+
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath
+{
+    UIControlState controlState = UIControlStateNormal;
+    NSString* cleanKeyPath = [self themeKeyPath:keyPath controlState:&controlState];
+    if ([cleanKeyPath isEqualToString:@"font"] || [cleanKeyPath isEqualToString:@"titleColor"])
+    {
+        // all the text attributes of a state are set with a single call, that would otherwise replace the ones already set
+        return [NSString stringWithFormat:@"%@%lu", TITLE_TEXT_ATTRIBUTES_BATCH_PREFIX, (unsigned long)controlState];
+    }
+    return [super themeBatchIdentifierForKeyPath:keyPath];
+}
+
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier
+{
+    if (![batchIdentifier hasPrefix:TITLE_TEXT_ATTRIBUTES_BATCH_PREFIX])
+    {
+        [super applyThemeValues:values forBatch:batchIdentifier];
+        return;
+    }
+    
+    UIControlState controlState = (UIControlState)[[batchIdentifier substringFromIndex:TITLE_TEXT_ATTRIBUTES_BATCH_PREFIX.length] integerValue];
+    NSMutableDictionary* attributes = [NSMutableDictionary dictionaryWithDictionary:[self titleTextAttributesForState:controlState] ?: @{}];
+    [values enumerateKeysAndObjectsUsingBlock:^(NSString* keyPath, id value, BOOL* stop) {
+        NSString* cleanKeyPath = [self themeKeyPath:keyPath controlState:NULL];
+        NSString* attributeName = [self themeTextAttributeNameForKeyPath:cleanKeyPath value:value];
+        if (attributeName)
+        {
+            attributes[attributeName] = value;
+        }
+        else
+        {
+            SDLogModuleWarning(kThemeManagerLogModuleName, @"Value %@ not valid for keyPath %@ of UISegmentedControl", value, keyPath);
+        }
+    }];
+    [self setTitleTextAttributes:attributes forState:controlState];
+}
+
+/**
+ * @return the text attribute set by the given keyPath, if the value has the right type.
+ */
+- (NSString*) themeTextAttributeNameForKeyPath:(NSString*)cleanKeyPath value:(id)value
+{
+    if ([cleanKeyPath isEqualToString:@"font"] && [value isKindOfClass:UIFont.class])
+    {
+        return NSFontAttributeName;
+    }
+    if ([cleanKeyPath isEqualToString:@"titleColor"] && [value isKindOfClass:UIColor.class])
+    {
+        return NSForegroundColorAttributeName;
+    }
+    return nil;
+}
+
+/**
+ * Removes the state prefix from the keyPath.
+ *
+ * @param keyPath the keyPath, possibly starting with a state prefix
+ * @param controlState if not NULL, set to the state indicated by the prefix
+ *
+ * @return the keyPath without the state prefix
+ */
+- (NSString*) themeKeyPath:(NSString*)keyPath controlState:(UIControlState*)controlState
+{
+    NSString* cleanKeyPath = keyPath;
+    UIControlState state = UIControlStateNormal;
     
     if ([keyPath hasPrefix:NORMAL_STATE_PREFIX])
     {
         cleanKeyPath = [keyPath substringFromIndex:NORMAL_STATE_PREFIX.length];
-        controlState = UIControlStateNormal;
+        state = UIControlStateNormal;
     }
     else if ([keyPath hasPrefix:SELECTED_STATE_PREFIX])
     {
         cleanKeyPath = [keyPath substringFromIndex:SELECTED_STATE_PREFIX.length];
-        controlState = UIControlStateSelected;
+        state = UIControlStateSelected;
     }
     else if ([keyPath hasPrefix:DISABLED_STATE_PREFIX])
     {
         cleanKeyPath = [keyPath substringFromIndex:DISABLED_STATE_PREFIX.length];
-        controlState = UIControlStateDisabled;
+        state = UIControlStateDisabled;
     }
     else if ([keyPath hasPrefix:HIGHLIGHTED_STATE_PREFIX])
     {
         cleanKeyPath = [keyPath substringFromIndex:HIGHLIGHTED_STATE_PREFIX.length];
-        controlState = UIControlStateHighlighted;
+        state = UIControlStateHighlighted;
     }
     
-    if ([cleanKeyPath isEqualToString:@"backgroundImageWithColor"])
+    if (controlState)
     {
-        [self setBackgroundImage:[UIImage imageWithColor:value] forState:controlState barMetrics:barMetrics];
-    }
-    else if ([cleanKeyPath isEqualToString:@"backgroundImage"])
-    {
-        [self setBackgroundImage:value forState:controlState barMetrics:barMetrics];
-    }
-    else if ([cleanKeyPath isEqualToString:@"font"] && [value isKindOfClass:UIFont.class])
-    {
-        [self setTitleTextAttributes:@{ NSFontAttributeName: value } forState:controlState];
-    }
-    else
-    {
-        [super applyThemeValue:value forKeyPath:keyPath];
+        *controlState = state;
     }
+    return cleanKeyPath;
 }
 
 @end
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #import "UITableView+ThemeManager.h"
+#import "SDThemeEnumRegistry.h"
 
 @implementation UITableView (ThemeManager)
 
@@ -20,12 +21,17 @@
 {
 	if ([keyPath isEqualToString:@"separatorStyle"])
 	{
-		NSString* stringValue = (NSString*)value;
-		if ([stringValue.lowercaseString rangeOfString:@"singlelineetched"].location != NSNotFound)
+		// "enum:UITableViewCellSeparatorStyle.singleLine" is resolved when the theme is loaded, a plain name is looked up in the same table
+		NSNumber* separatorStyle = [value isKindOfClass:[NSNumber class]] ? value : [[SDThemeEnumRegistry sharedRegistry] valueForCase:value ofEnum:@"UITableViewCellSeparatorStyle"];
+		if (separatorStyle)
+		{
+			self.separatorStyle = separatorStyle.integerValue;
+		}
+		else if ([[value lowercaseString] rangeOfString:@"singlelineetched"].location != NSNotFound)
 		{
 			self.separatorStyle = UITableViewCellSeparatorStyleSingleLineEtched;
 		}
-		else if ([stringValue.lowercaseString rangeOfString:@"singleline"].location != NSNotFound)
+		else if ([[value lowercaseString] rangeOfString:@"singleline"].location != NSNotFound)
 		{
 			self.separatorStyle = UITableViewCellSeparatorStyleSingleLine;
 		}
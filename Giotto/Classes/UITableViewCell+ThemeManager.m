@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #import "UITableViewCell+ThemeManager.h"
+#import "SDThemeEnumRegistry.h"
 
 @implementation UITableViewCell (ThemeManager)
 
@@ -20,8 +21,13 @@
 {
 	if ([keyPath isEqualToString:@"selectionStyle"])
 	{
-		NSString* stringValue = (NSString*)value;
-		if ([stringValue.lowercaseString rangeOfString:@"default"].location != NSNotFound)
+		// "enum:UITableViewCellSelectionStyle.default" is resolved when the theme is loaded, a plain name is looked up in the same table
+		NSNumber* selectionStyle = [value isKindOfClass:[NSNumber class]] ? value : [[SDThemeEnumRegistry sharedRegistry] valueForCase:value ofEnum:@"UITableViewCellSelectionStyle"];
+		if (selectionStyle)
+		{
+			self.selectionStyle = selectionStyle.integerValue;
+		}
+		else if ([[value lowercaseString] rangeOfString:@"default"].location != NSNotFound)
 		{
 			self.selectionStyle = UITableViewCellSelectionStyleDefault;
 		}
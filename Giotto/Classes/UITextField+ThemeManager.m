@@ -15,40 +15,17 @@
 #import "UITextField+ThemeManager.h"
 #import "NSObject+ThemeManager.h"
 
+#define PLACEHOLDER_BATCH @"attributedPlaceholder"
+
 @implementation UITextField (ThemeManager)
 
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
 {
-    if ([keyPath isEqualToString:@"placeholderColor"])
-    {
-        if ([self respondsToSelector:@selector(setAttributedPlaceholder:)] && [value isKindOfClass:[UIColor class]])
-        {
-            NSMutableAttributedString* attributedString = [self.attributedPlaceholder mutableCopy];
-            if (attributedString.length == 0 && self.placeholder.length > 0)
-            {
-                attributedString = [[NSMutableAttributedString alloc] initWithString:self.placeholder attributes:@{ NSForegroundColorAttributeName: value }];
-            }
-            else
-            {
-                [attributedString addAttribute:NSForegroundColorAttributeName value:value range:NSMakeRange(0, attributedString.length)];
-            }
-            self.attributedPlaceholder = attributedString;
-        }
-    }
-    else if ([keyPath isEqualToString:@"placeholderFont"])
+    if ([keyPath isEqualToString:@"placeholderColor"] || [keyPath isEqualToString:@"placeholderFont"])
     {
-        if ([self respondsToSelector:@selector(setAttributedPlaceholder:)] && [value isKindOfClass:[UIFont class]])
+        if (value)
         {
-            NSMutableAttributedString* attributedString = [self.attributedPlaceholder mutableCopy];
-            if (attributedString.length == 0 && self.placeholder.length > 0)
-            {
-                attributedString = [[NSMutableAttributedString alloc] initWithString:self.placeholder attributes:@{ NSFontAttributeName: value }];
-            }
-            else
-            {
-                [attributedString addAttribute:NSFontAttributeName value:value range:NSMakeRange(0, attributedString.length)];
-            }
-            self.attributedPlaceholder = attributedString;
+            [self applyThemeValues:@{ keyPath: value } forBatch:PLACEHOLDER_BATCH];
         }
     }
     else if ([keyPath isEqualToString:@"leftMargin"])
@@ -65,4 +42,64 @@
     }
 }
 
+- (BOOL) shouldSkipRedundantThemeValueForKeyPath:(NSString*)keyPath
+{
+    if ([keyPath isEqualToString:@"placeholderColor"] || [keyPath isEqualToString:@"placeholderFont"])
+    {
+        // the attributes are lost when the placeholder text changes
+        return NO;
+    }
+    return [super shouldSkipRedundantThemeValueForKeyPath:keyPath];
+}
+
+- (NSString*) themeBatchIdentifierForKeyPath:(NSString*)keyPath
+{
+    if ([keyPath isEqualToString:@"placeholderColor"] || [keyPath isEqualToString:@"placeholderFont"])
+    {
+        // color and font of the placeholder are applied with a single attributed string
+        return PLACEHOLDER_BATCH;
+    }
+    return [super themeBatchIdentifierForKeyPath:keyPath];
+}
+
+- (void) applyThemeValues:(NSDictionary<NSString*, id>*)values forBatch:(NSString*)batchIdentifier
+{
+    if ([batchIdentifier isEqualToString:PLACEHOLDER_BATCH])
+    {
+        NSMutableDictionary* attributes = [NSMutableDictionary new];
+        if ([values[@"placeholderColor"] isKindOfClass:[UIColor class]])
+        {
+            attributes[NSForegroundColorAttributeName] = values[@"placeholderColor"];
+        }
+        if ([values[@"placeholderFont"] isKindOfClass:[UIFont class]])
+        {
+            attributes[NSFontAttributeName] = values[@"placeholderFont"];
+        }
+        [self applyPlaceholderAttributes:attributes];
+    }
+    else
+    {
+        [super applyThemeValues:values forBatch:batchIdentifier];
+    }
+}
+
+- (void) applyPlaceholderAttributes:(NSDictionary*)attributes
+{
+    if (attributes.count == 0 || ![self respondsToSelector:@selector(setAttributedPlaceholder:)])
+    {
+        return;
+    }
+    
+    NSMutableAttributedString* attributedString = [self.attributedPlaceholder mutableCopy];
+    if (attributedString.length == 0 && self.placeholder.length > 0)
+    {
+        attributedString = [[NSMutableAttributedString alloc] initWithString:self.placeholder attributes:attributes];
+    }
+    else
+    {
+        [attributedString addAttributes:attributes range:NSMakeRange(0, attributedString.length)];
+    }
+    self.attributedPlaceholder = attributedString;
+}
+
 @end
@@ -16,4 +16,14 @@
 
 @interface UIView (ThemeManager)
 
+/**
+ * Style classes of the view, separated by spaces, matched by the ".<style class>" selectors of the theme rules (eg. "title primary").
+ */
+@property (nonatomic, copy) NSString* themeStyleClass;
+
+/**
+ * The style classes of themeStyleClass, split once when it is set.
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString*>* themeStyleClasses;
+
 @end
@@ -8,9 +8,37 @@
 
 #import "UIView+ThemeManager.h"
 #import "NSObject+ThemeManager.h"
+#import <objc/runtime.h>
+
+static char SDThemeStyleClassKey;
+static char SDThemeStyleClassesKey;
 
 @implementation UIView (ThemeManager)
 
+- (NSString*) themeStyleClass
+{
+    return objc_getAssociatedObject(self, &SDThemeStyleClassKey);
+}
+
+- (void) setThemeStyleClass:(NSString*)themeStyleClass
+{
+    NSMutableArray<NSString*>* styleClasses = [NSMutableArray new];
+    for (NSString* styleClass in [themeStyleClass componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]])
+    {
+        if (styleClass.length > 0)
+        {
+            [styleClasses addObject:styleClass];
+        }
+    }
+    objc_setAssociatedObject(self, &SDThemeStyleClassKey, themeStyleClass, OBJC_ASSOCIATION_COPY_NONATOMIC);
+    objc_setAssociatedObject(self, &SDThemeStyleClassesKey, styleClasses.count > 0 ? [styleClasses copy] : nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (NSArray<NSString*>*) themeStyleClasses
+{
+    return objc_getAssociatedObject(self, &SDThemeStyleClassesKey);
+}
+
 - (void) applyThemeValue:(id)value forKeyPath:(NSString*)keyPath
 {
     [super applyThemeValue:value forKeyPath:keyPath];
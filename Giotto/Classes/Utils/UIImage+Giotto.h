@@ -22,6 +22,19 @@
 
 + (UIImage*) imageWithColor:(UIColor*)color;
 
+/**
+ * Returns a stretchable image of a rounded rect, the smallest that can be stretched to any size through its cap insets.
+ *
+ * @param fillColor the color of the rect, or nil
+ * @param cornerRadius the radius of the corners
+ * @param borderWidth the width of the border, drawn inside the rect
+ * @param borderColor the color of the border, or nil
+ * @param tintColor a color drawn over the fill (eg. to darken the highlighted state), or nil
+ *
+ * @discussion The images are rendered at the scale of the main screen and cached by their parameters, so the same image is shared by all the controls and states that describe the same background.
+ */
++ (UIImage*) resizableImageWithFillColor:(UIColor*)fillColor cornerRadius:(CGFloat)cornerRadius borderWidth:(CGFloat)borderWidth borderColor:(UIColor*)borderColor tintColor:(UIColor*)tintColor;
+
 - (UIImage*) coloredImageWithColor:(UIColor*)color;
 
 @end
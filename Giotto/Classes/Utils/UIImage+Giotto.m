@@ -76,6 +76,81 @@
     return image;
 }
 
+/**
+ * Describes a color in the key of a cached image.
+ */
+static NSString* SDThemeImageColorKey(UIColor* color)
+{
+    CGFloat red = 0.0, green = 0.0, blue = 0.0, alpha = 0.0;
+    if (!color)
+    {
+        return @"-";
+    }
+    if (![color getRed:&red green:&green blue:&blue alpha:&alpha])
+    {
+        // colors outside the RGB space (eg. patterns) are compared by identity
+        return [NSString stringWithFormat:@"%p", color];
+    }
+    return [NSString stringWithFormat:@"%.4f,%.4f,%.4f,%.4f", red, green, blue, alpha];
+}
+
++ (UIImage*) resizableImageWithFillColor:(UIColor*)fillColor cornerRadius:(CGFloat)cornerRadius borderWidth:(CGFloat)borderWidth borderColor:(UIColor*)borderColor tintColor:(UIColor*)tintColor
+{
+    static NSCache<NSString*, UIImage*>* cache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [NSCache new];
+        cache.name = @"com.sysdata.giotto.resizableImages";
+    });
+    
+    cornerRadius = MAX(cornerRadius, 0.0);
+    borderWidth = borderColor ? MAX(borderWidth, 0.0) : 0.0;
+    CGFloat scale = [UIScreen mainScreen].scale;
+    
+    NSString* key = [NSString stringWithFormat:@"%@|%.2f|%.2f|%@|%@|%.1f", SDThemeImageColorKey(fillColor), cornerRadius, borderWidth, SDThemeImageColorKey(borderColor), SDThemeImageColorKey(tintColor), scale];
+    UIImage* image = [cache objectForKey:key];
+    if (image)
+    {
+        return image;
+    }
+    
+    // the corners are the caps, the single point between them is stretched
+    CGFloat cap = ceil(MAX(cornerRadius, borderWidth));
+    CGRect rect = CGRectMake(0.0, 0.0, cap * 2.0 + 1.0, cap * 2.0 + 1.0);
+    
+    UIGraphicsBeginImageContextWithOptions(rect.size, NO, scale);
+    
+    // the border is stroked inside the rect
+    CGRect pathRect = CGRectInset(rect, borderWidth / 2.0, borderWidth / 2.0);
+    UIBezierPath* path = [UIBezierPath bezierPathWithRoundedRect:pathRect cornerRadius:MAX(cornerRadius - borderWidth / 2.0, 0.0)];
+    if (fillColor)
+    {
+        [fillColor setFill];
+        [path fill];
+    }
+    if (tintColor)
+    {
+        [tintColor setFill];
+        [path fill];
+    }
+    if (borderWidth > 0.0)
+    {
+        [borderColor setStroke];
+        path.lineWidth = borderWidth;
+        [path stroke];
+    }
+    
+    image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+    
+    image = [image resizableImageWithCapInsets:UIEdgeInsetsMake(cap, cap, cap, cap) resizingMode:UIImageResizingModeStretch];
+    if (image)
+    {
+        [cache setObject:image forKey:key];
+    }
+    return image;
+}
+
 - (UIImage*) coloredImageWithColor:(UIColor*)color
 {
     UIGraphicsBeginImageContextWithOptions(self.size, NO, [[UIScreen mainScreen] scale]);
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+# Copyright 2017 Sysdata S.p.A.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generates a header of typed handles for the constants and the styles of a theme plist.
+
+Usage:
+    generate_theme_handles.py theme_default.plist -o ThemeHandles.h [--prefix Theme]
+
+For a constant COLOR_BRAND and a style NavBarStyle the header declares:
+
+    ThemeConstant_COLOR_BRAND    (SDThemeConstantHandle)
+    ThemeStyle_NavBarStyle       (SDThemeStyleHandle)
+    ThemeRegisterHandles(manager)
+
+Call ThemeRegisterHandles([SDThemeManager sharedManager]) once at startup, then use the handle based
+methods of SDThemeManager (colorForConstantHandle:, floatForConstantHandle:, applyStyleWithHandle:toObject:...).
+Add the script to a build phase so that a renamed or removed key becomes a compile error.
+"""
+
+import argparse
+import os
+import plistlib
+import re
+import sys
+
+FORMAT_VERSION_KEY = "formatVersion"
+CONSTANTS_KEY = "Constants"
+
+
+def load_names(path):
+    with open(path, "rb") as f:
+        theme = plistlib.load(f)
+    if not isinstance(theme, dict):
+        raise ValueError("%s is not a dictionary" % path)
+
+    # themes before version 2 only contain constants
+    if int(theme.get(FORMAT_VERSION_KEY, 0)) < 2:
+        return sorted(k for k in theme.keys() if k != FORMAT_VERSION_KEY), []
+
+    constants = theme.get(CONSTANTS_KEY, {})
+    styles = set()
+    # as the theme manager, all the dictionaries other than Constants are groups of styles
+    for key, group in theme.items():
+        if key in (FORMAT_VERSION_KEY, CONSTANTS_KEY) or not isinstance(group, dict):
+            continue
+        styles.update(group.keys())
+    return sorted(constants.keys()), sorted(styles)
+
+
+def identifiers(prefix, names):
+    result = []
+    used = set()
+    for name in names:
+        identifier = prefix + re.sub(r"[^A-Za-z0-9_]", "_", name)
+        candidate = identifier
+        suffix = 2
+        while candidate in used:
+            candidate = "%s_%d" % (identifier, suffix)
+            suffix += 1
+        used.add(candidate)
+        result.append(candidate)
+    return result
+
+
+def objc_string(name):
+    return '@"%s"' % name.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def generate(source, constants, styles, prefix):
+    lines = [
+        "// Generated by generate_theme_handles.py from %s. Do not edit." % os.path.basename(source),
+        "",
+        "#import \"SDThemeManager.h\"",
+        "",
+    ]
+
+    def table(name, values):
+        lines.append("static NSString* const %s[] = {" % name)
+        for value in values:
+            lines.append("    %s," % objc_string(value))
+        if not values:
+            lines.append("    nil,")
+        lines.append("};")
+        lines.append("")
+
+    table("%sConstantHandleNames" % prefix, constants)
+    table("%sStyleHandleNames" % prefix, styles)
+
+    for index, identifier in enumerate(identifiers(prefix + "Constant_", constants)):
+        lines.append("static const SDThemeConstantHandle %s = { %d };" % (identifier, index))
+    lines.append("")
+    for index, identifier in enumerate(identifiers(prefix + "Style_", styles)):
+        lines.append("static const SDThemeStyleHandle %s = { %d };" % (identifier, index))
+    lines.append("")
+
+    lines.append("static inline void %sRegisterHandles(SDThemeManager* manager)" % prefix)
+    lines.append("{")
+    lines.append("    [manager registerConstantHandleNames:%sConstantHandleNames count:%d styleHandleNames:%sStyleHandleNames count:%d];"
+                 % (prefix, len(constants), prefix, len(styles)))
+    lines.append("}")
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generates typed handles for the constants and the styles of a theme plist.")
+    parser.add_argument("plist", help="path of the theme plist, usually theme_default.plist")
+    parser.add_argument("-o", "--output", help="path of the generated header (default: standard output)")
+    parser.add_argument("--prefix", default="Theme", help="prefix of the generated identifiers (default: Theme)")
+    args = parser.parse_args()
+
+    constants, styles = load_names(args.plist)
+    header = generate(args.plist, constants, styles, args.prefix)
+
+    if args.output:
+        # rewrite only if changed, to avoid rebuilding the files that import the header
+        if os.path.exists(args.output):
+            with open(args.output) as f:
+                if f.read() == header:
+                    return 0
+        with open(args.output, "w") as f:
+            f.write(header)
+    else:
+        sys.stdout.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,263 @@
+#!/usr/bin/env python3
+# Copyright 2017 Sysdata S.p.A.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Removes from a theme plist the styles and the constants that cannot be reached by the app.
+
+Usage:
+    strip_theme.py theme_default.plist -o Stripped/theme_default.plist --sources MyApp [--sources MyKit]
+                   [--usage-log usage.json] [--alternative theme_dark.plist] [--keep 'Promo.*']
+                   [--exclude '*/ThemeHandles.h'] [--report report.json]
+
+The reachable names start from:
+    - the names of styles and constants found as words in the sources (.m, .mm, .h, .swift, .xib, .storyboard)
+    - the names recorded at runtime by SDThemeManager.usageLog (SDThemeUsageLog writeToFile:error:)
+    - the styles of the Rules
+    - the names matching a --keep regular expression (eg. styles whose name is built at runtime)
+and follow the references of the reachable values: _superstyle, _inherit, s: composites, grafted styles,
+constants used by styles, by conventions and by derived constants, and the variants declaring the style in _variantOf.
+The values of the --alternative themes are followed too, since they override the stripped one.
+
+Exclude the header generated by generate_theme_handles.py: it names every style and constant.
+A name is kept if it appears as a word anywhere in a reachable value, as the dependency index of the manager
+does, so the result errs on keeping too much. Check the report before shipping the stripped theme.
+"""
+
+import argparse
+import fnmatch
+import json
+import os
+import plistlib
+import re
+import sys
+import time
+
+FORMAT_VERSION_KEY = "formatVersion"
+CONSTANTS_KEY = "Constants"
+RULES_KEY = "Rules"
+
+SOURCE_EXTENSIONS = (".m", ".mm", ".h", ".swift", ".xib", ".storyboard")
+
+WORD = re.compile(r"[A-Za-z0-9_]+")
+# key of a variant style naming its base style, eg. "Card_DARK": {"_variantOf": "Card", ...}
+VARIANT_OF_KEY = "_variantOf"
+
+PARSE_REPETITIONS = 20
+
+
+class Theme(object):
+
+    def __init__(self, path):
+        self.path = path
+        with open(path, "rb") as f:
+            self.data = f.read()
+        self.plist = plistlib.loads(self.data)
+        if not isinstance(self.plist, dict):
+            raise ValueError("%s is not a dictionary" % path)
+
+        self.format_version = int(self.plist.get(FORMAT_VERSION_KEY, 0))
+        if self.format_version < 2:
+            # themes before version 2 only contain constants
+            self.constants = {k: v for k, v in self.plist.items() if k != FORMAT_VERSION_KEY}
+            self.styles = {}
+            self.rules = {}
+            return
+
+        self.constants = self.plist.get(CONSTANTS_KEY, {})
+        self.rules = self.plist.get(RULES_KEY, {})
+        self.styles = {}
+        # as the theme manager, all the dictionaries other than Constants and Rules are groups of styles
+        for key, group in self.plist.items():
+            if key in (FORMAT_VERSION_KEY, CONSTANTS_KEY, RULES_KEY) or not isinstance(group, dict):
+                continue
+            self.styles.update(group)
+
+
+def words_of_value(value, words):
+    if isinstance(value, str):
+        words.update(WORD.findall(value))
+    elif isinstance(value, dict):
+        for subvalue in value.values():
+            words_of_value(subvalue, words)
+    elif isinstance(value, list):
+        for subvalue in value:
+            words_of_value(subvalue, words)
+    return words
+
+
+def words_of_sources(directories, excludes):
+    words = set()
+    for directory in directories:
+        for root, _, files in os.walk(directory):
+            for name in files:
+                path = os.path.join(root, name)
+                if not name.endswith(SOURCE_EXTENSIONS) or any(fnmatch.fnmatch(path, e) for e in excludes):
+                    continue
+                with open(path, encoding="utf-8", errors="ignore") as f:
+                    words.update(WORD.findall(f.read()))
+    return words
+
+
+def names_of_usage_logs(paths):
+    styles, constants = set(), set()
+    for path in paths:
+        with open(path) as f:
+            log = json.load(f)
+        styles.update(log.get("styles", []))
+        constants.update(log.get("constants", []))
+    return styles, constants
+
+
+def reachable_names(themes, seed_styles, seed_constants):
+    """
+    Follows the references from the seeds through the values of all the themes.
+    """
+    all_styles = set().union(*(t.styles.keys() for t in themes))
+    all_constants = set().union(*(t.constants.keys() for t in themes))
+
+    # variants by base style
+    variants = {}
+    for theme in themes:
+        for name, style in theme.styles.items():
+            base = style.get(VARIANT_OF_KEY) if isinstance(style, dict) else None
+            if isinstance(base, str):
+                variants.setdefault(base, set()).add(name)
+
+    styles, constants = set(), set()
+    queue = [("style", n) for n in seed_styles & all_styles] + [("constant", n) for n in seed_constants & all_constants]
+    while queue:
+        kind, name = queue.pop()
+        reached = styles if kind == "style" else constants
+        if name in reached:
+            continue
+        reached.add(name)
+
+        words = set()
+        for theme in themes:
+            # _superstyle, _inherit and s: are values of the style, so they are words too
+            words_of_value((theme.styles if kind == "style" else theme.constants).get(name), words)
+        if kind == "style":
+            words.update(variants.get(name, ()))
+        queue.extend(("style", w) for w in words & all_styles if w not in styles)
+        queue.extend(("constant", w) for w in words & all_constants if w not in constants)
+    return styles, constants
+
+
+def stripped_plist(theme, styles, constants):
+    if theme.format_version < 2:
+        return {k: v for k, v in theme.plist.items() if k == FORMAT_VERSION_KEY or k in constants}
+
+    plist = {}
+    for key, value in theme.plist.items():
+        if key == CONSTANTS_KEY:
+            plist[key] = {k: v for k, v in value.items() if k in constants}
+        elif key in (FORMAT_VERSION_KEY, RULES_KEY) or not isinstance(value, dict):
+            plist[key] = value
+        else:
+            group = {k: v for k, v in value.items() if k in styles}
+            if group:
+                plist[key] = group
+    return plist
+
+
+def parse_time(data):
+    # median of a few loads of the binary form, the one copied in the bundle
+    binary = plistlib.dumps(plistlib.loads(data), fmt=plistlib.FMT_BINARY)
+    samples = []
+    for _ in range(PARSE_REPETITIONS):
+        start = time.perf_counter()
+        plistlib.loads(binary)
+        samples.append(time.perf_counter() - start)
+    samples.sort()
+    return samples[len(samples) // 2], len(binary)
+
+
+def object_size(value):
+    # size of the parsed object graph, a proxy of the memory taken by the theme in the app
+    size = sys.getsizeof(value)
+    if isinstance(value, dict):
+        size += sum(object_size(k) + object_size(v) for k, v in value.items())
+    elif isinstance(value, list):
+        size += sum(object_size(v) for v in value)
+    return size
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Removes the styles and the constants that the app cannot reach from a theme plist.")
+    parser.add_argument("plist", help="path of the theme plist to strip, usually theme_default.plist")
+    parser.add_argument("-o", "--output", required=True, help="path of the stripped plist")
+    parser.add_argument("--sources", action="append", default=[], help="directory of sources referencing styles and constants (repeatable)")
+    parser.add_argument("--exclude", action="append", default=[], help="glob of source paths to ignore, eg. the generated handles header (repeatable)")
+    parser.add_argument("--usage-log", action="append", default=[], help="JSON written by SDThemeUsageLog (repeatable)")
+    parser.add_argument("--alternative", action="append", default=[], help="alternative theme plist whose references are followed too (repeatable)")
+    parser.add_argument("--keep", action="append", default=[], help="regular expression of names to keep (repeatable)")
+    parser.add_argument("--format", choices=("xml", "binary"), default="xml", help="format of the stripped plist (default: xml)")
+    parser.add_argument("--report", help="path of the JSON report (default: summary on standard output)")
+    args = parser.parse_args()
+
+    theme = Theme(args.plist)
+    themes = [theme] + [Theme(path) for path in args.alternative]
+
+    seeds = words_of_sources(args.sources, args.exclude)
+    log_styles, log_constants = names_of_usage_logs(args.usage_log)
+    seed_styles = seeds | log_styles
+    seed_constants = seeds | log_constants
+    for t in themes:
+        for value in t.rules.values():
+            words_of_value(value, seed_styles)
+    if args.keep:
+        keep = re.compile("|".join("(?:%s)" % k for k in args.keep))
+        for t in themes:
+            seed_styles.update(n for n in t.styles if keep.fullmatch(n))
+            seed_constants.update(n for n in t.constants if keep.fullmatch(n))
+
+    styles, constants = reachable_names(themes, seed_styles, seed_constants)
+    plist = stripped_plist(theme, styles, constants)
+
+    output = plistlib.dumps(plist, fmt=plistlib.FMT_BINARY if args.format == "binary" else plistlib.FMT_XML, sort_keys=True)
+    directory = os.path.dirname(args.output)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    with open(args.output, "wb") as f:
+        f.write(output)
+
+    time_before, binary_before = parse_time(theme.data)
+    time_after, binary_after = parse_time(output)
+    removed_styles = sorted(set(theme.styles) - styles)
+    removed_constants = sorted(set(theme.constants) - constants)
+    report = {
+        "theme": args.plist,
+        "styles": {"total": len(theme.styles), "removed": len(removed_styles)},
+        "constants": {"total": len(theme.constants), "removed": len(removed_constants)},
+        "binary_size": {"before": binary_before, "after": binary_after},
+        "parse_time_ms": {"before": round(time_before * 1000, 3), "after": round(time_after * 1000, 3)},
+        "object_size": {"before": object_size(theme.plist), "after": object_size(plist)},
+        "removed_styles": removed_styles,
+        "removed_constants": removed_constants,
+    }
+
+    if args.report:
+        with open(args.report, "w") as f:
+            json.dump(report, f, indent=2)
+    sys.stdout.write("Removed %d of %d styles and %d of %d constants\n"
+                     % (len(removed_styles), len(theme.styles), len(removed_constants), len(theme.constants)))
+    sys.stdout.write("Binary plist: %d -> %d bytes, parse time: %.3f -> %.3f ms, parsed objects: %d -> %d bytes\n"
+                     % (binary_before, binary_after, time_before * 1000, time_after * 1000,
+                        report["object_size"]["before"], report["object_size"]["after"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())